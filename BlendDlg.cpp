@@ -2,6 +2,7 @@
 
 #include "stdafx.h"
 #include "BlendDlg.h"
+#include "PerfTrace.h"
 #include "afxdialogex.h"
 
 IMPLEMENT_DYNAMIC(BlendDlg, CDialogEx)
@@ -54,7 +55,7 @@ BOOL BlendDlg::OnInitDialog()
 
 void BlendDlg::OnOK()
 {
-	auto t0 = std::chrono::system_clock::now();
+	PerfTraceSpan span("ui", "BlendDlg::OnOK", true);
 	
 	m_pCmdOp->Unhighlight();
 
@@ -138,10 +139,7 @@ void BlendDlg::OnOK()
 	view->GetCanvas().Update();
 
 	// Show process time
-	auto t1 = std::chrono::system_clock::now();
-
-	auto dur1 = t1 - t0;
-	auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+	int msec1 = (int)span.ElapsedMsec();
 
 	wchar_t wcsbuf[256];
 	swprintf(wcsbuf, sizeof(wcsbuf), L"Process time: %d msec", msec1);
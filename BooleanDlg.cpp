@@ -3,7 +3,9 @@
 
 #include "stdafx.h"
 #include "BooleanDlg.h"
+#include "PerfTrace.h"
 #include "afxdialogex.h"
+#include <algorithm>
 
 #define COLOR_ACTIVE RGB(255, 128, 128)
 #define COLOR_INACTIVE RGB(255, 255, 255)
@@ -57,59 +59,75 @@ BOOL BooleanDlg::OnInitDialog()
 
 void BooleanDlg::OnOK()
 {
-	auto t0 = std::chrono::system_clock::now();
+	PerfTraceSpan span("ui", "BooleanDlg::OnOK", true);
 
 	m_pCmdOp->Unhighlight();
 
 	UpdateData(true);
 
-	HPS::Component targetComp = m_pCmdOp->GetTargetComponent();
+	HPS::ComponentArray targetCompArr = m_pCmdOp->GetTargetComponents();
 	HPS::ComponentArray toolCompArr = m_pCmdOp->GetToolComponents();
 
-	if (HPS::Type::None != targetComp.Type() && 0 < toolCompArr.size())
+	if (0 < targetCompArr.size() && 0 < toolCompArr.size())
 	{
-		HPS::Component::DeleteMode deleteMode = HPS::Component::DeleteMode::Standard;
-
+		// Every target gets all the tools, the sets run in one kernel mark
 #ifdef USING_EXCHANGE_PARASOLID
-		PK_BODY_t targetBody = ((HPS::Parasolid::Component)targetComp).GetParasolidEntity();
 		std::vector<PK_BODY_t> toolBodyArr;
 		for (int i = 0; i < toolCompArr.size(); i++)
 		{
 			toolBodyArr.push_back(((HPS::Parasolid::Component)toolCompArr[i]).GetParasolidEntity());
 		}
 
-		int resBodyCnt = 0;
-		PK_BODY_t* resBodies;
-		if (!m_pProcess->Boolean((PsBoolType)m_iTBoolType, targetBody, toolBodyArr.size(), toolBodyArr.data(), resBodyCnt, resBodies))
+		std::vector<PsBoolSet> setArr(targetCompArr.size());
+		for (int i = 0; i < targetCompArr.size(); i++)
+		{
+			setArr[i].targetBody = ((HPS::Parasolid::Component)targetCompArr[i]).GetParasolidEntity();
+			setArr[i].toolBodies = toolBodyArr;
+		}
+
+		std::vector<PsBoolSetResult> resultArr;
+		PsJournalStep step;
+		if (!m_pProcess->BooleanBatch((PsBoolType)m_iTBoolType, setArr, resultArr, step))
 			return;
 
-		for (int i = 0; i < resBodyCnt; i++)
+		for (int i = 0; i < targetCompArr.size(); i++)
 		{
-			PK_BODY_t resBody = resBodies[i];
-			if (resBody == targetBody)
-			{
-				// Tessellate
-				((HPS::Parasolid::Component)targetComp).Tessellate(
-					HPS::Parasolid::FacetTessellationKit::GetDefault(),
-					HPS::Parasolid::LineTessellationKit::GetDefault());
-
-				// Register target body as updated model
-				HPS::Exchange::Component ownerComp = view->GetOwnerBrepModel(targetComp);
-				A3DRiBrepModel* pRiBrepModel = ownerComp.GetExchangeEntity();
-				m_pProcess->RegisterUpdatedBody(pRiBrepModel, targetBody);
-
-				// Update Ps component map
-				view->InitPsBodyMap((int)targetBody, targetComp);
-			}
-			else
+			if (!resultArr[i].bSucceeded)
+				continue;
+
+			PK_BODY_t targetBody = setArr[i].targetBody;
+			for (size_t j = 0; j < resultArr[i].bodies.size(); j++)
 			{
-				// Add new body
-				view->AddBody(resBody);
+				PK_BODY_t resBody = resultArr[i].bodies[j];
+				if (resBody == targetBody)
+				{
+					// Tessellate
+					((HPS::Parasolid::Component)targetCompArr[i]).Tessellate(
+						HPS::Parasolid::FacetTessellationKit::GetDefault(),
+						HPS::Parasolid::LineTessellationKit::GetDefault());
+
+					// Register target body as updated model
+					HPS::Exchange::Component ownerComp = view->GetOwnerBrepModel(targetCompArr[i]);
+					A3DRiBrepModel* pRiBrepModel = ownerComp.GetExchangeEntity();
+					m_pProcess->RegisterUpdatedBody(pRiBrepModel, targetBody);
+
+					// Update Ps component map
+					view->InitPsBodyMap((int)targetBody, targetCompArr[i]);
+				}
+				else
+				{
+					// Add new body
+					view->AddBody(resBody);
+				}
 			}
 		}
 
-		for (int i = 0; i < toolBodyArr.size(); i++)
+		// The tools of the failed sets only are kept
+		for (int i = 0; i < toolCompArr.size(); i++)
 		{
+			if (step.deletedBodies.end() == std::find(step.deletedBodies.begin(), step.deletedBodies.end(), toolBodyArr[i]))
+				continue;
+
 			// Delete toolbody from map
 			view->DeletePsBodyMap(toolBodyArr[i]);
 
@@ -117,38 +135,38 @@ void BooleanDlg::OnOK()
 			HPS::Exchange::Component ownerComp = view->GetOwnerBrepModel(toolCompArr[i]);
 			A3DRiBrepModel* pRiBrepModel = ownerComp.GetExchangeEntity();
 			m_pProcess->RegisterDeleteBody(pRiBrepModel);
-		}
-
-#else
-		A3DRiBrepModel* pTargetBrep = ((HPS::Exchange::Component)targetComp).GetExchangeEntity();
-		std::vector< A3DRiBrepModel*> pToolBrepArr;
-		for (int i = 0; i < toolCompArr.size(); i++)
-			pToolBrepArr.push_back(((HPS::Exchange::Component)toolCompArr[i]).GetExchangeEntity());
 
-		if (!m_pProcess->Boolean((PsBoolType)m_iTBoolType, pTargetBrep, pToolBrepArr.size(), pToolBrepArr.data()))
-			return;
-
-		// Reload target component
-		HPS::Exchange::ReloadNotifier notifier = ((HPS::Exchange::Component)targetComp).Reload();
-		notifier.Wait();
-
-		deleteMode = HPS::Component::DeleteMode::StandardAndExchange;
-#endif
-		// Delete tool comonent
-		for (int i = 0; i < toolCompArr.size(); i++)
-			toolCompArr[i].Delete(deleteMode);
+			// Delete tool comonent
+			toolCompArr[i].Delete(HPS::Component::DeleteMode::Standard);
+		}
 
 		view->GetCanvas().Update();
 
 		// Show process time
-		auto t1 = std::chrono::system_clock::now();
-
-		auto dur1 = t1 - t0;
-		auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+		int msec1 = (int)span.ElapsedMsec();
 
 		wchar_t wcsbuf[256];
 		swprintf(wcsbuf, sizeof(wcsbuf), L"Process time: %d msec", msec1);
 		view->ShowMessage(wcsbuf);
+#else
+		std::vector<A3DRiBrepModel*> toolBrepArr;
+		for (int i = 0; i < toolCompArr.size(); i++)
+			toolBrepArr.push_back(((HPS::Exchange::Component)toolCompArr[i]).GetExchangeEntity());
+
+		std::vector<ExBoolSet> setArr(targetCompArr.size());
+		for (int i = 0; i < targetCompArr.size(); i++)
+		{
+			setArr[i].pTargetBrep = ((HPS::Exchange::Component)targetCompArr[i]).GetExchangeEntity();
+			setArr[i].toolBreps = toolBrepArr;
+		}
+
+		// The updated targets are reloaded and the consumed tools deleted at once
+		ExPipelineResult result;
+		if (!m_pProcess->BooleanBatch((PsBoolType)m_iTBoolType, setArr, result))
+			return;
+
+		view->RefreshAfterPipeline(result);
+#endif
 	}
 	DestroyWindow();
 }
@@ -191,17 +209,19 @@ void BooleanDlg::OnTimer(UINT_PTR nIDEvent)
 	{
 		UpdateData(true);
 
-		HPS::Component targetComp = m_pCmdOp->GetTargetComponent();
+		HPS::ComponentArray targetCompArr = m_pCmdOp->GetTargetComponents();
 		HPS::ComponentArray toolCompArr = m_pCmdOp->GetToolComponents();
 
-		if (HPS::Type::None != targetComp.Type())
+		// The targets are listed in the edit, more of them are picked after a click in it
+		CString sTargets;
+		for (int i = 0; i < targetCompArr.size(); i++)
 		{
 			int iBody = 0;
 #ifdef USING_EXCHANGE_PARASOLID
-			iBody = ((HPS::Parasolid::Component)targetComp).GetParasolidEntity();
+			iBody = ((HPS::Parasolid::Component)targetCompArr[i]).GetParasolidEntity();
 
 #else
-			A3DRiBrepModel* pRiBrepModel = HPS::Exchange::Component(targetComp).GetExchangeEntity();
+			A3DRiBrepModel* pRiBrepModel = HPS::Exchange::Component(targetCompArr[i]).GetExchangeEntity();
 			iBody = m_pProcess->GetEntityTag(pRiBrepModel, NULL, false);
 #endif
 			CString sBody("UNKNOWN");
@@ -209,19 +229,19 @@ void BooleanDlg::OnTimer(UINT_PTR nIDEvent)
 			if (0 < iBody)
 				sBody.Format(_T("%d"), iBody);
 
-			if (m_cTargetBody != sBody)
-			{
-				m_cTargetBody = sBody;
-
-				m_iActiveCtrl = 1;
-				m_pCmdOp->SetSelectionStep(1);
-				Invalidate();
-			}
+			if (0 < i)
+				sTargets += _T(", ");
+			sTargets += sBody;
 		}
-		else
+
+		// Tools are picked after the first target
+		if (m_cTargetBody.IsEmpty() && 1 == targetCompArr.size())
 		{
-			m_cTargetBody = "";
+			m_iActiveCtrl = 1;
+			m_pCmdOp->SetSelectionStep(1);
+			Invalidate();
 		}
+		m_cTargetBody = sTargets;
 
 		int nCount = m_toolBodyListBox.GetCount();
 		for (int i = nCount - 1; i > -1; i--)
@@ -245,7 +265,7 @@ void BooleanDlg::OnTimer(UINT_PTR nIDEvent)
 		}
 
 		CButton* okBtn = (CButton*)GetDlgItem(IDOK);
-		if (HPS::Type::None != targetComp.Type() && 0 < toolCompArr.size())
+		if (0 < targetCompArr.size() && 0 < toolCompArr.size())
 			okBtn->EnableWindow(TRUE);
 		else
 			okBtn->EnableWindow(FALSE);
@@ -110,28 +110,62 @@ bool BooleanOp::OnMouseUp(HPS::MouseState const& in_state)
 			{
 				if (0 == m_iStep)
 				{
+					bool bTool = false;
 					for (int i = 0; i < m_toolCompArr.size(); i++)
 					{
 						if (m_toolCompArr[i] == selComp)
 						{
 							m_toolCompArr.erase(std::cbegin(m_toolCompArr) + i);
 							m_toolCompPathArr.erase(std::cbegin(m_toolCompPathArr) + i);
+							bTool = true;
 							break;
 						}
 					}
 
-					m_targetComp = selComp;
-					m_targetCompPath = compPath;
+					// A selected target is toggled off
+					bool bFlg = false;
+					for (int i = 0; i < m_targetCompArr.size(); i++)
+					{
+						if (m_targetCompArr[i] == selComp)
+						{
+							m_targetCompArr.erase(std::cbegin(m_targetCompArr) + i);
+							m_targetCompPathArr.erase(std::cbegin(m_targetCompPathArr) + i);
+							bFlg = true;
+							break;
+						}
+					}
 
-					m_highlight_options_1.SetNotification(true);
-					m_targetCompPath.Highlight(view->GetCanvas(), m_highlight_options_1);
+					if (!bFlg)
+					{
+						m_targetCompArr.push_back(selComp);
+						m_targetCompPathArr.push_back(compPath);
+#ifndef USING_EXCHANGE_PARASOLID
+						view->PrefetchSelected(selComp);
+#endif
+					}
+
+					if (!bFlg && !bTool)
+					{
+						m_highlight_options_1.SetNotification(true);
+						compPath.Highlight(view->GetCanvas(), m_highlight_options_1);
+					}
+					else
+					{
+						highlightAll();
+					}
 				}
 				else
 				{
-					if (m_targetComp == selComp)
+					bool bTarget = false;
+					for (int i = 0; i < m_targetCompArr.size(); i++)
 					{
-						m_targetComp = HPS::Component();
-						m_targetCompPath = HPS::ComponentPath();
+						if (m_targetCompArr[i] == selComp)
+						{
+							m_targetCompArr.erase(std::cbegin(m_targetCompArr) + i);
+							m_targetCompPathArr.erase(std::cbegin(m_targetCompPathArr) + i);
+							bTarget = true;
+							break;
+						}
 					}
 
 					bool bFlg = false;
@@ -150,22 +184,20 @@ bool BooleanOp::OnMouseUp(HPS::MouseState const& in_state)
 					{
 						m_toolCompArr.push_back(selComp);
 						m_toolCompPathArr.push_back(compPath);
+#ifndef USING_EXCHANGE_PARASOLID
+						view->PrefetchSelected(selComp);
+#endif
+					}
 
+					if (!bFlg && !bTarget)
+					{
 						// Make the selected component get highlighted in the model browser
 						m_highlight_options_2.SetNotification(true);
 						compPath.Highlight(view->GetCanvas(), m_highlight_options_2);
 					}
 					else
 					{
-						view->Unhighlight();
-						m_highlight_options_1.SetNotification(true);
-						m_targetCompPath.Highlight(view->GetCanvas(), m_highlight_options_1);
-
-						for (int i = 0; i < m_toolCompPathArr.size(); i++)
-						{
-							m_highlight_options_2.SetNotification(true);
-							m_toolCompPathArr[i].Highlight(view->GetCanvas(), m_highlight_options_2);
-						}
+						highlightAll();
 					}
 				}
 
@@ -181,6 +213,23 @@ bool BooleanOp::OnMouseUp(HPS::MouseState const& in_state)
 	return false;
 }
 
+void BooleanOp::highlightAll()
+{
+	view->Unhighlight();
+
+	for (int i = 0; i < m_targetCompPathArr.size(); i++)
+	{
+		m_highlight_options_1.SetNotification(true);
+		m_targetCompPathArr[i].Highlight(view->GetCanvas(), m_highlight_options_1);
+	}
+
+	for (int i = 0; i < m_toolCompPathArr.size(); i++)
+	{
+		m_highlight_options_2.SetNotification(true);
+		m_toolCompPathArr[i].Highlight(view->GetCanvas(), m_highlight_options_2);
+	}
+}
+
 void BooleanOp::Unhighlight()
 {
 	view->GetCanvas().GetWindowKey().GetHighlightControl().Unhighlight(m_highlight_options_1);
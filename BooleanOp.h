@@ -31,16 +31,19 @@ private:
 	HPS::HighlightOptionsKit m_highlight_options_2;
 
 	int m_iStep;
-	HPS::Component m_targetComp;
-	HPS::ComponentPath m_targetCompPath;
+	HPS::ComponentArray m_targetCompArr;	// Each target gets all the tools
+	HPS::ComponentPathArray m_targetCompPathArr;
 	HPS::ComponentArray m_toolCompArr;
 	HPS::ComponentPathArray m_toolCompPathArr;
 
 public:
 	bool m_bUpdated;
 	void SetSelectionStep(const int step) { m_iStep = step; }
-	HPS::Component GetTargetComponent() { return m_targetComp; }
+	HPS::ComponentArray GetTargetComponents() { return m_targetCompArr; }
 	HPS::ComponentArray GetToolComponents() { return m_toolCompArr; }
 	void Unhighlight();
+
+private:
+	void highlightAll();
 };
 
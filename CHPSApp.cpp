@@ -8,15 +8,21 @@
 #include "CHPSView.h"
 
 #include "hoops_license.h"
+#include "PerfTrace.h"
 
 #include <sstream>
 
 #ifdef USING_EXCHANGE
 #define INITIALIZE_A3D_API
 #include "A3DSDKIncludes.h"
+#include "ExMemoryPool.h"
 
 #endif // USING_EXCHANGE
 
+#if defined(USING_PARASOLID) || defined(USING_PARASOLID_OP)
+#include "PsMemoryPool.h"
+#endif
+
 
 // The one and only CHPSApp object
 CHPSApp theApp;
@@ -34,6 +40,21 @@ CHPSApp::CHPSApp()
 
 BOOL CHPSApp::InitInstance()
 {
+	// SANDBOX_TRACE=<file.json> records the pipeline spans, written at exit or with Ctrl+Shift+T
+	char tracePath[MAX_PATH];
+	if (GetEnvironmentVariableA("SANDBOX_TRACE", tracePath, MAX_PATH))
+	{
+		PerfTrace::SetDumpPath(tracePath);
+		PerfTrace::SetThreadName("main");
+		PerfTrace::Enable(true);
+	}
+
+#if defined(USING_PARASOLID) || defined(USING_PARASOLID_OP)
+	// The arrays returned by the kernel come from the pool, it has to be in place before the session starts
+	if (!PsMemoryPool::Register())
+		OutputDebugString(_T("Cannot register the Parasolid memory callbacks\n"));
+#endif
+
 	//! [hps_init]
 	// Initialize HPS::World
 	_world = new HPS::World(HOOPS_LICENSE);
@@ -71,6 +92,15 @@ BOOL CHPSApp::InitInstance()
 				A3DInt32 iMajorVersion = 0, iMinorVersion = 0;
 				A3DDllGetVersion(&iMajorVersion, &iMinorVersion);
 
+				// Exchange allocates through the pool, SANDBOX_EXCHANGE_ALLOCATOR=heap compares with malloc
+				ExMemoryMode memoryMode = ExMemoryMode::POOL;
+				wchar_t allocator[16];
+				if (GetEnvironmentVariable(L"SANDBOX_EXCHANGE_ALLOCATOR", allocator, 16) && 0 == _wcsicmp(allocator, L"heap"))
+					memoryMode = ExMemoryMode::HEAP;
+
+				if (!ExMemoryPool::Register(memoryMode))
+					OutputDebugString(_T("Cannot register the HOOPS Exchange memory callbacks\n"));
+
 				if (A3DDllInitialize(A3D_DLL_MAJORVERSION, A3D_DLL_MINORVERSION) != A3D_SUCCESS)
 					OutputDebugString(_T("Cannot initialize the HOOPS Exchange library\n"));
 			}
@@ -179,6 +209,9 @@ int CHPSApp::ExitInstance()
  	delete _world;
  	_world = NULL;
 
+	if (PerfTrace::IsEnabled())
+		PerfTrace::Dump();
+
 	AfxOleTerm(FALSE);
 	return CWinAppEx::ExitInstance();
 }
@@ -10,6 +10,7 @@
 #include <propkey.h>
 
 #include "A3DSDKIncludes.h"
+#include "ExMemoryPool.h"
 #include "PsProcess.h"
 
 IMPLEMENT_DYNCREATE(CHPSDoc, CDocument)
@@ -391,6 +392,7 @@ bool CHPSDoc::ImportExchangeFileWithParasolid(LPCTSTR lpszPathName)
 
 	try
 	{
+		ExMemoryScope memScope("Import");
 		CHPSExchangeProgressDialog dlg(this, notifier, filename);
 
 		notifier = HPS::ExchangeParasolid::File::Import(
@@ -468,7 +470,12 @@ bool CHPSDoc::ImportExchangeFile(LPCTSTR lpszPathName, HPS::Exchange::ImportOpti
 	{
 		//! [import_options]
 		HPS::Exchange::ImportOptionsKit ioOpts = options;
+#if defined (USING_EXCHANGE_PARASOLID)
 		ioOpts.SetTessellationLevel(HPS::Exchange::Tessellation::Level::Medium);
+#else
+		// Coarse first, the view refines the bodies which grow on screen
+		ioOpts.SetTessellationLevel(HPS::Exchange::Tessellation::Level::Low);
+#endif
 		ioOpts.SetBRepMode(HPS::Exchange::BRepMode::BRepAndTessellation);
 		//! [import_options]
 
@@ -489,6 +496,7 @@ bool CHPSDoc::ImportExchangeFile(LPCTSTR lpszPathName, HPS::Exchange::ImportOpti
 			ioOpts.SetConfiguration(selectedConfig);
 		}
 
+		ExMemoryScope memScope("Import");
 		CHPSExchangeProgressDialog dlg(this, notifier, filename);
 
 		//! [exchange_import]
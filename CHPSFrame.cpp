@@ -3,6 +3,7 @@
 #include "CHPSApp.h"
 #include "CHPSFrame.h"
 #include "SandboxHighlightOp.h"
+#include "PerfTrace.h"
 #include <imm.h>
 
 
@@ -349,6 +350,20 @@ BOOL CHPSFrame::PreTranslateMessage(MSG* pMsg)
         UINT keycode = (UINT)pMsg->wParam;
         if (keycode == VK_PROCESSKEY)
             keycode = ImmGetVirtualKey(pMsg->hwnd);
+
+		// Ctrl+Shift+T writes the recorded spans (SANDBOX_TRACE)
+		if ('T' == keycode && PerfTrace::IsEnabled() && (GetKeyState(VK_CONTROL) & 0x8000) && (GetKeyState(VK_SHIFT) & 0x8000))
+		{
+			wchar_t wcsbuf[512];
+			if (PerfTrace::Dump())
+				swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Trace: %d events written to %hs (%llu lost)",
+					(int)PerfTrace::GetEventCount(), PerfTrace::GetDumpPath(), PerfTrace::GetLostCount());
+			else
+				swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Trace: cannot write %hs", PerfTrace::GetDumpPath());
+			view->ShowMessage(wcsbuf);
+			return TRUE;
+		}
+
         view->GetCanvas().GetWindowKey().GetEventDispatcher().InjectEvent(BuildKeyboardEvent(HPS::KeyboardEvent::Action::KeyDown, keycode));
     }
 
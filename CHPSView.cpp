@@ -2,6 +2,7 @@
 #include "CHPSApp.h"
 #include "CHPSDoc.h"
 #include "CHPSView.h"
+#include "PerfTrace.h"
 #include "sprk.h"
 #include "SandboxHighlightOp.h"
 #include "CProgressDialog.h"
@@ -83,8 +84,17 @@ BEGIN_MESSAGE_MAP(CHPSView, CView)
 	ON_COMMAND(ID_BUTTON_HOLLOW, &CHPSView::OnButtonHollow)
 	ON_COMMAND(ID_BUTTON_DELETE_BODY, &CHPSView::OnButtonDeleteBody)
 	ON_COMMAND(ID_BUTTON_MIRROR, &CHPSView::OnButtonMirror)
+	ON_COMMAND(ID_EDIT_UNDO, &CHPSView::OnEditUndo)
+	ON_COMMAND(ID_EDIT_REDO, &CHPSView::OnEditRedo)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_UNDO, &CHPSView::OnUpdateEditUndo)
+	ON_UPDATE_COMMAND_UI(ID_EDIT_REDO, &CHPSView::OnUpdateEditRedo)
+	ON_WM_TIMER()
 END_MESSAGE_MAP()
 
+// Checks whether bodies grew on screen and need a finer tessellation
+static const UINT_PTR s_tessRefineTimer = 1;
+static const UINT s_tessRefineMsec = 500;
+
 CHPSView::CHPSView()
 	: _enableSimpleShadows(false),
 	_enableFrameRate(false),
@@ -106,12 +116,24 @@ CHPSView::CHPSView()
 #else
 	m_pProcess = new ExProcess();
 #endif
+
+	m_executor.Start();
 }
 
 CHPSView::~CHPSView()
 {
+	// The running operation uses the process
+	m_executor.Stop();
+
 	_canvas.Delete();
 
+	// The session goes with the world, the kernel data of the process before it
+#ifdef USING_EXCHANGE_PARASOLID
+	((ExPsProcess*)m_pProcess)->Terminate();
+#else
+	((ExProcess*)m_pProcess)->Terminate();
+#endif
+
 	delete m_pProcess;
 }
 
@@ -827,20 +849,17 @@ void CHPSView::OnFileOpen()
 
 	if (dlg.DoModal() == IDOK)
 	{
-		auto t0 = std::chrono::system_clock::now();
+		PerfTraceSpan span("ui", "CHPSView::Load", true);
 		GetDocument()->OnOpenDocument(dlg.GetPathName());
 
 		CADModel cadModel = GetDocument()->GetCADModel();
 		if (Type::ExchangeCADModel != cadModel.Type())
 			return;
 		
-		auto t1 = std::chrono::system_clock::now();
-
-		auto dur1 = t1 - t0;
-		auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+		int msec1 = (int)span.ElapsedMsec();
 
 		wchar_t wcsbuf[512];
-		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Loading time: %d msec", (int)msec1);
+		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Loading time: %d msec", msec1);
 
 		ShowMessage(wcsbuf);
 
@@ -878,6 +897,11 @@ void CHPSView::OnFileOpen()
 
 #else
 		((ExProcess*)m_pProcess)->SetModelFile(((HPS::Exchange::CADModel)cadModel).GetExchangeEntity());
+
+		// The first operation on each body doesn't wait its translation to Parasolid
+		((ExProcess*)m_pProcess)->StartPrefetch();
+
+		SetTimer(s_tessRefineTimer, s_tessRefineMsec, NULL);
 #endif
 
 
@@ -894,7 +918,7 @@ void CHPSView::OnFileSaveAs()
 	CString filter = _T("HOOPS Stream Files (*.hsf)|*.hsf|PDF (*.pdf)|*.pdf|Postscript Files (*.ps)|*.ps|JPEG Image File(*.jpeg)|*.jpeg|PNG Image Files (*.png)|*.png|");
 #ifdef USING_EXCHANGE
 	CString exchange_filter =
-		_T("PRC Files (*.prc)|*.prc|");
+		_T("PRC Files (*.prc)|*.prc|Parasolid Binary Files (*.x_b)|*.x_b|Parasolid Text Files (*.x_t)|*.x_t|");
 
 	exchange_filter.Append(filter);
 	filter = exchange_filter;
@@ -1053,12 +1077,18 @@ void CHPSView::OnFileSaveAs()
 			{
 #ifdef USING_EXCHANGE_PARASOLID
 				A3DAsmModelFile* pCopyModelFile;
-				((ExPsProcess*)m_pProcess)->CopyAndUpdateModelFile(pCopyModelFile);
+				if (!((ExPsProcess*)m_pProcess)->CopyAndUpdateModelFile(pCopyModelFile))
+				{
+					GetParentFrame()->MessageBox(L"Failed to update the modified bodies", _T("File export error"), MB_ICONERROR | MB_OK);
+					return;
+				}
 
 				HPS::Exchange::CADModel copy_cad_model = HPS::Exchange::Factory::CreateCADModel(HPS::Factory::CreateModel(), pCopyModelFile);
 
 				HPS::Exchange::File::ExportPRC(copy_cad_model, ansiPath, export_kit);
 #else
+				// Exchange is not read in background while exporting
+				((ExProcess*)m_pProcess)->StopPrefetch();
 				HPS::Exchange::File::ExportPRC(cad_model, ansiPath, export_kit);
 #endif
 			}
@@ -1068,6 +1098,18 @@ void CHPSView::OnFileSaveAs()
 				HPS::Exchange::File::ExportPRC(sprocket_path.GetKeyPath(), ansiPath);
 			}
 		}
+		else if (strcmp(ext, "x_b") == 0 || strcmp(ext, "x_t") == 0)
+		{
+			// The parts are written in background, the model can be edited meanwhile
+			PK_transmit_format_t format = (strcmp(ext, "x_t") == 0) ? PK_transmit_format_text_c : PK_transmit_format_binary_c;
+#ifdef USING_EXCHANGE_PARASOLID
+			bool bStarted = ((ExPsProcess*)m_pProcess)->Save(ansiPath, format);
+#else
+			bool bStarted = ((ExProcess*)m_pProcess)->Save(ansiPath, format);
+#endif
+			if (!bStarted)
+				GetParentFrame()->MessageBox(L"Parasolid transmit failed", _T("File export error"), MB_ICONERROR | MB_OK);
+		}
 #endif
 	}
 }
@@ -1615,3 +1657,226 @@ void CHPSView::OnButtonMirror()
 	MirrorDlg* pDlg = new MirrorDlg(this, m_pProcess, this);
 	pDlg->ShowWindow(SW_SHOW);
 }
+
+#ifdef USING_EXCHANGE_PARASOLID
+void CHPSView::applyJournalStep(const PsJournalStep& step, const bool bUndo)
+{
+	// Bodies created by an undone step (or deleted by a redone one) are gone, the others are back
+	const std::vector<PK_BODY_t>& goneBodyArr = bUndo ? step.createdBodies : step.deletedBodies;
+	const std::vector<PK_BODY_t>& backBodyArr = bUndo ? step.deletedBodies : step.createdBodies;
+
+	for (size_t i = 0; i < goneBodyArr.size(); i++)
+	{
+		HPS::Component bodyComp = GetPsComponent(goneBodyArr[i]);
+		if (HPS::Type::None == bodyComp.Type())
+			continue;
+
+		// Same as deleting the body from the dialog
+		HPS::Exchange::Component ownerComp = GetOwnerBrepModel(bodyComp);
+		A3DRiBrepModel* pRiBrepModel = ownerComp.GetExchangeEntity();
+		((ExPsProcess*)m_pProcess)->RegisterDeleteBody(pRiBrepModel);
+
+		DeletePsBodyMap(goneBodyArr[i]);
+		bodyComp.Delete(HPS::Component::DeleteMode::Standard);
+	}
+
+	for (size_t i = 0; i < backBodyArr.size(); i++)
+		AddBody(backBodyArr[i]);
+
+	for (size_t i = 0; i < step.modifiedBodies.size(); i++)
+	{
+		HPS::Component bodyComp = GetPsComponent(step.modifiedBodies[i]);
+		if (HPS::Type::None == bodyComp.Type())
+			continue;
+
+		// Tessellate
+		HPS::Parasolid::Component(bodyComp).Tessellate(
+			HPS::Parasolid::FacetTessellationKit::GetDefault(),
+			HPS::Parasolid::LineTessellationKit::GetDefault());
+
+		// The face and edge tags may have changed
+		InitPsBodyMap(step.modifiedBodies[i], bodyComp);
+
+		HPS::Exchange::Component ownerComp = GetOwnerBrepModel(bodyComp);
+		A3DRiBrepModel* pRiBrepModel = ownerComp.GetExchangeEntity();
+		((ExPsProcess*)m_pProcess)->RegisterUpdatedBody(pRiBrepModel, step.modifiedBodies[i]);
+	}
+
+	GetCanvas().Update();
+}
+#endif
+
+void CHPSView::OnEditUndo()
+{
+#ifdef USING_EXCHANGE_PARASOLID
+	PsJournalStep step;
+	if (((ExPsProcess*)m_pProcess)->Undo(step))
+		applyJournalStep(step, true);
+#else
+	// The kernel lock is held by the operation in background
+	if (m_executor.IsBusy())
+		return;
+
+	ExPipelineResult result;
+	if (((ExProcess*)m_pProcess)->Undo(result))
+		RefreshAfterPipeline(result);
+#endif
+}
+
+void CHPSView::OnEditRedo()
+{
+#ifdef USING_EXCHANGE_PARASOLID
+	PsJournalStep step;
+	if (((ExPsProcess*)m_pProcess)->Redo(step))
+		applyJournalStep(step, false);
+#else
+	if (m_executor.IsBusy())
+		return;
+
+	ExPipelineResult result;
+	if (((ExProcess*)m_pProcess)->Redo(result))
+		RefreshAfterPipeline(result);
+#endif
+}
+
+void CHPSView::OnUpdateEditUndo(CCmdUI* pCmdUI)
+{
+#ifdef USING_EXCHANGE_PARASOLID
+	pCmdUI->Enable(((ExPsProcess*)m_pProcess)->CanUndo());
+#else
+	pCmdUI->Enable(!m_executor.IsBusy() && ((ExProcess*)m_pProcess)->CanUndo());
+#endif
+}
+
+void CHPSView::OnUpdateEditRedo(CCmdUI* pCmdUI)
+{
+#ifdef USING_EXCHANGE_PARASOLID
+	pCmdUI->Enable(((ExPsProcess*)m_pProcess)->CanRedo());
+#else
+	pCmdUI->Enable(!m_executor.IsBusy() && ((ExProcess*)m_pProcess)->CanRedo());
+#endif
+}
+
+#ifndef USING_EXCHANGE_PARASOLID
+void CHPSView::refineTessellation()
+{
+	HPS::CADModel cadModel = GetDocument()->GetCADModel();
+	if (HPS::Type::ExchangeCADModel != cadModel.Type())
+		return;
+
+	// Model units per pixel at the target of the camera
+	HPS::CameraKit camera;
+	GetCanvas().GetFrontView().GetSegmentKey().ShowCamera(camera);
+
+	float fieldW, fieldH;
+	if (!camera.ShowField(fieldW, fieldH) || 0.0f >= fieldW)
+		return;
+
+	CRect rect;
+	GetClientRect(&rect);
+	if (0 >= rect.Width())
+		return;
+
+	std::vector<A3DRiBrepModel*> refinedArr;
+	if (!((ExProcess*)m_pProcess)->RefineTessellation((double)rect.Width() / fieldW, 4, refinedArr))
+		return;
+
+	HPS::Exchange::CADModel exCadModel(cadModel);
+	for (size_t i = 0; i < refinedArr.size(); i++)
+	{
+		HPS::Component brepComp = exCadModel.GetComponentFromEntity(refinedArr[i]);
+		if (brepComp.Empty())
+			continue;
+
+		HPS::Exchange::ReloadNotifier notifier = HPS::Exchange::Component(brepComp).Reload();
+		notifier.Wait();
+	}
+
+	GetCanvas().Update();
+}
+
+void CHPSView::RefreshAfterPipeline(ExPipelineResult& result)
+{
+	PerfTraceSpan span("ui", "CHPSView::RefreshAfterPipeline", true);
+
+	if (NULL != result.pNewModelFile)
+	{
+		// Exchange to HPS
+		HPS::Exchange::CADModel exCadModel = HPS::Exchange::Factory::CreateCADModel(HPS::Factory::CreateModel(), result.pNewModelFile);
+
+		GetDocument()->SetCADModel((HPS::CADModel)exCadModel);
+
+		exCadModel.Reload().Wait();
+
+		GetCanvas().GetFrontView().AttachModel(exCadModel.GetModel());
+
+		setCameraIso();
+	}
+	else
+	{
+		HPS::Exchange::CADModel exCadModel = (HPS::Exchange::CADModel)GetDocument()->GetCADModel();
+
+		for (size_t i = 0; i < result.deletedArr.size(); i++)
+		{
+			HPS::Component brepComp = exCadModel.GetComponentFromEntity(result.deletedArr[i]);
+			if (!brepComp.Empty())
+				brepComp.Delete(HPS::Component::DeleteMode::StandardAndExchange);
+		}
+
+		if (result.bBodiesAdded)
+		{
+			// The whole model is reloaded anyway for the new bodies
+			HPS::Exchange::ReloadNotifier notifier = exCadModel.Reload();
+			notifier.Wait();
+		}
+		else
+		{
+			for (size_t i = 0; i < result.updatedArr.size(); i++)
+			{
+				HPS::Component brepComp = exCadModel.GetComponentFromEntity(result.updatedArr[i]);
+				if (brepComp.Empty())
+					continue;
+
+				HPS::Exchange::ReloadNotifier notifier = HPS::Exchange::Component(brepComp).Reload();
+				notifier.Wait();
+			}
+		}
+	}
+
+	GetCanvas().Update();
+
+	result.timings.refreshMsec = span.ElapsedMsec();
+
+	wchar_t wcsbuf[512];
+	swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Kernel: %d msec, Translation: %d msec, Tessellation: %d msec, Refresh: %d msec",
+		(int)result.timings.kernelMsec, (int)result.timings.translateMsec, (int)result.timings.tessellateMsec, (int)result.timings.refreshMsec);
+	ShowMessage(wcsbuf);
+}
+
+void CHPSView::PrefetchSelected(HPS::Component selComp)
+{
+	HPS::Component::ComponentType compType = selComp.GetComponentType();
+
+	HPS::Component brepComp;
+	if (HPS::Component::ComponentType::ExchangeRIBRepModel == compType)
+		brepComp = selComp;
+	else if (HPS::Component::ComponentType::ExchangeTopoFace == compType || HPS::Component::ComponentType::ExchangeTopoEdge == compType)
+		brepComp = GetOwnerBrepModel(selComp);
+	else
+		return;
+
+	A3DRiBrepModel* pRiBrepModel = HPS::Exchange::Component(brepComp).GetExchangeEntity();
+	((ExProcess*)m_pProcess)->PrefetchFirst(std::vector<A3DRiBrepModel*>(1, pRiBrepModel));
+}
+#endif
+
+void CHPSView::OnTimer(UINT_PTR nIDEvent)
+{
+#ifndef USING_EXCHANGE_PARASOLID
+	// The kernel lock is held by the operation in background
+	if (s_tessRefineTimer == nIDEvent && !m_executor.IsBusy())
+		refineTessellation();
+#endif
+
+	CView::OnTimer(nIDEvent);
+}
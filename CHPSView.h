@@ -1,6 +1,7 @@
 #pragma once
 #include <map>
 #include "A3DSDKIncludes.h"
+#include "PsKernelExecutor.h"
 
 #ifdef USING_EXCHANGE_PARASOLID
 #include "ExPsProcess.h"
@@ -197,6 +198,7 @@ private:
 
 public:
 	void* m_pProcess;
+	PsKernelExecutor m_executor;	// Long kernel operations run there, the view stays interactive
 	void ShowMessage(wchar_t* wmag);
 	HPS::Component GetOwnerBrepModel(HPS::Component in_comp);
 
@@ -212,6 +214,18 @@ public:
 	void DeletePsBodyMap(const int body) { m_psMapper->DeleteBodyMap(body); }
 	void InitPsBodyMap(const int body, HPS::Component bodyComp) { m_psMapper->InitBodyMap(body, bodyComp); }
 	HPS::Component GetOwnerPSBodyCompo(HPS::Component in_comp);
+
+private:
+	void applyJournalStep(const PsJournalStep& step, const bool bUndo);
+#else
+private:
+	void refineTessellation();
+
+public:
+	// Display update of a pipeline run on the executor or of a batch Boolean, on the UI thread
+	void RefreshAfterPipeline(ExPipelineResult& result);
+	// The body of a selected Brep model, face or edge is translated before the rest of the model
+	void PrefetchSelected(HPS::Component selComp);
 #endif
 
 public:
@@ -273,6 +287,11 @@ public:
 	afx_msg void OnButtonHollow();
 	afx_msg void OnButtonDeleteBody();
 	afx_msg void OnButtonMirror();
+	afx_msg void OnEditUndo();
+	afx_msg void OnEditRedo();
+	afx_msg void OnUpdateEditUndo(CCmdUI* pCmdUI);
+	afx_msg void OnUpdateEditRedo(CCmdUI* pCmdUI);
+	afx_msg void OnTimer(UINT_PTR nIDEvent);
 };
 
 
@@ -193,6 +193,9 @@ bool ClickEntitiesCmdOp::OnMouseUp(HPS::MouseState const& in_state)
 				{
 					m_selCompArr.push_back(selComp);
 					m_selCompPathArr.push_back(compPath);
+#ifndef USING_EXCHANGE_PARASOLID
+					view->PrefetchSelected(selComp);
+#endif
 
 					// Make the selected component get highlighted in the model browser
 					m_highlight_options_1.SetNotification(true);
@@ -2,6 +2,7 @@
 
 #include "stdafx.h"
 #include "DeleteCompDlg.h"
+#include "PerfTrace.h"
 #include "afxdialogex.h"
 
 
@@ -53,7 +54,7 @@ BOOL DeleteCompDlg::OnInitDialog()
 
 void DeleteCompDlg::OnOK()
 {
-	auto t0 = std::chrono::system_clock::now();
+	PerfTraceSpan span("ui", "DeleteCompDlg::OnOK", true);
 
 	m_pCmdOp->Unhighlight();
 
@@ -94,10 +95,7 @@ void DeleteCompDlg::OnOK()
 		selCompArr[i].Delete(deleteMode);
 	}
 	// Show process time
-	auto t1 = std::chrono::system_clock::now();
-
-	auto dur1 = t1 - t0;
-	auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+	int msec1 = (int)span.ElapsedMsec();
 
 	wchar_t wcsbuf[256];
 	swprintf(wcsbuf, sizeof(wcsbuf), L"Process time: %d msec", msec1);
@@ -2,6 +2,7 @@
 
 #include "stdafx.h"
 #include "DeleteFaceDlg.h"
+#include "PerfTrace.h"
 #include "afxdialogex.h"
 
 
@@ -45,7 +46,7 @@ BOOL DeleteFaceDlg::OnInitDialog()
 
 void DeleteFaceDlg::OnOK()
 {
-	auto t0 = std::chrono::system_clock::now();
+	PerfTraceSpan span("ui", "DeleteFaceDlg::OnOK", true);
 
 	m_pCmdOp->Unhighlight();
 
@@ -97,10 +98,7 @@ void DeleteFaceDlg::OnOK()
 
 #endif
 	// Show process time
-	auto t1 = std::chrono::system_clock::now();
-
-	auto dur1 = t1 - t0;
-	auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+	int msec1 = (int)span.ElapsedMsec();
 
 	wchar_t wcsbuf[256];
 	swprintf(wcsbuf, sizeof(wcsbuf), L"Process time: %d msec", msec1);
@@ -0,0 +1,144 @@
+#include "stdafx.h"
+#include "ExBodyLifecycle.h"
+
+ExBodyLifecycle::ExBodyLifecycle() :
+	m_liveBytes(0),
+	m_peakBytes(0),
+	m_budgetBytes(0),
+	m_iPinnedCnt(0),
+	m_iEvictedCnt(0),
+	m_iRetranslatedCnt(0)
+{
+}
+
+ExBodyLifecycle::~ExBodyLifecycle()
+{
+}
+
+void ExBodyLifecycle::Add(A3DRiBrepModel* pRiBrepModel, const size_t bytes)
+{
+	auto it = m_infoMap.find(pRiBrepModel);
+	if (m_infoMap.end() != it)
+	{
+		Resize(pRiBrepModel, bytes);
+		Touch(pRiBrepModel);
+		return;
+	}
+
+	if (m_evictedSet.erase(pRiBrepModel))
+		m_iRetranslatedCnt++;
+
+	m_lruList.push_front(pRiBrepModel);
+
+	Info info;
+	info.bytes = bytes;
+	info.refCnt = 0;
+	info.lruIt = m_lruList.begin();
+	m_infoMap[pRiBrepModel] = info;
+
+	m_liveBytes += bytes;
+	if (m_peakBytes < m_liveBytes)
+		m_peakBytes = m_liveBytes;
+}
+
+void ExBodyLifecycle::Resize(A3DRiBrepModel* pRiBrepModel, const size_t bytes)
+{
+	auto it = m_infoMap.find(pRiBrepModel);
+	if (m_infoMap.end() == it)
+		return;
+
+	m_liveBytes = m_liveBytes - it->second.bytes + bytes;
+	it->second.bytes = bytes;
+	if (m_peakBytes < m_liveBytes)
+		m_peakBytes = m_liveBytes;
+}
+
+void ExBodyLifecycle::Touch(A3DRiBrepModel* pRiBrepModel)
+{
+	auto it = m_infoMap.find(pRiBrepModel);
+	if (m_infoMap.end() == it)
+		return;
+
+	m_lruList.splice(m_lruList.begin(), m_lruList, it->second.lruIt);
+}
+
+void ExBodyLifecycle::Remove(A3DRiBrepModel* pRiBrepModel)
+{
+	auto it = m_infoMap.find(pRiBrepModel);
+	if (m_infoMap.end() == it)
+		return;
+
+	if (0 < it->second.refCnt)
+		m_iPinnedCnt--;
+
+	m_liveBytes -= it->second.bytes;
+	m_lruList.erase(it->second.lruIt);
+	m_infoMap.erase(it);
+}
+
+void ExBodyLifecycle::Clear()
+{
+	m_lruList.clear();
+	m_infoMap.clear();
+	m_evictedSet.clear();
+	m_liveBytes = 0;
+	m_iPinnedCnt = 0;
+}
+
+void ExBodyLifecycle::Acquire(A3DRiBrepModel* pRiBrepModel)
+{
+	auto it = m_infoMap.find(pRiBrepModel);
+	if (m_infoMap.end() == it)
+		return;
+
+	if (0 == it->second.refCnt++)
+		m_iPinnedCnt++;
+}
+
+void ExBodyLifecycle::Release(A3DRiBrepModel* pRiBrepModel)
+{
+	auto it = m_infoMap.find(pRiBrepModel);
+	if (m_infoMap.end() == it || 0 == it->second.refCnt)
+		return;
+
+	if (0 == --it->second.refCnt)
+		m_iPinnedCnt--;
+}
+
+void ExBodyLifecycle::SelectEvictions(const std::unordered_set<A3DRiBrepModel*>& keepSet, std::vector<A3DRiBrepModel*>& evictArr)
+{
+	if (0 == m_budgetBytes)
+		return;
+
+	auto it = m_lruList.end();
+	while (m_budgetBytes < m_liveBytes && m_lruList.begin() != it)
+	{
+		--it;
+
+		A3DRiBrepModel* pRiBrepModel = *it;
+		Info& info = m_infoMap[pRiBrepModel];
+		if (0 < info.refCnt || keepSet.count(pRiBrepModel))
+			continue;
+
+		evictArr.push_back(pRiBrepModel);
+		m_evictedSet.insert(pRiBrepModel);
+		m_iEvictedCnt++;
+
+		m_liveBytes -= info.bytes;
+		m_infoMap.erase(pRiBrepModel);
+		it = m_lruList.erase(it);
+	}
+}
+
+ExBodyLifeStats ExBodyLifecycle::GetStats() const
+{
+	ExBodyLifeStats stats;
+	stats.liveCnt = (int)m_infoMap.size();
+	stats.pinnedCnt = m_iPinnedCnt;
+	stats.liveBytes = m_liveBytes;
+	stats.peakBytes = m_peakBytes;
+	stats.budgetBytes = m_budgetBytes;
+	stats.evictedCnt = m_iEvictedCnt;
+	stats.retranslatedCnt = m_iRetranslatedCnt;
+	return stats;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <A3DSDKIncludes.h>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct ExBodyLifeStats
+{
+	int liveCnt = 0;
+	int pinnedCnt = 0;
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+	size_t budgetBytes = 0;
+	int evictedCnt = 0;
+	int retranslatedCnt = 0;	// Evicted bodies translated again
+};
+
+// Use of the translated PK bodies (and their mappers) by Brep model, in least recently used order.
+// A body is pinned while an operation uses it; the cold ones are given for eviction
+// when the estimated memory goes over the budget, they are translated again at the next use.
+class ExBodyLifecycle
+{
+public:
+	ExBodyLifecycle();
+	~ExBodyLifecycle();
+
+private:
+	struct Info
+	{
+		size_t bytes;
+		int refCnt;
+		std::list<A3DRiBrepModel*>::iterator lruIt;
+	};
+
+	std::list<A3DRiBrepModel*> m_lruList;		// Most recently used first
+	std::unordered_map<A3DRiBrepModel*, Info> m_infoMap;
+	std::unordered_set<A3DRiBrepModel*> m_evictedSet;
+	size_t m_liveBytes;
+	size_t m_peakBytes;
+	size_t m_budgetBytes;
+	int m_iPinnedCnt;
+	int m_iEvictedCnt;
+	int m_iRetranslatedCnt;
+
+public:
+	void Add(A3DRiBrepModel* pRiBrepModel, const size_t bytes);
+	void Resize(A3DRiBrepModel* pRiBrepModel, const size_t bytes);
+	void Touch(A3DRiBrepModel* pRiBrepModel);
+	void Remove(A3DRiBrepModel* pRiBrepModel);
+	void Clear();
+
+	void Acquire(A3DRiBrepModel* pRiBrepModel);
+	void Release(A3DRiBrepModel* pRiBrepModel);
+
+	// 0 for no limit
+	void SetBudget(const size_t budgetBytes) { m_budgetBytes = budgetBytes; }
+	// Coldest unpinned bodies to release until the memory is under the budget, they are forgotten here.
+	// The bodies of keepSet are skipped like the pinned ones
+	void SelectEvictions(const std::unordered_set<A3DRiBrepModel*>& keepSet, std::vector<A3DRiBrepModel*>& evictArr);
+	ExBodyLifeStats GetStats() const;
+};
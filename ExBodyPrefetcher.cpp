@@ -0,0 +1,193 @@
+#include "stdafx.h"
+#include "ExBodyPrefetcher.h"
+#include "PerfTrace.h"
+#include <chrono>
+
+ExBodyPrefetcher::ExBodyPrefetcher() :
+	m_bStop(false),
+	m_usedBytes(0),
+	m_budgetBytes(0),
+	m_iTranslatedCnt(0)
+{
+}
+
+ExBodyPrefetcher::~ExBodyPrefetcher()
+{
+	Stop();
+}
+
+void ExBodyPrefetcher::Start(const TranslateFunc fnTranslate, const size_t budgetBytes)
+{
+	Stop();
+
+	m_fnTranslate = fnTranslate;
+	m_budgetBytes = budgetBytes;
+	m_bStop = false;
+
+	m_thread = std::thread(&ExBodyPrefetcher::workerLoop, this);
+}
+
+void ExBodyPrefetcher::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bStop = true;
+		m_queue.clear();
+		m_queuedSet.clear();
+	}
+	m_queueCond.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void ExBodyPrefetcher::Clear()
+{
+	Stop();
+
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	m_readyMap.clear();
+	m_usedBytes = 0;
+	m_iTranslatedCnt = 0;
+}
+
+void ExBodyPrefetcher::Queue(const std::vector<A3DRiBrepModel*>& riBrepModelArr, const bool bFirst)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+
+		if (bFirst)
+		{
+			// The front keeps the given order
+			std::vector<A3DRiBrepModel*> frontArr;
+			for (size_t i = 0; i < riBrepModelArr.size(); i++)
+			{
+				A3DRiBrepModel* pRiBrepModel = riBrepModelArr[i];
+				if (m_readyMap.count(pRiBrepModel))
+					continue;
+
+				if (m_queuedSet.count(pRiBrepModel))
+				{
+					for (auto it = m_queue.begin(); it != m_queue.end(); ++it)
+					{
+						if (pRiBrepModel == *it)
+						{
+							m_queue.erase(it);
+							break;
+						}
+					}
+				}
+				else
+					m_queuedSet.insert(pRiBrepModel);
+
+				frontArr.push_back(pRiBrepModel);
+			}
+			m_queue.insert(m_queue.begin(), frontArr.begin(), frontArr.end());
+		}
+		else
+		{
+			for (size_t i = 0; i < riBrepModelArr.size(); i++)
+			{
+				A3DRiBrepModel* pRiBrepModel = riBrepModelArr[i];
+				if (m_readyMap.count(pRiBrepModel) || m_queuedSet.count(pRiBrepModel))
+					continue;
+
+				m_queuedSet.insert(pRiBrepModel);
+				m_queue.push_back(pRiBrepModel);
+			}
+		}
+	}
+	m_queueCond.notify_one();
+}
+
+void ExBodyPrefetcher::workerLoop()
+{
+	PerfTrace::SetThreadName("ExBodyPrefetcher");
+
+	while (true)
+	{
+		std::unique_lock<std::recursive_mutex> kernelLock(m_kernelMutex, std::defer_lock);
+		A3DRiBrepModel* pRiBrepModel = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCond.wait(lock, [this] { return m_bStop || m_queue.size(); });
+
+			if (m_bStop || m_budgetBytes <= m_usedBytes)
+				return;
+		}
+
+		// The queue may change while waiting the kernel lock. It is polled so that Stop called
+		// under the kernel lock doesn't dead lock
+		while (!kernelLock.try_lock())
+		{
+			if (m_bStop)
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			if (m_bStop)
+				return;
+			if (0 == m_queue.size())
+				continue;
+
+			pRiBrepModel = m_queue.front();
+			m_queue.pop_front();
+			m_queuedSet.erase(pRiBrepModel);
+		}
+
+		PERF_TRACE_SCOPE("ex", "ExBodyPrefetcher::Translate");
+
+		Result result = { PK_ENTITY_null, NULL };
+		size_t bytes = 0;
+		if (!m_fnTranslate(pRiBrepModel, result.body, result.pPkMapper, bytes))
+			continue;
+
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_readyMap[pRiBrepModel] = result;
+		m_usedBytes += bytes;
+		m_iTranslatedCnt++;
+	}
+}
+
+bool ExBodyPrefetcher::Take(A3DRiBrepModel* pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper)
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+
+	auto it = m_readyMap.find(pRiBrepModel);
+	if (m_readyMap.end() != it)
+	{
+		body = it->second.body;
+		pPkMapper = it->second.pPkMapper;
+		m_readyMap.erase(it);
+		return true;
+	}
+
+	if (m_queuedSet.count(pRiBrepModel))
+	{
+		m_queuedSet.erase(pRiBrepModel);
+		for (auto qit = m_queue.begin(); qit != m_queue.end(); ++qit)
+		{
+			if (pRiBrepModel == *qit)
+			{
+				m_queue.erase(qit);
+				break;
+			}
+		}
+	}
+
+	return false;
+}
+
+ExPrefetchStats ExBodyPrefetcher::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+
+	ExPrefetchStats stats;
+	stats.queuedCnt = (int)m_queue.size();
+	stats.readyCnt = (int)m_readyMap.size();
+	stats.translatedCnt = m_iTranslatedCnt;
+	stats.usedBytes = m_usedBytes;
+	stats.budgetBytes = m_budgetBytes;
+	return stats;
+}
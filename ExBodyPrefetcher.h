@@ -0,0 +1,70 @@
+#pragma once
+#include <A3DSDKIncludes.h>
+#include "parasolid_kernel.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct ExPrefetchStats
+{
+	int queuedCnt = 0;
+	int readyCnt = 0;		// Translated and not yet taken
+	int translatedCnt = 0;
+	size_t usedBytes = 0;
+	size_t budgetBytes = 0;
+};
+
+// Translates the RiBrepModels of the model file to Parasolid on a background thread, one body at a time
+// under the kernel lock. The operations take the same lock, so they only wait the body in translation.
+// Prefetch stops once the estimated memory of the translated bodies reaches the budget.
+class ExBodyPrefetcher
+{
+public:
+	// bytes is an estimate of the memory of the translated body
+	typedef std::function<bool(A3DRiBrepModel* pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper, size_t& bytes)> TranslateFunc;
+
+	ExBodyPrefetcher();
+	~ExBodyPrefetcher();
+
+private:
+	struct Result
+	{
+		PK_BODY_t body;
+		A3DMiscPKMapper* pPkMapper;
+	};
+
+	TranslateFunc m_fnTranslate;
+	std::recursive_mutex m_kernelMutex;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCond;
+	std::deque<A3DRiBrepModel*> m_queue;
+	std::unordered_set<A3DRiBrepModel*> m_queuedSet;
+	std::unordered_map<A3DRiBrepModel*, Result> m_readyMap;
+	std::thread m_thread;
+	std::atomic<bool> m_bStop;
+	size_t m_usedBytes;
+	size_t m_budgetBytes;
+	int m_iTranslatedCnt;
+
+	void workerLoop();
+
+public:
+	void Start(const TranslateFunc fnTranslate, const size_t budgetBytes);
+	// Queued bodies are forgotten, the translated ones are kept for Take
+	void Stop();
+	// Bodies already queued are moved to the front when bFirst (visible / selected ones)
+	void Queue(const std::vector<A3DRiBrepModel*>& riBrepModelArr, const bool bFirst);
+	// Has to be called with the kernel lock held. Return false if the body isn't translated,
+	// it is removed from the queue then and the caller translates it
+	bool Take(A3DRiBrepModel* pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper);
+	// Forget everything, the bodies of the previous model don't exist anymore
+	void Clear();
+	std::recursive_mutex& GetKernelMutex() { return m_kernelMutex; }
+	ExPrefetchStats GetStats();
+};
@@ -0,0 +1,295 @@
+#include "stdafx.h"
+#include "ExBodyRegistry.h"
+
+static const int s_emptyBucket = -1;
+static const int s_deletedBucket = -2;
+static const size_t s_minBucketCnt = 64;
+
+// Pointers are aligned and tags are small, mix all the bits before masking
+static size_t hashKey(const uint64_t key)
+{
+	uint64_t h = key;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return (size_t)h;
+}
+
+ExBodyRegistry::ExBodyRegistry() :
+	m_count(0)
+{
+	m_riBrepTable.usedCnt = 0;
+	m_bodyTable.usedCnt = 0;
+}
+
+ExBodyRegistry::~ExBodyRegistry()
+{
+}
+
+uint64_t ExBodyRegistry::keyOf(const int entry, const bool bBody) const
+{
+	if (bBody)
+		return (uint64_t)m_entryArr[entry].body;
+
+	return (uint64_t)(uintptr_t)m_entryArr[entry].pRiBrepModel;
+}
+
+int ExBodyRegistry::findBucket(const Table& table, const uint64_t key, const bool bBody) const
+{
+	size_t bucketCnt = table.bucketArr.size();
+	if (0 == bucketCnt)
+		return -1;
+
+	size_t mask = bucketCnt - 1;
+	for (size_t i = hashKey(key) & mask, n = 0; n < bucketCnt; i = (i + 1) & mask, n++)
+	{
+		int entry = table.bucketArr[i];
+		if (s_emptyBucket == entry)
+			return -1;
+
+		if (s_deletedBucket != entry && key == keyOf(entry, bBody))
+			return (int)i;
+	}
+
+	return -1;
+}
+
+int ExBodyRegistry::findEntry(const Table& table, const uint64_t key, const bool bBody) const
+{
+	int bucket = findBucket(table, key, bBody);
+	if (0 > bucket)
+		return -1;
+
+	return table.bucketArr[bucket];
+}
+
+void ExBodyRegistry::rehash(Table& table, const size_t bucketCnt, const bool bBody)
+{
+	std::vector<int> oldArr;
+	oldArr.swap(table.bucketArr);
+
+	table.bucketArr.assign(bucketCnt, s_emptyBucket);
+	table.usedCnt = 0;
+
+	for (size_t i = 0; i < oldArr.size(); i++)
+	{
+		if (0 <= oldArr[i])
+			insert(table, oldArr[i], bBody);
+	}
+}
+
+void ExBodyRegistry::insert(Table& table, const int entry, const bool bBody)
+{
+	// Keep the load (tombstones included) under a half, tombstones are dropped by the rehash
+	if (table.bucketArr.size() < (table.usedCnt + 1) * 2)
+	{
+		size_t bucketCnt = s_minBucketCnt;
+		while (bucketCnt < (m_count + 1) * 4)
+			bucketCnt *= 2;
+		rehash(table, bucketCnt, bBody);
+	}
+
+	size_t mask = table.bucketArr.size() - 1;
+	size_t i = hashKey(keyOf(entry, bBody)) & mask;
+	while (0 <= table.bucketArr[i])
+		i = (i + 1) & mask;
+
+	if (s_emptyBucket == table.bucketArr[i])
+		table.usedCnt++;
+	table.bucketArr[i] = entry;
+}
+
+void ExBodyRegistry::erase(Table& table, const uint64_t key, const bool bBody)
+{
+	int bucket = findBucket(table, key, bBody);
+	if (0 <= bucket)
+		table.bucketArr[bucket] = s_deletedBucket;
+}
+
+void ExBodyRegistry::releaseEntry(const int entry)
+{
+	erase(m_riBrepTable, keyOf(entry, false), false);
+	erase(m_bodyTable, keyOf(entry, true), true);
+
+	Entry& e = m_entryArr[entry];
+	e.pRiBrepModel = NULL;
+	e.body = PK_ENTITY_null;
+	e.pPkMapper = NULL;
+	e.generation++;
+
+	m_freeArr.push_back(entry);
+	m_count--;
+}
+
+ExBodyHandle ExBodyRegistry::Set(A3DRiBrepModel* pRiBrepModel, const PK_BODY_t body, A3DMiscPKMapper* pPkMapper)
+{
+	ExBodyHandle handle;
+	if (NULL == pRiBrepModel)
+		return handle;
+
+	// The body moves from another Brep model
+	int owner = findEntry(m_bodyTable, (uint64_t)body, true);
+	if (0 <= owner && pRiBrepModel != m_entryArr[owner].pRiBrepModel)
+		releaseEntry(owner);
+
+	int entry = findEntry(m_riBrepTable, (uint64_t)(uintptr_t)pRiBrepModel, false);
+	if (0 <= entry)
+	{
+		Entry& e = m_entryArr[entry];
+		if (body != e.body)
+		{
+			erase(m_bodyTable, (uint64_t)e.body, true);
+			e.body = body;
+			e.generation++;
+			insert(m_bodyTable, entry, true);
+		}
+		e.pPkMapper = pPkMapper;
+	}
+	else
+	{
+		if (m_freeArr.size())
+		{
+			entry = m_freeArr.back();
+			m_freeArr.pop_back();
+		}
+		else
+		{
+			entry = (int)m_entryArr.size();
+			Entry e = { NULL, PK_ENTITY_null, NULL, 0 };
+			m_entryArr.push_back(e);
+		}
+
+		Entry& e = m_entryArr[entry];
+		e.pRiBrepModel = pRiBrepModel;
+		e.body = body;
+		e.pPkMapper = pPkMapper;
+
+		m_count++;
+		insert(m_riBrepTable, entry, false);
+		insert(m_bodyTable, entry, true);
+	}
+
+	handle.entry = entry;
+	handle.generation = m_entryArr[entry].generation;
+	return handle;
+}
+
+bool ExBodyRegistry::Contains(A3DRiBrepModel* pRiBrepModel) const
+{
+	return 0 <= findEntry(m_riBrepTable, (uint64_t)(uintptr_t)pRiBrepModel, false);
+}
+
+PK_BODY_t ExBodyRegistry::FindBody(A3DRiBrepModel* pRiBrepModel) const
+{
+	int entry = findEntry(m_riBrepTable, (uint64_t)(uintptr_t)pRiBrepModel, false);
+	if (0 > entry)
+		return PK_ENTITY_null;
+
+	return m_entryArr[entry].body;
+}
+
+A3DMiscPKMapper* ExBodyRegistry::FindMapper(A3DRiBrepModel* pRiBrepModel) const
+{
+	int entry = findEntry(m_riBrepTable, (uint64_t)(uintptr_t)pRiBrepModel, false);
+	if (0 > entry)
+		return NULL;
+
+	return m_entryArr[entry].pPkMapper;
+}
+
+A3DRiBrepModel* ExBodyRegistry::FindRiBrepModel(const PK_BODY_t body) const
+{
+	int entry = findEntry(m_bodyTable, (uint64_t)body, true);
+	if (0 > entry)
+		return NULL;
+
+	return m_entryArr[entry].pRiBrepModel;
+}
+
+bool ExBodyRegistry::Remove(A3DRiBrepModel* pRiBrepModel)
+{
+	int entry = findEntry(m_riBrepTable, (uint64_t)(uintptr_t)pRiBrepModel, false);
+	if (0 > entry)
+		return false;
+
+	releaseEntry(entry);
+	return true;
+}
+
+bool ExBodyRegistry::RemoveBody(const PK_BODY_t body)
+{
+	int entry = findEntry(m_bodyTable, (uint64_t)body, true);
+	if (0 > entry)
+		return false;
+
+	releaseEntry(entry);
+	return true;
+}
+
+void ExBodyRegistry::GetRiBrepModels(std::vector<A3DRiBrepModel*>& riBrepModelArr) const
+{
+	riBrepModelArr.clear();
+	riBrepModelArr.reserve(m_count);
+	for (size_t i = 0; i < m_entryArr.size(); i++)
+	{
+		if (NULL != m_entryArr[i].pRiBrepModel)
+			riBrepModelArr.push_back(m_entryArr[i].pRiBrepModel);
+	}
+}
+
+void ExBodyRegistry::Clear()
+{
+	// Generations are kept so that the handles given before stay stale
+	m_freeArr.clear();
+	for (size_t i = 0; i < m_entryArr.size(); i++)
+	{
+		Entry& e = m_entryArr[i];
+		if (NULL != e.pRiBrepModel)
+			e.generation++;
+		e.pRiBrepModel = NULL;
+		e.body = PK_ENTITY_null;
+		e.pPkMapper = NULL;
+		m_freeArr.push_back((int)i);
+	}
+
+	std::vector<int>().swap(m_riBrepTable.bucketArr);
+	std::vector<int>().swap(m_bodyTable.bucketArr);
+	m_riBrepTable.usedCnt = 0;
+	m_bodyTable.usedCnt = 0;
+	m_count = 0;
+}
+
+ExBodyHandle ExBodyRegistry::GetHandle(A3DRiBrepModel* pRiBrepModel) const
+{
+	ExBodyHandle handle;
+
+	int entry = findEntry(m_riBrepTable, (uint64_t)(uintptr_t)pRiBrepModel, false);
+	if (0 <= entry)
+	{
+		handle.entry = entry;
+		handle.generation = m_entryArr[entry].generation;
+	}
+
+	return handle;
+}
+
+bool ExBodyRegistry::IsAlive(const ExBodyHandle& handle) const
+{
+	if (0 > handle.entry || m_entryArr.size() <= (size_t)handle.entry)
+		return false;
+
+	const Entry& e = m_entryArr[handle.entry];
+	return NULL != e.pRiBrepModel && handle.generation == e.generation;
+}
+
+bool ExBodyRegistry::Resolve(const ExBodyHandle& handle, A3DRiBrepModel*& pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper) const
+{
+	if (!IsAlive(handle))
+		return false;
+
+	const Entry& e = m_entryArr[handle.entry];
+	pRiBrepModel = e.pRiBrepModel;
+	body = e.body;
+	pPkMapper = e.pPkMapper;
+	return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <A3DSDKIncludes.h>
+#include "parasolid_kernel.h"
+#include <stdint.h>
+#include <vector>
+
+// Reference to a registered body, it becomes stale when the body is removed or given to another Brep model
+struct ExBodyHandle
+{
+	int entry = -1;
+	unsigned int generation = 0;
+};
+
+// RiBrepModel <=> PK body and RiBrepModel => PK mapper in both directions.
+// Entries are kept in a flat array, two open addressing tables (linear probing) index them
+// by RiBrepModel and by PK body, so every lookup and update is constant time.
+// A PK body belongs to only one RiBrepModel, registering it again drops the former owner.
+class ExBodyRegistry
+{
+public:
+	ExBodyRegistry();
+	~ExBodyRegistry();
+
+private:
+	struct Entry
+	{
+		A3DRiBrepModel* pRiBrepModel;	// NULL while the entry is free
+		PK_BODY_t body;
+		A3DMiscPKMapper* pPkMapper;
+		unsigned int generation;		// Incremented each time the entry is released
+	};
+
+	// A bucket holds an entry index, the key is read from the entry
+	struct Table
+	{
+		std::vector<int> bucketArr;
+		size_t usedCnt;		// Entries and tombstones
+	};
+
+	std::vector<Entry> m_entryArr;
+	std::vector<int> m_freeArr;
+	Table m_riBrepTable;
+	Table m_bodyTable;
+	size_t m_count;
+
+	uint64_t keyOf(const int entry, const bool bBody) const;
+	int findBucket(const Table& table, const uint64_t key, const bool bBody) const;
+	int findEntry(const Table& table, const uint64_t key, const bool bBody) const;
+	void insert(Table& table, const int entry, const bool bBody);
+	void erase(Table& table, const uint64_t key, const bool bBody);
+	void rehash(Table& table, const size_t bucketCnt, const bool bBody);
+	void releaseEntry(const int entry);
+
+public:
+	ExBodyHandle Set(A3DRiBrepModel* pRiBrepModel, const PK_BODY_t body, A3DMiscPKMapper* pPkMapper);
+	bool Contains(A3DRiBrepModel* pRiBrepModel) const;
+	PK_BODY_t FindBody(A3DRiBrepModel* pRiBrepModel) const;
+	A3DMiscPKMapper* FindMapper(A3DRiBrepModel* pRiBrepModel) const;
+	A3DRiBrepModel* FindRiBrepModel(const PK_BODY_t body) const;
+	bool Remove(A3DRiBrepModel* pRiBrepModel);
+	bool RemoveBody(const PK_BODY_t body);
+	void Clear();
+	size_t GetCount() const { return m_count; }
+	void GetRiBrepModels(std::vector<A3DRiBrepModel*>& riBrepModelArr) const;
+
+	ExBodyHandle GetHandle(A3DRiBrepModel* pRiBrepModel) const;
+	bool IsAlive(const ExBodyHandle& handle) const;
+	// Return false if the handle is stale
+	bool Resolve(const ExBodyHandle& handle, A3DRiBrepModel*& pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper) const;
+};
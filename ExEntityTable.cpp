@@ -0,0 +1,125 @@
+#include "stdafx.h"
+#include "ExEntityTable.h"
+
+ExEntityTable::ExEntityTable() :
+	m_pPkMapper(NULL),
+	m_body(PK_ENTITY_null),
+	m_bBuilt(false),
+	m_minTag(0)
+{
+}
+
+ExEntityTable::~ExEntityTable()
+{
+}
+
+void ExEntityTable::Clear()
+{
+	m_pPkMapper = NULL;
+	m_body = PK_ENTITY_null;
+	m_bBuilt = false;
+	m_minTag = 0;
+	std::vector<A3DEntity*>().swap(m_a3dArr);
+	std::unordered_map<A3DEntity*, PK_ENTITY_t>().swap(m_pkMap);
+}
+
+void ExEntityTable::addTopols(const int topolCnt, const PK_TOPOL_t* topols)
+{
+	for (int i = 0; i < topolCnt; i++)
+	{
+		int iNbA3DEntities = 0;
+		A3DEntity** ppEntities = NULL;
+		A3DStatus status = A3DMiscPKMapperGetA3DEntitiesFromPKEntity(m_pPkMapper, topols[i], &iNbA3DEntities, &ppEntities);
+		if (A3D_SUCCESS != status || 0 == iNbA3DEntities)
+			continue;
+
+		m_a3dArr[topols[i] - m_minTag] = ppEntities[0];
+
+		for (int j = 0; j < iNbA3DEntities; j++)
+			m_pkMap[ppEntities[j]] = topols[i];
+	}
+}
+
+bool ExEntityTable::Build(A3DMiscPKMapper* pPkMapper, const PK_BODY_t body)
+{
+	Clear();
+
+	if (NULL == pPkMapper || PK_ENTITY_null == body)
+		return false;
+
+	int faceCnt = 0, edgeCnt = 0;
+	PK_FACE_t* faces = NULL;
+	PK_EDGE_t* edges = NULL;
+	if (PK_ERROR_no_errors != PK_BODY_ask_faces(body, &faceCnt, &faces))
+		return false;
+	if (PK_ERROR_no_errors != PK_BODY_ask_edges(body, &edgeCnt, &edges))
+	{
+		if (faceCnt)
+			PK_MEMORY_free(faces);
+		return false;
+	}
+
+	PK_ENTITY_t minTag = 0, maxTag = -1;
+	for (int i = 0; i < faceCnt + edgeCnt; i++)
+	{
+		PK_ENTITY_t tag = (i < faceCnt) ? faces[i] : edges[i - faceCnt];
+		if (0 == i || tag < minTag)
+			minTag = tag;
+		if (0 == i || maxTag < tag)
+			maxTag = tag;
+	}
+
+	m_pPkMapper = pPkMapper;
+	m_body = body;
+	m_minTag = minTag;
+	if (minTag <= maxTag)
+		m_a3dArr.assign(maxTag - minTag + 1, NULL);
+	m_pkMap.reserve(faceCnt + edgeCnt);
+
+	addTopols(faceCnt, faces);
+	addTopols(edgeCnt, edges);
+
+	if (faceCnt)
+		PK_MEMORY_free(faces);
+	if (edgeCnt)
+		PK_MEMORY_free(edges);
+
+	m_bBuilt = true;
+	return true;
+}
+
+bool ExEntityTable::ToPk(const int entityCnt, A3DEntity* const* ppEntities, PK_ENTITY_t* pkEntities) const
+{
+	bool bAll = true;
+	for (int i = 0; i < entityCnt; i++)
+	{
+		auto it = m_pkMap.find(ppEntities[i]);
+		if (m_pkMap.end() == it)
+		{
+			pkEntities[i] = PK_ENTITY_null;
+			bAll = false;
+		}
+		else
+			pkEntities[i] = it->second;
+	}
+
+	return bAll;
+}
+
+bool ExEntityTable::ToA3D(const int entityCnt, const PK_ENTITY_t* pkEntities, A3DEntity** ppEntities) const
+{
+	bool bAll = true;
+	for (int i = 0; i < entityCnt; i++)
+	{
+		ppEntities[i] = NULL;
+
+		PK_ENTITY_t index = pkEntities[i] - m_minTag;
+		if (0 <= index && (size_t)index < m_a3dArr.size())
+			ppEntities[i] = m_a3dArr[index];
+
+		if (NULL == ppEntities[i])
+			bAll = false;
+	}
+
+	return bAll;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <A3DSDKIncludes.h>
+#include "parasolid_kernel.h"
+#include <unordered_map>
+#include <vector>
+
+// A3D topology <=> PK tag of the faces and edges of one body, read once from its PK mapper.
+// PK tags are small integers, the PK => A3D side is a dense array indexed by the tag.
+class ExEntityTable
+{
+public:
+	ExEntityTable();
+	~ExEntityTable();
+
+private:
+	A3DMiscPKMapper* m_pPkMapper;
+	PK_BODY_t m_body;
+	bool m_bBuilt;
+	PK_ENTITY_t m_minTag;
+	std::vector<A3DEntity*> m_a3dArr;	// Indexed by tag - m_minTag
+	std::unordered_map<A3DEntity*, PK_ENTITY_t> m_pkMap;
+
+	void addTopols(const int topolCnt, const PK_TOPOL_t* topols);
+
+public:
+	bool Build(A3DMiscPKMapper* pPkMapper, const PK_BODY_t body);
+	void Clear();
+	bool IsBuiltFor(const A3DMiscPKMapper* pPkMapper) const { return m_bBuilt && pPkMapper == m_pPkMapper; }
+
+	// An entity out of the table gives PK_ENTITY_null / NULL, return true if all of them were found
+	bool ToPk(const int entityCnt, A3DEntity* const* ppEntities, PK_ENTITY_t* pkEntities) const;
+	bool ToA3D(const int entityCnt, const PK_ENTITY_t* pkEntities, A3DEntity** ppEntities) const;
+};
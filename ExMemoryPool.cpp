@@ -0,0 +1,420 @@
+#include "stdafx.h"
+#include "ExMemoryPool.h"
+#include "A3DSDKIncludes.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define EX_MEMORY_MAGIC 0x45584D4Du
+#define EX_MEMORY_BIN_CNT 13
+#define EX_MEMORY_HEAP_BIN 0xFFFFFFFFu
+#define EX_MEMORY_CHUNK_BYTES (64 * 1024)
+#define EX_MEMORY_BATCH 32				// Blocks moved at once between a thread cache and the shared bin
+#define EX_MEMORY_CACHE_MAX 128			// Free blocks a thread keeps per bin
+#define EX_MEMORY_PUBLISH_OPS 64		// Operations of a thread between two publications of its counters
+
+// Put in front of every block, a free block links the next one in its first bytes
+struct ExMemoryHeader
+{
+	uint32_t bin;
+	uint32_t magic;
+	uint64_t bytes;
+};
+
+#define EX_MEMORY_NEXT(pHeader) (*(ExMemoryHeader**)((pHeader) + 1))
+
+static const size_t s_binBytes[EX_MEMORY_BIN_CNT] = { 16, 32, 48, 64, 80, 96, 112, 128, 256, 512, 1024, 2048, 4096 };
+
+struct ExMemorySharedBin
+{
+	std::mutex mutex;
+	ExMemoryHeader* pHead = NULL;
+};
+
+static ExMemorySharedBin s_sharedBins[EX_MEMORY_BIN_CNT];
+static ExMemoryMode s_mode = ExMemoryMode::POOL;
+static bool s_bRegistered = false;
+
+static std::atomic<long long> s_liveBytes(0);
+static std::atomic<long long> s_peakBytes(0);
+static std::atomic<long long> s_reservedBytes(0);
+static std::atomic<long long> s_allocBytes(0);
+static std::atomic<unsigned long long> s_allocCnt(0);
+static std::atomic<unsigned long long> s_freeCnt(0);
+
+// Outermost scope
+static std::atomic<int> s_scopeDepth(0);
+static std::atomic<long long> s_scopePeak(0);
+static ExMemoryScopeStats s_scopeStats;
+static long long s_scopeBaseLive = 0;
+static std::chrono::steady_clock::time_point s_scopeStart;
+static std::mutex s_statsMutex;
+static ExMemoryScopeStats s_lastScopeStats;
+static bool s_bDump = false;
+
+static void stUpdateMax(std::atomic<long long>& value, const long long candidate)
+{
+	long long current = value.load();
+	while (current < candidate && !value.compare_exchange_weak(current, candidate)) {}
+}
+
+static void stPublish(const long long liveDelta, const long long allocBytes, const unsigned long long allocCnt, const unsigned long long freeCnt)
+{
+	long long live = s_liveBytes.fetch_add(liveDelta) + liveDelta;
+	s_allocBytes += allocBytes;
+	s_allocCnt += allocCnt;
+	s_freeCnt += freeCnt;
+
+	stUpdateMax(s_peakBytes, live);
+	stUpdateMax(s_scopePeak, live);
+}
+
+// Free blocks and counters of a thread
+struct ExMemoryThreadCache
+{
+	ExMemoryHeader* pHead[EX_MEMORY_BIN_CNT];
+	int cnt[EX_MEMORY_BIN_CNT];
+	long long liveDelta;
+	long long allocBytes;
+	unsigned long long allocCnt;
+	unsigned long long freeCnt;
+	int opCnt;
+
+	ExMemoryThreadCache();
+	~ExMemoryThreadCache();
+
+	void Publish();
+	void Count();
+	ExMemoryHeader* Pop(const uint32_t bin);
+	void Push(ExMemoryHeader* pHeader);
+};
+
+// The cache of a thread is destroyed before the other thread_local objects which may still free blocks
+static thread_local bool s_bCacheGone = false;
+static thread_local ExMemoryThreadCache s_cache;
+
+ExMemoryThreadCache::ExMemoryThreadCache() :
+	liveDelta(0),
+	allocBytes(0),
+	allocCnt(0),
+	freeCnt(0),
+	opCnt(0)
+{
+	for (int i = 0; i < EX_MEMORY_BIN_CNT; i++)
+	{
+		pHead[i] = NULL;
+		cnt[i] = 0;
+	}
+}
+
+ExMemoryThreadCache::~ExMemoryThreadCache()
+{
+	// Give the free blocks back to the shared bins
+	for (int i = 0; i < EX_MEMORY_BIN_CNT; i++)
+	{
+		if (NULL == pHead[i])
+			continue;
+
+		ExMemoryHeader* pTail = pHead[i];
+		while (NULL != EX_MEMORY_NEXT(pTail))
+			pTail = EX_MEMORY_NEXT(pTail);
+
+		std::lock_guard<std::mutex> lock(s_sharedBins[i].mutex);
+		EX_MEMORY_NEXT(pTail) = s_sharedBins[i].pHead;
+		s_sharedBins[i].pHead = pHead[i];
+		pHead[i] = NULL;
+	}
+
+	Publish();
+	s_bCacheGone = true;
+}
+
+void ExMemoryThreadCache::Publish()
+{
+	stPublish(liveDelta, allocBytes, allocCnt, freeCnt);
+
+	liveDelta = 0;
+	allocBytes = 0;
+	allocCnt = 0;
+	freeCnt = 0;
+	opCnt = 0;
+}
+
+void ExMemoryThreadCache::Count()
+{
+	if (EX_MEMORY_PUBLISH_OPS <= ++opCnt)
+		Publish();
+}
+
+ExMemoryHeader* ExMemoryThreadCache::Pop(const uint32_t bin)
+{
+	if (NULL == pHead[bin])
+	{
+		// Refill from the shared bin
+		ExMemorySharedBin& sharedBin = s_sharedBins[bin];
+		{
+			std::lock_guard<std::mutex> lock(sharedBin.mutex);
+			for (int i = 0; i < EX_MEMORY_BATCH && NULL != sharedBin.pHead; i++)
+			{
+				ExMemoryHeader* pHeader = sharedBin.pHead;
+				sharedBin.pHead = EX_MEMORY_NEXT(pHeader);
+
+				EX_MEMORY_NEXT(pHeader) = pHead[bin];
+				pHead[bin] = pHeader;
+				cnt[bin]++;
+			}
+		}
+
+		// Or carve a new chunk
+		if (NULL == pHead[bin])
+		{
+			size_t blockBytes = sizeof(ExMemoryHeader) + s_binBytes[bin];
+			size_t blockCnt = EX_MEMORY_CHUNK_BYTES / blockBytes;
+			char* pChunk = (char*)malloc(blockCnt * blockBytes);
+			if (NULL == pChunk)
+				return NULL;
+
+			for (size_t i = 0; i < blockCnt; i++)
+			{
+				ExMemoryHeader* pHeader = (ExMemoryHeader*)(pChunk + i * blockBytes);
+				pHeader->bin = bin;
+				EX_MEMORY_NEXT(pHeader) = pHead[bin];
+				pHead[bin] = pHeader;
+			}
+			cnt[bin] += (int)blockCnt;
+			s_reservedBytes += (long long)(blockCnt * blockBytes);
+		}
+	}
+
+	ExMemoryHeader* pHeader = pHead[bin];
+	pHead[bin] = EX_MEMORY_NEXT(pHeader);
+	cnt[bin]--;
+
+	return pHeader;
+}
+
+void ExMemoryThreadCache::Push(ExMemoryHeader* pHeader)
+{
+	uint32_t bin = pHeader->bin;
+
+	EX_MEMORY_NEXT(pHeader) = pHead[bin];
+	pHead[bin] = pHeader;
+	cnt[bin]++;
+
+	if (EX_MEMORY_CACHE_MAX < cnt[bin])
+	{
+		// Give a batch back to the shared bin, blocks freed by a thread which doesn't allocate return to the others
+		ExMemoryHeader* pFirst = pHead[bin];
+		ExMemoryHeader* pLast = pFirst;
+		for (int i = 1; i < EX_MEMORY_BATCH; i++)
+			pLast = EX_MEMORY_NEXT(pLast);
+
+		pHead[bin] = EX_MEMORY_NEXT(pLast);
+		cnt[bin] -= EX_MEMORY_BATCH;
+
+		ExMemorySharedBin& sharedBin = s_sharedBins[bin];
+		std::lock_guard<std::mutex> lock(sharedBin.mutex);
+		EX_MEMORY_NEXT(pLast) = sharedBin.pHead;
+		sharedBin.pHead = pFirst;
+	}
+}
+
+static uint32_t stBin(const size_t n_bytes)
+{
+	if (n_bytes <= 128)
+		return (0 == n_bytes) ? 0 : (uint32_t)((n_bytes - 1) / 16);
+
+	for (uint32_t bin = 8; bin < EX_MEMORY_BIN_CNT; bin++)
+	{
+		if (n_bytes <= s_binBytes[bin])
+			return bin;
+	}
+
+	return EX_MEMORY_HEAP_BIN;
+}
+
+bool ExMemoryPool::Register(const ExMemoryMode mode)
+{
+	s_mode = mode;
+
+	s_bRegistered = (A3D_SUCCESS == A3DDllSetCallbacksMemory(stAlloc, stFree));
+	return s_bRegistered;
+}
+
+void ExMemoryPool::Free(void* pointer)
+{
+	// Without the callbacks Exchange allocates with malloc
+	if (s_bRegistered)
+		stFree(pointer);
+	else
+		free(pointer);
+}
+
+ExMemoryMode ExMemoryPool::GetMode()
+{
+	return s_mode;
+}
+
+ExMemoryStats ExMemoryPool::GetStats()
+{
+	if (!s_bCacheGone)
+		s_cache.Publish();
+
+	ExMemoryStats stats;
+	stats.liveBytes = s_liveBytes;
+	stats.peakBytes = s_peakBytes;
+	stats.reservedBytes = s_reservedBytes;
+	stats.allocCnt = s_allocCnt;
+	stats.freeCnt = s_freeCnt;
+
+	return stats;
+}
+
+ExMemoryScopeStats ExMemoryPool::GetLastScopeStats()
+{
+	std::lock_guard<std::mutex> lock(s_statsMutex);
+	return s_lastScopeStats;
+}
+
+void ExMemoryPool::SetDump(const bool bDump)
+{
+	std::lock_guard<std::mutex> lock(s_statsMutex);
+	s_bDump = bDump;
+}
+
+void* ExMemoryPool::stAlloc(size_t n_bytes)
+{
+	uint32_t bin = (ExMemoryMode::POOL == s_mode) ? stBin(n_bytes) : EX_MEMORY_HEAP_BIN;
+
+	ExMemoryHeader* pHeader = NULL;
+	if (EX_MEMORY_HEAP_BIN == bin)
+	{
+		pHeader = (ExMemoryHeader*)malloc(sizeof(ExMemoryHeader) + n_bytes);
+		if (NULL != pHeader)
+			pHeader->bin = EX_MEMORY_HEAP_BIN;
+	}
+	else if (!s_bCacheGone)
+	{
+		pHeader = s_cache.Pop(bin);
+	}
+	else
+	{
+		// Thread ending, straight from the shared bin
+		ExMemorySharedBin& sharedBin = s_sharedBins[bin];
+		std::lock_guard<std::mutex> lock(sharedBin.mutex);
+		pHeader = sharedBin.pHead;
+		if (NULL != pHeader)
+			sharedBin.pHead = EX_MEMORY_NEXT(pHeader);
+		else if (NULL != (pHeader = (ExMemoryHeader*)malloc(sizeof(ExMemoryHeader) + s_binBytes[bin])))
+			pHeader->bin = bin;
+	}
+
+	if (NULL == pHeader)
+		return NULL;
+
+	pHeader->magic = EX_MEMORY_MAGIC;
+	pHeader->bytes = n_bytes;
+
+	if (!s_bCacheGone)
+	{
+		s_cache.liveDelta += (long long)n_bytes;
+		s_cache.allocBytes += (long long)n_bytes;
+		s_cache.allocCnt++;
+		s_cache.Count();
+	}
+	else
+	{
+		stPublish((long long)n_bytes, (long long)n_bytes, 1, 0);
+	}
+
+	return pHeader + 1;
+}
+
+void ExMemoryPool::stFree(void* pointer)
+{
+	if (NULL == pointer)
+		return;
+
+	ExMemoryHeader* pHeader = (ExMemoryHeader*)pointer - 1;
+	if (EX_MEMORY_MAGIC != pHeader->magic)
+		return;
+
+	// A freed block can't be taken for a live one
+	pHeader->magic = 0;
+	long long bytes = (long long)pHeader->bytes;
+
+	if (EX_MEMORY_HEAP_BIN == pHeader->bin)
+	{
+		free(pHeader);
+	}
+	else if (!s_bCacheGone)
+	{
+		s_cache.Push(pHeader);
+	}
+	else
+	{
+		ExMemorySharedBin& sharedBin = s_sharedBins[pHeader->bin];
+		std::lock_guard<std::mutex> lock(sharedBin.mutex);
+		EX_MEMORY_NEXT(pHeader) = sharedBin.pHead;
+		sharedBin.pHead = pHeader;
+	}
+
+	if (!s_bCacheGone)
+	{
+		s_cache.liveDelta -= bytes;
+		s_cache.freeCnt++;
+		s_cache.Count();
+	}
+	else
+	{
+		stPublish(-bytes, 0, 0, 1);
+	}
+}
+
+ExMemoryScope::ExMemoryScope(const char* name)
+{
+	m_bOutermost = 0 == s_scopeDepth.fetch_add(1);
+	if (!m_bOutermost)
+		return;
+
+	ExMemoryStats stats = ExMemoryPool::GetStats();
+
+	std::lock_guard<std::mutex> lock(s_statsMutex);
+	s_scopeStats = ExMemoryScopeStats();
+	s_scopeStats.name = name;
+	s_scopeStats.allocCnt = stats.allocCnt;
+	s_scopeStats.allocBytes = s_allocBytes;
+	s_scopeBaseLive = stats.liveBytes;
+	s_scopePeak = stats.liveBytes;
+	s_scopeStart = std::chrono::steady_clock::now();
+}
+
+ExMemoryScope::~ExMemoryScope()
+{
+	s_scopeDepth--;
+	if (!m_bOutermost)
+		return;
+
+	ExMemoryStats stats = ExMemoryPool::GetStats();
+
+	std::lock_guard<std::mutex> lock(s_statsMutex);
+	ExMemoryScopeStats& scopeStats = s_lastScopeStats;
+	scopeStats.name = s_scopeStats.name;
+	scopeStats.allocCnt = stats.allocCnt - s_scopeStats.allocCnt;
+	scopeStats.allocBytes = s_allocBytes - s_scopeStats.allocBytes;
+	scopeStats.peakBytes = s_scopePeak - s_scopeBaseLive;
+	scopeStats.netBytes = stats.liveBytes - s_scopeBaseLive;
+	scopeStats.msec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - s_scopeStart).count();
+
+	if (s_bDump)
+	{
+		char buf[256];
+		snprintf(buf, sizeof(buf), "ExMemory %s (%s): %llu allocs, %lld bytes, peak %lld bytes, net %lld bytes, %.1f ms\n",
+			scopeStats.name, (ExMemoryMode::POOL == s_mode) ? "pool" : "heap", scopeStats.allocCnt, scopeStats.allocBytes,
+			scopeStats.peakBytes, scopeStats.netBytes, scopeStats.msec);
+		OutputDebugStringA(buf);
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+
+enum class ExMemoryMode
+{
+	POOL,		// Size class bins with per-thread caches
+	HEAP		// Plain malloc / free with the same counters, to compare with
+};
+
+// Counters of the whole session. The threads publish theirs every few operations,
+// so the live bytes and the peak are accurate within a few KB per thread
+struct ExMemoryStats
+{
+	long long liveBytes = 0;
+	long long peakBytes = 0;
+	long long reservedBytes = 0;		// Chunks of the bins, never given back
+	unsigned long long allocCnt = 0;
+	unsigned long long freeCnt = 0;
+};
+
+// Counters of one traversal or translation, all the threads together
+struct ExMemoryScopeStats
+{
+	const char* name = "";
+	unsigned long long allocCnt = 0;
+	long long allocBytes = 0;
+	long long peakBytes = 0;			// Above the live bytes at the start of the scope
+	long long netBytes = 0;				// Still alive at the end of the scope
+	double msec = 0.0;
+};
+
+// Memory callbacks of HOOPS Exchange. Blocks up to 4096 bytes come from size class bins,
+// each thread keeps a cache of free blocks per bin and exchanges them with the shared bins by batches.
+// Register has to be called before A3DDllInitialize, Exchange mustn't free a block of another allocator.
+class ExMemoryPool
+{
+public:
+	static bool Register(const ExMemoryMode mode);
+	static ExMemoryMode GetMode();
+	// Give back an array Exchange allocated for the caller
+	static void Free(void* pointer);
+	static ExMemoryStats GetStats();
+	static ExMemoryScopeStats GetLastScopeStats();
+	// Write a line per closed scope to the debugger output
+	static void SetDump(const bool bDump);
+
+private:
+	static void* stAlloc(size_t n_bytes);
+	static void stFree(void* pointer);
+};
+
+// Traversal or translation measured on all the threads, nested scopes belong to the outermost one
+class ExMemoryScope
+{
+public:
+	ExMemoryScope(const char* name);
+	~ExMemoryScope();
+
+private:
+	bool m_bOutermost;
+};
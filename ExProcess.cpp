@@ -1,42 +1,83 @@
 #include "ExProcess.h"
+#include "ExMemoryPool.h"
+#include "PerfTrace.h"
+#include <set>
 
-A3DRiBrepModel* SearchBrepModelFromTopoBrep(A3DAsmModelFile* pModelFile, A3DTopoBrepData* pTopoBrep)
+static bool IsBodyAlive(const PK_BODY_t body)
 {
-	A3DStatus ex_status;
+	PK_CLASS_t entity_class;
+	return PK_ERROR_no_errors == PK_ENTITY_ask_class(body, &entity_class) && PK_CLASS_body == entity_class;
+}
+
+static void ResetPipelineResult(ExPipelineResult& result)
+{
+	result.bSucceeded = false;
+	result.bCancelled = false;
+	result.failedOp = -1;
+	result.bBodiesAdded = false;
+	result.pNewModelFile = NULL;
+	result.updatedArr.clear();
+	result.deletedArr.clear();
+	result.timings.kernelMsec = 0.0;
+	result.timings.translateMsec = 0.0;
+	result.timings.tessellateMsec = 0.0;
+	result.timings.refreshMsec = 0.0;
+}
+
+static void CollectRiBrepModels(A3DRiRepresentationItem* pRiItem, std::vector<A3DRiBrepModel*>& riBrepModelArr)
+{
+	A3DEEntityType eType;
+	if (A3D_SUCCESS != A3DEntityGetType(pRiItem, &eType))
+		return;
+
+	if (kA3DTypeRiBrepModel == eType)
+	{
+		riBrepModelArr.push_back((A3DRiBrepModel*)pRiItem);
+	}
+	else if (kA3DTypeRiSet == eType)
+	{
+		A3DRiSetData sSetData;
+		A3D_INITIALIZE_DATA(A3DRiSetData, sSetData);
+		if (A3D_SUCCESS != A3DRiSetGet(pRiItem, &sSetData))
+			return;
 
-	A3DAsmModelFileData sModelFileData;
-	A3D_INITIALIZE_DATA(A3DAsmModelFileData, sModelFileData);
-	if (A3D_SUCCESS != A3DAsmModelFileGet(pModelFile, &sModelFileData))
-		return nullptr;
+		for (A3DUns32 ui = 0; ui < sSetData.m_uiRepItemsSize; ui++)
+			CollectRiBrepModels(sSetData.m_ppRepItems[ui], riBrepModelArr);
 
-	A3DAsmProductOccurrenceData sPOData;
-	A3D_INITIALIZE_DATA(A3DAsmProductOccurrenceData, sPOData);
-	if (A3DAsmProductOccurrenceGet(sModelFileData.m_ppPOccurrences[0], &sPOData))
-		return nullptr;
+		A3DRiSetGet(NULL, &sSetData);
+	}
+}
 
-	A3DAsmPartDefinitionData sPartData;
-	A3D_INITIALIZE_DATA(A3DAsmPartDefinitionData, sPartData);
-	if (A3DAsmPartDefinitionGet(sPOData.m_pPart, &sPartData))
-		return nullptr;
+static void CollectRiBrepModels(A3DAsmProductOccurrence* pPO, std::unordered_set<A3DEntity*>& visitedSet, std::vector<A3DRiBrepModel*>& riBrepModelArr)
+{
+	if (NULL == pPO || !visitedSet.insert(pPO).second)
+		return;
 
-	A3DRiRepresentationItem* pRi = sPartData.m_ppRepItems[0];
-	A3DEEntityType eType;
-	ex_status = A3DEntityGetType(pRi, &eType);
+	A3DAsmProductOccurrenceData sPoData;
+	A3D_INITIALIZE_DATA(A3DAsmProductOccurrenceData, sPoData);
+	if (A3D_SUCCESS != A3DAsmProductOccurrenceGet(pPO, &sPoData))
+		return;
 
-	if (A3DEEntityType::kA3DTypeRiBrepModel != eType)
-		return nullptr;
+	if (NULL != sPoData.m_pPart && visitedSet.insert(sPoData.m_pPart).second)
+	{
+		A3DAsmPartDefinitionData sPartData;
+		A3D_INITIALIZE_DATA(A3DAsmPartDefinitionData, sPartData);
+		if (A3D_SUCCESS == A3DAsmPartDefinitionGet(sPoData.m_pPart, &sPartData))
+		{
+			for (A3DUns32 ui = 0; ui < sPartData.m_uiRepItemsSize; ui++)
+				CollectRiBrepModels(sPartData.m_ppRepItems[ui], riBrepModelArr);
 
-	A3DRiBrepModel* pRiBrepModel = (A3DRiBrepModel*)pRi;
+			A3DAsmPartDefinitionGet(NULL, &sPartData);
+		}
+	}
 
-	A3DRiBrepModelData sRiBrepModelData;
-	A3D_INITIALIZE_DATA(A3DRiBrepModelData, sRiBrepModelData);
-	if (A3DRiBrepModelGet(pRiBrepModel, &sRiBrepModelData))
-		return nullptr;
+	CollectRiBrepModels(sPoData.m_pPrototype, visitedSet, riBrepModelArr);
+	CollectRiBrepModels(sPoData.m_pExternalData, visitedSet, riBrepModelArr);
 
-	if (sRiBrepModelData.m_pBrepData = pTopoBrep)
-		return pRiBrepModel;
+	for (A3DUns32 ui = 0; ui < sPoData.m_uiPOccurrencesSize; ui++)
+		CollectRiBrepModels(sPoData.m_ppPOccurrences[ui], visitedSet, riBrepModelArr);
 
-	return nullptr;
+	A3DAsmProductOccurrenceGet(NULL, &sPoData);
 }
 
 ExProcess::ExProcess()
@@ -44,29 +85,53 @@ ExProcess::ExProcess()
 	m_pModelFile = NULL;
 	m_bIsPart = false;
 	m_pPsProcess = new PsProcess();
+	m_iOperationDepth = 0;
+	m_iStepIdAtStart = -1;
+	m_bodyLifecycle.SetBudget((size_t)1024 * 1024 * 1024);
+	clearPipeline();
 }
 
 ExProcess::~ExProcess()
 {
+	m_prefetcher.Stop();
 	delete m_pPsProcess;
 }
 
+void ExProcess::Terminate()
+{
+	m_prefetcher.Stop();
+	m_pPsProcess->Terminate();
+}
+
 void ExProcess::Initialize()
 {
+	m_prefetcher.Clear();
+	m_bodyLifecycle.Clear();
+	m_pinnedArr.clear();
+	m_tessPolicy.Clear();
 	m_pPsProcess->Initialize();
 
 	if (NULL != m_pModelFile)
 		m_pModelFile = NULL;
 
-	std::map<A3DRiBrepModel*, PK_BODY_t>().swap(m_bodyMap);
-	std::map<A3DRiBrepModel*, A3DMiscPKMapper*>().swap(m_mapperMap);
-
+	m_bodyRegistry.Clear();
+	m_entityTableMap.clear();
+	m_mapperRefMap.clear();
+	// Not deleted, the closed model may still reference their entities
+	m_linkedModelFileArr.clear();
+	m_brepModelFileMap.clear();
+	clearPipeline();
+
+	// The journal of the kernel is cleared too
+	m_deltaArr.clear();
+	m_curDelta = ExJournalDelta();
 }
 
 void ExProcess::SetModelFile(A3DAsmModelFile* pModelFile)
 {
 	A3DStatus status;
 	
+	m_prefetcher.Clear();
 	m_pModelFile = pModelFile;
 
 	// Get model file data
@@ -85,82 +150,546 @@ void ExProcess::SetModelFile(A3DAsmModelFile* pModelFile)
 	else
 		m_bIsPart = false;
 
+	// Tessellated by the import, refined when the view asks
+	m_tessPolicy.Clear();
+	std::vector<A3DRiBrepModel*> riBrepModelArr;
+	std::unordered_set<A3DEntity*> visitedSet;
+	for (A3DUns32 ui = 0; ui < sData.m_uiPOccurrencesSize; ui++)
+		CollectRiBrepModels(sData.m_ppPOccurrences[ui], visitedSet, riBrepModelArr);
+
+	for (size_t i = 0; i < riBrepModelArr.size(); i++)
+		m_tessPolicy.Register((A3DRiRepresentationItem*)riBrepModelArr[i]);
+
 	A3DAsmProductOccurrenceGet(NULL, &sPoData);
 	A3DAsmModelFileGet(NULL, &sData);
 }
 
-PK_BODY_t ExProcess::getPkBodyFromRiBrepModel(A3DRiBrepModel* pRiBrepModel, bool translateIfNotThere)
+bool ExProcess::RefineTessellation(const double pixelsPerUnit, const size_t maxCnt, std::vector<A3DRiBrepModel*>& refinedArr)
+{
+	PERF_TRACE_SCOPE("ex", "ExProcess::RefineTessellation");
+
+	OperationScope scope(this);
+
+	m_tessPolicy.SetViewScale(pixelsPerUnit);
+
+	std::vector<A3DRiRepresentationItem*> riItemArr;
+	m_tessPolicy.FindRefinements(maxCnt, riItemArr);
+
+	for (size_t i = 0; i < riItemArr.size(); i++)
+	{
+		if (A3D_SUCCESS == m_tessPolicy.Tessellate(riItemArr[i], false))
+			refinedArr.push_back((A3DRiBrepModel*)riItemArr[i]);
+	}
+
+	return 0 < refinedArr.size();
+}
+
+ExProcess::OperationScope::OperationScope(ExProcess* pProcess) :
+	m_pProcess(pProcess),
+	m_kernelLock(pProcess->m_prefetcher.GetKernelMutex())
+{
+	if (0 == m_pProcess->m_iOperationDepth++)
+	{
+		m_pProcess->m_curDelta = ExJournalDelta();
+		m_pProcess->m_iStepIdAtStart = m_pProcess->m_pPsProcess->GetJournalStepId();
+	}
+}
+
+ExProcess::OperationScope::~OperationScope()
+{
+	if (0 == --m_pProcess->m_iOperationDepth)
+		m_pProcess->endOperation();
+}
+
+void ExProcess::endOperation()
+{
+	// The operation made a journal step
+	const int stepId = m_pPsProcess->GetJournalStepId();
+	if (0 <= stepId && stepId != m_iStepIdAtStart)
+		recordDelta(stepId);
+	m_curDelta = ExJournalDelta();
+
+	for (size_t i = 0; i < m_pinnedArr.size(); i++)
+		m_bodyLifecycle.Release(m_pinnedArr[i]);
+	m_pinnedArr.clear();
+
+	// The bodies of the journal steps are kept: going back to a mark brings back the bodies it had, which have to
+	// be the ones of the registry. The others come back unused, their Brep is translated again at the next use
+	std::unordered_set<A3DRiBrepModel*> keepSet;
+	for (size_t i = 0; i < m_deltaArr.size(); i++)
+	{
+		const ExJournalDelta& delta = m_deltaArr[i];
+		for (size_t j = 0; j < delta.updatedArr.size(); j++)
+			keepSet.insert(m_bodyRegistry.FindRiBrepModel(delta.updatedArr[j]));
+		for (size_t j = 0; j < delta.addedArr.size(); j++)
+			keepSet.insert(m_bodyRegistry.FindRiBrepModel(delta.addedArr[j]));
+	}
+
+	std::vector<A3DRiBrepModel*> evictArr;
+	m_bodyLifecycle.SelectEvictions(keepSet, evictArr);
+
+	for (size_t i = 0; i < evictArr.size(); i++)
+		evictBody(evictArr[i]);
+}
+
+void ExProcess::recordDelta(const int stepId)
+{
+	// The undone steps were discarded by the new one, the oldest ones were pruned by the journal
+	while (m_deltaArr.size() && m_iStepIdAtStart < m_deltaArr.back().stepId)
+		m_deltaArr.pop_back();
+
+	const int oldestId = m_pPsProcess->GetJournalOldestId();
+	while (m_deltaArr.size() && m_deltaArr.front().stepId < oldestId)
+		m_deltaArr.pop_front();
+
+	m_curDelta.stepId = stepId;
+	m_deltaArr.push_back(m_curDelta);
+}
+
+const ExJournalDelta* ExProcess::findDelta(const int stepId) const
+{
+	for (auto it = m_deltaArr.rbegin(); it != m_deltaArr.rend(); ++it)
+	{
+		if (stepId == it->stepId)
+			return &(*it);
+	}
+
+	return NULL;
+}
+
+void ExProcess::dropDeadBodies()
+{
+	// Translated after the mark which was gone to, the Breps are still there and are translated again at the next use
+	std::vector<A3DRiBrepModel*> riBrepModelArr;
+	m_bodyRegistry.GetRiBrepModels(riBrepModelArr);
+
+	for (size_t i = 0; i < riBrepModelArr.size(); i++)
+	{
+		A3DRiBrepModel* pRiBrepModel = riBrepModelArr[i];
+		if (IsBodyAlive(m_bodyRegistry.FindBody(pRiBrepModel)))
+			continue;
+
+		releaseMapper(m_bodyRegistry.FindMapper(pRiBrepModel));
+
+		m_bodyRegistry.Remove(pRiBrepModel);
+		m_entityTableMap.erase(pRiBrepModel);
+		m_bodyLifecycle.Remove(pRiBrepModel);
+	}
+}
+
+void ExProcess::replayDelta(const ExJournalDelta& delta, const bool bUndo, ExPipelineResult& result)
+{
+	// Bodies added by an undone step (or removed by a redone one) are gone, the others are back
+	const std::vector<PK_BODY_t>& goneBodyArr = bUndo ? delta.addedArr : delta.removedArr;
+	const std::vector<PK_BODY_t>& backBodyArr = bUndo ? delta.removedArr : delta.addedArr;
+
+	for (size_t i = 0; i < goneBodyArr.size(); i++)
+	{
+		A3DRiBrepModel* pRiBrepModel = m_bodyRegistry.FindRiBrepModel(goneBodyArr[i]);
+		if (NULL == pRiBrepModel)
+			continue;
+
+		forgetBody(pRiBrepModel);
+		result.deletedArr.push_back(pRiBrepModel);
+	}
+
+	dropDeadBodies();
+
+	for (size_t i = 0; i < delta.updatedArr.size(); i++)
+	{
+		A3DRiBrepModel* pRiBrepModel = m_bodyRegistry.FindRiBrepModel(delta.updatedArr[i]);
+		if (NULL != pRiBrepModel && updatePkBodyToA3DRiBrepModel(delta.updatedArr[i], pRiBrepModel))
+			result.updatedArr.push_back(pRiBrepModel);
+	}
+
+	if (backBodyArr.size())
+	{
+		addBodies((int)backBodyArr.size(), backBodyArr.data(), result.pNewModelFile);
+		result.bBodiesAdded = true;
+	}
+}
+
+bool ExProcess::stepJournal(const bool bUndo, ExPipelineResult& result)
+{
+	OperationScope scope(this);
+
+	ResetPipelineResult(result);
+
+	if (m_pipeline.bActive)
+		return false;
+
+	// The delta of an undone step is the one of the current step before the cursor moves
+	ExJournalDelta delta;
+	if (bUndo)
+	{
+		const ExJournalDelta* pDelta = findDelta(m_pPsProcess->GetJournalStepId());
+		if (NULL != pDelta)
+			delta = *pDelta;
+	}
+
+	{
+		PerfTraceSpan kernelSpan("ex", "stepJournal kernel", true);
+
+		PsJournalStep step;
+		if (!(bUndo ? m_pPsProcess->Undo(step) : m_pPsProcess->Redo(step)))
+			return false;
+
+		result.timings.kernelMsec = kernelSpan.ElapsedMsec();
+	}
+
+	if (!bUndo)
+	{
+		const ExJournalDelta* pDelta = findDelta(m_pPsProcess->GetJournalStepId());
+		if (NULL != pDelta)
+			delta = *pDelta;
+	}
+
+	PerfTraceSpan translateSpan("ex", "stepJournal translate", true);
+
+	m_pipeline.tessMsec = 0.0;
+	replayDelta(delta, bUndo, result);
+
+	// Not a new step for endOperation
+	m_iStepIdAtStart = m_pPsProcess->GetJournalStepId();
+
+	result.timings.tessellateMsec = m_pipeline.tessMsec;
+	result.timings.translateMsec = translateSpan.ElapsedMsec() - m_pipeline.tessMsec;
+	result.bSucceeded = true;
+
+	return true;
+}
+
+bool ExProcess::Undo(ExPipelineResult& result)
+{
+	PERF_TRACE_SCOPE("ex", "ExProcess::Undo");
+
+	return stepJournal(true, result);
+}
+
+bool ExProcess::Redo(ExPipelineResult& result)
+{
+	PERF_TRACE_SCOPE("ex", "ExProcess::Redo");
+
+	return stepJournal(false, result);
+}
+
+size_t ExProcess::estimateBodyBytes(const PK_BODY_t body)
+{
+	// Rough size of a face with its geometry, edges and mapper entries
+	const size_t faceBytes = 16 * 1024;
+
+	int faceCnt = 0;
+	PK_FACE_t* faces = NULL;
+	if (PK_ERROR_no_errors == PK_BODY_ask_faces(body, &faceCnt, &faces) && faceCnt)
+		PK_MEMORY_free(faces);
+
+	return faceCnt * faceBytes;
+}
+
+void ExProcess::useBody(A3DRiBrepModel* pRiBrepModel, const PK_BODY_t body, const bool bNew)
+{
+	if (bNew)
+		m_bodyLifecycle.Add(pRiBrepModel, estimateBodyBytes(body));
+	else
+		m_bodyLifecycle.Touch(pRiBrepModel);
+
+	if (0 < m_iOperationDepth)
+	{
+		m_bodyLifecycle.Acquire(pRiBrepModel);
+		m_pinnedArr.push_back(pRiBrepModel);
+	}
+}
+
+void ExProcess::evictBody(A3DRiBrepModel* pRiBrepModel)
+{
+	// The Brep model holds the result of every operation, the body is translated again from it at the next use
+	PK_BODY_t body = m_bodyRegistry.FindBody(pRiBrepModel);
+	A3DMiscPKMapper* pPkMapper = m_bodyRegistry.FindMapper(pRiBrepModel);
+
+	if (PK_ENTITY_null != body)
+	{
+		// Assemblies made by the translation are deleted with the body
+		std::set<PK_ASSEMBLY_t> assySet;
+		int n_instances = 0;
+		PK_INSTANCE_t* instances = NULL;
+		if (PK_ERROR_no_errors == PK_PART_ask_ref_instances(body, &n_instances, &instances) && n_instances)
+		{
+			for (int i = 0; i < n_instances; i++)
+			{
+				PK_INSTANCE_sf_t instance_sf;
+				if (PK_ERROR_no_errors == PK_INSTANCE_ask(instances[i], &instance_sf))
+					assySet.insert(instance_sf.assembly);
+			}
+			PK_MEMORY_free(instances);
+		}
+
+		std::vector<PK_ASSEMBLY_t> assyArr(assySet.begin(), assySet.end());
+		if (assyArr.size())
+			PK_ENTITY_delete((int)assyArr.size(), assyArr.data());
+		PK_ENTITY_delete(1, &body);
+
+		m_pPsProcess->InvalidateFRCache(body);
+	}
+
+	releaseMapper(pPkMapper);
+
+	m_bodyRegistry.Remove(pRiBrepModel);
+	m_entityTableMap.erase(pRiBrepModel);
+}
+
+bool ExProcess::translateRiBrepModel(A3DRiBrepModel* pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::translateRiBrepModel");
+
 	A3DStatus status;
 
+	// Exchange => Parasolid
+	A3DRWParamsTranslateToPkPartsData pParamsTranslateToPkPartsData;
+	A3D_INITIALIZE_DATA(A3DRWParamsTranslateToPkPartsData, pParamsTranslateToPkPartsData);
+	pParamsTranslateToPkPartsData.m_pMapper = &pPkMapper;
+
+	int iNbPkParts = 0;
+	PK_PART_t* pPkParts = NULL;
+	status = A3DRepresentationItemTranslateToPkParts((A3DRiRepresentationItem*)pRiBrepModel, 
+		&pParamsTranslateToPkPartsData, 1, &iNbPkParts, &pPkParts);
+
+	if (A3D_SUCCESS != status || 0 == iNbPkParts)
+	{
+		ExMemoryPool::Free(pPkParts);
+		return false;
+	}
+
+	PK_ASSEMBLY_t pkAssembly = pPkParts[0];
+	ExMemoryPool::Free(pPkParts);
+
+	int n_parts = 0;
+	PK_PART_t* parts = NULL;
+	PK_ERROR_code_t error_code = PK_ASSEMBLY_ask_parts(pkAssembly, &n_parts, &parts);
+	if (PK_ERROR_no_errors != error_code || 0 == n_parts)
+	{
+		if (n_parts)
+			PK_MEMORY_free(parts);
+		return false;
+	}
+
+	body = parts[0];
+	PK_MEMORY_free(parts);
+
+	return true;
+}
+
+PK_BODY_t ExProcess::getPkBodyFromRiBrepModel(A3DRiBrepModel* pRiBrepModel, bool translateIfNotThere)
+{
 	int body = 0;
 
-	if (0 < m_bodyMap.count(pRiBrepModel))
-		body = m_bodyMap[pRiBrepModel];
+	body = m_bodyRegistry.FindBody(pRiBrepModel);
 
 	A3DMiscPKMapper* pPkMapper = NULL;
 
-	if (0 == body && translateIfNotThere)
+	// The caller holds the kernel lock, no body is in translation in background
+	bool bTaken = false;
+	if (0 == body && m_prefetcher.Take(pRiBrepModel, body, pPkMapper))
 	{
-		// Exchange => Parasolid
-		A3DRWParamsTranslateToPkPartsData pParamsTranslateToPkPartsData;
-		A3D_INITIALIZE_DATA(A3DRWParamsTranslateToPkPartsData, pParamsTranslateToPkPartsData);
-		pParamsTranslateToPkPartsData.m_pMapper = &pPkMapper;
-
-		int iNbPkParts;
-		PK_PART_t* pPkParts;
-		status = A3DRepresentationItemTranslateToPkParts((A3DRiRepresentationItem*)pRiBrepModel, 
-			&pParamsTranslateToPkPartsData, 1, &iNbPkParts, &pPkParts);
+		bTaken = IsBodyAlive(body);
+		if (!bTaken)
+		{
+			// Translated in background after a mark which was gone back to since
+			if (NULL != pPkMapper)
+				A3DEntityDelete(pPkMapper);
+			pPkMapper = NULL;
+			body = 0;
+		}
+	}
 
-		if (A3D_SUCCESS != status)
+	if (bTaken)
+	{
+		m_bodyRegistry.Set(pRiBrepModel, body, pPkMapper);
+		retainMapper(pPkMapper);
+		useBody(pRiBrepModel, body, true);
+	}
+	else if (0 != body)
+	{
+		useBody(pRiBrepModel, body, false);
+	}
+	else if (translateIfNotThere)
+	{
+		if (!translateRiBrepModel(pRiBrepModel, body, pPkMapper))
 			return 0;
 
+		m_bodyRegistry.Set(pRiBrepModel, body, pPkMapper);
+		retainMapper(pPkMapper);
+		useBody(pRiBrepModel, body, true);
+
+		if (m_pipeline.bActive)
+			m_pipeline.translatedArr.push_back(pRiBrepModel);
+	}
+
+	return body;
+}
+
+void ExProcess::StartPrefetch(const size_t budgetBytes)
+{
+	if (NULL == m_pModelFile)
+		return;
+
+	std::vector<A3DRiBrepModel*> riBrepModelArr;
+	std::unordered_set<A3DEntity*> visitedSet;
+
+	A3DAsmModelFileData sData;
+	A3D_INITIALIZE_DATA(A3DAsmModelFileData, sData);
+	if (A3D_SUCCESS != A3DAsmModelFileGet(m_pModelFile, &sData))
+		return;
+
+	for (A3DUns32 ui = 0; ui < sData.m_uiPOccurrencesSize; ui++)
+		CollectRiBrepModels(sData.m_ppPOccurrences[ui], visitedSet, riBrepModelArr);
+
+	A3DAsmModelFileGet(NULL, &sData);
+
+	m_prefetcher.Start([this](A3DRiBrepModel* pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper, size_t& bytes)
+	{
+		// Translated by an operation since it was queued
+		if (m_bodyRegistry.Contains(pRiBrepModel))
+			return false;
+
+		if (!translateRiBrepModel(pRiBrepModel, body, pPkMapper))
+			return false;
+
+		bytes = estimateBodyBytes(body);
+		return true;
+	}, budgetBytes);
+
+	// Bodies already translated by an operation are not queued again
+	std::vector<A3DRiBrepModel*> queueArr;
+	for (size_t i = 0; i < riBrepModelArr.size(); i++)
+	{
+		if (!m_bodyRegistry.Contains(riBrepModelArr[i]))
+			queueArr.push_back(riBrepModelArr[i]);
+	}
+	m_prefetcher.Queue(queueArr, false);
+}
+
+const ExEntityTable& ExProcess::getEntityTable(A3DRiBrepModel* pRiBrepModel)
+{
+	A3DMiscPKMapper* pPkMapper = m_bodyRegistry.FindMapper(pRiBrepModel);
+
+	// A new mapper is given by each update of the Brep, the table is read again from it
+	ExEntityTable& table = m_entityTableMap[pRiBrepModel];
+	if (!table.IsBuiltFor(pPkMapper))
+		table.Build(pPkMapper, m_bodyRegistry.FindBody(pRiBrepModel));
+
+	return table;
+}
+
+bool ExProcess::toPkEntities(A3DRiBrepModel* pRiBrepModel, const int entityCnt, A3DEntity* const* ppEntities, PK_ENTITY_t* pkEntities)
+{
+	if (getEntityTable(pRiBrepModel).ToPk(entityCnt, ppEntities, pkEntities))
+		return true;
 
-		PK_ASSEMBLY_t pkAssembly = pPkParts[0];
+	// Entities out of the table (not a face / edge) are asked to the mapper
+	A3DMiscPKMapper* pPkMapper = m_bodyRegistry.FindMapper(pRiBrepModel);
+	for (int i = 0; i < entityCnt; i++)
+	{
+		if (PK_ENTITY_null != pkEntities[i])
+			continue;
 
-		PK_ASSEMBLY_ask_parts(pkAssembly, &iNbPkParts, &pPkParts);
+		int iNbPkEntities = 0;
+		PK_ENTITY_t* entities;
+		A3DStatus status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, ppEntities[i], &iNbPkEntities, &entities);
 
-		body = pPkParts[0];
+		if (A3D_SUCCESS != status || 0 == iNbPkEntities)
+			return false;
 
-		m_bodyMap[pRiBrepModel] = body;
-		m_mapperMap[pRiBrepModel] = pPkMapper;
+		pkEntities[i] = entities[0];
 	}
 
-	return body;
+	return true;
 }
 
-bool ExProcess::updatePkBodyToA3DRiBrepModel(PK_BODY_t inBody, A3DRiBrepModel* in_pRiBrepModel)
+bool ExProcess::toA3DEntities(A3DRiBrepModel* pRiBrepModel, const int entityCnt, const PK_ENTITY_t* pkEntities, A3DEntity** ppEntities)
+{
+	if (getEntityTable(pRiBrepModel).ToA3D(entityCnt, pkEntities, ppEntities))
+		return true;
+
+	bool bAll = true;
+	A3DMiscPKMapper* pPkMapper = m_bodyRegistry.FindMapper(pRiBrepModel);
+	for (int i = 0; i < entityCnt; i++)
+	{
+		if (NULL != ppEntities[i])
+			continue;
+
+		int iNbA3DEntities = 0;
+		A3DEntity** pEntities;
+		A3DStatus status = A3DMiscPKMapperGetA3DEntitiesFromPKEntity(pPkMapper, pkEntities[i], &iNbA3DEntities, &pEntities);
+
+		if (A3D_SUCCESS == status && 0 < iNbA3DEntities)
+			ppEntities[i] = pEntities[0];
+		else
+			bAll = false;
+	}
+
+	return bAll;
+}
+
+bool ExProcess::updatePkBodyToA3DRiBrepModel(PK_BODY_t inBody, A3DRiBrepModel* in_pRiBrepModel, const PsTopolDelta* pDelta)
 {
 	A3DStatus status;
 
+	// The operation didn't touch any face, current Brep and tessellation are still valid
+	if (NULL != pDelta && pDelta->IsEmpty() && m_bodyRegistry.Contains(in_pRiBrepModel))
+		return true;
+
+	// Once at the end of the pipeline
+	if (m_pipeline.bActive)
+	{
+		if (m_pipeline.updateMap.insert(std::make_pair(in_pRiBrepModel, inBody)).second)
+			m_pipeline.updateArr.push_back(in_pRiBrepModel);
+		else
+			m_pipeline.updateMap[in_pRiBrepModel] = inBody;
+		return true;
+	}
+
+	PERF_TRACE_SCOPE("ex", "ExProcess::TranslateBody");
+	ExMemoryScope memScope("TranslateBody");
+
+	// Geometry only: the Brep is tessellated once below after it is set to in_pRiBrepModel
 	A3DRWParamsLoadData sParams;
 	A3D_INITIALIZE_DATA(A3DRWParamsLoadData, sParams);
 	sParams.m_sGeneral.m_bReadSolids = true;
 	sParams.m_sGeneral.m_bReadSurfaces = true;
-	sParams.m_sGeneral.m_eReadGeomTessMode = kA3DReadGeomAndTess;
+	sParams.m_sGeneral.m_eReadGeomTessMode = kA3DReadGeomOnly;
 	sParams.m_sMultiEntries.m_bLoadDefault = true;
 
-	A3DAsmModelFile* pModelFile;
-	A3DMiscPKMapper* pPkMapper;
+	A3DAsmModelFile* pModelFile = NULL;
+	A3DMiscPKMapper* pPkMapper = NULL;
 
 	PK_PART_t* pPkParts = &inBody;
 	status = A3DPkPartsTranslateToA3DAsmModelFile(1, pPkParts, &sParams, &pModelFile, &pPkMapper);
+	if (A3D_SUCCESS != status || NULL == pModelFile || NULL == pPkMapper)
+	{
+		if (NULL != pModelFile)
+			A3DAsmModelFileDelete(pModelFile);
+		if (NULL != pPkMapper)
+			A3DEntityDelete(pPkMapper);
+		return false;
+	}
 
 	// Get Exchange entity
-	int iNbA3DEntities;
-	A3DEntity** ppEntiries;
+	int iNbA3DEntities = 0;
+	A3DEntity** ppEntiries = NULL;
 	status = A3DMiscPKMapperGetA3DEntitiesFromPKEntity(pPkMapper, inBody, &iNbA3DEntities, &ppEntiries);
 
-	if (A3D_SUCCESS != status || 1 != iNbA3DEntities)
-		return false;
-
-	A3DEntity* pResultEntity = ppEntiries[0];
+	A3DEntity* pResultEntity = (A3D_SUCCESS == status && 1 == iNbA3DEntities) ? ppEntiries[0] : NULL;
 
 	A3DEEntityType eType = kA3DTypeUnknown;
-	status = A3DEntityGetType(pResultEntity, &eType);
+	if (NULL != pResultEntity)
+		A3DEntityGetType(pResultEntity, &eType);
 
 	if (kA3DTypeTopoBrepData != eType)
+	{
+		A3DAsmModelFileDelete(pModelFile);
+		A3DEntityDelete(pPkMapper);
 		return false;
+	}
 
 	// Update Brep Model Data
 	A3DRiBrepModelData sData;
@@ -179,136 +708,225 @@ bool ExProcess::updatePkBodyToA3DRiBrepModel(PK_BODY_t inBody, A3DRiBrepModel* i
 		sData.m_bSolid = 0;
 
 	status = A3DRiBrepModelEdit(&sData, in_pRiBrepModel);
-	if (A3D_SUCCESS != status)
-		return false;
+	A3DRiBrepModelGet(NULL, &sData);
 
-	// Update tessellation
-	A3DRWParamsTessellationData tessellationParameters;
-	A3D_INITIALIZE_DATA(A3DRWParamsTessellationData, tessellationParameters);
-	tessellationParameters.m_eTessellationLevelOfDetail = kA3DTessLODMedium;
-	status = A3DRiRepresentationItemComputeTessellation((A3DRiRepresentationItem*)in_pRiBrepModel, &tessellationParameters);
 	if (A3D_SUCCESS != status)
+	{
+		A3DAsmModelFileDelete(pModelFile);
+		A3DEntityDelete(pPkMapper);
 		return false;
+	}
 
-	// Update map
-	for (auto it = m_bodyMap.begin(); it != m_bodyMap.end();)
+	// The former mapper refers the replaced Brep, it is deleted with its last body
+	A3DMiscPKMapper* pOldPkMapper = m_bodyRegistry.FindMapper(in_pRiBrepModel);
+	if (pOldPkMapper != pPkMapper)
 	{
-		if (it->second == inBody)
-			it = m_bodyMap.erase(it);
-		else
-			++it;
+		m_entityTableMap.erase(in_pRiBrepModel);
+		releaseMapper(pOldPkMapper);
+		retainMapper(pPkMapper);
 	}
 
-	m_bodyMap[in_pRiBrepModel] = inBody;
-	m_mapperMap[in_pRiBrepModel] = pPkMapper;
+	// The Brep and the mapper belong to the translated model file, the one of the replaced Brep isn't referenced anymore
+	A3DAsmModelFile*& pBrepModelFile = m_brepModelFileMap[in_pRiBrepModel];
+	if (NULL != pBrepModelFile)
+		A3DAsmModelFileDelete(pBrepModelFile);
+	pBrepModelFile = pModelFile;
 
-	return true;
+	// Update map, a former Brep model of the body is dropped
+	m_bodyRegistry.Set(in_pRiBrepModel, inBody, pPkMapper);
+	m_bodyLifecycle.Resize(in_pRiBrepModel, estimateBodyBytes(inBody));
+	m_curDelta.updatedArr.push_back(inBody);
+
+	// Update tessellation, coarse until the view asks to refine it
+	status = tessellate((A3DRiRepresentationItem*)in_pRiBrepModel, true);
+
+	return A3D_SUCCESS == status;
 }
 
-void ExProcess::addBody(PK_BODY_t body, A3DAsmModelFile*& pNewModelFile)
+void ExProcess::addBodies(const int bodyCnt, const PK_BODY_t* bodies, A3DAsmModelFile*& pNewModelFile)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::TranslateBodies");
+	ExMemoryScope memScope("TranslateBodies");
+
 	A3DStatus status;
 
-	// Parasolid to Exchange
+	if (0 >= bodyCnt)
+		return;
+
+	// Added together at the end of the pipeline
+	if (m_pipeline.bActive)
+	{
+		m_pipeline.newBodyArr.insert(m_pipeline.newBodyArr.end(), bodies, bodies + bodyCnt);
+		pNewModelFile = NULL;
+		return;
+	}
+
+	// Parasolid to Exchange, all the bodies at once
 	A3DRWParamsLoadData sParams;
 	A3D_INITIALIZE_DATA(A3DRWParamsLoadData, sParams);
 	sParams.m_sGeneral.m_bReadSolids = true;
-	sParams.m_sGeneral.m_eReadGeomTessMode = kA3DReadGeomAndTess;
-	sParams.m_sTessellation.m_eTessellationLevelOfDetail = A3DETessellationLevelOfDetail::kA3DTessLODMedium;
+	sParams.m_sGeneral.m_eReadGeomTessMode = kA3DReadGeomOnly;
 
 	A3DAsmModelFile* pBlockModelFile;
 	A3DMiscPKMapper* pPkMapper;
-	status = A3DPkPartsTranslateToA3DAsmModelFile(1, &body, &sParams, &pBlockModelFile, &pPkMapper);
+	status = A3DPkPartsTranslateToA3DAsmModelFile(bodyCnt, bodies, &sParams, &pBlockModelFile, &pPkMapper);
+	if (A3D_SUCCESS != status)
+		return;
+
+	A3DAsmModelFileData sBlockData;
+	A3D_INITIALIZE_DATA(A3DAsmModelFileData, sBlockData);
+	status = A3DAsmModelFileGet(pBlockModelFile, &sBlockData);
+
+	// RiBrepModels of the translated model by their Brep
+	std::vector<A3DRiBrepModel*> blockRiBrepArr;
+	std::unordered_set<A3DEntity*> visitedSet;
+	for (A3DUns32 ui = 0; ui < sBlockData.m_uiPOccurrencesSize; ui++)
+		CollectRiBrepModels(sBlockData.m_ppPOccurrences[ui], visitedSet, blockRiBrepArr);
+
+	std::unordered_map<A3DTopoBrepData*, A3DRiBrepModel*> brepMap;
+	for (size_t i = 0; i < blockRiBrepArr.size(); i++)
+	{
+		A3DRiBrepModelData sRiBrepModelData;
+		A3D_INITIALIZE_DATA(A3DRiBrepModelData, sRiBrepModelData);
+		if (A3D_SUCCESS == A3DRiBrepModelGet(blockRiBrepArr[i], &sRiBrepModelData))
+		{
+			brepMap[sRiBrepModelData.m_pBrepData] = blockRiBrepArr[i];
+			A3DRiBrepModelGet(NULL, &sRiBrepModelData);
+		}
+	}
+
+	std::vector<A3DRiRepresentationItem*> newRepItemArr;
+	for (int i = 0; i < bodyCnt; i++)
+	{
+		// Get A3DEntity of created PK_BODY
+		int iCnt = 0;
+		A3DEntity** ppEntities;
+		status = A3DMiscPKMapperGetA3DEntitiesFromPKEntity(pPkMapper, bodies[i], &iCnt, &ppEntities);
+		if (A3D_SUCCESS != status || 0 == iCnt)
+			continue;
+
+		auto it = brepMap.find(ppEntities[0]);
+		if (brepMap.end() == it)
+			continue;
+
+		A3DRiBrepModel* pRiBrepModel = it->second;
 
-	// Get A3DEntity of created PK_BODY
-	int iCnt;
-	A3DEntity** ppEntities;
-	status = A3DMiscPKMapperGetA3DEntitiesFromPKEntity(pPkMapper, body, &iCnt, &ppEntities);
+		// Before the PO is moved to the model
+		status = tessellate((A3DRiRepresentationItem*)pRiBrepModel, true);
 
-	// Get RiBrepModel from TopoBrepData and add to the mapping table
-	A3DTopoBrepData* pTopoBrepData = ppEntities[0];
-	A3DRiBrepModel* pRiBrepModel = SearchBrepModelFromTopoBrep(pBlockModelFile, pTopoBrepData);
+		// Add mapping table, the mapper is shared by the bodies of the batch
+		m_bodyRegistry.Set(pRiBrepModel, bodies[i], pPkMapper);
+		retainMapper(pPkMapper);
+		useBody(pRiBrepModel, bodies[i], true);
+		m_curDelta.addedArr.push_back(bodies[i]);
 
-	// Add mapping table
-	m_bodyMap[pRiBrepModel] = body;
-	m_mapperMap[pRiBrepModel] = pPkMapper;
+		newRepItemArr.push_back((A3DRiRepresentationItem*)pRiBrepModel);
+	}
+
+	// No body could be mapped back
+	if (0 == m_mapperRefMap.count(pPkMapper))
+		A3DEntityDelete(pPkMapper);
+
+	if (newRepItemArr.empty() && NULL != m_pModelFile)
+	{
+		A3DAsmModelFileGet(NULL, &sBlockData);
+		A3DAsmModelFileDelete(pBlockModelFile);
+		return;
+	}
 
 	if (NULL == m_pModelFile)
 	{
 		// Create new part model
+		A3DAsmModelFileGet(NULL, &sBlockData);
+
 		pNewModelFile = pBlockModelFile;
 		SetModelFile(pBlockModelFile);
-
+		return;
 	}
-	else
-	{
-		// Get model file data
-		A3DAsmModelFileData sData;
-		A3D_INITIALIZE_DATA(A3DAsmModelFileData, sData);
-		status = A3DAsmModelFileGet(m_pModelFile, &sData);
-		A3DAsmProductOccurrence* pPO = sData.m_ppPOccurrences[0];
 
-		A3DAsmProductOccurrenceData sPoData;
-		A3D_INITIALIZE_DATA(A3DAsmProductOccurrenceData, sPoData);
-		status = A3DAsmProductOccurrenceGet(pPO, &sPoData);
+	// Get model file data
+	A3DAsmModelFileData sData;
+	A3D_INITIALIZE_DATA(A3DAsmModelFileData, sData);
+	status = A3DAsmModelFileGet(m_pModelFile, &sData);
+	A3DAsmProductOccurrence* pPO = sData.m_ppPOccurrences[0];
 
-		if (m_bIsPart)
-		{
-			// Add body to the existing part
-			A3DAsmPartDefinition* pPart = sPoData.m_pPart;
-			A3DAsmPartDefinitionData sPartData;
-			A3D_INITIALIZE_DATA(A3DAsmPartDefinitionData, sPartData);
-			status = A3DAsmPartDefinitionGet(pPart, &sPartData);
+	A3DAsmProductOccurrenceData sPoData;
+	A3D_INITIALIZE_DATA(A3DAsmProductOccurrenceData, sPoData);
+	status = A3DAsmProductOccurrenceGet(pPO, &sPoData);
 
-			A3DRiRepresentationItem** ppRepItem = new A3DRiRepresentationItem * [sPartData.m_uiRepItemsSize];
+	if (m_bIsPart)
+	{
+		// Add the bodies to the existing part with a single edit
+		A3DAsmPartDefinition* pPart = sPoData.m_pPart;
+		A3DAsmPartDefinitionData sPartData;
+		A3D_INITIALIZE_DATA(A3DAsmPartDefinitionData, sPartData);
+		status = A3DAsmPartDefinitionGet(pPart, &sPartData);
 
-			for (A3DUns32 ui = 0; ui < sPartData.m_uiRepItemsSize; ui++)
-				ppRepItem[ui] = sPartData.m_ppRepItems[ui];
+		std::vector<A3DRiRepresentationItem*> repItemArr(sPartData.m_ppRepItems, sPartData.m_ppRepItems + sPartData.m_uiRepItemsSize);
+		repItemArr.insert(repItemArr.end(), newRepItemArr.begin(), newRepItemArr.end());
 
-			ppRepItem[sPartData.m_uiRepItemsSize] = (A3DRiRepresentationItem*)pRiBrepModel;
+		A3DAsmPartDefinitionData sEditData = sPartData;
+		sEditData.m_uiRepItemsSize = (A3DUns32)repItemArr.size();
+		sEditData.m_ppRepItems = repItemArr.data();
 
-			sPartData.m_uiRepItemsSize++;
-			sPartData.m_ppRepItems = ppRepItem;
+		status = A3DAsmPartDefinitionEdit(&sEditData, pPart);
 
-			status = A3DAsmPartDefinitionEdit(&sPartData, pPart);
+		A3DAsmPartDefinitionGet(NULL, &sPartData);
+	}
+	else
+	{
+		// Move the translated POs to the existing assembly model with a single edit,
+		// the registered RiBrepModels are the displayed ones
+		std::vector<A3DAsmProductOccurrence*> poArr(sPoData.m_ppPOccurrences, sPoData.m_ppPOccurrences + sPoData.m_uiPOccurrencesSize);
+		poArr.insert(poArr.end(), sBlockData.m_ppPOccurrences, sBlockData.m_ppPOccurrences + sBlockData.m_uiPOccurrencesSize);
 
-			A3DAsmProductOccurrenceGet(NULL, &sPoData);
-		}
-		else
-		{
-			// Add PO to the existing assembly model 
-			A3DAsmProductOccurrence** ppPO = new A3DAsmProductOccurrence * [sPoData.m_uiPOccurrencesSize + 1];
-			for (A3DUns32 ui = 0; ui < sPoData.m_uiPOccurrencesSize; ui++)
-				ppPO[ui] = sPoData.m_ppPOccurrences[ui];
+		A3DAsmProductOccurrenceData sEditData = sPoData;
+		sEditData.m_uiPOccurrencesSize = (A3DUns32)poArr.size();
+		sEditData.m_ppPOccurrences = poArr.data();
 
-			// Make copy PO of block
-			A3DAsmModelFileData sBlockData;
-			A3D_INITIALIZE_DATA(A3DAsmModelFileData, sBlockData);
-			status = A3DAsmModelFileGet(pBlockModelFile, &sBlockData);
+		status = A3DAsmProductOccurrenceEdit(&sEditData, pPO);
+	}
 
-			A3DAsmProductOccurrence* pCopyPO;
-			status = A3DAsmProductOccurrenceDeepCopy(sBlockData.m_ppPOccurrences[0], &pCopyPO);
+	A3DAsmProductOccurrenceGet(NULL, &sPoData);
+	A3DAsmModelFileGet(NULL, &sData);
+	A3DAsmModelFileGet(NULL, &sBlockData);
 
-			ppPO[sPoData.m_uiPOccurrencesSize] = pCopyPO;
-			sPoData.m_uiPOccurrencesSize++;
-			sPoData.m_ppPOccurrences = ppPO;
+	// The model references the translated items and the mapper the translated model file, which is kept
+	m_linkedModelFileArr.push_back(pBlockModelFile);
+}
 
-			status = A3DAsmProductOccurrenceEdit(&sPoData, pPO);
-		}
+void ExProcess::retainMapper(A3DMiscPKMapper* pPkMapper)
+{
+	if (NULL != pPkMapper)
+		m_mapperRefMap[pPkMapper]++;
+}
+
+void ExProcess::releaseMapper(A3DMiscPKMapper* pPkMapper)
+{
+	auto it = m_mapperRefMap.find(pPkMapper);
+	if (m_mapperRefMap.end() == it)
+		return;
 
-		A3DAsmModelFileGet(NULL, &sData);
+	if (0 == --it->second)
+	{
+		m_mapperRefMap.erase(it);
+		A3DEntityDelete(pPkMapper);
 	}
 }
 
 bool ExProcess::CreateSolid(const SolidShape solidShape, const double* in_size, const double* in_offset, const double* in_dir, A3DAsmModelFile*& pNewModelFile)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::CreateSolid");
+
+	OperationScope scope(this);
+
 	// Create a block model using Parasolid
 	PK_BODY_t body;
 	
 	if (!m_pPsProcess->CreateSolid(solidShape, in_size, in_offset, in_dir, body))
 		return false;
 
-	addBody(body, pNewModelFile);
+	addBodies(1, &body, pNewModelFile);
 
 	return true;
 }
@@ -316,47 +934,34 @@ bool ExProcess::CreateSolid(const SolidShape solidShape, const double* in_size,
 bool ExProcess::BlendRC(const PsBlendType blendType, const double blendR, const double blendC2, A3DRiBrepModel* pRiBrepModel, 
 	const int edgeCnt, A3DTopoEdge** ppTopoEdges, A3DTopoFace** ppTopoFaces)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::BlendRC");
+
+	OperationScope scope(this);
+
 	A3DStatus status;
 	
 	// Get Parasolid body tag
 	PK_BODY_t body = getPkBodyFromRiBrepModel(pRiBrepModel);
-	A3DMiscPKMapper* pPkMapper = NULL;
-
 	if (0 == body)
 		return false;
-	else
-		pPkMapper = m_mapperMap[pRiBrepModel];
 
 	// Get Parasolid edge Tag
-	PK_EDGE_t* edges = new PK_EDGE_t[edgeCnt];
-	PK_FACE_t* faces = new PK_EDGE_t[edgeCnt];
-	for (int i = 0; i < edgeCnt; i++)
+	std::vector<PK_EDGE_t> edges(edgeCnt);
+	std::vector<PK_FACE_t> faces(edgeCnt);
+	if (!toPkEntities(pRiBrepModel, edgeCnt, ppTopoEdges, edges.data()))
+		return false;
+
+	if (PsBlendType::C == blendType)
 	{
-		PK_ENTITY_t* entities;
-		int iNbA3DEntities;
-		status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, ppTopoEdges[i], &iNbA3DEntities, &entities);
-	
-		if (A3D_SUCCESS != status || 1 != iNbA3DEntities)
+		if (!toPkEntities(pRiBrepModel, edgeCnt, ppTopoFaces, faces.data()))
 			return false;
-
-		edges[i] = entities[0];
-
-		if (PsBlendType::C == blendType)
-		{
-			status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, ppTopoFaces[i], &iNbA3DEntities, &entities);
-			
-			if (A3D_SUCCESS != status || 1 != iNbA3DEntities)
-				return false;
-
-			faces[i] = entities[0];
-		}
 	}
 
-	if (!m_pPsProcess->BlendRC(blendType, blendR, blendC2, body, edgeCnt, edges, faces))
+	if (!m_pPsProcess->BlendRC(blendType, blendR, blendC2, body, edgeCnt, edges.data(), faces.data()))
 		return false;
 
 	// Update Exchange Brep
-	if (updatePkBodyToA3DRiBrepModel(body, pRiBrepModel))
+	if (updatePkBodyToA3DRiBrepModel(body, pRiBrepModel, &m_pPsProcess->GetLastDelta()))
 		return true;
 
 	return false;
@@ -364,37 +969,27 @@ bool ExProcess::BlendRC(const PsBlendType blendType, const double blendR, const
 
 bool ExProcess::Hollow(const double thisckness, A3DRiBrepModel* pRiBrepModel, const int faceCnt, A3DTopoFace** ppTopoFaces)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::Hollow");
+
+	OperationScope scope(this);
+
 	A3DStatus status;
 
 	// Get Parasolid body tag
 	PK_BODY_t body = getPkBodyFromRiBrepModel(pRiBrepModel);
-	A3DMiscPKMapper* pPkMapper = NULL;
-
 	if (0 == body)
 		return false;
-	else
-		pPkMapper = m_mapperMap[pRiBrepModel];
-
-	// Get Parasolid edge Tag
-	PK_FACE_t* faces = new PK_FACE_t[faceCnt];
-
-	for (int i = 0; i < faceCnt; i++)
-	{
-		int iNbA3DEntities;
-		PK_ENTITY_t* entities;
-		status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, ppTopoFaces[i], &iNbA3DEntities, &entities);
 
-		if (A3D_SUCCESS != status || 1 != iNbA3DEntities)
-			return false;
-
-		faces[i] = entities[0];
-	}
+	// Get Parasolid face Tag
+	std::vector<PK_FACE_t> faces(faceCnt);
+	if (!toPkEntities(pRiBrepModel, faceCnt, ppTopoFaces, faces.data()))
+		return false;
 
-	if (!m_pPsProcess->Hollow(thisckness, body, faceCnt, faces))
+	if (!m_pPsProcess->Hollow(thisckness, body, faceCnt, faces.data()))
 		return false;
 
 	// Update Exchange Brep
-	if (!updatePkBodyToA3DRiBrepModel(body, pRiBrepModel))
+	if (!updatePkBodyToA3DRiBrepModel(body, pRiBrepModel, &m_pPsProcess->GetLastDelta()))
 		return false;
 
 	return true;
@@ -402,19 +997,46 @@ bool ExProcess::Hollow(const double thisckness, A3DRiBrepModel* pRiBrepModel, co
 
 bool ExProcess::DeleteBody(A3DRiBrepModel* pRiBrepModel)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::DeleteBody");
+
+	OperationScope scope(this);
+
 	A3DStatus status;
 	
 	// Delete bofy of Parasolid
 	PK_BODY_t body = GetEntityTag(pRiBrepModel, NULL, false);
 
-	if (0 < body)
-		m_pPsProcess->DeleteBody(body);
+	if (0 < body && m_pPsProcess->DeleteBody(body))
+		forgetBody(pRiBrepModel);
 
 	return true;
 }
 
+void ExProcess::forgetBody(A3DRiBrepModel* pRiBrepModel)
+{
+	// The Brep is still needed if the pipeline is rolled back
+	if (m_pipeline.bActive)
+	{
+		m_pipeline.forgetArr.push_back(pRiBrepModel);
+		return;
+	}
+
+	PK_BODY_t body = m_bodyRegistry.FindBody(pRiBrepModel);
+	if (PK_ENTITY_null != body)
+		m_curDelta.removedArr.push_back(body);
+
+	releaseMapper(m_bodyRegistry.FindMapper(pRiBrepModel));
+
+	m_bodyRegistry.Remove(pRiBrepModel);
+	m_entityTableMap.erase(pRiBrepModel);
+	m_bodyLifecycle.Remove(pRiBrepModel);
+	m_tessPolicy.Forget((A3DRiRepresentationItem*)pRiBrepModel);
+}
+
 bool ExProcess::DeletePart(A3DAsmProductOccurrence* pTargetPO)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::DeletePart");
+
 	A3DStatus status;
 
 	return true;
@@ -422,37 +1044,27 @@ bool ExProcess::DeletePart(A3DAsmProductOccurrence* pTargetPO)
 
 bool ExProcess::DeleteFaces(A3DRiBrepModel* pRiBrepModel, const int faceCnt, A3DTopoEdge** ppTopoFaces)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::DeleteFaces");
+
+	OperationScope scope(this);
+
 	A3DStatus status;
 
 	// Get Parasolid body tag
 	PK_BODY_t body = getPkBodyFromRiBrepModel(pRiBrepModel);
-	A3DMiscPKMapper* pPkMapper = NULL;
-
 	if (0 == body)
 		return false;
-	else
-		pPkMapper = m_mapperMap[pRiBrepModel];
-
-	// Get Parasolid edge Tag
-	PK_FACE_t* faces = new PK_FACE_t[faceCnt];
-
-	for (int i = 0; i < faceCnt; i++)
-	{
-		int iNbA3DEntities;
-		PK_ENTITY_t* entities;
-		status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, ppTopoFaces[i], &iNbA3DEntities, &entities);
-
-		if (A3D_SUCCESS != status || 1 != iNbA3DEntities)
-			return false;
 
-		faces[i] = entities[0];
-	}
+	// Get Parasolid face Tag
+	std::vector<PK_FACE_t> faces(faceCnt);
+	if (!toPkEntities(pRiBrepModel, faceCnt, ppTopoFaces, faces.data()))
+		return false;
 
-	if (!m_pPsProcess->DeleteFace(faceCnt, faces))
+	if (!m_pPsProcess->DeleteFace(faceCnt, faces.data()))
 		return false;
 
 	// Update Exchange Brep
-	if (!updatePkBodyToA3DRiBrepModel(body, pRiBrepModel))
+	if (!updatePkBodyToA3DRiBrepModel(body, pRiBrepModel, &m_pPsProcess->GetLastDelta()))
 		return false;
 
 	return true;
@@ -460,6 +1072,10 @@ bool ExProcess::DeleteFaces(A3DRiBrepModel* pRiBrepModel, const int faceCnt, A3D
 
 bool ExProcess::Boolean(const PsBoolType boolType, A3DRiBrepModel* pTargetBrep, const int toolCnt, A3DRiBrepModel** ppToolBreps)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::Boolean");
+
+	OperationScope scope(this);
+
 	// Get Parasolid body tag
 	PK_BODY_t targetBody = getPkBodyFromRiBrepModel(pTargetBrep);
 	std::vector<PK_BODY_t> toolBodyArr;
@@ -473,63 +1089,281 @@ bool ExProcess::Boolean(const PsBoolType boolType, A3DRiBrepModel* pTargetBrep,
 	PK_BODY_t* resBodies;
 	if (m_pPsProcess->Boolean(boolType, targetBody, toolCnt, toolBodyArr.data(), resBodyCnt, resBodies))
 	{
+		// The other pieces of the result are added together
+		std::vector<PK_BODY_t> newBodyArr;
 		for (int i = 0; i < resBodyCnt; i++)
 		{
 			PK_BODY_t resBody = resBodies[i];
 			if (targetBody == resBody)
+				updatePkBodyToA3DRiBrepModel(resBody, pTargetBrep, &m_pPsProcess->GetLastDelta());
+			else
+				newBodyArr.push_back(resBody);
+		}
+		PK_MEMORY_free(resBodies);
+
+		A3DAsmModelFile* pModelFile;
+		addBodies((int)newBodyArr.size(), newBodyArr.data(), pModelFile);
+
+		// The tool bodies were consumed by the kernel
+		for (int i = 0; i < toolCnt; i++)
+			forgetBody(ppToolBreps[i]);
+		return true;
+	}
+
+	return false;
+}
+
+A3DStatus ExProcess::tessellate(A3DRiRepresentationItem* pRiItem, const bool bCoarse)
+{
+	PerfTraceSpan span("ex", "ExProcess::tessellate", true);
+
+	A3DStatus status = m_tessPolicy.Tessellate(pRiItem, bCoarse);
+
+	m_pipeline.tessMsec += span.ElapsedMsec();
+
+	return status;
+}
+
+void ExProcess::clearPipeline()
+{
+	m_pipeline.bActive = false;
+	m_pipeline.updateArr.clear();
+	m_pipeline.updateMap.clear();
+	m_pipeline.newBodyArr.clear();
+	m_pipeline.forgetArr.clear();
+	m_pipeline.translatedArr.clear();
+	m_pipeline.tessMsec = 0.0;
+}
+
+bool ExProcess::RunPipeline(const std::vector<ExOperation>& opArr, ExPipelineResult& result, PsKernelTask* pTask)
+{
+	PERF_TRACE_SCOPE("ex", "ExProcess::RunPipeline");
+
+	OperationScope scope(this);
+
+	ResetPipelineResult(result);
+
+	if (m_pipeline.bActive || !m_pPsProcess->BeginGroup())
+		return false;
+
+	clearPipeline();
+	m_pipeline.bActive = true;
+
+	// Kernel operations, the Exchange side only records what to update
+	{
+		PerfTraceSpan kernelSpan("ex", "RunPipeline kernel", true);
+
+		for (size_t i = 0; i < opArr.size(); i++)
+		{
+			if (NULL != pTask && pTask->IsCancelled())
 			{
-				updatePkBodyToA3DRiBrepModel(resBody, pTargetBrep);
+				result.bCancelled = true;
+				result.failedOp = (int)i;
+				break;
+			}
+
+			if (!opArr[i](this))
+			{
+				result.failedOp = (int)i;
+				break;
+			}
+
+			// The Exchange update at the end is counted as one more operation
+			if (NULL != pTask)
+				pTask->SetProgress((double)(i + 1) / (double)(opArr.size() + 1));
+		}
+
+		// Cancelled while the last operation was running
+		if (0 > result.failedOp && opArr.size() && NULL != pTask && pTask->IsCancelled())
+		{
+			result.bCancelled = true;
+			result.failedOp = (int)opArr.size() - 1;
+		}
+
+		result.timings.kernelMsec = kernelSpan.ElapsedMsec();
+	}
+
+	// Closing the group, Exchange updates and tessellation
+	PerfTraceSpan translateSpan("ex", "RunPipeline translate", true);
+
+	m_pipeline.bActive = false;
+
+	PsJournalStep step;
+	if (0 <= result.failedOp)
+	{
+		m_pPsProcess->EndGroup(false, step);
+
+		// The bodies translated during the pipeline are gone with the group mark
+		for (size_t i = 0; i < m_pipeline.translatedArr.size(); i++)
+			forgetBody(m_pipeline.translatedArr[i]);
+
+		clearPipeline();
+		return false;
+	}
+
+	m_pPsProcess->EndGroup(true, step);
+
+	// One update per touched Brep, the removed ones are skipped
+	std::unordered_set<A3DRiBrepModel*> forgetSet(m_pipeline.forgetArr.begin(), m_pipeline.forgetArr.end());
+
+	m_pipeline.tessMsec = 0.0;
+	for (size_t i = 0; i < m_pipeline.updateArr.size(); i++)
+	{
+		A3DRiBrepModel* pRiBrepModel = m_pipeline.updateArr[i];
+		if (forgetSet.count(pRiBrepModel))
+			continue;
+
+		if (updatePkBodyToA3DRiBrepModel(m_pipeline.updateMap[pRiBrepModel], pRiBrepModel))
+			result.updatedArr.push_back(pRiBrepModel);
+	}
+
+	if (m_pipeline.newBodyArr.size())
+	{
+		addBodies((int)m_pipeline.newBodyArr.size(), m_pipeline.newBodyArr.data(), result.pNewModelFile);
+		result.bBodiesAdded = true;
+	}
+
+	for (auto it = forgetSet.begin(); it != forgetSet.end(); it++)
+	{
+		forgetBody(*it);
+		result.deletedArr.push_back(*it);
+	}
+
+	result.timings.tessellateMsec = m_pipeline.tessMsec;
+	result.timings.translateMsec = translateSpan.ElapsedMsec() - m_pipeline.tessMsec;
+
+	clearPipeline();
+	result.bSucceeded = true;
+
+	if (NULL != pTask)
+		pTask->SetProgress(1.0);
+
+	return true;
+}
+
+bool ExProcess::BooleanBatch(const PsBoolType boolType, const std::vector<ExBoolSet>& setArr, ExPipelineResult& result)
+{
+	PERF_TRACE_SCOPE("ex", "ExProcess::BooleanBatch");
+
+	OperationScope scope(this);
+
+	ResetPipelineResult(result);
+
+	if (m_pipeline.bActive)
+		return false;
+
+	// Get Parasolid body tags
+	std::vector<PsBoolSet> psSetArr;
+	std::unordered_map<PK_BODY_t, A3DRiBrepModel*> toolBrepMap;
+	for (size_t i = 0; i < setArr.size(); i++)
+	{
+		PsBoolSet psSet;
+		psSet.targetBody = getPkBodyFromRiBrepModel(setArr[i].pTargetBrep);
+		if (0 == psSet.targetBody)
+			return false;
+
+		for (size_t j = 0; j < setArr[i].toolBreps.size(); j++)
+		{
+			PK_BODY_t toolBody = getPkBodyFromRiBrepModel(setArr[i].toolBreps[j]);
+			if (0 == toolBody)
+				return false;
+
+			psSet.toolBodies.push_back(toolBody);
+			toolBrepMap[toolBody] = setArr[i].toolBreps[j];
+		}
+
+		psSetArr.push_back(psSet);
+	}
+
+	std::vector<PsBoolSetResult> resultArr;
+	PsJournalStep step;
+	{
+		PerfTraceSpan kernelSpan("ex", "BooleanBatch kernel", true);
+
+		if (!m_pPsProcess->BooleanBatch(boolType, psSetArr, resultArr, step))
+			return false;
+
+		result.timings.kernelMsec = kernelSpan.ElapsedMsec();
+	}
+
+	PerfTraceSpan translateSpan("ex", "BooleanBatch translate", true);
+	m_pipeline.tessMsec = 0.0;
+
+	// The pieces of all the sets are added together
+	std::vector<PK_BODY_t> newBodyArr;
+	for (size_t i = 0; i < resultArr.size(); i++)
+	{
+		if (!resultArr[i].bSucceeded)
+			continue;
+
+		PK_BODY_t targetBody = psSetArr[i].targetBody;
+		for (size_t j = 0; j < resultArr[i].bodies.size(); j++)
+		{
+			PK_BODY_t resBody = resultArr[i].bodies[j];
+			if (targetBody == resBody)
+			{
+				if (updatePkBodyToA3DRiBrepModel(resBody, setArr[i].pTargetBrep, &m_pPsProcess->GetLastDelta()))
+					result.updatedArr.push_back(setArr[i].pTargetBrep);
 			}
 			else
 			{
-				A3DAsmModelFile* pModelFile;
-				addBody(resBody, pModelFile);
+				newBodyArr.push_back(resBody);
 			}
 		}
+	}
 
-		for (int i = 0; i < toolCnt; i++)
-			DeleteBody(ppToolBreps[i]);
-		return true;
+	addBodies((int)newBodyArr.size(), newBodyArr.data(), result.pNewModelFile);
+	result.bBodiesAdded = !newBodyArr.empty();
+
+	for (size_t i = 0; i < step.deletedBodies.size(); i++)
+	{
+		auto it = toolBrepMap.find(step.deletedBodies[i]);
+		if (toolBrepMap.end() == it)
+			continue;
+
+		forgetBody(it->second);
+		result.deletedArr.push_back(it->second);
 	}
 
-	return false;
+	result.timings.tessellateMsec = m_pipeline.tessMsec;
+	result.timings.translateMsec = translateSpan.ElapsedMsec() - m_pipeline.tessMsec;
+	result.bSucceeded = true;
+
+	return true;
 }
 
 bool ExProcess::FR(PsFRType frType, A3DRiBrepModel* pRiBrepModel, A3DTopoFace* pTopoFace, std::vector<A3DEntity*>& entityArr)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::FR");
+
+	OperationScope scope(this);
+
 	A3DStatus status;
 	
 	// Get Parasolid body tag
 	PK_BODY_t body = getPkBodyFromRiBrepModel(pRiBrepModel);
-	A3DMiscPKMapper* pPkMapper = NULL;
-
 	if (0 == body)
 		return false;
-	else
-		pPkMapper = m_mapperMap[pRiBrepModel];
 
 	// Get Parasolid face Tag
-	PK_FACE_t* faces;
-	int iNbA3DEntities = 0;
-	status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, pTopoFace, &iNbA3DEntities, &faces);
-
-	if (A3D_SUCCESS != status || 0 == iNbA3DEntities)
+	PK_FACE_t face;
+	if (!toPkEntities(pRiBrepModel, 1, &pTopoFace, &face))
 		return false;
 
 	std::vector<PK_FACE_t> pkFaceArr;
-	bool bRet = m_pPsProcess->FR(frType, faces[0], pkFaceArr);
+	bool bRet = m_pPsProcess->FR(frType, face, pkFaceArr);
 
 	if (!bRet)
 		return false;
 
-	for (size_t i = 0; i < pkFaceArr.size(); i++)
-	{
-		PK_FACE_t face = pkFaceArr[i];
-		A3DEntity** pEntities;
-		status = A3DMiscPKMapperGetA3DEntitiesFromPKEntity(pPkMapper, face, &iNbA3DEntities, &pEntities);
+	// Faces which are not found are skipped
+	std::vector<A3DEntity*> pEntityArr(pkFaceArr.size());
+	toA3DEntities(pRiBrepModel, (int)pkFaceArr.size(), pkFaceArr.data(), pEntityArr.data());
 
-		if (A3D_SUCCESS == status || 1 == iNbA3DEntities)
-			entityArr.push_back(pEntities[0]);
+	for (size_t i = 0; i < pEntityArr.size(); i++)
+	{
+		if (NULL != pEntityArr[i])
+			entityArr.push_back(pEntityArr[i]);
 	}
 
 	return true;
@@ -537,26 +1371,21 @@ bool ExProcess::FR(PsFRType frType, A3DRiBrepModel* pRiBrepModel, A3DTopoFace* p
 
 int ExProcess::GetEntityTag(A3DRiBrepModel* pRiBrepModel, A3DEntity* pEntity, bool translateIfNotThere)
 {
+	OperationScope scope(this);
+
 	A3DStatus status;
 	
 	// Get Parasolid body tag
 	PK_BODY_t body = getPkBodyFromRiBrepModel(pRiBrepModel, translateIfNotThere);
-	A3DMiscPKMapper* pPkMapper = NULL;
-
 	if (0 == body)
 		return 0;
-	else
-		pPkMapper = m_mapperMap[pRiBrepModel];
 
 	if (NULL != pEntity)
 	{
 		// Get Parasolid face / edge Tag
-		int iNbA3DEntities;
-		PK_ENTITY_t* entities;
-		status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, pEntity, &iNbA3DEntities, &entities);
-
-		if (A3D_SUCCESS == status && 0 < iNbA3DEntities)
-			return entities[0];
+		PK_ENTITY_t entity;
+		if (toPkEntities(pRiBrepModel, 1, &pEntity, &entity))
+			return entity;
 	}
 	else
 		return body;
@@ -566,16 +1395,16 @@ int ExProcess::GetEntityTag(A3DRiBrepModel* pRiBrepModel, A3DEntity* pEntity, bo
 
 bool ExProcess::MirrorBody(A3DRiBrepModel* pRiBrepModel, const double* location, const double* normal, const double isCopy, const double isMerge)
 {
+	PERF_TRACE_SCOPE("ex", "ExProcess::MirrorBody");
+
+	OperationScope scope(this);
+
 	A3DStatus status;
 
 	// Get Parasolid body tag
 	PK_BODY_t body = getPkBodyFromRiBrepModel(pRiBrepModel);
-	A3DMiscPKMapper* pPkMapper = NULL;
-
 	if (0 == body)
 		return false;
-	else
-		pPkMapper = m_mapperMap[pRiBrepModel];
 
 	PK_BODY_t mirror_body = PK_ENTITY_null;
 	if (!m_pPsProcess->MirrorBody(body, location, normal, isCopy, isMerge, mirror_body))
@@ -586,12 +1415,12 @@ bool ExProcess::MirrorBody(A3DRiBrepModel* pRiBrepModel, const double* location,
 		if (PK_ENTITY_null != mirror_body)
 		{
 			A3DAsmModelFile* pNewModelFile;
-			addBody(mirror_body, pNewModelFile);
+			addBodies(1, &mirror_body, pNewModelFile);
 		}
 	}
 
-	// Update Exchange Brep
-	if (!updatePkBodyToA3DRiBrepModel(body, pRiBrepModel))
+	// Update Exchange Brep, a copy alone leaves the delta of the original empty
+	if (!updatePkBodyToA3DRiBrepModel(body, pRiBrepModel, &m_pPsProcess->GetLastDelta()))
 		return false;
 
 	return true;
@@ -599,25 +1428,29 @@ bool ExProcess::MirrorBody(A3DRiBrepModel* pRiBrepModel, const double* location,
 
 bool ExProcess::GetPlaneInfo(A3DRiBrepModel* pRiBrepModel, A3DTopoFace* pTopoFace, double* position, double* normal)
 {
+	OperationScope scope(this);
+
 	A3DStatus status;
 	
 	// Get Parasolid body tag
 	PK_BODY_t body = getPkBodyFromRiBrepModel(pRiBrepModel);
-	A3DMiscPKMapper* pPkMapper = NULL;
-
 	if (0 == body)
 		return false;
-	else
-		pPkMapper = m_mapperMap[pRiBrepModel];
 
 	// Get Parasolid face Tag
-	PK_FACE_t* faces;
-	int iNbA3DEntities = 0;
-	status = A3DMiscPKMapperGetPKEntitiesFromA3DEntity(pPkMapper, pTopoFace, &iNbA3DEntities, &faces);
-
-	if (A3D_SUCCESS != status || 0 == iNbA3DEntities)
+	PK_FACE_t face;
+	if (!toPkEntities(pRiBrepModel, 1, &pTopoFace, &face))
 		return false;
 
-	return m_pPsProcess->GetPlaneInfo(faces[0], position, normal);
+	return m_pPsProcess->GetPlaneInfo(face, position, normal);
 
-}
\ No newline at end of file
+}
+bool ExProcess::Save(const char* filePath, const PK_transmit_format_t format)
+{
+	PERF_TRACE_SCOPE("ex", "ExProcess::Save");
+
+	// The snapshot is taken under the kernel lock, the file is written after
+	OperationScope scope(this);
+
+	return m_pPsProcess->Save(filePath, format);
+}
@@ -1,7 +1,60 @@
 #pragma once
 #include <A3DSDKIncludes.h>
 #include "PsProcess.h"
-#include <map>
+#include "ExBodyLifecycle.h"
+#include "ExBodyPrefetcher.h"
+#include "ExBodyRegistry.h"
+#include "ExEntityTable.h"
+#include "ExTessPolicy.h"
+#include "PsKernelExecutor.h"
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+// One target Brep of a batch Boolean with its tools, a tool may be shared by several sets
+struct ExBoolSet
+{
+	A3DRiBrepModel* pTargetBrep;
+	std::vector<A3DRiBrepModel*> toolBreps;
+};
+
+class ExProcess;
+
+// Queued operation of a pipeline, false aborts the whole pipeline
+typedef std::function<bool(ExProcess*)> ExOperation;
+
+// Milliseconds spent by each stage of a pipeline run
+struct ExPipelineTimings
+{
+	double kernelMsec;		// Queued operations inside the group mark
+	double translateMsec;	// PK => A3D of the touched and created bodies
+	double tessellateMsec;
+	double refreshMsec;		// Filled by the view after its reload
+};
+
+struct ExPipelineResult
+{
+	bool bSucceeded;
+	bool bCancelled;
+	int failedOp;			// Index of the operation which failed or was cancelled, -1 if none
+	bool bBodiesAdded;		// The model file has new bodies
+	A3DAsmModelFile* pNewModelFile;	// Made when there was no model file yet
+	std::vector<A3DRiBrepModel*> updatedArr;
+	std::vector<A3DRiBrepModel*> deletedArr;
+	ExPipelineTimings timings;
+};
+
+// Exchange side of a journal step: the bodies whose Brep was updated, added or removed by it.
+// The Breps are looked up at replay, the bodies added back by an undo / redo get new ones
+struct ExJournalDelta
+{
+	int stepId;
+	std::vector<PK_BODY_t> updatedArr;
+	std::vector<PK_BODY_t> addedArr;
+	std::vector<PK_BODY_t> removedArr;
+
+	ExJournalDelta() : stepId(-1) {}
+};
 
 class ExProcess
 {
@@ -12,17 +65,76 @@ public:
 private:
 	A3DAsmModelFile* m_pModelFile;
 	PsProcess* m_pPsProcess;
-	std::map<A3DRiBrepModel*, PK_BODY_t> m_bodyMap;
-	std::map<A3DRiBrepModel*, A3DMiscPKMapper*> m_mapperMap;
+	ExBodyRegistry m_bodyRegistry;
+	std::unordered_map<A3DRiBrepModel*, ExEntityTable> m_entityTableMap;	// Built at the first lookup with the current mapper of the body
+	std::unordered_map<A3DMiscPKMapper*, int> m_mapperRefMap;	// Bodies translated together share their mapper
+	std::vector<A3DAsmModelFile*> m_linkedModelFileArr;	// Translated model files whose entities are in the model, kept until it is closed
+	std::unordered_map<A3DRiBrepModel*, A3DAsmModelFile*> m_brepModelFileMap;	// Translated model file of the updated Brep, deleted once it is replaced
+	ExBodyPrefetcher m_prefetcher;
+	ExBodyLifecycle m_bodyLifecycle;
+	std::vector<A3DRiBrepModel*> m_pinnedArr;	// Bodies used by the running operation
+	int m_iOperationDepth;
+	ExTessPolicy m_tessPolicy;
+
+	// Running pipeline, the Brep updates, additions and removals wait for its end
+	struct PipelineState
+	{
+		bool bActive;
+		std::vector<A3DRiBrepModel*> updateArr;
+		std::unordered_map<A3DRiBrepModel*, PK_BODY_t> updateMap;
+		std::vector<PK_BODY_t> newBodyArr;
+		std::vector<A3DRiBrepModel*> forgetArr;
+		std::vector<A3DRiBrepModel*> translatedArr;	// Made after the group mark, gone if it is rolled back
+		double tessMsec;
+	};
+	PipelineState m_pipeline;
+
+	std::deque<ExJournalDelta> m_deltaArr;	// Same steps as the kernel journal, oldest first
+	ExJournalDelta m_curDelta;				// Filled by the running outermost operation
+	int m_iStepIdAtStart;					// Journal step before the running outermost operation
 
+	// Held by the public operations: waits the body in translation in background, pins the bodies used
+	// and evicts the cold ones at the end of the outermost operation
+	struct OperationScope
+	{
+		ExProcess* m_pProcess;
+		std::lock_guard<std::recursive_mutex> m_kernelLock;
+
+		OperationScope(ExProcess* pProcess);
+		~OperationScope();
+	};
+
+	void endOperation();
+	void recordDelta(const int stepId);
+	const ExJournalDelta* findDelta(const int stepId) const;
+	void replayDelta(const ExJournalDelta& delta, const bool bUndo, ExPipelineResult& result);
+	void dropDeadBodies();
+	bool stepJournal(const bool bUndo, ExPipelineResult& result);
+	size_t estimateBodyBytes(const PK_BODY_t body);
+	void useBody(A3DRiBrepModel* pRiBrepModel, const PK_BODY_t body, const bool bNew);
+	void evictBody(A3DRiBrepModel* pRiBrepModel);
+	bool translateRiBrepModel(A3DRiBrepModel* pRiBrepModel, PK_BODY_t& body, A3DMiscPKMapper*& pPkMapper);
 	PK_BODY_t getPkBodyFromRiBrepModel(A3DRiBrepModel* pRiBrepModel, bool translateIfNotThere = true);
-	bool updatePkBodyToA3DRiBrepModel(PK_BODY_t inBody, A3DRiBrepModel* in_pRiBrepModel);
-	void addBody(PK_BODY_t body, A3DAsmModelFile*& pNewModelFile);
+	// The body is translated and tessellated as a whole, pDelta only tells when it can be skipped: Exchange has no
+	// per-face PK translation nor per-face tessellation to splice the touched faces into the Brep
+	bool updatePkBodyToA3DRiBrepModel(PK_BODY_t inBody, A3DRiBrepModel* in_pRiBrepModel, const PsTopolDelta* pDelta = NULL);
+	// All the bodies are translated together and share one mapper, the part / PO is edited once
+	void addBodies(const int bodyCnt, const PK_BODY_t* bodies, A3DAsmModelFile*& pNewModelFile);
+	void retainMapper(A3DMiscPKMapper* pPkMapper);
+	void releaseMapper(A3DMiscPKMapper* pPkMapper);
+	void forgetBody(A3DRiBrepModel* pRiBrepModel);
+	A3DStatus tessellate(A3DRiRepresentationItem* pRiItem, const bool bCoarse);
+	void clearPipeline();
+	const ExEntityTable& getEntityTable(A3DRiBrepModel* pRiBrepModel);
+	bool toPkEntities(A3DRiBrepModel* pRiBrepModel, const int entityCnt, A3DEntity* const* ppEntities, PK_ENTITY_t* pkEntities);
+	bool toA3DEntities(A3DRiBrepModel* pRiBrepModel, const int entityCnt, const PK_ENTITY_t* pkEntities, A3DEntity** ppEntities);
 
 public:
 	bool m_bIsPart;
 	
 	void Initialize();
+	// Before the Parasolid session stops
+	void Terminate();
 	void SetModelFile(A3DAsmModelFile* pModelFile);
 	bool CreateSolid(const SolidShape solidShape, const double *in_size, const double *in_offset, const double* in_dir, A3DAsmModelFile*& pNewModelFile);
 	bool BlendRC(const PsBlendType blendType, const double blendR, const double blendC2, A3DRiBrepModel* pRiBrepModel, 
@@ -32,10 +144,41 @@ public:
 	bool DeletePart(A3DAsmProductOccurrence* pTargetPO);
 	bool DeleteFaces(A3DRiBrepModel* pRiBrepModel, const int faccCnt, A3DTopoEdge** ppTopoFaces);
 	bool Boolean(const PsBoolType, A3DRiBrepModel* pTargetBrep, const int toolCnt, A3DRiBrepModel** ppToolBreps);
+	// The operations run in one kernel mark, the touched bodies are translated and tessellated once at the end.
+	// If one of them fails or the task is cancelled, all of them are rolled back
+	bool RunPipeline(const std::vector<ExOperation>& opArr, ExPipelineResult& result, PsKernelTask* pTask = NULL);
+	// The updated targets and the consumed tools are returned as for a pipeline so that the view reloads them at once.
+	// Return false if no set succeeded
+	bool BooleanBatch(const PsBoolType boolType, const std::vector<ExBoolSet>& setArr, ExPipelineResult& result);
+	// Step back / forward in the kernel journal. Only the Breps of the step are updated, removed or added back,
+	// the result is filled as for a pipeline so that the view reloads them the same way
+	bool Undo(ExPipelineResult& result);
+	bool Redo(ExPipelineResult& result);
+	bool CanUndo() const { return m_pPsProcess->CanUndo(); }
+	bool CanRedo() const { return m_pPsProcess->CanRedo(); }
 	bool FR(const PsFRType frType, A3DRiBrepModel* pRiBrepModel, A3DTopoFace* pTopoFace, std::vector<A3DEntity*> &entityArr);
 	int GetEntityTag(A3DRiBrepModel* pRiBrepModel, A3DEntity* pEntity, bool translateIfNotThere = true);
 	bool MirrorBody(A3DRiBrepModel* pRiBrepModel, const double* location, const double* normal, const double isCopy, const double isMerge);
 	bool GetPlaneInfo(A3DRiBrepModel* pRiBrepModel, A3DTopoFace* pTopoFace, double* position, double* normal);
+	// Parts of the session, written in background
+	bool Save(const char* filePath, const PK_transmit_format_t format = PK_transmit_format_binary_c);
+
+	// Translate all the bodies of the model file to Parasolid in background, up to the estimated memory budget
+	void StartPrefetch(const size_t budgetBytes = 512 * 1024 * 1024);
+	// Selected bodies go to the front of the queue
+	void PrefetchFirst(const std::vector<A3DRiBrepModel*>& riBrepModelArr) { m_prefetcher.Queue(riBrepModelArr, true); }
+	void StopPrefetch() { m_prefetcher.Stop(); }
+	ExPrefetchStats GetPrefetchStats() { return m_prefetcher.GetStats(); }
+
+	// Estimated memory of the translated bodies kept alive, 0 for no limit. The bodies touched by the journal steps
+	// aren't evicted, the budget may be exceeded until the journal drops the steps (SetJournalSize)
+	void SetBodyBudget(const size_t budgetBytes) { m_bodyLifecycle.SetBudget(budgetBytes); }
+	ExBodyLifeStats GetBodyStats() const { return m_bodyLifecycle.GetStats(); }
+
+	// Retessellate the bodies which are coarser than the view scale asks, largest first
+	bool RefineTessellation(const double pixelsPerUnit, const size_t maxCnt, std::vector<A3DRiBrepModel*>& refinedArr);
+	void SetTessSettings(const ExTessSettings& settings) { m_tessPolicy.SetSettings(settings); }
+	size_t GetTriangleCount() const { return m_tessPolicy.GetTriangleCount(); }
 
 };
 
@@ -1,5 +1,7 @@
 #include "ExPsProcess.h"
 #include "ExUtilities.h"
+#include "ExMemoryPool.h"
+#include "PerfTrace.h"
 
 ExPsProcess::ExPsProcess()
 {
@@ -19,6 +21,7 @@ void ExPsProcess::Initialize()
 		m_pModelFile = NULL;
 
 	std::vector<UpdatedComponent>().swap(m_updatedCompArr);
+	releaseCopyModelFiles();
 
 }
 
@@ -54,6 +57,8 @@ bool ExPsProcess::RegisterUpdatedBody(A3DRiBrepModel* pRiBrepModel, PK_BODY_t bo
 	updatedComp.pTargetComp = pRiBrepModel;
 	updatedComp.body = body;
 	updatedComp.updateType = UpdatedType::UPDATE;
+	updatedComp.iCompId = -1;
+	updatedComp.pNewRiBrep = NULL;
 	m_updatedCompArr.push_back(updatedComp);
 
 	return true;
@@ -72,7 +77,10 @@ bool ExPsProcess::RegisterDeleteBody(A3DRiBrepModel* pRiBrepModel)
 
 	UpdatedComponent updatedBrep;
 	updatedBrep.pTargetComp = pRiBrepModel;
+	updatedBrep.body = 0;
 	updatedBrep.updateType = UpdatedType::DELEATE_BODY;
+	updatedBrep.iCompId = -1;
+	updatedBrep.pNewRiBrep = NULL;
 	m_updatedCompArr.push_back(updatedBrep);
 
 	return true;
@@ -82,7 +90,10 @@ bool ExPsProcess::RegisterDeletePart(A3DAsmProductOccurrence* pPO)
 {
 	UpdatedComponent updatedComp;
 	updatedComp.pTargetComp = pPO;
+	updatedComp.body = 0;
 	updatedComp.updateType = UpdatedType::DELEATE_PART;
+	updatedComp.iCompId = -1;
+	updatedComp.pNewRiBrep = NULL;
 	m_updatedCompArr.push_back(updatedComp);
 
 	return true;
@@ -136,12 +147,52 @@ bool ExPsProcess::DeleteFaces(const int faceCnt, PK_FACE_t* faces, A3DRiBrepMode
 	return true;
 };
 
+bool ExPsProcess::convertUpdatedBodies()
+{
+	PERF_TRACE_SCOPE("ex", "ExPsProcess::convertUpdatedBodies");
+
+	// A3DPkPartsTranslateToA3DAsmModelFile isn't documented as re-entrant, the bodies are translated one by one
+	for (A3DUns32 ui = 0; ui < m_updatedCompArr.size(); ui++)
+	{
+		UpdatedComponent& updatedComp = m_updatedCompArr[ui];
+		updatedComp.pNewRiBrep = NULL;
+
+		// Only the effective UPDATE entries need a new Brep
+		if (UpdatedType::UPDATE != updatedComp.updateType || 0 > updatedComp.iCompId)
+			continue;
+
+		A3DRiBrepModel* pRiBrepModel = NULL;
+		A3DAsmModelFile* pBlockModelFile = NULL;
+		if (!PkBodyToA3DRiBrepModel(updatedComp.body, pRiBrepModel, pBlockModelFile))
+			return false;
+
+		updatedComp.pNewRiBrep = pRiBrepModel;
+		m_copyModelFileArr.push_back(pBlockModelFile);
+	}
+
+	return true;
+}
+
+void ExPsProcess::releaseCopyModelFiles()
+{
+	for (size_t i = 0; i < m_copyModelFileArr.size(); i++)
+		A3DAsmModelFileDelete(m_copyModelFileArr[i]);
+
+	m_copyModelFileArr.clear();
+}
+
 bool ExPsProcess::CopyAndUpdateModelFile(A3DAsmModelFile*& pCopyModelFile)
 {
+	PERF_TRACE_SCOPE("ex", "ExPsProcess::CopyAndUpdateModelFile");
+	ExMemoryScope memScope("UpdateModelFile");
+
 	A3DStatus status;
 	
-	// Search updated Brep ID
+	// Search updated Brep ID and build the update plan
+	UpdatePlan plan;
 	{
+		PERF_TRACE_SCOPE("ex", "SearchCompIdVisitor");
+
 		A3DVisitorContainer sA3DVisitorContainer(CONNECT_TRANSFO);
 		sA3DVisitorContainer.SetTraverseInstance(false);
 
@@ -152,26 +203,15 @@ bool ExPsProcess::CopyAndUpdateModelFile(A3DAsmModelFile*& pCopyModelFile)
 		status = sModelFileConnector.Traverse(&sA3DVisitorContainer);
 
 		m_updatedCompArr = pMyTreeVisitor->m_updatedComp;
+		plan = pMyTreeVisitor->GetUpdatePlan();
 	}
 
-	// PK_BODY to RiBrepModel
-	for (A3DUns32 ui = 0; ui < m_updatedCompArr.size(); ui++)
-	{
-		if (UpdatedType::UPDATE == m_updatedCompArr[ui].updateType)
-		{
-			PK_BODY_t body = m_updatedCompArr[ui].body;
-			A3DRiBrepModel* pRiBrepModel;
-			A3DMiscPKMapper* pPkMapper;
-			if (!PkBodyToA3DRiBrepModel(body, pRiBrepModel, pPkMapper))
-				return false;
+	// The previous copy was exported
+	releaseCopyModelFiles();
 
-			m_updatedCompArr[ui].pNewRiBrep = pRiBrepModel;
-		}
-		else
-		{
-			m_updatedCompArr[ui].pNewRiBrep = NULL;
-		}
-	}
+	// PK_BODY to RiBrepModel
+	if (!convertUpdatedBodies())
+		return false;
 
 	// Make a copy ModelFile
 	A3DAsmModelFileData sData;
@@ -179,7 +219,10 @@ bool ExPsProcess::CopyAndUpdateModelFile(A3DAsmModelFile*& pCopyModelFile)
 	A3DAsmModelFileGet(m_pModelFile, &sData);
 
 	A3DAsmProductOccurrence* pCopyPO;
-	status = A3DAsmProductOccurrenceDeepCopy(sData.m_ppPOccurrences[0], &pCopyPO);
+	{
+		PERF_TRACE_SCOPE("ex", "A3DAsmProductOccurrenceDeepCopy");
+		status = A3DAsmProductOccurrenceDeepCopy(sData.m_ppPOccurrences[0], &pCopyPO);
+	}
 
 	A3DAsmModelFileData sCopyData;
 	A3D_INITIALIZE_DATA(A3DAsmModelFileData, sCopyData);
@@ -194,10 +237,12 @@ bool ExPsProcess::CopyAndUpdateModelFile(A3DAsmModelFile*& pCopyModelFile)
 
 	// Update Breps of copy ModelFile
 	{
+		PERF_TRACE_SCOPE("ex", "UpdatedCompVisitor");
+
 		A3DVisitorContainer sA3DVisitorContainer(CONNECT_TRANSFO);
 		sA3DVisitorContainer.SetTraverseInstance(false);
 
-		UpdatedCompVisitor* pMyTreeVisitor = new UpdatedCompVisitor(&sA3DVisitorContainer, m_updatedCompArr);
+		UpdatedCompVisitor* pMyTreeVisitor = new UpdatedCompVisitor(&sA3DVisitorContainer, m_updatedCompArr, plan);
 		sA3DVisitorContainer.push(pMyTreeVisitor);
 
 		A3DModelFileConnector sModelFileConnector(pCopyModelFile);
@@ -21,16 +21,27 @@ private:
 	A3DAsmModelFile* m_pModelFile;
 	PsProcess* m_pPsProcess;
 	std::vector<UpdatedComponent> m_updatedCompArr;
+	std::vector<A3DAsmModelFile*> m_copyModelFileArr;	// Translated bodies used by the last copy
+
+	bool convertUpdatedBodies();
+	void releaseCopyModelFiles();
 
 public:
 	bool m_bIsPart;
-	bool Save() { return m_pPsProcess->Save(); };
+	bool Save(const char* filePath, const PK_transmit_format_t format = PK_transmit_format_binary_c, const PsSaveMode mode = PsSaveMode::BACKGROUND) { return m_pPsProcess->Save(filePath, format, mode); };
+	bool IsSaving() const { return m_pPsProcess->IsSaving(); };
+	PsSaveStatus GetSaveStatus() const { return m_pPsProcess->GetSaveStatus(); };
+	bool WaitSave() { return m_pPsProcess->WaitSave(); };
 	void Initialize();
+	// Before the Parasolid session stops
+	void Terminate() { m_pPsProcess->Terminate(); };
 	void SetModelFile(A3DAsmModelFile* pModelFile);
 	bool RegisterUpdatedBody(A3DRiBrepModel* pRiBrepModel, PK_BODY_t body);
 	bool RegisterDeleteBody(A3DRiBrepModel* pRiBrepModel);
 	bool RegisterDeletePart(A3DAsmProductOccurrence* pPO);
 	bool CreateSolid(const SolidShape solidShape, const double* in_size, const double* in_offset, const double *in_dir, PK_BODY_t& body) { return m_pPsProcess->CreateSolid(solidShape, in_size, in_offset, in_dir, body); };
+	PsPrimitiveCacheStats GetPrimitiveCacheStats() const { return m_pPsProcess->GetPrimitiveCacheStats(); };
+	void SetPrimitiveCacheBudget(const size_t budgetBytes) { m_pPsProcess->SetPrimitiveCacheBudget(budgetBytes); };
 	bool BlendRC(const PsBlendType boolType, const double blendR, const double blendC2, 
 		const int edgeCnt, PK_EDGE_t* edges, PK_FACE_t* faces, A3DRiBrepModel* pRiBrepModel);
 	bool Hollow(const double thisckness, const PK_BODY_t body, const int faceCnt, const PK_FACE_t* pierceFaces, A3DRiBrepModel* pRiBrepModel);
@@ -39,7 +50,14 @@ public:
 	{ 
 		return m_pPsProcess->Boolean(boolType, targetBody, toolCnt, toolBodies, bodyCnt, bodies);
 	};
+	bool BooleanBatch(const PsBoolType boolType, const std::vector<PsBoolSet>& setArr, std::vector<PsBoolSetResult>& resultArr, PsJournalStep& step)
+	{
+		return m_pPsProcess->BooleanBatch(boolType, setArr, resultArr, step);
+	};
 	bool FR(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& pkFaceArr) { return m_pPsProcess->FR(frType, face, pkFaceArr); };
+	bool FRGroups(const PsFRType frType, const PK_BODY_t body, std::vector<std::vector<PK_FACE_t>>& groupArr) { return m_pPsProcess->FRGroups(frType, body, groupArr); };
+	void SetFRWorkerCount(const unsigned int workerCnt) { m_pPsProcess->SetFRWorkerCount(workerCnt); };
+	// The translated bodies of the copy are kept until the next copy or Initialize
 	bool CopyAndUpdateModelFile(A3DAsmModelFile*& pCopyModelFile);
 	bool MirrorBody(PK_BODY_t targetBody, const double* location, const double* normal, const double isCopy, const double isMerge, PK_BODY_t &mirror_body) {
 		return m_pPsProcess->MirrorBody(targetBody, location, normal, isCopy, isMerge, mirror_body);
@@ -47,6 +65,10 @@ public:
 	bool GetPlaneInfo(PK_FACE_t face, double* location, double* normal) {
 		return m_pPsProcess->GetPlaneInfo(face, location, normal);
 	};
+	bool Undo(PsJournalStep& step) { return m_pPsProcess->Undo(step); };
+	bool Redo(PsJournalStep& step) { return m_pPsProcess->Redo(step); };
+	bool CanUndo() const { return m_pPsProcess->CanUndo(); };
+	bool CanRedo() const { return m_pPsProcess->CanRedo(); };
 
 };
 
@@ -0,0 +1,171 @@
+#include "stdafx.h"
+#include "ExTessPolicy.h"
+#include <algorithm>
+#include <math.h>
+
+// A tessellation is refined when it is this times coarser than the target, so that a small zoom doesn't retessellate
+static const double s_refineHysteresis = 2.0;
+
+ExTessPolicy::ExTessPolicy() :
+	m_dPixelsPerUnit(0.0),
+	m_triangleCnt(0)
+{
+}
+
+ExTessPolicy::~ExTessPolicy()
+{
+}
+
+double ExTessPolicy::askDiagonal(A3DRiRepresentationItem* pRiItem)
+{
+	A3DBoundingBoxData sBox;
+	A3D_INITIALIZE_DATA(A3DBoundingBoxData, sBox);
+	if (A3D_SUCCESS != A3DMiscGetBoundingBox(pRiItem, &sBox))
+		return 0.0;
+
+	double dx = sBox.m_sMax.m_dX - sBox.m_sMin.m_dX;
+	double dy = sBox.m_sMax.m_dY - sBox.m_sMin.m_dY;
+	double dz = sBox.m_sMax.m_dZ - sBox.m_sMin.m_dZ;
+	return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+size_t ExTessPolicy::askTriangleCount(A3DRiRepresentationItem* pRiItem)
+{
+	size_t triangleCnt = 0;
+
+	A3DRiRepresentationItemData sRiData;
+	A3D_INITIALIZE_DATA(A3DRiRepresentationItemData, sRiData);
+	if (A3D_SUCCESS != A3DRiRepresentationItemGet(pRiItem, &sRiData))
+		return 0;
+
+	if (NULL != sRiData.m_pTessBase)
+	{
+		A3DTess3DData sTessData;
+		A3D_INITIALIZE_DATA(A3DTess3DData, sTessData);
+		if (A3D_SUCCESS == A3DTess3DGet(sRiData.m_pTessBase, &sTessData))
+		{
+			// Estimate, each vertex of a triangle has a normal and a point index
+			triangleCnt = sTessData.m_uiTriangulatedIndexSize / 6;
+			A3DTess3DGet(NULL, &sTessData);
+		}
+	}
+
+	A3DRiRepresentationItemGet(NULL, &sRiData);
+	return triangleCnt;
+}
+
+ExTessPolicy::Item& ExTessPolicy::getItem(A3DRiRepresentationItem* pRiItem)
+{
+	auto it = m_itemMap.find(pRiItem);
+	if (m_itemMap.end() != it)
+		return it->second;
+
+	Item item = { -1.0, 0.0, 0 };
+	return m_itemMap[pRiItem] = item;
+}
+
+double ExTessPolicy::targetChord(const double diag) const
+{
+	double minChord = diag * m_settings.minChordRatio;
+	double maxChord = diag * m_settings.maxChordRatio;
+
+	// No view yet, the middle of the range
+	if (0.0 >= m_dPixelsPerUnit)
+		return sqrt(minChord * maxChord);
+
+	double chord = m_settings.pixelTol / m_dPixelsPerUnit;
+	return std::min(std::max(chord, minChord), maxChord);
+}
+
+void ExTessPolicy::Register(A3DRiRepresentationItem* pRiItem)
+{
+	Item& item = getItem(pRiItem);
+	item.diag = -1.0;
+	item.chord = 0.0;
+}
+
+void ExTessPolicy::Forget(A3DRiRepresentationItem* pRiItem)
+{
+	auto it = m_itemMap.find(pRiItem);
+	if (m_itemMap.end() == it)
+		return;
+
+	m_triangleCnt -= it->second.triangleCnt;
+	m_itemMap.erase(it);
+}
+
+void ExTessPolicy::Clear()
+{
+	m_itemMap.clear();
+	m_triangleCnt = 0;
+}
+
+void ExTessPolicy::Compute(A3DRiRepresentationItem* pRiItem, const bool bCoarse, A3DRWParamsTessellationData& params)
+{
+	Item& item = getItem(pRiItem);
+	if (0.0 > item.diag)
+		item.diag = askDiagonal(pRiItem);
+
+	double chord = targetChord(item.diag);
+	double angleTol = m_settings.angleTolDeg;
+	if (bCoarse)
+	{
+		chord = std::min(chord * m_settings.coarseFactor, item.diag * m_settings.maxChordRatio);
+		angleTol = std::min(angleTol * m_settings.coarseFactor, 60.0);
+	}
+
+	A3D_INITIALIZE_DATA(A3DRWParamsTessellationData, params);
+	params.m_eTessellationLevelOfDetail = kA3DTessLODUserDefined;
+	params.m_bUseHeightInsteadOfRatio = true;
+	params.m_dMaxChordHeight = chord;
+	params.m_dAngleToleranceDeg = angleTol;
+	params.m_dMinimalTriangleAngleDeg = 20.0;
+}
+
+A3DStatus ExTessPolicy::Tessellate(A3DRiRepresentationItem* pRiItem, const bool bCoarse)
+{
+	A3DRWParamsTessellationData params;
+	Compute(pRiItem, bCoarse, params);
+
+	A3DStatus status = A3DRiRepresentationItemComputeTessellation(pRiItem, &params);
+	if (A3D_SUCCESS != status)
+		return status;
+
+	Item& item = getItem(pRiItem);
+	item.chord = params.m_dMaxChordHeight;
+
+	size_t triangleCnt = askTriangleCount(pRiItem);
+	m_triangleCnt = m_triangleCnt - item.triangleCnt + triangleCnt;
+	item.triangleCnt = triangleCnt;
+
+	return status;
+}
+
+void ExTessPolicy::FindRefinements(const size_t maxCnt, std::vector<A3DRiRepresentationItem*>& riItemArr)
+{
+	if (0.0 >= m_dPixelsPerUnit)
+		return;
+
+	if (m_settings.triangleBudget && m_settings.triangleBudget <= m_triangleCnt)
+		return;
+
+	std::vector<std::pair<double, A3DRiRepresentationItem*>> candidateArr;
+	for (auto it = m_itemMap.begin(); it != m_itemMap.end(); ++it)
+	{
+		Item& item = it->second;
+		if (0.0 > item.diag)
+			item.diag = askDiagonal(it->first);
+
+		// Out of the policy, taken as the coarsest
+		double chord = (0.0 < item.chord) ? item.chord : item.diag * m_settings.maxChordRatio;
+		if (targetChord(item.diag) * s_refineHysteresis < chord)
+			candidateArr.push_back(std::make_pair(item.diag, it->first));
+	}
+
+	size_t cnt = std::min(maxCnt, candidateArr.size());
+	std::partial_sort(candidateArr.begin(), candidateArr.begin() + cnt, candidateArr.end(),
+		[](const std::pair<double, A3DRiRepresentationItem*>& a, const std::pair<double, A3DRiRepresentationItem*>& b) { return a.first > b.first; });
+
+	for (size_t i = 0; i < cnt; i++)
+		riItemArr.push_back(candidateArr[i].second);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <A3DSDKIncludes.h>
+#include <unordered_map>
+#include <vector>
+
+struct ExTessSettings
+{
+	double pixelTol = 0.5;			// Chord height on screen
+	double minChordRatio = 1.0e-4;	// Chord height limits relative to the bounding box diagonal
+	double maxChordRatio = 1.0e-2;
+	double angleTolDeg = 20.0;
+	double coarseFactor = 4.0;		// First pass, chord height and angle tolerance are multiplied by it
+	size_t triangleBudget = 0;		// Of the whole model, 0 for no limit
+};
+
+// Tessellation tolerances of each representation item derived from its bounding box and its size on screen.
+// Items are tessellated coarse first, the ones which grow on screen are refined later, largest first.
+class ExTessPolicy
+{
+public:
+	ExTessPolicy();
+	~ExTessPolicy();
+
+private:
+	struct Item
+	{
+		double diag;		// Bounding box diagonal, < 0 until asked
+		double chord;		// Chord height of the current tessellation
+		size_t triangleCnt;
+	};
+
+	ExTessSettings m_settings;
+	double m_dPixelsPerUnit;	// 0 until the view gives its scale
+	std::unordered_map<A3DRiRepresentationItem*, Item> m_itemMap;
+	size_t m_triangleCnt;
+
+	static double askDiagonal(A3DRiRepresentationItem* pRiItem);
+	static size_t askTriangleCount(A3DRiRepresentationItem* pRiItem);
+	Item& getItem(A3DRiRepresentationItem* pRiItem);
+	double targetChord(const double diag) const;
+
+public:
+	void SetSettings(const ExTessSettings& settings) { m_settings = settings; }
+	const ExTessSettings& GetSettings() const { return m_settings; }
+	void SetViewScale(const double pixelsPerUnit) { m_dPixelsPerUnit = pixelsPerUnit; }
+
+	// An item tessellated out of the policy (import), assumed to be coarse
+	void Register(A3DRiRepresentationItem* pRiItem);
+	void Forget(A3DRiRepresentationItem* pRiItem);
+	void Clear();
+
+	void Compute(A3DRiRepresentationItem* pRiItem, const bool bCoarse, A3DRWParamsTessellationData& params);
+	A3DStatus Tessellate(A3DRiRepresentationItem* pRiItem, const bool bCoarse);
+	// Items coarser than the current view asks, largest on screen first. None when the triangle budget is used
+	void FindRefinements(const size_t maxCnt, std::vector<A3DRiRepresentationItem*>& riItemArr);
+	size_t GetTriangleCount() const { return m_triangleCnt; }
+};
@@ -1,7 +1,10 @@
 #include "ExUtilities.h"
+#include "PerfTrace.h"
 
 bool SearchBrepModelFromTopoBrep(A3DAsmModelFile* pModelFile, A3DTopoBrepData* pTopoBrep, A3DRiBrepModel*& pRiBrepModel)
 {
+	PERF_TRACE_SCOPE("ex", "SearchBrepModelFromTopoBrep");
+
 	A3DStatus ex_status;
 
 	A3DAsmModelFileData sModelFileData;
@@ -39,8 +42,10 @@ bool SearchBrepModelFromTopoBrep(A3DAsmModelFile* pModelFile, A3DTopoBrepData* p
 	return false;
 }
 
-bool PkBodyToA3DRiBrepModel(int body, A3DRiBrepModel*& pRiBrepModel, A3DMiscPKMapper*& pPkMapper)
+bool PkBodyToA3DRiBrepModel(int body, A3DRiBrepModel*& pRiBrepModel, A3DAsmModelFile*& pBlockModelFile)
 {
+	PERF_TRACE_SCOPE("ex", "PkBodyToA3DRiBrepModel");
+
 	A3DStatus status;
 
 	A3DRWParamsLoadData sParams;
@@ -48,19 +53,42 @@ bool PkBodyToA3DRiBrepModel(int body, A3DRiBrepModel*& pRiBrepModel, A3DMiscPKMa
 	sParams.m_sGeneral.m_bReadSolids = true;
 	sParams.m_sGeneral.m_eReadGeomTessMode = kA3DReadGeomAndTess;
 
-	A3DAsmModelFile* pBlockModelFile;
-	status = A3DPkPartsTranslateToA3DAsmModelFile(1, &body, &sParams, &pBlockModelFile, &pPkMapper);
+	pBlockModelFile = NULL;
+	A3DMiscPKMapper* pPkMapper = NULL;
+	{
+		PERF_TRACE_SCOPE("ex", "A3DPkPartsTranslateToA3DAsmModelFile");
+		status = A3DPkPartsTranslateToA3DAsmModelFile(1, &body, &sParams, &pBlockModelFile, &pPkMapper);
+	}
+	if (A3D_SUCCESS != status || NULL == pBlockModelFile || NULL == pPkMapper)
+	{
+		if (NULL != pBlockModelFile)
+			A3DAsmModelFileDelete(pBlockModelFile);
+		if (NULL != pPkMapper)
+			A3DEntityDelete(pPkMapper);
+		pBlockModelFile = NULL;
+		return false;
+	}
 
 	// Get A3DEntity of created PK_BODY
-	int iCnt;
-	A3DEntity** ppEntities;
+	int iCnt = 0;
+	A3DEntity** ppEntities = NULL;
 	status = A3DMiscPKMapperGetA3DEntitiesFromPKEntity(pPkMapper, body, &iCnt, &ppEntities);
 
 	// Get RiBrepModel from TopoBrepData and add to the mapping table
-	A3DTopoBrepData* pTopoBrepData = ppEntities[0];
-	
-	if (!SearchBrepModelFromTopoBrep(pBlockModelFile, pTopoBrepData, pRiBrepModel))
+	A3DTopoBrepData* pTopoBrepData = (A3D_SUCCESS == status && 0 < iCnt && NULL != ppEntities) ? ppEntities[0] : NULL;
+
+	bool bFound = NULL != pTopoBrepData && SearchBrepModelFromTopoBrep(pBlockModelFile, pTopoBrepData, pRiBrepModel);
+
+	// Only needed to find the Brep
+	A3DEntityDelete(pPkMapper);
+
+	if (!bFound)
+	{
+		A3DAsmModelFileDelete(pBlockModelFile);
+		pBlockModelFile = NULL;
+		pRiBrepModel = NULL;
 		return false;
+	}
 
 	return true;
 }
\ No newline at end of file
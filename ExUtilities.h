@@ -2,4 +2,5 @@
 #include "A3DSDKIncludes.h"
 
 bool SearchBrepModelFromTopoBrep(A3DAsmModelFile* pModelFile, A3DTopoBrepData* pTopoBrep, A3DRiBrepModel*& pRiBrepModel);
-bool PkBodyToA3DRiBrepModel(int body, A3DRiBrepModel*& pRiBrepModel, A3DMiscPKMapper*& pPkMapper);
+// The RiBrepModel belongs to pBlockModelFile, which is deleted by the caller once the RiBrepModel isn't used anymore
+bool PkBodyToA3DRiBrepModel(int body, A3DRiBrepModel*& pRiBrepModel, A3DAsmModelFile*& pBlockModelFile);
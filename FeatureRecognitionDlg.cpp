@@ -3,6 +3,7 @@
 
 #include "stdafx.h"
 #include "FeatureRecognitionDlg.h"
+#include "PerfTrace.h"
 #include "afxdialogex.h"
 
 
@@ -98,7 +99,7 @@ void FeatureRecognitionDlg::OnTimer(UINT_PTR nIDEvent)
 		if (!selCompArr[0].operator==(m_selComp))
 		{
 			// New selection
-			auto t0 = std::chrono::system_clock::now();
+			PerfTraceSpan span("ui", "FeatureRecognitionDlg::FR", true);
 
 			m_selComp = selCompArr[0];
 
@@ -227,10 +228,7 @@ void FeatureRecognitionDlg::OnTimer(UINT_PTR nIDEvent)
 			UpdateData(false);
 
 			// Show process time
-			auto t1 = std::chrono::system_clock::now();
-
-			auto dur1 = t1 - t0;
-			auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+			int msec1 = (int)span.ElapsedMsec();
 
 			wchar_t wcsbuf[256];
 			swprintf(wcsbuf, sizeof(wcsbuf), L"Process time: %d msec", msec1);
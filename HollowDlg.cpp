@@ -3,6 +3,7 @@
 
 #include "stdafx.h"
 #include "HollowDlg.h"
+#include "PerfTrace.h"
 #include "afxdialogex.h"
 
 
@@ -22,6 +23,7 @@ HollowDlg::HollowDlg(CHPSView* in_view, void* pProcess, CWnd* pParent /*=nullptr
 #else
 	m_pProcess = (ExProcess*)pProcess;
 	HPS::Component::ComponentType targetComp = HPS::Component::ComponentType::ExchangeTopoFace;
+	m_bRunning = false;
 #endif
 
 	m_pCmdOp = new ClickEntitiesCmdOp(targetComp, view, m_pProcess, false, HPS::MouseButtons::ButtonLeft());
@@ -48,7 +50,7 @@ BOOL HollowDlg::OnInitDialog()
 
 void HollowDlg::OnOK()
 {
-	auto t0 = std::chrono::system_clock::now();
+	PerfTraceSpan span("ui", "HollowDlg::OnOK", true);
 
 	m_pCmdOp->Unhighlight();
 
@@ -100,24 +102,34 @@ void HollowDlg::OnOK()
 
 	if (0 < pTopoFaces.size())
 	{
-		if (m_pProcess->Hollow(dThick, pRiBrepModel, pTopoFaces.size(), pTopoFaces.data()))
-		{
-			// Reload
-			HPS::Exchange::ReloadNotifier notifier = HPS::Exchange::Component(ownerComp).Reload();
-			notifier.Wait();
-		}
+		// Run on the executor, the result is taken by OnTimer
+		std::vector<ExOperation> opArr;
+		opArr.push_back([=](ExProcess* pProcess) mutable {
+			return pProcess->Hollow(dThick, pRiBrepModel, (int)pTopoFaces.size(), pTopoFaces.data());
+		});
+
+		ExProcess* pProcess = m_pProcess;
+		ExPipelineResult* pResult = &m_pipelineResult;
+		m_future = view->m_executor.Submit([pProcess, opArr, pResult](PsKernelTask& task) {
+			return pProcess->RunPipeline(opArr, *pResult, &task);
+		});
+
+		m_bRunning = true;
+		m_runStartNsec = PerfTrace::Now();
+		GetDlgItem(IDOK)->EnableWindow(FALSE);
+		wchar_t wcsbuf[256];
+		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Hollow running (Cancel rolls it back when the kernel call returns)");
+		view->ShowMessage(wcsbuf);
+		return;
 	}
 #endif
 	view->GetCanvas().Update();
 
 	// Show process time
-	auto t1 = std::chrono::system_clock::now();
-
-	auto dur1 = t1 - t0;
-	auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+	int msec1 = (int)span.ElapsedMsec();
 
 	wchar_t wcsbuf[256];
-	swprintf(wcsbuf, sizeof(wcsbuf), L"Process time: %d msec", (int)msec1);
+	swprintf(wcsbuf, sizeof(wcsbuf), L"Process time: %d msec", msec1);
 	view->ShowMessage(wcsbuf);
 
 	DestroyWindow();
@@ -125,6 +137,17 @@ void HollowDlg::OnOK()
 
 void HollowDlg::OnCancel()
 {
+#ifndef USING_EXCHANGE_PARASOLID
+	// Rolled back by the executor once PK_BODY_hollow_2 returns (it can't be interrupted), the dialog is closed when the result comes
+	if (m_bRunning)
+	{
+		view->m_executor.Cancel();
+		wchar_t wcsbuf[256];
+		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Hollow cancelled, waiting for the kernel call to return");
+		view->ShowMessage(wcsbuf);
+		return;
+	}
+#endif
 	m_pCmdOp->Unhighlight();
 
 	DestroyWindow();
@@ -153,6 +176,28 @@ END_MESSAGE_MAP()
 
 void HollowDlg::OnTimer(UINT_PTR nIDEvent)
 {
+#ifndef USING_EXCHANGE_PARASOLID
+	if (m_bRunning)
+	{
+		if (std::future_status::ready == m_future.wait_for(std::chrono::seconds(0)))
+		{
+			endRun();
+			return;
+		}
+
+		// One operation: the kernel call, then the Exchange update (progress 0.5)
+		PsKernelStatus status = view->m_executor.GetStatus();
+		const wchar_t* phase = (0.5 > status.progress) ? L"kernel" : L"Exchange update";
+
+		wchar_t wcsbuf[256];
+		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Hollow running: %ls, %d msec", phase, (int)status.runningMsec);
+		view->ShowMessage(wcsbuf);
+
+		// The selection can't be asked while the kernel is busy
+		CDialogEx::OnTimer(nIDEvent);
+		return;
+	}
+#endif
 	if (m_pCmdOp->m_bUpdated)
 	{
 		int nCount = m_psTagListBox.GetCount();
@@ -196,8 +241,45 @@ void HollowDlg::OnTimer(UINT_PTR nIDEvent)
 }
 
 
+#ifndef USING_EXCHANGE_PARASOLID
+void HollowDlg::endRun()
+{
+	m_bRunning = false;
+
+	if (m_future.get())
+	{
+		view->RefreshAfterPipeline(m_pipelineResult);
+
+		// Show process time
+		int msec1 = (int)((PerfTrace::Now() - m_runStartNsec) / 1000000);
+
+		wchar_t wcsbuf[256];
+		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Process time: %d msec", msec1);
+		view->ShowMessage(wcsbuf);
+	}
+	else
+	{
+		wchar_t wcsbuf[256];
+		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), m_pipelineResult.bCancelled ? L"Hollow cancelled" : L"Hollow failed");
+		view->ShowMessage(wcsbuf);
+	}
+
+	m_pCmdOp->Unhighlight();
+
+	DestroyWindow();
+}
+#endif
+
 void HollowDlg::OnClose()
 {
+#ifndef USING_EXCHANGE_PARASOLID
+	// The timer has to collect the result, the dialog is closed by endRun
+	if (m_bRunning)
+	{
+		OnCancel();
+		return;
+	}
+#endif
 	if (m_timerID != 0)
 	{
 		BOOL err = KillTimer(m_timerID);
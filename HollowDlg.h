@@ -31,6 +31,14 @@ private:
 	ExPsProcess* m_pProcess;
 #else
 	ExProcess* m_pProcess;
+
+	// Hollow running on the executor of the view
+	bool m_bRunning;
+	std::future<bool> m_future;
+	ExPipelineResult m_pipelineResult;
+	uint64_t m_runStartNsec;		// PerfTrace::Now() of the submission
+
+	void endRun();
 #endif
 	ClickEntitiesCmdOp* m_pCmdOp;
 
@@ -1,5 +1,6 @@
 ﻿#include "stdafx.h"
 #include "MirrorBodyDlg.h"
+#include "PerfTrace.h"
 #include "afxdialogex.h"
 
 #define COLOR_ACTIVE RGB(255, 128, 128)
@@ -62,7 +63,7 @@ BOOL MirrorDlg::OnInitDialog()
 
 void MirrorDlg::OnOK()
 {
-	auto t0 = std::chrono::system_clock::now();
+	PerfTraceSpan span("ui", "MirrorDlg::OnOK", true);
 	
 	m_pCmdOp->Unhighlight();
 
@@ -104,10 +105,7 @@ void MirrorDlg::OnOK()
 		view->GetCanvas().Update();
 
 		// Show process time
-		auto t1 = std::chrono::system_clock::now();
-
-		auto dur1 = t1 - t0;
-		auto msec1 = std::chrono::duration_cast<std::chrono::milliseconds>(dur1).count();
+		int msec1 = (int)span.ElapsedMsec();
 
 		wchar_t wcsbuf[512];
 		swprintf(wcsbuf, sizeof(wcsbuf) / sizeof(wchar_t), L"Process time: %d msec", msec1);
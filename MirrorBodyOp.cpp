@@ -118,6 +118,9 @@ bool MirrorBodyOp::OnMouseUp(HPS::MouseState const& in_state)
 				{
 					m_targetComp = selComp;
 					m_targetCompPath = compPath;
+#ifndef USING_EXCHANGE_PARASOLID
+					view->PrefetchSelected(selComp);
+#endif
 
 					view->GetCanvas().GetWindowKey().GetHighlightControl().Unhighlight(m_highlight_options_1);
 					GetAttachedView().Update(HPS::Window::UpdateType::Complete);
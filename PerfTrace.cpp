@@ -0,0 +1,242 @@
+#include "stdafx.h"
+#include "PerfTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// A slot is a seqlock: odd while written, 2 * (index + 1) once the event of that index is complete.
+// A reader keeps the slot only if the sequence is the same before and after reading it.
+struct PerfTraceSlot
+{
+	std::atomic<uint64_t> seq;
+	std::atomic<const char*> category;
+	std::atomic<const char*> name;
+	std::atomic<uint64_t> startNsec;
+	std::atomic<uint64_t> durNsec;
+	std::atomic<uint32_t> threadId;
+};
+
+struct PerfTraceEvent
+{
+	const char* category;
+	const char* name;
+	uint64_t startNsec;
+	uint64_t durNsec;
+	uint32_t threadId;
+};
+
+std::atomic<bool> PerfTrace::s_bEnabled(false);
+
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+static std::atomic<PerfTraceSlot*> s_pSlots(NULL);
+static size_t s_slotMask = 0;
+static std::atomic<uint64_t> s_head(0);		// Next event index
+static std::atomic<uint64_t> s_tail(0);		// First event index since the last Clear
+
+static std::atomic<uint32_t> s_nextThreadId(1);
+static thread_local uint32_t s_threadId = 0;
+
+// Enable, thread names and dump path, not on the recording path
+static std::mutex s_mutex;
+static std::vector<std::pair<uint32_t, std::string>> s_threadNameArr;
+static std::string s_dumpPath;
+
+static uint32_t stThreadId()
+{
+	if (0 == s_threadId)
+		s_threadId = s_nextThreadId++;
+	return s_threadId;
+}
+
+static void stWriteString(FILE* fp, const char* str)
+{
+	fputc('"', fp);
+	for (const char* p = str; *p; p++)
+	{
+		if ('"' == *p || '\\' == *p)
+			fputc('\\', fp);
+		if ((unsigned char)*p < 0x20)
+			fputc(' ', fp);
+		else
+			fputc(*p, fp);
+	}
+	fputc('"', fp);
+}
+
+uint64_t PerfTrace::Now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+void PerfTrace::Enable(const bool bEnable, const size_t eventCnt)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	if (bEnable && NULL == s_pSlots.load(std::memory_order_acquire))
+	{
+		size_t slotCnt = 1024;
+		while (slotCnt < eventCnt)
+			slotCnt <<= 1;
+
+		PerfTraceSlot* pSlots = new PerfTraceSlot[slotCnt];
+		for (size_t i = 0; i < slotCnt; i++)
+			pSlots[i].seq.store(0, std::memory_order_relaxed);
+
+		s_slotMask = slotCnt - 1;
+		s_pSlots.store(pSlots, std::memory_order_release);
+	}
+
+	s_bEnabled.store(bEnable, std::memory_order_relaxed);
+}
+
+void PerfTrace::Clear()
+{
+	s_tail.store(s_head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void PerfTrace::SetThreadName(const char* name)
+{
+	uint32_t threadId = stThreadId();
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	for (size_t i = 0; i < s_threadNameArr.size(); i++)
+	{
+		if (threadId == s_threadNameArr[i].first)
+		{
+			s_threadNameArr[i].second = name;
+			return;
+		}
+	}
+	s_threadNameArr.push_back(std::make_pair(threadId, std::string(name)));
+}
+
+void PerfTrace::SetDumpPath(const char* filePath)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_dumpPath = filePath ? filePath : "";
+}
+
+const char* PerfTrace::GetDumpPath()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_dumpPath.c_str();
+}
+
+void PerfTrace::record(const char* category, const char* name, const uint64_t startNsec, const uint64_t endNsec)
+{
+	PerfTraceSlot* pSlots = s_pSlots.load(std::memory_order_acquire);
+	if (NULL == pSlots)
+		return;
+
+	uint64_t index = s_head.fetch_add(1, std::memory_order_relaxed);
+	PerfTraceSlot& slot = pSlots[index & s_slotMask];
+
+	slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.category.store(category, std::memory_order_relaxed);
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.startNsec.store(startNsec, std::memory_order_relaxed);
+	slot.durNsec.store(endNsec - startNsec, std::memory_order_relaxed);
+	slot.threadId.store(stThreadId(), std::memory_order_relaxed);
+
+	slot.seq.store(2 * (index + 1), std::memory_order_release);
+}
+
+size_t PerfTrace::GetEventCount()
+{
+	if (NULL == s_pSlots.load(std::memory_order_acquire))
+		return 0;
+
+	uint64_t recordedCnt = s_head.load(std::memory_order_acquire) - s_tail.load(std::memory_order_acquire);
+	return (size_t)std::min<uint64_t>(recordedCnt, s_slotMask + 1);
+}
+
+unsigned long long PerfTrace::GetLostCount()
+{
+	if (NULL == s_pSlots.load(std::memory_order_acquire))
+		return 0;
+
+	uint64_t recordedCnt = s_head.load(std::memory_order_acquire) - s_tail.load(std::memory_order_acquire);
+	return (recordedCnt <= s_slotMask + 1) ? 0 : (unsigned long long)(recordedCnt - s_slotMask - 1);
+}
+
+bool PerfTrace::Dump(const char* filePath)
+{
+	std::string path = filePath ? filePath : GetDumpPath();
+	if (path.empty())
+		return false;
+
+	// Copy the complete slots, the ones being written are skipped
+	std::vector<PerfTraceEvent> eventArr;
+	PerfTraceSlot* pSlots = s_pSlots.load(std::memory_order_acquire);
+	if (NULL != pSlots)
+	{
+		uint64_t head = s_head.load(std::memory_order_acquire);
+		uint64_t first = s_tail.load(std::memory_order_acquire);
+		if (s_slotMask + 1 < head - first)
+			first = head - s_slotMask - 1;
+
+		eventArr.reserve((size_t)(head - first));
+		for (uint64_t index = first; index < head; index++)
+		{
+			const PerfTraceSlot& slot = pSlots[index & s_slotMask];
+
+			uint64_t seq = slot.seq.load(std::memory_order_acquire);
+			PerfTraceEvent event;
+			event.category = slot.category.load(std::memory_order_relaxed);
+			event.name = slot.name.load(std::memory_order_relaxed);
+			event.startNsec = slot.startNsec.load(std::memory_order_relaxed);
+			event.durNsec = slot.durNsec.load(std::memory_order_relaxed);
+			event.threadId = slot.threadId.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			if (2 * (index + 1) == seq && seq == slot.seq.load(std::memory_order_relaxed))
+				eventArr.push_back(event);
+		}
+	}
+
+	// Parents before their children at the same start
+	std::sort(eventArr.begin(), eventArr.end(), [](const PerfTraceEvent& a, const PerfTraceEvent& b)
+	{
+		if (a.startNsec != b.startNsec)
+			return a.startNsec < b.startNsec;
+		return a.durNsec > b.durNsec;
+	});
+
+	FILE* fp = fopen(path.c_str(), "w");
+	if (NULL == fp)
+		return false;
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(fp, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"hps_mfc_sandbox\"}}");
+
+	{
+		std::lock_guard<std::mutex> lock(s_mutex);
+		for (size_t i = 0; i < s_threadNameArr.size(); i++)
+		{
+			fprintf(fp, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", s_threadNameArr[i].first);
+			stWriteString(fp, s_threadNameArr[i].second.c_str());
+			fprintf(fp, "}}");
+		}
+	}
+
+	// Complete events, microseconds
+	for (size_t i = 0; i < eventArr.size(); i++)
+	{
+		const PerfTraceEvent& event = eventArr[i];
+		fprintf(fp, ",\n{\"ph\":\"X\",\"cat\":");
+		stWriteString(fp, event.category);
+		fprintf(fp, ",\"name\":");
+		stWriteString(fp, event.name);
+		fprintf(fp, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.threadId, event.startNsec / 1000.0, event.durNsec / 1000.0);
+	}
+
+	fprintf(fp, "\n]}\n");
+
+	return 0 == fclose(fp);
+}
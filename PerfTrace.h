@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Spans of the edit pipeline (kernel, PK => A3D translation, tessellation, reload...) recorded with their thread
+// into a lock-free ring and dumped as Chrome trace events (chrome://tracing, ui.perfetto.dev) on demand.
+// Off by default, a span then costs a relaxed load. PERF_TRACE_DISABLED compiles the scopes out.
+class PerfTrace
+{
+public:
+	// The ring of eventCnt slots (rounded up to a power of 2) is allocated at the first enable and kept
+	static void Enable(const bool bEnable, const size_t eventCnt = 1 << 17);
+	static bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+
+	// Forget the recorded events, the spans still open are kept
+	static void Clear();
+
+	// Name of the calling thread in the dump
+	static void SetThreadName(const char* name);
+
+	// Events of the ring, oldest first. NULL writes to the dump path
+	static bool Dump(const char* filePath = NULL);
+	static void SetDumpPath(const char* filePath);
+	static const char* GetDumpPath();
+
+	static size_t GetEventCount();
+	static unsigned long long GetLostCount();	// Overwritten since the last Clear
+
+	static uint64_t Now();	// Nanoseconds
+
+private:
+	friend class PerfTraceSpan;
+	static std::atomic<bool> s_bEnabled;
+
+	static void record(const char* category, const char* name, const uint64_t startNsec, const uint64_t endNsec);
+};
+
+class PerfTraceSpan
+{
+public:
+	// The names are kept by pointer, they have to live until the dump (string literals).
+	// bTimed measures the span even when the trace is off, for ElapsedMsec()
+	PerfTraceSpan(const char* category, const char* name, const bool bTimed = false) :
+		m_category(category),
+		m_name(name),
+		m_startNsec(0),
+		m_bRecord(PerfTrace::IsEnabled())
+	{
+		if (m_bRecord || bTimed)
+			m_startNsec = PerfTrace::Now();
+	}
+
+	~PerfTraceSpan()
+	{
+		if (m_bRecord)
+			PerfTrace::record(m_category, m_name, m_startNsec, PerfTrace::Now());
+	}
+
+	double ElapsedMsec() const { return (double)(PerfTrace::Now() - m_startNsec) / 1.0e6; }
+
+private:
+	const char* m_category;
+	const char* m_name;
+	uint64_t m_startNsec;
+	bool m_bRecord;
+
+	PerfTraceSpan(const PerfTraceSpan&) = delete;
+	PerfTraceSpan& operator=(const PerfTraceSpan&) = delete;
+};
+
+#ifndef PERF_TRACE_DISABLED
+#define PERF_TRACE_CONCAT_(a, b) a##b
+#define PERF_TRACE_CONCAT(a, b) PERF_TRACE_CONCAT_(a, b)
+#define PERF_TRACE_SCOPE(category, name) PerfTraceSpan PERF_TRACE_CONCAT(perfTraceSpan, __LINE__)(category, name)
+#else
+#define PERF_TRACE_SCOPE(category, name) ((void)0)
+#endif
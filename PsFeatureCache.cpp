@@ -0,0 +1,316 @@
+#include "stdafx.h"
+#include "PsFeatureCache.h"
+#include "PerfTrace.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// 1: concave or smooth concave, 0: other, -1: failed
+static char stAskConcave(const PsKernel& kernel, const PK_EDGE_t edge)
+{
+	PK_emboss_convexity_t convexity;
+	if (PK_ERROR_no_errors != kernel.AskEdgeConvexity(edge, convexity))
+		return -1;
+
+	return ((convexity == PK_EDGE_convexity_concave_c) || (convexity == PK_EDGE_convexity_smooth_ccv_c)) ? 1 : 0;
+}
+
+// The edges are shared out by chunks, each result is written to its own slot
+static void stAskConcaveArr(const PK_EDGE_t* edges, const int edgeCnt, char* concaveArr, unsigned int workerCnt)
+{
+	const int chunkSize = 256;
+	int chunkCnt = (edgeCnt + chunkSize - 1) / chunkSize;
+	if ((int)workerCnt > chunkCnt)
+		workerCnt = (unsigned int)chunkCnt;
+
+	const PsKernel& kernel = PsKernel::Current();
+	std::atomic<int> nextChunk(0);
+	auto worker = [&]()
+	{
+		PERF_TRACE_SCOPE("ps", "stAskConcaveArr worker");
+
+		for (int iChunk = nextChunk++; iChunk < chunkCnt; iChunk = nextChunk++)
+		{
+			int iEnd = std::min(edgeCnt, (iChunk + 1) * chunkSize);
+			for (int i = iChunk * chunkSize; i < iEnd; i++)
+				concaveArr[i] = stAskConcave(kernel, edges[i]);
+		}
+	};
+
+	if (workerCnt <= 1)
+	{
+		worker();
+		return;
+	}
+
+	std::vector<std::thread> threadArr;
+	for (unsigned int i = 0; i < workerCnt; i++)
+		threadArr.push_back(std::thread(worker));
+
+	for (auto& th : threadArr)
+		th.join();
+}
+
+PsFeatureCache::PsFeatureCache() :
+	m_body(PK_ENTITY_null),
+	m_bBuilt(false),
+	m_bEdgeBuilt(false),
+	m_iDeadEdgeCnt(0)
+{
+}
+
+PsFeatureCache::~PsFeatureCache()
+{
+}
+
+void PsFeatureCache::Clear()
+{
+	m_body = PK_ENTITY_null;
+	m_bBuilt = false;
+	for (int i = 0; i < 3; i++)
+		m_groups[i] = GroupArr();
+
+	m_bEdgeBuilt = false;
+	m_iDeadEdgeCnt = 0;
+	m_edgeArr.clear();
+	m_concaveArr.clear();
+	m_edgeMap.clear();
+}
+
+void PsFeatureCache::setGroups(const PsFRType frType, const std::vector<std::vector<PK_FACE_t>>& groupArr)
+{
+	GroupArr& groups = m_groups[frType];
+
+	size_t faceCnt = 0;
+	for (size_t i = 0; i < groupArr.size(); i++)
+		faceCnt += groupArr[i].size();
+
+	groups.groupMap.clear();
+	groups.groupMap.reserve(faceCnt);
+	groups.startArr.clear();
+	groups.startArr.reserve(groupArr.size() + 1);
+	groups.faceArr.clear();
+	groups.faceArr.reserve(faceCnt);
+
+	for (size_t i = 0; i < groupArr.size(); i++)
+	{
+		groups.startArr.push_back((int)groups.faceArr.size());
+		for (size_t j = 0; j < groupArr[i].size(); j++)
+		{
+			groups.groupMap[groupArr[i][j]] = (int)i;
+			groups.faceArr.push_back(groupArr[i][j]);
+		}
+	}
+	groups.startArr.push_back((int)groups.faceArr.size());
+}
+
+bool PsFeatureCache::buildEdges(const PK_BODY_t body, const unsigned int workerCnt)
+{
+	PERF_TRACE_SCOPE("ps", "PsFeatureCache::buildEdges");
+
+	m_bEdgeBuilt = false;
+	m_iDeadEdgeCnt = 0;
+	m_edgeMap.clear();
+
+	if (PK_ERROR_no_errors != PsKernel::Current().AskBodyEdges(body, m_edgeArr))
+		return false;
+
+	m_concaveArr.assign(m_edgeArr.size(), 0);
+
+	stAskConcaveArr(m_edgeArr.data(), (int)m_edgeArr.size(), m_concaveArr.data(), workerCnt);
+
+	m_edgeMap.reserve(m_edgeArr.size());
+	for (int i = 0; i < (int)m_edgeArr.size(); i++)
+		m_edgeMap[m_edgeArr[i]] = i;
+
+	m_bEdgeBuilt = true;
+
+	return true;
+}
+
+void PsFeatureCache::compactEdges()
+{
+	size_t liveCnt = 0;
+	for (size_t i = 0; i < m_edgeArr.size(); i++)
+	{
+		if (PK_ENTITY_null == m_edgeArr[i])
+			continue;
+
+		m_edgeArr[liveCnt] = m_edgeArr[i];
+		m_concaveArr[liveCnt] = m_concaveArr[i];
+		m_edgeMap[m_edgeArr[liveCnt]] = (int)liveCnt;
+		liveCnt++;
+	}
+
+	m_edgeArr.resize(liveCnt);
+	m_concaveArr.resize(liveCnt);
+	m_iDeadEdgeCnt = 0;
+}
+
+void PsFeatureCache::UpdateEdges(const std::vector<PK_FACE_t>& changedFaces, const std::vector<PK_TOPOL_t>& deletedTopols, const unsigned int workerCnt)
+{
+	PERF_TRACE_SCOPE("ps", "PsFeatureCache::UpdateEdges");
+
+	// Groups may merge or split anywhere on the body
+	m_bBuilt = false;
+	for (int i = 0; i < 3; i++)
+		m_groups[i] = GroupArr();
+
+	if (!m_bEdgeBuilt)
+		return;
+
+	for (size_t i = 0; i < deletedTopols.size(); i++)
+	{
+		auto it = m_edgeMap.find(deletedTopols[i]);
+		if (m_edgeMap.end() == it)
+			continue;
+
+		m_edgeArr[it->second] = PK_ENTITY_null;
+		m_edgeMap.erase(it);
+		m_iDeadEdgeCnt++;
+	}
+
+	// The convexity of an edge depends on its two faces only
+	const PsKernel& kernel = PsKernel::Current();
+	std::vector<PK_EDGE_t> edgeArr, faceEdgeArr;
+	for (size_t i = 0; i < changedFaces.size(); i++)
+	{
+		if (PK_ERROR_no_errors != kernel.AskFaceEdges(changedFaces[i], faceEdgeArr))
+			continue;
+
+		edgeArr.insert(edgeArr.end(), faceEdgeArr.begin(), faceEdgeArr.end());
+	}
+
+	std::sort(edgeArr.begin(), edgeArr.end());
+	edgeArr.erase(std::unique(edgeArr.begin(), edgeArr.end()), edgeArr.end());
+
+	std::vector<char> concaveArr(edgeArr.size(), 0);
+	stAskConcaveArr(edgeArr.data(), (int)edgeArr.size(), concaveArr.data(), workerCnt);
+
+	for (size_t i = 0; i < edgeArr.size(); i++)
+	{
+		auto it = m_edgeMap.find(edgeArr[i]);
+		if (m_edgeMap.end() != it)
+		{
+			m_concaveArr[it->second] = concaveArr[i];
+		}
+		else
+		{
+			m_edgeMap[edgeArr[i]] = (int)m_edgeArr.size();
+			m_edgeArr.push_back(edgeArr[i]);
+			m_concaveArr.push_back(concaveArr[i]);
+		}
+	}
+
+	if (1024 < m_iDeadEdgeCnt && (int)m_edgeMap.size() < m_iDeadEdgeCnt)
+		compactEdges();
+}
+
+bool PsFeatureCache::classifyBoss(const PK_BODY_t body)
+{
+	// Concave edges bound the boss facesets
+	std::vector<PK_EDGE_t> concaveEdgeArr;
+	for (size_t i = 0; i < m_edgeArr.size(); i++)
+	{
+		if (PK_ENTITY_null != m_edgeArr[i] && 1 == m_concaveArr[i])
+			concaveEdgeArr.push_back(m_edgeArr[i]);
+	}
+
+	// No selecting face: every faceset of the body is returned
+	std::vector<std::vector<PK_FACE_t>> groupArr;
+	if (PK_ERROR_no_errors != PsKernel::Current().FindFacesets(body, concaveEdgeArr, PK_ENTITY_null, groupArr))
+		return false;
+
+	setGroups(PsFRType::BOSS, groupArr);
+
+	return true;
+}
+
+bool PsFeatureCache::Classify(const PK_BODY_t body, PsGeomIndex& geomIndex, const double tol, const double angTol, const unsigned int workerCnt)
+{
+	PERF_TRACE_SCOPE("ps", "PsFeatureCache::Classify");
+
+	m_bBuilt = false;
+
+	if (m_body != body)
+	{
+		Clear();
+		m_body = body;
+	}
+
+	if (!m_bEdgeBuilt && !buildEdges(body, workerCnt))
+		return false;
+
+	// Update keeps the index of the body current, only the faces it changed are grouped again
+	if ((!geomIndex.IsBuilt() || body != geomIndex.GetBody()) && !geomIndex.Build(body))
+		return false;
+
+	// A dead edge left in the table by an untracked change makes the faceset search fail, start over then
+	if (!classifyBoss(body))
+	{
+		if (!buildEdges(body, workerCnt) || !classifyBoss(body))
+			return false;
+	}
+
+	std::vector<std::vector<PK_FACE_t>> groupArr;
+	geomIndex.GroupConcentric(tol, angTol, groupArr);
+	setGroups(PsFRType::CONCENTRIC, groupArr);
+
+	geomIndex.GroupCoplanar(tol, angTol, groupArr);
+	setGroups(PsFRType::COPLANAR, groupArr);
+
+	m_bBuilt = true;
+
+	return true;
+}
+
+bool PsFeatureCache::Find(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr) const
+{
+	if (!m_bBuilt)
+		return false;
+
+	const GroupArr& groups = m_groups[frType];
+
+	auto it = groups.groupMap.find(face);
+	if (groups.groupMap.end() == it)
+	{
+		// A face of the body which is not a plane / cylinder has no coplanar / concentric group
+		if (PsFRType::BOSS == frType)
+			return false;
+
+		return 0 != m_groups[PsFRType::BOSS].groupMap.count(face);
+	}
+
+	int iGroup = it->second;
+	entityArr.insert(entityArr.end(), groups.faceArr.begin() + groups.startArr[iGroup], groups.faceArr.begin() + groups.startArr[iGroup + 1]);
+
+	return true;
+}
+
+int PsFeatureCache::GetGroupCount(const PsFRType frType, const int minFaceCnt) const
+{
+	const GroupArr& groups = m_groups[frType];
+
+	int groupCnt = 0;
+	for (size_t i = 0; i + 1 < groups.startArr.size(); i++)
+	{
+		if (minFaceCnt <= groups.startArr[i + 1] - groups.startArr[i])
+			groupCnt++;
+	}
+
+	return groupCnt;
+}
+
+void PsFeatureCache::GetGroups(const PsFRType frType, std::vector<std::vector<PK_FACE_t>>& groupArr, const int minFaceCnt) const
+{
+	const GroupArr& groups = m_groups[frType];
+
+	groupArr.clear();
+	for (size_t i = 0; i + 1 < groups.startArr.size(); i++)
+	{
+		if (groups.startArr[i + 1] - groups.startArr[i] < minFaceCnt)
+			continue;
+
+		groupArr.push_back(std::vector<PK_FACE_t>(groups.faceArr.begin() + groups.startArr[i], groups.faceArr.begin() + groups.startArr[i + 1]));
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "PsGeomIndex.h"
+#include <unordered_map>
+#include <vector>
+
+enum PsFRType
+{
+	BOSS,
+	CONCENTRIC,
+	COPLANAR
+};
+
+// Every face of a body classified at once into coplanar sets, concentric sets and boss facesets.
+// A feature recognition query of the body is a lookup of the group of the seed face then.
+// The convexity of the edges outlives the groups, only the edges of the faces touched by an operation are asked again.
+class PsFeatureCache
+{
+public:
+	PsFeatureCache();
+	~PsFeatureCache();
+
+private:
+	// Groups stored back to back: the faces of group i are faceArr[startArr[i]] .. faceArr[startArr[i + 1] - 1]
+	struct GroupArr
+	{
+		std::unordered_map<PK_FACE_t, int> groupMap;
+		std::vector<int> startArr;
+		std::vector<PK_FACE_t> faceArr;
+	};
+
+	PK_BODY_t m_body;
+	bool m_bBuilt;
+	GroupArr m_groups[3];	// Indexed by PsFRType
+
+	// Edge convexity, a removed edge keeps its place with a null tag until the next compaction
+	bool m_bEdgeBuilt;
+	int m_iDeadEdgeCnt;
+	std::vector<PK_EDGE_t> m_edgeArr;
+	std::vector<char> m_concaveArr;
+	std::unordered_map<PK_EDGE_t, int> m_edgeMap;
+
+	void setGroups(const PsFRType frType, const std::vector<std::vector<PK_FACE_t>>& groupArr);
+	bool buildEdges(const PK_BODY_t body, const unsigned int workerCnt);
+	void compactEdges();
+	bool classifyBoss(const PK_BODY_t body);
+
+public:
+	// The geometry index is built if it isn't yet, else it has to be kept up to date with PsGeomIndex::Update.
+	// Convexity enquiries run on workerCnt threads, 1 unless the kernel session is thread safe
+	bool Classify(const PK_BODY_t body, PsGeomIndex& geomIndex, const double tol, const double angTol, const unsigned int workerCnt = 1);
+	void Clear();
+
+	// Drop the groups and ask the convexity of the edges of modified / created faces again
+	void UpdateEdges(const std::vector<PK_FACE_t>& changedFaces, const std::vector<PK_TOPOL_t>& deletedTopols, const unsigned int workerCnt = 1);
+	bool IsBuilt() const { return m_bBuilt; }
+	PK_BODY_t GetBody() const { return m_body; }
+
+	// Return false if the face wasn't classified (not a face of the body when it was classified)
+	bool Find(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr) const;
+
+	// Groups of more than one face, for the bulk selections
+	int GetGroupCount(const PsFRType frType, const int minFaceCnt = 2) const;
+	void GetGroups(const PsFRType frType, std::vector<std::vector<PK_FACE_t>>& groupArr, const int minFaceCnt = 2) const;
+};
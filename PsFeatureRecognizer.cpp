@@ -0,0 +1,146 @@
+#include "stdafx.h"
+#include "PsFeatureRecognizer.h"
+#include "PsModelQuery.h"
+#include <thread>
+
+PsFeatureRecognizer::PsFeatureRecognizer(const double tol, const double angTol) :
+	m_dTol(tol),
+	m_dAngTol(angTol),
+	m_uiWorkerCnt(1)
+{
+}
+
+PsFeatureRecognizer::~PsFeatureRecognizer()
+{
+}
+
+bool PsFeatureRecognizer::findBoss(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr)
+{
+	return PsModelQuery(PsKernel::Current()).FindBoss(body, face, entityArr);
+}
+
+bool PsFeatureRecognizer::findConcentric(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr)
+{
+	// Only the cylinders in the buckets of the input axis are checked
+	size_t entityCnt = entityArr.size();
+	PsGeomIndex& geomIndex = getGeomIndex(body);
+	if (geomIndex.FindConcentric(face, m_dTol, m_dAngTol, entityArr))
+		return true;
+
+	// Stale index
+	entityArr.resize(entityCnt);
+	if (!geomIndex.Build(body))
+		return false;
+
+	return geomIndex.FindConcentric(face, m_dTol, m_dAngTol, entityArr);
+}
+
+bool PsFeatureRecognizer::findCoplanar(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr)
+{
+	// Only the planes in the buckets of the input normal / offset are checked
+	size_t entityCnt = entityArr.size();
+	PsGeomIndex& geomIndex = getGeomIndex(body);
+	if (geomIndex.FindCoplanar(face, m_dTol, m_dAngTol, entityArr))
+		return true;
+
+	// Stale index
+	entityArr.resize(entityCnt);
+	if (!geomIndex.Build(body))
+		return false;
+
+	return geomIndex.FindCoplanar(face, m_dTol, m_dAngTol, entityArr);
+}
+
+PsGeomIndex& PsFeatureRecognizer::getGeomIndex(const PK_BODY_t body)
+{
+	PsGeomIndex& geomIndex = m_geomIndexMap[body];
+	if (!geomIndex.IsBuilt())
+		geomIndex.Build(body);
+
+	return geomIndex;
+}
+
+PsFeatureCache& PsFeatureRecognizer::getFeatureCache(const PK_BODY_t body)
+{
+	PsFeatureCache& featureCache = m_featureCacheMap[body];
+	if (!featureCache.IsBuilt())
+		featureCache.Classify(body, m_geomIndexMap[body], m_dTol, m_dAngTol, m_uiWorkerCnt);
+
+	return featureCache;
+}
+
+void PsFeatureRecognizer::Update(const PK_BODY_t body, const std::vector<PK_FACE_t>& changedFaces, const std::vector<PK_TOPOL_t>& deletedTopols)
+{
+	auto itIndex = m_geomIndexMap.find(body);
+	if (m_geomIndexMap.end() != itIndex)
+		itIndex->second.Update(changedFaces, deletedTopols);
+
+	// The groups are dropped, a merge or a split may ripple through the body, but the edge convexity is kept
+	auto itCache = m_featureCacheMap.find(body);
+	if (m_featureCacheMap.end() != itCache)
+		itCache->second.UpdateEdges(changedFaces, deletedTopols, m_uiWorkerCnt);
+}
+
+void PsFeatureRecognizer::Invalidate(const PK_BODY_t body)
+{
+	if (PK_ENTITY_null == body)
+	{
+		m_geomIndexMap.clear();
+		m_featureCacheMap.clear();
+	}
+	else
+	{
+		m_geomIndexMap.erase(body);
+		m_featureCacheMap.erase(body);
+	}
+}
+
+void PsFeatureRecognizer::SetWorkerCount(const unsigned int workerCnt)
+{
+	m_uiWorkerCnt = workerCnt;
+	if (0 == m_uiWorkerCnt)
+		m_uiWorkerCnt = std::thread::hardware_concurrency();
+	if (0 == m_uiWorkerCnt)
+		m_uiWorkerCnt = 1;
+}
+
+bool PsFeatureRecognizer::Find(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr)
+{
+	PK_BODY_t body;
+	if (PK_ERROR_no_errors != PsKernel::Current().AskFaceBody(face, body))
+		return false;
+
+	// The whole body is classified at the first query, the next ones are lookups
+	PsFeatureCache& featureCache = getFeatureCache(body);
+	if (featureCache.Find(frType, face, entityArr))
+		return true;
+
+	// The face is newer than the groups
+	if (featureCache.Classify(body, m_geomIndexMap[body], m_dTol, m_dAngTol, m_uiWorkerCnt) && featureCache.Find(frType, face, entityArr))
+		return true;
+
+	switch (frType)
+	{
+	case PsFRType::BOSS:
+		return findBoss(body, face, entityArr);
+	case PsFRType::CONCENTRIC:
+		return findConcentric(body, face, entityArr);
+	case PsFRType::COPLANAR:
+		return findCoplanar(body, face, entityArr);
+	default:
+		break;
+	}
+
+	return false;
+}
+
+bool PsFeatureRecognizer::FindGroups(const PsFRType frType, const PK_BODY_t body, std::vector<std::vector<PK_FACE_t>>& groupArr)
+{
+	PsFeatureCache& featureCache = getFeatureCache(body);
+	if (!featureCache.IsBuilt())
+		return false;
+
+	featureCache.GetGroups(frType, groupArr);
+
+	return true;
+}
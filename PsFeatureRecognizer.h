@@ -0,0 +1,42 @@
+#pragma once
+#include "PsFeatureCache.h"
+#include <map>
+#include <vector>
+
+// FR of PsProcess written on PsKernel only, so ps_batch runs it on the stand-in too.
+// The geometry index and the feature cache of a body are built at its first query and kept up to date by the operations.
+class PsFeatureRecognizer
+{
+public:
+	PsFeatureRecognizer(const double tol, const double angTol);
+	~PsFeatureRecognizer();
+
+private:
+	const double m_dTol;
+	const double m_dAngTol;
+	unsigned int m_uiWorkerCnt;		// Threads asking the edge convexity
+	std::map<PK_BODY_t, PsGeomIndex> m_geomIndexMap;	// Built at the first coplanar / concentric query of a body
+	std::map<PK_BODY_t, PsFeatureCache> m_featureCacheMap;	// Built at the first FR query of a body, the edge convexity survives the operations
+
+	PsGeomIndex& getGeomIndex(const PK_BODY_t body);
+	PsFeatureCache& getFeatureCache(const PK_BODY_t body);
+	bool findBoss(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr);
+	bool findConcentric(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr);
+	bool findCoplanar(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr);
+
+public:
+	bool Find(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr);
+	bool FindGroups(const PsFRType frType, const PK_BODY_t body, std::vector<std::vector<PK_FACE_t>>& groupArr);
+
+	bool IsCached(const PK_BODY_t body) const { return m_geomIndexMap.count(body) || m_featureCacheMap.count(body); }
+	// Faces changed by an operation on the body. The groups are dropped, the edge convexity is kept
+	void Update(const PK_BODY_t body, const std::vector<PK_FACE_t>& changedFaces, const std::vector<PK_TOPOL_t>& deletedTopols);
+	// The index is built again at the next query, cheaper than an update when most of the faces changed
+	void DropGeomIndex(const PK_BODY_t body) { m_geomIndexMap.erase(body); }
+	// PK_ENTITY_null for all the bodies
+	void Invalidate(const PK_BODY_t body);
+
+	// 0 for the number of cores
+	void SetWorkerCount(const unsigned int workerCnt);
+	unsigned int GetWorkerCount() const { return m_uiWorkerCnt; }
+};
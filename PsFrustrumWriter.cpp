@@ -0,0 +1,124 @@
+#include "stdafx.h"
+#include "PsFrustrumWriter.h"
+#include <unordered_map>
+#include <vector>
+
+static const int s_noErrors = 0;	// FR_no_errors of the frustrum
+
+typedef void (*FfwritFunc)(const int*, const int*, const int*, const char*, int*);
+typedef void (*FfclosFunc)(const int*, const int*, const int*, int*);
+typedef void (*FfseekFunc)(const int*, const int*, const int*, int*);
+typedef void (*FftellFunc)(const int*, const int*, int*, int*);
+
+static FfwritFunc s_fnWrite = NULL;
+static FfclosFunc s_fnClose = NULL;
+static FfseekFunc s_fnSeek = NULL;
+static FftellFunc s_fnTell = NULL;
+static size_t s_bufferBytes = 0;
+static size_t s_writtenBytes = 0;
+static size_t s_writeCnt = 0;
+
+// The frustrum is only called by the modelling thread
+static std::unordered_map<int, std::vector<char>> s_bufferMap;
+
+static void stWriteThrough(const int* guise, const int strid, const char* data, const size_t n_bytes, int* ifail)
+{
+	int nchars = (int)n_bytes;
+	s_fnWrite(guise, &strid, &nchars, data, ifail);
+
+	s_writtenBytes += n_bytes;
+	s_writeCnt++;
+}
+
+static void stFlush(const int* guise, const int strid, int* ifail)
+{
+	*ifail = s_noErrors;
+
+	auto it = s_bufferMap.find(strid);
+	if (s_bufferMap.end() == it || it->second.empty())
+		return;
+
+	stWriteThrough(guise, strid, it->second.data(), it->second.size(), ifail);
+	it->second.clear();
+}
+
+static void stFfwrit(const int* guise, const int* strid, const int* nchars, const char* buffer, int* ifail)
+{
+	std::vector<char>& bufferArr = s_bufferMap[*strid];
+	if (bufferArr.capacity() < s_bufferBytes)
+		bufferArr.reserve(s_bufferBytes);
+
+	if (s_bufferBytes < bufferArr.size() + *nchars)
+	{
+		stFlush(guise, *strid, ifail);
+		if (s_noErrors != *ifail)
+			return;
+	}
+
+	// Large pieces go as they are
+	if (s_bufferBytes <= (size_t)*nchars)
+	{
+		stWriteThrough(guise, *strid, buffer, *nchars, ifail);
+		return;
+	}
+
+	bufferArr.insert(bufferArr.end(), buffer, buffer + *nchars);
+	*ifail = s_noErrors;
+}
+
+static void stFfclos(const int* guise, const int* strid, const int* action, int* ifail)
+{
+	int flushFail = s_noErrors;
+	stFlush(guise, *strid, &flushFail);
+	s_bufferMap.erase(*strid);
+
+	s_fnClose(guise, strid, action, ifail);
+	if (s_noErrors == *ifail)
+		*ifail = flushFail;
+}
+
+static void stFfseek(const int* guise, const int* strid, const int* pos, int* ifail)
+{
+	stFlush(guise, *strid, ifail);
+	if (s_noErrors == *ifail)
+		s_fnSeek(guise, strid, pos, ifail);
+}
+
+static void stFftell(const int* guise, const int* strid, int* pos, int* ifail)
+{
+	stFlush(guise, *strid, ifail);
+	if (s_noErrors == *ifail)
+		s_fnTell(guise, strid, pos, ifail);
+}
+
+void PsFrustrumWriter::Wrap(PK_SESSION_frustrum_t& fru, const size_t bufferBytes)
+{
+	if (NULL == fru.ffwrit || NULL == fru.ffclos || NULL == fru.ffseek || NULL == fru.fftell)
+		return;
+
+	s_fnWrite = fru.ffwrit;
+	s_fnClose = fru.ffclos;
+	s_fnSeek = fru.ffseek;
+	s_fnTell = fru.fftell;
+	s_bufferBytes = bufferBytes;
+
+	fru.ffwrit = stFfwrit;
+	fru.ffclos = stFfclos;
+	fru.ffseek = stFfseek;
+	fru.fftell = stFftell;
+}
+
+bool PsFrustrumWriter::IsWrapped()
+{
+	return NULL != s_fnWrite;
+}
+
+size_t PsFrustrumWriter::GetWrittenBytes()
+{
+	return s_writtenBytes;
+}
+
+size_t PsFrustrumWriter::GetWriteCount()
+{
+	return s_writeCnt;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "parasolid_kernel.h"
+#include <stddef.h>
+
+// Write side of the frustrum with large writes. The kernel transmits a part in small pieces, they are
+// gathered per stream and given to the wrapped FFWRIT in blocks of the buffer size.
+// Only for the sessions the sandbox starts itself (the batch runner), HPS registers the frustrum of the application.
+class PsFrustrumWriter
+{
+public:
+	// Keeps the write functions of fru and puts the buffered ones, before PK_SESSION_register_frustrum
+	static void Wrap(PK_SESSION_frustrum_t& fru, const size_t bufferBytes = 8 * 1024 * 1024);
+	static bool IsWrapped();
+	// Bytes given to the wrapped frustrum and number of its write calls since the session started
+	static size_t GetWrittenBytes();
+	static size_t GetWriteCount();
+};
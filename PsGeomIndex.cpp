@@ -0,0 +1,747 @@
+#include "stdafx.h"
+#include "PsGeomIndex.h"
+#include "PerfTrace.h"
+#include <algorithm>
+#include <math.h>
+
+// Cells are much larger than the FR tolerances, a query also looks at the next cell when it is within the margin
+static const double s_dirCell = 1.0e-6;
+static const double s_dirMargin = 1.0e-8;
+static const double s_lenCell = 1.0e-3;
+static const double s_lenMargin = 1.0e-5;
+
+static void stNormalize(double* v)
+{
+	double len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (0.0 < len)
+	{
+		v[0] /= len;
+		v[1] /= len;
+		v[2] /= len;
+	}
+}
+
+static double stDot(const double* a, const double* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static double stCrossMagnitude(const double* a, const double* b)
+{
+	double c[3] = {
+		a[1] * b[2] - a[2] * b[1],
+		a[2] * b[0] - a[0] * b[2],
+		a[0] * b[1] - a[1] * b[0] };
+	return sqrt(stDot(c, c));
+}
+
+// Coplanar and concentric don't depend on the orientation: flip the direction so that its largest component is positive.
+// Returns true if another component is as large, then the opposite orientation has to be looked up too.
+static bool stCanonicalize(double* dir)
+{
+	int iMax = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (fabs(dir[iMax]) < fabs(dir[i]))
+			iMax = i;
+	}
+
+	if (dir[iMax] < 0.0)
+	{
+		for (int i = 0; i < 3; i++)
+			dir[i] = -dir[i];
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (i != iMax && fabs(fabs(dir[iMax]) - fabs(dir[i])) < s_dirMargin)
+			return true;
+	}
+	return false;
+}
+
+static uint64_t stHash(const int64_t* q, const int n)
+{
+	uint64_t h = 1469598103934665603ULL;
+	for (int i = 0; i < n; i++)
+		h ^= (uint64_t)q[i] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	return h;
+}
+
+// Keys of the cell of the values and of the neighbouring cells within the margin
+static void stCollectKeys(const int n, const double* val, const double* cell, const double* margin, std::vector<uint64_t>& keyArr)
+{
+	int64_t alt[6][3];
+	int altCnt[6];
+	for (int i = 0; i < n; i++)
+	{
+		int64_t q = (int64_t)floor(val[i] / cell[i]);
+		double lo = val[i] - (double)q * cell[i];
+
+		altCnt[i] = 0;
+		alt[i][altCnt[i]++] = q;
+		if (lo < margin[i])
+			alt[i][altCnt[i]++] = q - 1;
+		if (cell[i] - lo < margin[i])
+			alt[i][altCnt[i]++] = q + 1;
+	}
+
+	int idx[6] = { 0 };
+	int64_t q[6];
+	while (true)
+	{
+		for (int i = 0; i < n; i++)
+			q[i] = alt[i][idx[i]];
+		keyArr.push_back(stHash(q, n));
+
+		int i = 0;
+		while (i < n && ++idx[i] == altCnt[i])
+			idx[i++] = 0;
+		if (i == n)
+			break;
+	}
+}
+
+static uint64_t stKey(const int n, const double* val, const double* cell)
+{
+	int64_t q[6];
+	for (int i = 0; i < n; i++)
+		q[i] = (int64_t)floor(val[i] / cell[i]);
+	return stHash(q, n);
+}
+
+// Plane bucket values: canonical normal and signed offset from the origin
+static void stPlaneValues(const double* normal, const double* location, double* val)
+{
+	for (int i = 0; i < 3; i++)
+		val[i] = normal[i];
+	val[3] = stDot(normal, location);
+}
+
+// Cylinder bucket values: canonical axis and the point of the axis line nearest to the origin
+static void stCylValues(const double* axis, const double* location, double* val)
+{
+	double t = stDot(axis, location);
+	for (int i = 0; i < 3; i++)
+	{
+		val[i] = axis[i];
+		val[3 + i] = location[i] - t * axis[i];
+	}
+}
+
+static const double s_planeCell[4] = { s_dirCell, s_dirCell, s_dirCell, s_lenCell };
+static const double s_planeMargin[4] = { s_dirMargin, s_dirMargin, s_dirMargin, s_lenMargin };
+static const double s_cylCell[6] = { s_dirCell, s_dirCell, s_dirCell, s_lenCell, s_lenCell, s_lenCell };
+static const double s_cylMargin[6] = { s_dirMargin, s_dirMargin, s_dirMargin, s_lenMargin, s_lenMargin, s_lenMargin };
+
+static void stRemoveFromBucket(std::unordered_map<uint64_t, std::vector<int>>& buckets, const uint64_t key, const int index)
+{
+	auto it = buckets.find(key);
+	if (buckets.end() == it)
+		return;
+
+	// The slots stay in ascending order, the body order of the queries
+	std::vector<int>& slotArr = it->second;
+	auto itSlot = std::lower_bound(slotArr.begin(), slotArr.end(), index);
+	if (slotArr.end() != itSlot && index == *itSlot)
+		slotArr.erase(itSlot);
+
+	if (slotArr.empty())
+		buckets.erase(it);
+}
+
+PsGeomIndex::PsGeomIndex() :
+	m_body(PK_ENTITY_null),
+	m_bBuilt(false),
+	m_iDeadCnt(0)
+{
+}
+
+PsGeomIndex::~PsGeomIndex()
+{
+}
+
+void PsGeomIndex::Clear()
+{
+	m_body = PK_ENTITY_null;
+	m_bBuilt = false;
+	m_iDeadCnt = 0;
+	m_planes = PlaneArr();
+	m_cyls = CylArr();
+	m_faceMap.clear();
+	m_planeBuckets.clear();
+	m_cylBuckets.clear();
+	m_planeGrouping = Grouping();
+	m_cylGrouping = Grouping();
+}
+
+bool PsGeomIndex::Build(const PK_BODY_t body)
+{
+	PERF_TRACE_SCOPE("ps", "PsGeomIndex::Build");
+
+	Clear();
+
+	std::vector<PK_FACE_t> faceArr;
+	if (PK_ERROR_no_errors != PsKernel::Current().AskBodyFaces(body, faceArr))
+		return false;
+
+	m_faceMap.reserve(faceArr.size());
+	for (size_t i = 0; i < faceArr.size(); i++)
+		addFace(faceArr[i]);
+
+	m_body = body;
+	m_bBuilt = true;
+
+	return true;
+}
+
+bool PsGeomIndex::addFace(const PK_FACE_t face)
+{
+	PK_ERROR_code_t error_code;
+	const PsKernel& kernel = PsKernel::Current();
+
+	PK_SURF_t surf = PK_ENTITY_null;
+	error_code = kernel.AskFaceSurf(face, surf);
+	if (PK_ERROR_no_errors != error_code || PK_ENTITY_null == surf)
+		return false;
+
+	PK_CLASS_t surf_class;
+	error_code = kernel.AskClass(surf, surf_class);
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+
+	if (PK_CLASS_plane == surf_class)
+	{
+		PK_PLANE_sf_t plane_sf;
+		error_code = kernel.AskPlane(surf, plane_sf);
+		if (PK_ERROR_no_errors != error_code)
+			return false;
+
+		double normal[3], location[3], val[4];
+		for (int i = 0; i < 3; i++)
+		{
+			normal[i] = plane_sf.basis_set.axis.coord[i];
+			location[i] = plane_sf.basis_set.location.coord[i];
+		}
+		stNormalize(normal);
+
+		double canonical[3] = { normal[0], normal[1], normal[2] };
+		stCanonicalize(canonical);
+		stPlaneValues(canonical, location, val);
+		uint64_t key = stKey(4, val, s_planeCell);
+
+		int index = (int)m_planes.face.size();
+		m_planes.face.push_back(face);
+		m_planes.surf.push_back(surf);
+		m_planes.nx.push_back(normal[0]);
+		m_planes.ny.push_back(normal[1]);
+		m_planes.nz.push_back(normal[2]);
+		m_planes.lx.push_back(location[0]);
+		m_planes.ly.push_back(location[1]);
+		m_planes.lz.push_back(location[2]);
+		m_planes.key.push_back(key);
+
+		m_planeBuckets[key].push_back(index);
+		if (m_planeGrouping.bValid)
+			m_planeGrouping.pendingArr.push_back(index);
+		Slot slot = { PLANE_SLOT, index };
+		m_faceMap[face] = slot;
+	}
+	else if (PK_CLASS_cyl == surf_class)
+	{
+		PK_CYL_sf_t cyl_sf;
+		error_code = kernel.AskCyl(surf, cyl_sf);
+		if (PK_ERROR_no_errors != error_code)
+			return false;
+
+		double axis[3], location[3], val[6];
+		for (int i = 0; i < 3; i++)
+		{
+			axis[i] = cyl_sf.basis_set.axis.coord[i];
+			location[i] = cyl_sf.basis_set.location.coord[i];
+		}
+		stNormalize(axis);
+
+		double canonical[3] = { axis[0], axis[1], axis[2] };
+		stCanonicalize(canonical);
+		stCylValues(canonical, location, val);
+		uint64_t key = stKey(6, val, s_cylCell);
+
+		int index = (int)m_cyls.face.size();
+		m_cyls.face.push_back(face);
+		m_cyls.surf.push_back(surf);
+		m_cyls.ax.push_back(axis[0]);
+		m_cyls.ay.push_back(axis[1]);
+		m_cyls.az.push_back(axis[2]);
+		m_cyls.lx.push_back(location[0]);
+		m_cyls.ly.push_back(location[1]);
+		m_cyls.lz.push_back(location[2]);
+		m_cyls.radius.push_back(cyl_sf.radius);
+		m_cyls.key.push_back(key);
+
+		m_cylBuckets[key].push_back(index);
+		if (m_cylGrouping.bValid)
+			m_cylGrouping.pendingArr.push_back(index);
+		Slot slot = { CYL_SLOT, index };
+		m_faceMap[face] = slot;
+	}
+
+	return true;
+}
+
+void PsGeomIndex::removeFace(const PK_FACE_t face)
+{
+	auto it = m_faceMap.find(face);
+	if (m_faceMap.end() == it)
+		return;
+
+	const Slot& slot = it->second;
+	if (PLANE_SLOT == slot.kind)
+	{
+		stRemoveFromBucket(m_planeBuckets, m_planes.key[slot.index], slot.index);
+		leaveGroup(m_planeGrouping, true, slot.index);
+		m_planes.face[slot.index] = PK_ENTITY_null;
+	}
+	else
+	{
+		stRemoveFromBucket(m_cylBuckets, m_cyls.key[slot.index], slot.index);
+		leaveGroup(m_cylGrouping, false, slot.index);
+		m_cyls.face[slot.index] = PK_ENTITY_null;
+	}
+
+	m_faceMap.erase(it);
+	m_iDeadCnt++;
+}
+
+void PsGeomIndex::compact()
+{
+	PlaneArr planes;
+	CylArr cyls;
+
+	m_planeBuckets.clear();
+	m_cylBuckets.clear();
+
+	// The slots are numbered again, the groups are made again at the next query
+	m_planeGrouping = Grouping();
+	m_cylGrouping = Grouping();
+
+	for (size_t i = 0; i < m_planes.face.size(); i++)
+	{
+		if (PK_ENTITY_null == m_planes.face[i])
+			continue;
+
+		int index = (int)planes.face.size();
+		planes.face.push_back(m_planes.face[i]);
+		planes.surf.push_back(m_planes.surf[i]);
+		planes.nx.push_back(m_planes.nx[i]);
+		planes.ny.push_back(m_planes.ny[i]);
+		planes.nz.push_back(m_planes.nz[i]);
+		planes.lx.push_back(m_planes.lx[i]);
+		planes.ly.push_back(m_planes.ly[i]);
+		planes.lz.push_back(m_planes.lz[i]);
+		planes.key.push_back(m_planes.key[i]);
+
+		m_planeBuckets[m_planes.key[i]].push_back(index);
+		m_faceMap[m_planes.face[i]].index = index;
+	}
+
+	for (size_t i = 0; i < m_cyls.face.size(); i++)
+	{
+		if (PK_ENTITY_null == m_cyls.face[i])
+			continue;
+
+		int index = (int)cyls.face.size();
+		cyls.face.push_back(m_cyls.face[i]);
+		cyls.surf.push_back(m_cyls.surf[i]);
+		cyls.ax.push_back(m_cyls.ax[i]);
+		cyls.ay.push_back(m_cyls.ay[i]);
+		cyls.az.push_back(m_cyls.az[i]);
+		cyls.lx.push_back(m_cyls.lx[i]);
+		cyls.ly.push_back(m_cyls.ly[i]);
+		cyls.lz.push_back(m_cyls.lz[i]);
+		cyls.radius.push_back(m_cyls.radius[i]);
+		cyls.key.push_back(m_cyls.key[i]);
+
+		m_cylBuckets[m_cyls.key[i]].push_back(index);
+		m_faceMap[m_cyls.face[i]].index = index;
+	}
+
+	m_planes.face.swap(planes.face);
+	m_planes.surf.swap(planes.surf);
+	m_planes.nx.swap(planes.nx);
+	m_planes.ny.swap(planes.ny);
+	m_planes.nz.swap(planes.nz);
+	m_planes.lx.swap(planes.lx);
+	m_planes.ly.swap(planes.ly);
+	m_planes.lz.swap(planes.lz);
+	m_planes.key.swap(planes.key);
+
+	m_cyls.face.swap(cyls.face);
+	m_cyls.surf.swap(cyls.surf);
+	m_cyls.ax.swap(cyls.ax);
+	m_cyls.ay.swap(cyls.ay);
+	m_cyls.az.swap(cyls.az);
+	m_cyls.lx.swap(cyls.lx);
+	m_cyls.ly.swap(cyls.ly);
+	m_cyls.lz.swap(cyls.lz);
+	m_cyls.radius.swap(cyls.radius);
+	m_cyls.key.swap(cyls.key);
+
+	m_iDeadCnt = 0;
+}
+
+void PsGeomIndex::Update(const std::vector<PK_FACE_t>& changedFaces, const std::vector<PK_TOPOL_t>& deletedTopols)
+{
+	PERF_TRACE_SCOPE("ps", "PsGeomIndex::Update");
+
+	if (!m_bBuilt)
+		return;
+
+	for (size_t i = 0; i < deletedTopols.size(); i++)
+		removeFace(deletedTopols[i]);
+
+	for (size_t i = 0; i < changedFaces.size(); i++)
+	{
+		removeFace(changedFaces[i]);
+		addFace(changedFaces[i]);
+	}
+
+	// Keep the arrays dense enough for the scans of the buckets
+	if (1024 < m_iDeadCnt && (int)m_faceMap.size() < m_iDeadCnt)
+		compact();
+}
+
+bool PsGeomIndex::isAlive(const PK_FACE_t face, const PK_SURF_t surf) const
+{
+	PK_SURF_t cur_surf = PK_ENTITY_null;
+	if (PK_ERROR_no_errors != PsKernel::Current().AskFaceSurf(face, cur_surf))
+		return false;
+
+	return cur_surf == surf;
+}
+
+void PsGeomIndex::planeKeys(const int input, std::vector<uint64_t>& keyArr) const
+{
+	double normal[3] = { m_planes.nx[input], m_planes.ny[input], m_planes.nz[input] };
+	double location[3] = { m_planes.lx[input], m_planes.ly[input], m_planes.lz[input] };
+
+	// Keys of the candidate buckets, with the opposite orientation if the canonical one is ambiguous
+	keyArr.clear();
+	double canonical[3] = { normal[0], normal[1], normal[2] };
+	bool bAmbiguous = stCanonicalize(canonical);
+	for (int iOrient = 0; iOrient < (bAmbiguous ? 2 : 1); iOrient++)
+	{
+		double sign = iOrient ? -1.0 : 1.0;
+		double dir[3] = { sign * canonical[0], sign * canonical[1], sign * canonical[2] };
+		double val[4];
+		stPlaneValues(dir, location, val);
+		stCollectKeys(4, val, s_planeCell, s_planeMargin, keyArr);
+	}
+}
+
+void PsGeomIndex::planeCandidates(const int input, std::vector<const std::vector<int>*>& bucketArr) const
+{
+	std::vector<uint64_t> keyArr;
+	planeKeys(input, keyArr);
+
+	bucketArr.clear();
+	for (size_t i = 0; i < keyArr.size(); i++)
+	{
+		auto it = m_planeBuckets.find(keyArr[i]);
+		if (m_planeBuckets.end() != it && bucketArr.end() == std::find(bucketArr.begin(), bucketArr.end(), &it->second))
+			bucketArr.push_back(&it->second);
+	}
+}
+
+void PsGeomIndex::cylKeys(const int input, std::vector<uint64_t>& keyArr) const
+{
+	double axis[3] = { m_cyls.ax[input], m_cyls.ay[input], m_cyls.az[input] };
+	double location[3] = { m_cyls.lx[input], m_cyls.ly[input], m_cyls.lz[input] };
+
+	// The axis line doesn't depend on the orientation, only the direction part of the key does
+	keyArr.clear();
+	double canonical[3] = { axis[0], axis[1], axis[2] };
+	bool bAmbiguous = stCanonicalize(canonical);
+	for (int iOrient = 0; iOrient < (bAmbiguous ? 2 : 1); iOrient++)
+	{
+		double sign = iOrient ? -1.0 : 1.0;
+		double dir[3] = { sign * canonical[0], sign * canonical[1], sign * canonical[2] };
+		double val[6];
+		stCylValues(dir, location, val);
+		stCollectKeys(6, val, s_cylCell, s_cylMargin, keyArr);
+	}
+}
+
+void PsGeomIndex::cylCandidates(const int input, std::vector<const std::vector<int>*>& bucketArr) const
+{
+	std::vector<uint64_t> keyArr;
+	cylKeys(input, keyArr);
+
+	bucketArr.clear();
+	for (size_t i = 0; i < keyArr.size(); i++)
+	{
+		auto it = m_cylBuckets.find(keyArr[i]);
+		if (m_cylBuckets.end() != it && bucketArr.end() == std::find(bucketArr.begin(), bucketArr.end(), &it->second))
+			bucketArr.push_back(&it->second);
+	}
+}
+
+bool PsGeomIndex::isCoplanar(const int input, const int index, const double tol, const double angTol) const
+{
+	double normal[3] = { m_planes.nx[input], m_planes.ny[input], m_planes.nz[input] };
+	double other_normal[3] = { m_planes.nx[index], m_planes.ny[index], m_planes.nz[index] };
+	double dist_vec[3] = {
+		m_planes.lx[input] - m_planes.lx[index],
+		m_planes.ly[input] - m_planes.ly[index],
+		m_planes.lz[input] - m_planes.lz[index] };
+
+	// Same tests as the face scan: angle between normals, then distance along the input normal
+	return asin(stCrossMagnitude(normal, other_normal)) <= angTol && fabs(stDot(dist_vec, normal)) <= tol;
+}
+
+bool PsGeomIndex::isConcentric(const int input, const int index, const double tol, const double angTol) const
+{
+	double axis[3] = { m_cyls.ax[input], m_cyls.ay[input], m_cyls.az[input] };
+	double other_axis[3] = { m_cyls.ax[index], m_cyls.ay[index], m_cyls.az[index] };
+	double dist_vec[3] = {
+		m_cyls.lx[input] - m_cyls.lx[index],
+		m_cyls.ly[input] - m_cyls.ly[index],
+		m_cyls.lz[input] - m_cyls.lz[index] };
+
+	// Same tests as the face scan: angle between axes, then distance of the locations across the input axis
+	return asin(stCrossMagnitude(axis, other_axis)) <= angTol && stCrossMagnitude(dist_vec, axis) <= tol;
+}
+
+bool PsGeomIndex::FindCoplanar(const PK_FACE_t face, const double tol, const double angTol, std::vector<PK_ENTITY_t>& entityArr) const
+{
+	if (!m_bBuilt)
+		return false;
+
+	auto itFace = m_faceMap.find(face);
+	if (m_faceMap.end() == itFace)
+	{
+		// Not a plane / cylinder when the index is up to date
+		PK_SURF_t surf = PK_ENTITY_null;
+		PK_CLASS_t surf_class = PK_ENTITY_null;
+		PsKernel::Current().AskFaceSurf(face, surf);
+		PsKernel::Current().AskClass(surf, surf_class);
+		return PK_CLASS_plane != surf_class && PK_CLASS_cyl != surf_class;
+	}
+
+	if (PLANE_SLOT != itFace->second.kind)
+		return true;
+
+	// Update drops the dead faces, only the input tells if the index missed a change
+	int input = itFace->second.index;
+	if (!isAlive(face, m_planes.surf[input]))
+		return false;
+
+	std::vector<const std::vector<int>*> bucketArr;
+	planeCandidates(input, bucketArr);
+
+	std::vector<int> matchArr;
+	for (size_t i = 0; i < bucketArr.size(); i++)
+	{
+		size_t mid = matchArr.size();
+		for (int index : *bucketArr[i])
+		{
+			if (isCoplanar(input, index, tol, angTol))
+				matchArr.push_back(index);
+		}
+		std::inplace_merge(matchArr.begin(), matchArr.begin() + mid, matchArr.end());
+	}
+
+	for (size_t i = 0; i < matchArr.size(); i++)
+		entityArr.push_back(m_planes.face[matchArr[i]]);
+
+	return true;
+}
+
+bool PsGeomIndex::FindConcentric(const PK_FACE_t face, const double tol, const double angTol, std::vector<PK_ENTITY_t>& entityArr) const
+{
+	if (!m_bBuilt)
+		return false;
+
+	auto itFace = m_faceMap.find(face);
+	if (m_faceMap.end() == itFace)
+	{
+		// Not a plane / cylinder when the index is up to date
+		PK_SURF_t surf = PK_ENTITY_null;
+		PK_CLASS_t surf_class = PK_ENTITY_null;
+		PsKernel::Current().AskFaceSurf(face, surf);
+		PsKernel::Current().AskClass(surf, surf_class);
+		return PK_CLASS_plane != surf_class && PK_CLASS_cyl != surf_class;
+	}
+
+	if (CYL_SLOT != itFace->second.kind)
+		return true;
+
+	// Update drops the dead faces, only the input tells if the index missed a change
+	int input = itFace->second.index;
+	if (!isAlive(face, m_cyls.surf[input]))
+		return false;
+
+	std::vector<const std::vector<int>*> bucketArr;
+	cylCandidates(input, bucketArr);
+
+	std::vector<int> matchArr;
+	for (size_t i = 0; i < bucketArr.size(); i++)
+	{
+		size_t mid = matchArr.size();
+		for (int index : *bucketArr[i])
+		{
+			if (isConcentric(input, index, tol, angTol))
+				matchArr.push_back(index);
+		}
+		std::inplace_merge(matchArr.begin(), matchArr.begin() + mid, matchArr.end());
+	}
+
+	for (size_t i = 0; i < matchArr.size(); i++)
+		entityArr.push_back(m_cyls.face[matchArr[i]]);
+
+	return true;
+}
+
+void PsGeomIndex::joinGroup(Grouping& grouping, const bool bPlane, const int slot) const
+{
+	std::vector<uint64_t> keyArr;
+	if (bPlane)
+		planeKeys(slot, keyArr);
+	else
+		cylKeys(slot, keyArr);
+
+	// Only the first faces of the groups are compared, a large set costs one test
+	int first = -1;
+	for (size_t i = 0; i < keyArr.size(); i++)
+	{
+		auto it = grouping.firstBuckets.find(keyArr[i]);
+		if (grouping.firstBuckets.end() == it)
+			continue;
+
+		for (int other : it->second)
+		{
+			if (-1 != first && first <= other)
+				continue;
+
+			if (bPlane ? isCoplanar(other, slot, grouping.tol, grouping.angTol) : isConcentric(other, slot, grouping.tol, grouping.angTol))
+				first = other;
+		}
+	}
+
+	if (-1 == first)
+	{
+		first = slot;
+		grouping.firstBuckets[bPlane ? m_planes.key[slot] : m_cyls.key[slot]].push_back(slot);
+	}
+
+	grouping.firstArr[slot] = first;
+}
+
+void PsGeomIndex::leaveGroup(Grouping& grouping, const bool bPlane, const int slot)
+{
+	if (!grouping.bValid || (int)grouping.firstArr.size() <= slot || -1 == grouping.firstArr[slot])
+		return;
+
+	// The other faces of the group are grouped again at the next query
+	if (slot == grouping.firstArr[slot])
+	{
+		stRemoveFromBucket(grouping.firstBuckets, bPlane ? m_planes.key[slot] : m_cyls.key[slot], slot);
+		grouping.lostFirstArr.push_back(slot);
+	}
+
+	grouping.firstArr[slot] = -1;
+}
+
+void PsGeomIndex::regroup(Grouping& grouping, const bool bPlane, const double tol, const double angTol)
+{
+	const std::vector<PK_FACE_t>& faceArr = bPlane ? m_planes.face : m_cyls.face;
+
+	std::vector<int> slotArr;
+	if (!grouping.bValid || tol != grouping.tol || angTol != grouping.angTol)
+	{
+		grouping = Grouping();
+		grouping.bValid = true;
+		grouping.tol = tol;
+		grouping.angTol = angTol;
+
+		for (int i = 0; i < (int)faceArr.size(); i++)
+			slotArr.push_back(i);
+	}
+	else
+	{
+		slotArr.swap(grouping.pendingArr);
+
+		if (!grouping.lostFirstArr.empty())
+		{
+			std::vector<char> lostArr(faceArr.size(), 0);
+			for (int first : grouping.lostFirstArr)
+				lostArr[first] = 1;
+			grouping.lostFirstArr.clear();
+
+			for (int i = 0; i < (int)grouping.firstArr.size(); i++)
+			{
+				if (-1 != grouping.firstArr[i] && lostArr[grouping.firstArr[i]])
+				{
+					grouping.firstArr[i] = -1;
+					slotArr.push_back(i);
+				}
+			}
+		}
+
+		std::sort(slotArr.begin(), slotArr.end());
+		slotArr.erase(std::unique(slotArr.begin(), slotArr.end()), slotArr.end());
+	}
+
+	grouping.pendingArr.clear();
+	grouping.firstArr.resize(faceArr.size(), -1);
+
+	for (size_t i = 0; i < slotArr.size(); i++)
+	{
+		if (PK_ENTITY_null != faceArr[slotArr[i]] && -1 == grouping.firstArr[slotArr[i]])
+			joinGroup(grouping, bPlane, slotArr[i]);
+	}
+}
+
+void PsGeomIndex::collectGroups(const Grouping& grouping, const std::vector<PK_FACE_t>& faceArr, std::vector<std::vector<PK_FACE_t>>& groupArr) const
+{
+	groupArr.clear();
+
+	std::vector<int> groupOfFirst(faceArr.size(), -1);
+	for (int i = 0; i < (int)faceArr.size(); i++)
+	{
+		if (PK_ENTITY_null == faceArr[i])
+			continue;
+
+		int first = grouping.firstArr[i];
+		if (-1 == groupOfFirst[first])
+		{
+			groupOfFirst[first] = (int)groupArr.size();
+			groupArr.push_back(std::vector<PK_FACE_t>());
+		}
+		groupArr[groupOfFirst[first]].push_back(faceArr[i]);
+	}
+}
+
+void PsGeomIndex::GroupCoplanar(const double tol, const double angTol, std::vector<std::vector<PK_FACE_t>>& groupArr)
+{
+	PERF_TRACE_SCOPE("ps", "PsGeomIndex::GroupCoplanar");
+
+	groupArr.clear();
+	if (!m_bBuilt)
+		return;
+
+	regroup(m_planeGrouping, true, tol, angTol);
+	collectGroups(m_planeGrouping, m_planes.face, groupArr);
+}
+
+void PsGeomIndex::GroupConcentric(const double tol, const double angTol, std::vector<std::vector<PK_FACE_t>>& groupArr)
+{
+	PERF_TRACE_SCOPE("ps", "PsGeomIndex::GroupConcentric");
+
+	groupArr.clear();
+	if (!m_bBuilt)
+		return;
+
+	regroup(m_cylGrouping, false, tol, angTol);
+	collectGroups(m_cylGrouping, m_cyls.face, groupArr);
+}
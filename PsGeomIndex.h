@@ -0,0 +1,109 @@
+#pragma once
+#include "PsKernel.h"
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+// Plane and cylinder parameters of the faces of a body, read once from the kernel
+// and bucketed by quantized normal / offset and axis / axis position.
+// Coplanar and concentric queries only check the faces of the neighbouring buckets.
+// The geometry is asked to PsKernel::Current().
+class PsGeomIndex
+{
+public:
+	PsGeomIndex();
+	~PsGeomIndex();
+
+private:
+	enum SlotKind
+	{
+		PLANE_SLOT,
+		CYL_SLOT
+	};
+
+	struct Slot
+	{
+		SlotKind kind;
+		int index;
+	};
+
+	// Structure of arrays, a removed entry keeps its place with a null face until the next compaction
+	struct PlaneArr
+	{
+		std::vector<PK_FACE_t> face;
+		std::vector<PK_SURF_t> surf;
+		std::vector<double> nx, ny, nz;		// Unit normal
+		std::vector<double> lx, ly, lz;		// Basis set location
+		std::vector<uint64_t> key;
+	};
+
+	struct CylArr
+	{
+		std::vector<PK_FACE_t> face;
+		std::vector<PK_SURF_t> surf;
+		std::vector<double> ax, ay, az;		// Unit axis
+		std::vector<double> lx, ly, lz;		// Basis set location
+		std::vector<double> radius;
+		std::vector<uint64_t> key;
+	};
+
+	// Groups of one kind for the tolerances of the last grouping: a face joins the group of the first face
+	// it matches in the neighbouring buckets, else it starts a group. Update only marks the changed slots,
+	// they are grouped at the next query
+	struct Grouping
+	{
+		bool bValid = false;
+		double tol = 0.0;
+		double angTol = 0.0;
+		std::vector<int> firstArr;		// First slot of the group of each slot, -1 if not grouped
+		std::unordered_map<uint64_t, std::vector<int>> firstBuckets;	// First slots by bucket key
+		std::vector<int> pendingArr;	// Slots added since the last grouping
+		std::vector<int> lostFirstArr;	// Removed first slots, the rest of their group is grouped again
+	};
+
+	PK_BODY_t m_body;
+	bool m_bBuilt;
+	int m_iDeadCnt;
+	PlaneArr m_planes;
+	CylArr m_cyls;
+	std::unordered_map<PK_FACE_t, Slot> m_faceMap;
+	std::unordered_map<uint64_t, std::vector<int>> m_planeBuckets;
+	std::unordered_map<uint64_t, std::vector<int>> m_cylBuckets;
+	Grouping m_planeGrouping;
+	Grouping m_cylGrouping;
+
+	bool addFace(const PK_FACE_t face);
+	void removeFace(const PK_FACE_t face);
+	void compact();
+	bool isAlive(const PK_FACE_t face, const PK_SURF_t surf) const;
+	void planeKeys(const int input, std::vector<uint64_t>& keyArr) const;
+	void cylKeys(const int input, std::vector<uint64_t>& keyArr) const;
+	// Buckets of the input and of its neighbours, each one in ascending slot order
+	void planeCandidates(const int input, std::vector<const std::vector<int>*>& bucketArr) const;
+	void cylCandidates(const int input, std::vector<const std::vector<int>*>& bucketArr) const;
+	bool isCoplanar(const int input, const int index, const double tol, const double angTol) const;
+	bool isConcentric(const int input, const int index, const double tol, const double angTol) const;
+	void joinGroup(Grouping& grouping, const bool bPlane, const int slot) const;
+	void leaveGroup(Grouping& grouping, const bool bPlane, const int slot);
+	void regroup(Grouping& grouping, const bool bPlane, const double tol, const double angTol);
+	void collectGroups(const Grouping& grouping, const std::vector<PK_FACE_t>& faceArr, std::vector<std::vector<PK_FACE_t>>& groupArr) const;
+
+public:
+	bool Build(const PK_BODY_t body);
+	void Clear();
+	bool IsBuilt() const { return m_bBuilt; }
+	PK_BODY_t GetBody() const { return m_body; }
+
+	// Re-read the geometry of modified / created faces and forget the deleted topologies
+	void Update(const std::vector<PK_FACE_t>& changedFaces, const std::vector<PK_TOPOL_t>& deletedTopols);
+
+	// Return false if the index turned out to be stale, it has to be built again then.
+	// The faces are in body order, only the input face is checked with the kernel
+	bool FindCoplanar(const PK_FACE_t face, const double tol, const double angTol, std::vector<PK_ENTITY_t>& entityArr) const;
+	bool FindConcentric(const PK_FACE_t face, const double tol, const double angTol, std::vector<PK_ENTITY_t>& entityArr) const;
+
+	// Partition of all the planes / cylinders, a face alone is a group of one. Only the faces changed since
+	// the last call with the same tolerances are grouped again. The index has to be up to date, no check with the kernel is made
+	void GroupCoplanar(const double tol, const double angTol, std::vector<std::vector<PK_FACE_t>>& groupArr);
+	void GroupConcentric(const double tol, const double angTol, std::vector<std::vector<PK_FACE_t>>& groupArr);
+};
@@ -0,0 +1,129 @@
+#include "stdafx.h"
+#include "PsJournal.h"
+
+PsJournal::PsJournal() :
+	m_uiCursor(0),
+	m_iNextId(0),
+	m_uiMaxStepCnt(32)
+{
+}
+
+PsJournal::~PsJournal()
+{
+}
+
+void PsJournal::deleteMark(PK_MARK_t& mark)
+{
+	if (PK_ENTITY_null != mark)
+		PK_MARK_delete(mark);
+
+	mark = PK_ENTITY_null;
+}
+
+void PsJournal::deleteMarks(PsJournalStep& step)
+{
+	deleteMark(step.mark);
+	deleteMark(step.afterMark);
+}
+
+bool PsJournal::gotoMark(const PK_MARK_t mark)
+{
+	PK_MARK_goto_o_t goto_ots;
+	PK_MARK_goto_r_t goto_result;
+	PK_MARK_goto_o_m(goto_ots);
+	PK_ERROR_code_t error_code = PK_MARK_goto_2(mark, &goto_ots, &goto_result);
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+
+	PK_MARK_goto_r_f(&goto_result);
+
+	return true;
+}
+
+void PsJournal::pruneFront()
+{
+	while (m_uiMaxStepCnt < m_stepArr.size() && 0 < m_uiCursor)
+	{
+		deleteMarks(m_stepArr.front());
+		m_stepArr.pop_front();
+		m_uiCursor--;
+	}
+}
+
+void PsJournal::SetMaxStepCount(const size_t maxStepCnt)
+{
+	m_uiMaxStepCnt = maxStepCnt;
+	DiscardRedo();
+	pruneFront();
+}
+
+void PsJournal::DiscardRedo()
+{
+	while (m_uiCursor < m_stepArr.size())
+	{
+		deleteMarks(m_stepArr.back());
+		m_stepArr.pop_back();
+	}
+}
+
+int PsJournal::Record(const PsJournalStep& step)
+{
+	DiscardRedo();
+
+	PsJournalStep newStep = step;
+	if (0 == m_uiMaxStepCnt)
+	{
+		deleteMarks(newStep);
+		return -1;
+	}
+
+	// Without it the step can be undone but not redone
+	if (PK_ENTITY_null == newStep.afterMark && PK_ERROR_no_errors != PK_MARK_create(&newStep.afterMark))
+		newStep.afterMark = PK_ENTITY_null;
+
+	newStep.id = m_iNextId++;
+	m_stepArr.push_back(newStep);
+	m_uiCursor = m_stepArr.size();
+
+	pruneFront();
+
+	return newStep.id;
+}
+
+void PsJournal::Clear()
+{
+	for (size_t i = 0; i < m_stepArr.size(); i++)
+		deleteMarks(m_stepArr[i]);
+
+	m_stepArr.clear();
+	m_uiCursor = 0;
+}
+
+bool PsJournal::Undo(PsJournalStep& step)
+{
+	if (!CanUndo())
+		return false;
+
+	if (!gotoMark(m_stepArr[m_uiCursor - 1].mark))
+		return false;
+
+	m_uiCursor--;
+	step = m_stepArr[m_uiCursor];
+
+	return true;
+}
+
+bool PsJournal::Redo(PsJournalStep& step)
+{
+	if (!CanRedo())
+		return false;
+
+	PK_MARK_t mark = m_stepArr[m_uiCursor].afterMark;
+	if (PK_ENTITY_null == mark || !gotoMark(mark))
+		return false;
+
+	step = m_stepArr[m_uiCursor];
+	m_uiCursor++;
+
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "parasolid_kernel.h"
+#include <deque>
+#include <vector>
+
+// Bodies touched by one journaled operation
+struct PsJournalStep
+{
+	int id;
+	PK_MARK_t mark;		// Taken before the operation
+	PK_MARK_t afterMark;	// Taken when the step is recorded, the state a redo goes to
+	std::vector<PK_BODY_t> modifiedBodies;
+	std::vector<PK_BODY_t> createdBodies;	// Gone after undo
+	std::vector<PK_BODY_t> deletedBodies;	// Back after undo
+
+	PsJournalStep() : id(-1), mark(PK_ENTITY_null), afterMark(PK_ENTITY_null) {}
+};
+
+// Bounded undo / redo history over the kernel roll marks.
+// Steps before the cursor are done, the ones from the cursor are undone and can be redone
+// until a new operation is recorded. The oldest marks are deleted beyond the maximum step count.
+class PsJournal
+{
+public:
+	PsJournal();
+	~PsJournal();
+
+private:
+	std::deque<PsJournalStep> m_stepArr;
+	size_t m_uiCursor;
+	int m_iNextId;
+	size_t m_uiMaxStepCnt;
+
+	void deleteMark(PK_MARK_t& mark);
+	void deleteMarks(PsJournalStep& step);
+	bool gotoMark(const PK_MARK_t mark);
+	void pruneFront();
+
+public:
+	void SetMaxStepCount(const size_t maxStepCnt);
+	size_t GetMaxStepCount() const { return m_uiMaxStepCnt; }
+
+	// Before any modelling change: the undone steps can't be rolled forward anymore
+	void DiscardRedo();
+	// Return the id given to the step, -1 if it wasn't kept
+	int Record(const PsJournalStep& step);
+	void Clear();
+
+	bool CanUndo() const { return 0 < m_uiCursor; }
+	bool CanRedo() const { return m_uiCursor < m_stepArr.size(); }
+	bool Undo(PsJournalStep& step);
+	bool Redo(PsJournalStep& step);
+
+	// Id of the latest done step, -1 if none
+	int GetCurrentId() const { return m_uiCursor ? m_stepArr[m_uiCursor - 1].id : -1; }
+	int GetOldestId() const { return m_stepArr.size() ? m_stepArr.front().id : m_iNextId; }
+};
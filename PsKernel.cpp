@@ -0,0 +1,25 @@
+#include "stdafx.h"
+#include "PsKernel.h"
+#include <atomic>
+
+static std::atomic<PsKernel*> s_pCurrentKernel(NULL);
+
+static PsKernel* stDefaultKernel()
+{
+	static PsKernel* s_pDefaultKernel = PsKernelCreateDefault();
+	return s_pDefaultKernel;
+}
+
+PsKernel& PsKernel::Current()
+{
+	PsKernel* pKernel = s_pCurrentKernel;
+	if (NULL == pKernel)
+		pKernel = stDefaultKernel();
+
+	return *pKernel;
+}
+
+void PsKernel::SetCurrent(PsKernel* pKernel)
+{
+	s_pCurrentKernel = pKernel;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef PS_KERNEL_STANDIN
+#include "parasolid_kernel.h"
+#else
+#include "batch/PsKernelTypes.h"
+#endif
+#include <stddef.h>
+#include <vector>
+
+// Enquiries of the modeling kernel the FR and assembly algorithms are written against.
+// The Parasolid session is the binding of the application, the headless tools may set the in-memory stand-in instead.
+// Tags and structures are the PK ones, the returned arrays are copied so the binding keeps no ownership with the caller.
+class PsKernel
+{
+public:
+	virtual ~PsKernel() {}
+
+	virtual const char* GetName() const = 0;
+
+	virtual PK_ERROR_code_t AskClass(const PK_ENTITY_t entity, PK_CLASS_t& entityClass) const = 0;
+
+	// Topology
+	virtual PK_ERROR_code_t AskBodyFaces(const PK_BODY_t body, std::vector<PK_FACE_t>& faceArr) const = 0;
+	virtual PK_ERROR_code_t AskBodyEdges(const PK_BODY_t body, std::vector<PK_EDGE_t>& edgeArr) const = 0;
+	virtual PK_ERROR_code_t AskFaceBody(const PK_FACE_t face, PK_BODY_t& body) const = 0;
+	virtual PK_ERROR_code_t AskFaceEdges(const PK_FACE_t face, std::vector<PK_EDGE_t>& edgeArr) const = 0;
+	virtual PK_ERROR_code_t AskEdgeConvexity(const PK_EDGE_t edge, PK_emboss_convexity_t& convexity) const = 0;
+
+	// Facesets of the body bounded by the edges, only the faceset of selectingFace unless it is null
+	virtual PK_ERROR_code_t FindFacesets(const PK_BODY_t body, const std::vector<PK_EDGE_t>& boundEdgeArr, const PK_FACE_t selectingFace,
+		std::vector<std::vector<PK_FACE_t>>& facesetArr) const = 0;
+
+	// Geometry
+	virtual PK_ERROR_code_t AskFaceSurf(const PK_FACE_t face, PK_SURF_t& surf) const = 0;
+	virtual PK_ERROR_code_t AskPlane(const PK_PLANE_t plane, PK_PLANE_sf_t& plane_sf) const = 0;
+	virtual PK_ERROR_code_t AskCyl(const PK_CYL_t cyl, PK_CYL_sf_t& cyl_sf) const = 0;
+
+	// Assemblies of the current partition, and the parts instanced by an assembly
+	virtual PK_ERROR_code_t AskAssemblies(std::vector<PK_ASSEMBLY_t>& assyArr) const = 0;
+	virtual PK_ERROR_code_t AskInstanceParts(const PK_ASSEMBLY_t assy, std::vector<PK_PART_t>& partArr) const = 0;
+
+	// The binding linked with the program unless another one was set, SetCurrent(NULL) restores it
+	static PsKernel& Current();
+	static void SetCurrent(PsKernel* pKernel);
+};
+
+// Supplied by the binding linked with the program (PsKernelParasolid.cpp or the stand-in)
+PsKernel* PsKernelCreateDefault();
@@ -0,0 +1,152 @@
+#include "stdafx.h"
+#include "PsKernelExecutor.h"
+#include "PsProcess.h"
+#include "PerfTrace.h"
+
+PsKernelExecutor::PsKernelExecutor() :
+	m_bStop(false)
+{
+}
+
+PsKernelExecutor::~PsKernelExecutor()
+{
+	Stop();
+}
+
+void PsKernelExecutor::Start()
+{
+	if (m_thread.joinable())
+		return;
+
+	m_bStop = false;
+	m_thread = std::thread(&PsKernelExecutor::workerLoop, this);
+}
+
+void PsKernelExecutor::Stop()
+{
+	Cancel();
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bStop = true;
+	}
+	m_queueCond.notify_all();
+
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+std::future<bool> PsKernelExecutor::Submit(const Command fnCommand, PsProcess* pGroupProcess)
+{
+	std::unique_ptr<Entry> pEntry(new Entry);
+	pEntry->fnCommand = fnCommand;
+	pEntry->pGroupProcess = pGroupProcess;
+	pEntry->pTask = std::make_shared<PsKernelTask>();
+
+	std::future<bool> future = pEntry->result.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (m_bStop || !m_thread.joinable())
+		{
+			pEntry->result.set_value(false);
+			return future;
+		}
+
+		m_queue.push_back(std::move(pEntry));
+	}
+	m_queueCond.notify_one();
+
+	return future;
+}
+
+void PsKernelExecutor::Cancel()
+{
+	std::deque<std::unique_ptr<Entry>> cancelledQueue;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		cancelledQueue.swap(m_queue);
+
+		if (m_pRunningTask)
+			m_pRunningTask->m_bCancelled = true;
+	}
+
+	for (size_t i = 0; i < cancelledQueue.size(); i++)
+		cancelledQueue[i]->result.set_value(false);
+}
+
+bool PsKernelExecutor::IsBusy() const
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	return m_pRunningTask || m_queue.size();
+}
+
+PsKernelStatus PsKernelExecutor::GetStatus() const
+{
+	PsKernelStatus status;
+
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	status.queuedCnt = (int)m_queue.size();
+	if (m_pRunningTask)
+	{
+		status.bBusy = true;
+		status.progress = m_pRunningTask->GetProgress();
+		status.runningMsec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_runStart).count();
+	}
+	else
+	{
+		status.bBusy = 0 < status.queuedCnt;
+	}
+
+	return status;
+}
+
+void PsKernelExecutor::workerLoop()
+{
+	PerfTrace::SetThreadName("PsKernelExecutor");
+
+	while (true)
+	{
+		std::unique_ptr<Entry> pEntry;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCond.wait(lock, [this] { return m_bStop || m_queue.size(); });
+
+			if (m_queue.empty())
+				return;
+
+			pEntry = std::move(m_queue.front());
+			m_queue.pop_front();
+
+			m_pRunningTask = pEntry->pTask;
+			m_runStart = std::chrono::steady_clock::now();
+		}
+
+		PsKernelTask& task = *pEntry->pTask;
+
+		bool bGroup = NULL != pEntry->pGroupProcess && pEntry->pGroupProcess->BeginGroup();
+
+		bool bRet;
+		{
+			PERF_TRACE_SCOPE("ps", "PsKernelExecutor::Command");
+			bRet = pEntry->fnCommand(task);
+		}
+
+		// A cancel during the last kernel call is honoured too
+		if (task.IsCancelled())
+			bRet = false;
+
+		if (bGroup)
+		{
+			PsJournalStep step;
+			pEntry->pGroupProcess->EndGroup(bRet, step);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_pRunningTask.reset();
+		}
+
+		pEntry->result.set_value(bRet);
+	}
+}
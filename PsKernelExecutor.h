@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class PsProcess;
+
+// Cancellation and progress seen by the running command
+class PsKernelTask
+{
+public:
+	PsKernelTask() : m_bCancelled(false), m_progress(0.0) {}
+
+private:
+	std::atomic<bool> m_bCancelled;
+	std::atomic<double> m_progress;
+
+	friend class PsKernelExecutor;
+
+public:
+	// Checked by the command between its kernel calls
+	bool IsCancelled() const { return m_bCancelled; }
+	// 0.0 to 1.0
+	void SetProgress(const double progress) { m_progress = progress; }
+	double GetProgress() const { return m_progress; }
+};
+
+struct PsKernelStatus
+{
+	bool bBusy = false;
+	int queuedCnt = 0;
+	double progress = 0.0;		// Of the running command
+	double runningMsec = 0.0;
+};
+
+// Runs the kernel operations one after the other on a worker thread so that the UI thread stays free.
+// The results come back as futures, the UI polls them and refreshes the display on its own thread.
+// A command given a process runs in a group of it: when it fails or is cancelled, the kernel goes back
+// to the mark taken before it and the journal doesn't keep it.
+class PsKernelExecutor
+{
+public:
+	typedef std::function<bool(PsKernelTask& task)> Command;
+
+	PsKernelExecutor();
+	~PsKernelExecutor();
+
+private:
+	struct Entry
+	{
+		Command fnCommand;
+		PsProcess* pGroupProcess;
+		std::shared_ptr<PsKernelTask> pTask;
+		std::promise<bool> result;
+	};
+
+	std::thread m_thread;
+	mutable std::mutex m_queueMutex;
+	std::condition_variable m_queueCond;
+	std::deque<std::unique_ptr<Entry>> m_queue;
+	std::shared_ptr<PsKernelTask> m_pRunningTask;
+	std::chrono::steady_clock::time_point m_runStart;
+	bool m_bStop;
+
+	void workerLoop();
+
+public:
+	void Start();
+	// Queued commands are cancelled, the running one is waited
+	void Stop();
+	std::future<bool> Submit(const Command fnCommand, PsProcess* pGroupProcess = NULL);
+	// The running command stops at its next check, the queued ones don't run
+	void Cancel();
+	bool IsBusy() const;
+	PsKernelStatus GetStatus() const;
+};
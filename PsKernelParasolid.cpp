@@ -0,0 +1,160 @@
+#include "stdafx.h"
+#include "PsKernelParasolid.h"
+
+// Copy a PK array and free it
+template <typename T>
+static void stTakeArray(const int n, T* arr, std::vector<T>& out)
+{
+	out.assign(arr, arr + n);
+	if (n)
+		PK_MEMORY_free(arr);
+}
+
+PsKernel* PsKernelCreateDefault()
+{
+	return new PsKernelParasolid();
+}
+
+PsKernelParasolid::PsKernelParasolid()
+{
+}
+
+PsKernelParasolid::~PsKernelParasolid()
+{
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskClass(const PK_ENTITY_t entity, PK_CLASS_t& entityClass) const
+{
+	return PK_ENTITY_ask_class(entity, &entityClass);
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskBodyFaces(const PK_BODY_t body, std::vector<PK_FACE_t>& faceArr) const
+{
+	int n_faces = 0;
+	PK_FACE_t* faces = NULL;
+	PK_ERROR_code_t error_code = PK_BODY_ask_faces(body, &n_faces, &faces);
+	if (PK_ERROR_no_errors == error_code)
+		stTakeArray(n_faces, faces, faceArr);
+
+	return error_code;
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskBodyEdges(const PK_BODY_t body, std::vector<PK_EDGE_t>& edgeArr) const
+{
+	int n_edges = 0;
+	PK_EDGE_t* edges = NULL;
+	PK_ERROR_code_t error_code = PK_BODY_ask_edges(body, &n_edges, &edges);
+	if (PK_ERROR_no_errors == error_code)
+		stTakeArray(n_edges, edges, edgeArr);
+
+	return error_code;
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskFaceBody(const PK_FACE_t face, PK_BODY_t& body) const
+{
+	return PK_FACE_ask_body(face, &body);
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskFaceEdges(const PK_FACE_t face, std::vector<PK_EDGE_t>& edgeArr) const
+{
+	int n_edges = 0;
+	PK_EDGE_t* edges = NULL;
+	PK_ERROR_code_t error_code = PK_FACE_ask_edges(face, &n_edges, &edges);
+	if (PK_ERROR_no_errors == error_code)
+		stTakeArray(n_edges, edges, edgeArr);
+
+	return error_code;
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskEdgeConvexity(const PK_EDGE_t edge, PK_emboss_convexity_t& convexity) const
+{
+	PK_EDGE_ask_convexity_o_t convexity_opts;
+	PK_EDGE_ask_convexity_o_m(convexity_opts);
+
+	return PK_EDGE_ask_convexity(edge, &convexity_opts, &convexity);
+}
+
+PK_ERROR_code_t PsKernelParasolid::FindFacesets(const PK_BODY_t body, const std::vector<PK_EDGE_t>& boundEdgeArr, const PK_FACE_t selectingFace,
+	std::vector<std::vector<PK_FACE_t>>& facesetArr) const
+{
+	PK_BODY_find_facesets_o_t facesets_opts;
+	PK_BODY_find_facesets_o_m(facesets_opts);
+
+	PK_TOPOL_t selecting_topols[1] = { selectingFace };
+	if (PK_ENTITY_null != selectingFace)
+	{
+		facesets_opts.selector = PK_boolean_include_c;
+		facesets_opts.n_selecting_topol = 1;
+		facesets_opts.selecting_topol = selecting_topols;
+	}
+
+	PK_BODY_find_facesets_r_t results;
+	PK_ERROR_code_t error_code = PK_BODY_find_facesets(body, (int)boundEdgeArr.size(), boundEdgeArr.data(), &facesets_opts, &results);
+	if (PK_ERROR_no_errors != error_code)
+		return error_code;
+
+	int n_facesets = (PK_ENTITY_null != selectingFace) ? results.n_selected_facesets : results.n_facesets;
+	const PK_FACE_array_t* facesets = (PK_ENTITY_null != selectingFace) ? results.selected_facesets : results.facesets;
+
+	facesetArr.resize(n_facesets);
+	for (int i = 0; i < n_facesets; i++)
+		facesetArr[i].assign(facesets[i].array, facesets[i].array + facesets[i].length);
+
+	PK_BODY_find_facesets_r_f(&results);
+
+	return error_code;
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskFaceSurf(const PK_FACE_t face, PK_SURF_t& surf) const
+{
+	return PK_FACE_ask_surf(face, &surf);
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskPlane(const PK_PLANE_t plane, PK_PLANE_sf_t& plane_sf) const
+{
+	return PK_PLANE_ask(plane, &plane_sf);
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskCyl(const PK_CYL_t cyl, PK_CYL_sf_t& cyl_sf) const
+{
+	return PK_CYL_ask(cyl, &cyl_sf);
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskAssemblies(std::vector<PK_ASSEMBLY_t>& assyArr) const
+{
+	PK_PARTITION_t partition;
+	PK_ERROR_code_t error_code = PK_SESSION_ask_curr_partition(&partition);
+	if (PK_ERROR_no_errors != error_code)
+		return error_code;
+
+	int n_assy = 0;
+	PK_ASSEMBLY_t* assems = NULL;
+	error_code = PK_PARTITION_ask_assemblies(partition, &n_assy, &assems);
+	if (PK_ERROR_no_errors == error_code)
+		stTakeArray(n_assy, assems, assyArr);
+
+	return error_code;
+}
+
+PK_ERROR_code_t PsKernelParasolid::AskInstanceParts(const PK_ASSEMBLY_t assy, std::vector<PK_PART_t>& partArr) const
+{
+	int n_inst = 0;
+	PK_INSTANCE_t* instances = NULL;
+	PK_ERROR_code_t error_code = PK_ASSEMBLY_ask_instances(assy, &n_inst, &instances);
+	if (PK_ERROR_no_errors != error_code)
+		return error_code;
+
+	partArr.clear();
+	partArr.reserve(n_inst);
+	for (int i = 0; i < n_inst; i++)
+	{
+		PK_INSTANCE_sf_s instance_sf;
+		if (PK_ERROR_no_errors == PK_INSTANCE_ask(instances[i], &instance_sf))
+			partArr.push_back(instance_sf.part);
+	}
+
+	if (n_inst)
+		PK_MEMORY_free(instances);
+
+	return error_code;
+}
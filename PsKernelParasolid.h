@@ -0,0 +1,29 @@
+#pragma once
+#include "PsKernel.h"
+
+// PsKernel on the Parasolid session
+class PsKernelParasolid : public PsKernel
+{
+public:
+	PsKernelParasolid();
+	~PsKernelParasolid();
+
+	const char* GetName() const override { return "parasolid"; }
+
+	PK_ERROR_code_t AskClass(const PK_ENTITY_t entity, PK_CLASS_t& entityClass) const override;
+
+	PK_ERROR_code_t AskBodyFaces(const PK_BODY_t body, std::vector<PK_FACE_t>& faceArr) const override;
+	PK_ERROR_code_t AskBodyEdges(const PK_BODY_t body, std::vector<PK_EDGE_t>& edgeArr) const override;
+	PK_ERROR_code_t AskFaceBody(const PK_FACE_t face, PK_BODY_t& body) const override;
+	PK_ERROR_code_t AskFaceEdges(const PK_FACE_t face, std::vector<PK_EDGE_t>& edgeArr) const override;
+	PK_ERROR_code_t AskEdgeConvexity(const PK_EDGE_t edge, PK_emboss_convexity_t& convexity) const override;
+	PK_ERROR_code_t FindFacesets(const PK_BODY_t body, const std::vector<PK_EDGE_t>& boundEdgeArr, const PK_FACE_t selectingFace,
+		std::vector<std::vector<PK_FACE_t>>& facesetArr) const override;
+
+	PK_ERROR_code_t AskFaceSurf(const PK_FACE_t face, PK_SURF_t& surf) const override;
+	PK_ERROR_code_t AskPlane(const PK_PLANE_t plane, PK_PLANE_sf_t& plane_sf) const override;
+	PK_ERROR_code_t AskCyl(const PK_CYL_t cyl, PK_CYL_sf_t& cyl_sf) const override;
+
+	PK_ERROR_code_t AskAssemblies(std::vector<PK_ASSEMBLY_t>& assyArr) const override;
+	PK_ERROR_code_t AskInstanceParts(const PK_ASSEMBLY_t assy, std::vector<PK_PART_t>& partArr) const override;
+};
@@ -0,0 +1,278 @@
+#include "stdafx.h"
+#include "PsMemoryPool.h"
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PS_MEMORY_MAGIC 0x50534D4Du
+#define PS_MEMORY_CLASS_CNT 9			// 16 to 4096 bytes
+#define PS_MEMORY_LARGE_CLASS 0xFFFFFFFFu
+#define PS_MEMORY_CHUNK_BYTES (64 * 1024)
+
+// Put in front of every block
+struct PsMemoryHeader
+{
+	PsMemoryHeader* prev;			// Live blocks of the scope, or the free list of the class
+	PsMemoryHeader* next;
+	PsMemoryScope* pScope;
+	uint32_t sizeClass;
+	uint32_t magic;
+	size_t bytes;
+	size_t pad;						// Keeps the user block 16 bytes aligned
+};
+
+static std::mutex s_mutex;
+static PsMemoryHeader* s_freeList[PS_MEMORY_CLASS_CNT] = {};
+static PsMemoryStats s_stats;
+static PsMemoryScopeStats s_lastScopeStats;
+static bool s_bDump = false;
+
+// Outermost scope of this thread
+static thread_local PsMemoryScope* s_pScope = NULL;
+
+static uint32_t stSizeClass(const size_t n_bytes)
+{
+	uint32_t sizeClass = 0;
+	for (size_t classBytes = 16; classBytes < n_bytes; classBytes <<= 1)
+		sizeClass++;
+
+	return (PS_MEMORY_CLASS_CNT > sizeClass) ? sizeClass : PS_MEMORY_LARGE_CLASS;
+}
+
+bool PsMemoryPool::Register()
+{
+	PK_MEMORY_callbacks_t callbacks;
+	callbacks.alloc_fn = stAlloc;
+	callbacks.free_fn = stFree;
+
+	return PK_ERROR_no_errors == PK_MEMORY_register_callbacks(callbacks);
+}
+
+PsMemoryStats PsMemoryPool::GetStats()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_stats;
+}
+
+PsMemoryScopeStats PsMemoryPool::GetLastScopeStats()
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	return s_lastScopeStats;
+}
+
+void PsMemoryPool::SetDump(const bool bDump)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_bDump = bDump;
+}
+
+void PsMemoryPool::stAlloc(size_t n_bytes, void** pointer, PK_ERROR_code_t* error)
+{
+	*pointer = NULL;
+	*error = PK_ERROR_no_errors;
+
+	uint32_t sizeClass = stSizeClass(n_bytes);
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	PsMemoryHeader* pHeader = NULL;
+	if (PS_MEMORY_LARGE_CLASS == sizeClass)
+	{
+		pHeader = (PsMemoryHeader*)malloc(sizeof(PsMemoryHeader) + n_bytes);
+	}
+	else
+	{
+		if (NULL == s_freeList[sizeClass])
+		{
+			// Carve a new chunk into blocks of the class
+			size_t blockBytes = sizeof(PsMemoryHeader) + ((size_t)16 << sizeClass);
+			size_t blockCnt = PS_MEMORY_CHUNK_BYTES / blockBytes;
+			char* pChunk = (char*)malloc(blockCnt * blockBytes);
+			if (NULL != pChunk)
+			{
+				for (size_t i = 0; i < blockCnt; i++)
+				{
+					PsMemoryHeader* pBlock = (PsMemoryHeader*)(pChunk + i * blockBytes);
+					pBlock->next = s_freeList[sizeClass];
+					s_freeList[sizeClass] = pBlock;
+				}
+				s_stats.reservedBytes += blockCnt * blockBytes;
+			}
+		}
+
+		pHeader = s_freeList[sizeClass];
+		if (NULL != pHeader)
+			s_freeList[sizeClass] = pHeader->next;
+	}
+
+	if (NULL == pHeader)
+	{
+		*error = PK_ERROR_memory_full;
+		return;
+	}
+
+	pHeader->prev = NULL;
+	pHeader->next = NULL;
+	pHeader->pScope = s_pScope;
+	pHeader->sizeClass = sizeClass;
+	pHeader->magic = PS_MEMORY_MAGIC;
+	pHeader->bytes = n_bytes;
+
+	s_stats.allocCnt++;
+	s_stats.liveCnt++;
+	s_stats.liveBytes += n_bytes;
+	if (s_stats.peakBytes < s_stats.liveBytes)
+		s_stats.peakBytes = s_stats.liveBytes;
+
+	PsMemoryScope* pScope = pHeader->pScope;
+	if (NULL != pScope)
+	{
+		pHeader->next = pScope->m_pFirst;
+		if (NULL != pScope->m_pFirst)
+			pScope->m_pFirst->prev = pHeader;
+		pScope->m_pFirst = pHeader;
+
+		pScope->m_stats.allocCnt++;
+		pScope->m_stats.allocBytes += n_bytes;
+		pScope->m_liveBytes += n_bytes;
+		if (pScope->m_stats.peakBytes < pScope->m_liveBytes)
+			pScope->m_stats.peakBytes = pScope->m_liveBytes;
+	}
+
+	*pointer = pHeader + 1;
+}
+
+void PsMemoryPool::stFree(void* pointer)
+{
+	if (NULL == pointer)
+		return;
+
+	PsMemoryHeader* pHeader = (PsMemoryHeader*)pointer - 1;
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	if (PS_MEMORY_MAGIC != pHeader->magic)
+	{
+		s_stats.foreignFreeCnt++;
+		return;
+	}
+
+	unlinkBlock(pHeader);
+	releaseBlock(pHeader);
+}
+
+void PsMemoryPool::unlinkBlock(PsMemoryHeader* pHeader)
+{
+	PsMemoryScope* pScope = pHeader->pScope;
+	if (NULL == pScope)
+		return;
+
+	if (NULL != pHeader->prev)
+		pHeader->prev->next = pHeader->next;
+	else
+		pScope->m_pFirst = pHeader->next;
+
+	if (NULL != pHeader->next)
+		pHeader->next->prev = pHeader->prev;
+
+	pScope->m_liveBytes -= pHeader->bytes;
+
+	pHeader->prev = NULL;
+	pHeader->next = NULL;
+	pHeader->pScope = NULL;
+}
+
+void PsMemoryPool::releaseBlock(PsMemoryHeader* pHeader)
+{
+	s_stats.freeCnt++;
+	s_stats.liveCnt--;
+	s_stats.liveBytes -= pHeader->bytes;
+
+	// A freed block can't be taken for a live one
+	pHeader->magic = 0;
+
+	if (PS_MEMORY_LARGE_CLASS == pHeader->sizeClass)
+	{
+		free(pHeader);
+	}
+	else
+	{
+		pHeader->next = s_freeList[pHeader->sizeClass];
+		s_freeList[pHeader->sizeClass] = pHeader;
+	}
+}
+
+void PsMemoryPool::releaseScope(PsMemoryScope* pScope)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	PsMemoryHeader* pHeader = pScope->m_pFirst;
+	while (NULL != pHeader)
+	{
+		PsMemoryHeader* pNext = pHeader->next;
+
+		pScope->m_stats.releasedCnt++;
+		pScope->m_stats.releasedBytes += pHeader->bytes;
+		releaseBlock(pHeader);
+
+		pHeader = pNext;
+	}
+	pScope->m_pFirst = NULL;
+	pScope->m_liveBytes = 0;
+
+	s_lastScopeStats = pScope->m_stats;
+
+	if (s_bDump)
+	{
+		char buf[256];
+		snprintf(buf, sizeof(buf), "PsMemory %s: %llu allocs, %zu bytes, peak %zu bytes, released %d blocks (%zu bytes), live %zu bytes\n",
+			pScope->m_stats.name, pScope->m_stats.allocCnt, pScope->m_stats.allocBytes, pScope->m_stats.peakBytes,
+			pScope->m_stats.releasedCnt, pScope->m_stats.releasedBytes, s_stats.liveBytes);
+		OutputDebugStringA(buf);
+	}
+}
+
+PsMemoryScope::PsMemoryScope(const char* name) :
+	m_pOuter(s_pScope),
+	m_pFirst(NULL),
+	m_liveBytes(0)
+{
+	m_stats.name = name;
+
+	// A nested scope belongs to the outermost one
+	if (NULL == m_pOuter)
+		s_pScope = this;
+}
+
+PsMemoryScope::~PsMemoryScope()
+{
+	if (this != s_pScope)
+		return;
+
+	s_pScope = NULL;
+	PsMemoryPool::releaseScope(this);
+}
+
+void PsMemoryScope::Keep(const void* pointer)
+{
+	if (NULL == pointer)
+		return;
+
+	PsMemoryHeader* pHeader = (PsMemoryHeader*)pointer - 1;
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	if (PS_MEMORY_MAGIC == pHeader->magic)
+		PsMemoryPool::unlinkBlock(pHeader);
+}
+
+PsMemoryUnscoped::PsMemoryUnscoped() :
+	m_pScope(s_pScope)
+{
+	s_pScope = NULL;
+}
+
+PsMemoryUnscoped::~PsMemoryUnscoped()
+{
+	s_pScope = m_pScope;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "parasolid_kernel.h"
+#include <stdint.h>
+
+// Counters of the whole session
+struct PsMemoryStats
+{
+	size_t liveBytes = 0;
+	size_t liveCnt = 0;
+	size_t peakBytes = 0;
+	size_t reservedBytes = 0;		// Chunks of the size classes, never given back
+	unsigned long long allocCnt = 0;
+	unsigned long long freeCnt = 0;
+	unsigned long long foreignFreeCnt = 0;	// Blocks not allocated here, left alone
+};
+
+// Counters of one operation scope
+struct PsMemoryScopeStats
+{
+	const char* name = "";
+	unsigned long long allocCnt = 0;
+	size_t allocBytes = 0;
+	size_t peakBytes = 0;			// Of the blocks of the scope alive together
+	int releasedCnt = 0;			// Blocks still alive at the end of the scope, released by the reset
+	size_t releasedBytes = 0;
+};
+
+class PsMemoryScope;
+struct PsMemoryHeader;
+
+// Memory callbacks of the Parasolid session, it serves the arrays returned by the kernel.
+// Small blocks come from size classes of 16 to 4096 bytes carved in 64 KB chunks, larger ones from the heap.
+// Register has to be called before the session starts, the kernel mustn't free a block of another allocator.
+class PsMemoryPool
+{
+public:
+	static bool Register();
+	static PsMemoryStats GetStats();
+	static PsMemoryScopeStats GetLastScopeStats();
+	// Write a line per closed scope to the debugger output
+	static void SetDump(const bool bDump);
+
+private:
+	friend class PsMemoryScope;
+
+	static void stAlloc(size_t n_bytes, void** pointer, PK_ERROR_code_t* error);
+	static void stFree(void* pointer);
+	static void releaseScope(PsMemoryScope* pScope);
+	static void releaseBlock(PsMemoryHeader* pHeader);
+	static void unlinkBlock(PsMemoryHeader* pHeader);
+};
+
+// Scope of a kernel operation on this thread. The arrays the kernel returned meanwhile and the operation
+// didn't free are released together at the end of the outermost scope. Scopes on other threads are separate.
+class PsMemoryScope
+{
+public:
+	PsMemoryScope(const char* name);
+	~PsMemoryScope();
+
+	// The array outlives the scope, the caller frees it
+	static void Keep(const void* pointer);
+
+private:
+	friend class PsMemoryPool;
+
+	PsMemoryScope* m_pOuter;
+	PsMemoryHeader* m_pFirst;		// Live blocks of the scope
+	size_t m_liveBytes;
+	PsMemoryScopeStats m_stats;
+};
+
+// No scope on this thread while alive, for kernel memory kept beyond the operation (transmitted parts...)
+class PsMemoryUnscoped
+{
+public:
+	PsMemoryUnscoped();
+	~PsMemoryUnscoped();
+
+private:
+	PsMemoryScope* m_pScope;
+};
@@ -0,0 +1,114 @@
+#include "stdafx.h"
+#include "PsModelQuery.h"
+#include "PerfTrace.h"
+#include <map>
+
+PsModelQuery::PsModelQuery(const PsKernel& kernel) :
+	m_kernel(kernel)
+{
+}
+
+PsModelQuery::~PsModelQuery()
+{
+}
+
+PK_ASSEMBLY_t PsModelQuery::FindTopAssy() const
+{
+	PERF_TRACE_SCOPE("ps", "PsModelQuery::FindTopAssy");
+
+	std::vector<PK_ASSEMBLY_t> assyArr;
+	if (PK_ERROR_no_errors != m_kernel.AskAssemblies(assyArr))
+		return PK_ENTITY_null;
+
+	// chile-parent map
+	std::map<PK_ASSEMBLY_t, PK_ASSEMBLY_t> child_parent;
+
+	// Search assemblies and regiter to the map
+	for (size_t i = 0; i < assyArr.size(); i++)
+	{
+		PK_CLASS_t ent_class;
+		if (PK_ERROR_no_errors == m_kernel.AskClass(assyArr[i], ent_class) && PK_CLASS_assembly == ent_class)
+			child_parent.insert(std::make_pair(assyArr[i], PK_ENTITY_null));
+	}
+
+	std::vector<PK_PART_t> partArr;
+	for (auto itr = child_parent.begin(); itr != child_parent.end(); ++itr)
+	{
+		if (PK_ERROR_no_errors != m_kernel.AskInstanceParts(itr->first, partArr))
+			continue;
+
+		// If instance part exists in the map, its pearent becomes current assem
+		for (size_t i = 0; i < partArr.size(); i++)
+		{
+			auto itr2 = child_parent.find(partArr[i]);
+			if (child_parent.end() != itr2)
+				itr2->second = itr->first;
+		}
+	}
+
+	//Assem which doesn't have a parent becomes top assem
+	for (auto itr = child_parent.begin(); itr != child_parent.end(); ++itr)
+	{
+		if (PK_ENTITY_null == itr->second)
+			return itr->first;
+	}
+	return PK_ENTITY_null;
+}
+
+bool PsModelQuery::GetPlaneInfo(const PK_FACE_t face, const double unit, double* position, double* normal) const
+{
+	PK_SURF_t surf = PK_ENTITY_null;
+	PK_CLASS_t surf_class;
+
+	if (PK_ERROR_no_errors != m_kernel.AskFaceSurf(face, surf) || PK_ERROR_no_errors != m_kernel.AskClass(surf, surf_class))
+		return false;
+
+	if (PK_CLASS_plane != surf_class)
+		return false;
+
+	PK_PLANE_sf_t plane_sf;
+	if (PK_ERROR_no_errors != m_kernel.AskPlane(surf, plane_sf))
+		return false;
+
+	position[0] = plane_sf.basis_set.location.coord[0] * unit;
+	position[1] = plane_sf.basis_set.location.coord[1] * unit;
+	position[2] = plane_sf.basis_set.location.coord[2] * unit;
+
+	normal[0] = plane_sf.basis_set.axis.coord[0];
+	normal[1] = plane_sf.basis_set.axis.coord[1];
+	normal[2] = plane_sf.basis_set.axis.coord[2];
+
+	return true;
+}
+
+bool PsModelQuery::FindBoss(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr) const
+{
+	PERF_TRACE_SCOPE("ps", "PsModelQuery::FindBoss");
+
+	std::vector<PK_EDGE_t> edgeArr;
+	if (PK_ERROR_no_errors != m_kernel.AskBodyEdges(body, edgeArr))
+		return false;
+
+	// Find all of the concave edges by looping through every edge on the body.
+	std::vector<PK_EDGE_t> concave_edges;
+	concave_edges.reserve(edgeArr.size());
+	for (size_t i = 0; i < edgeArr.size(); i++)
+	{
+		PK_emboss_convexity_t convexity;
+		if (PK_ERROR_no_errors != m_kernel.AskEdgeConvexity(edgeArr[i], convexity))
+			continue;
+
+		if ((convexity == PK_EDGE_convexity_concave_c) || (convexity == PK_EDGE_convexity_smooth_ccv_c))
+			concave_edges.push_back(edgeArr[i]);
+	}
+
+	// The faceset of the input face bounded by the concave edges
+	std::vector<std::vector<PK_FACE_t>> facesetArr;
+	if (PK_ERROR_no_errors != m_kernel.FindFacesets(body, concave_edges, face, facesetArr))
+		return false;
+
+	for (size_t i = 0; i < facesetArr.size(); i++)
+		entityArr.insert(entityArr.end(), facesetArr[i].begin(), facesetArr[i].end());
+
+	return true;
+}
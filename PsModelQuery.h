@@ -0,0 +1,23 @@
+#pragma once
+#include "PsKernel.h"
+
+// Model enquiries of PsProcess written on PsKernel only, so they run on the stand-in too
+class PsModelQuery
+{
+public:
+	PsModelQuery(const PsKernel& kernel);
+	~PsModelQuery();
+
+private:
+	const PsKernel& m_kernel;
+
+public:
+	// Assembly of the current partition instanced by no other assembly
+	PK_ASSEMBLY_t FindTopAssy() const;
+
+	// Location and normal of a planar face, the location is scaled by unit
+	bool GetPlaneInfo(const PK_FACE_t face, const double unit, double* position, double* normal) const;
+
+	// Faceset of the face bounded by the concave edges of the body
+	bool FindBoss(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr) const;
+};
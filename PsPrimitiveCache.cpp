@@ -0,0 +1,275 @@
+#include "stdafx.h"
+#include "PsPrimitiveCache.h"
+#include <cmath>
+#include <set>
+#include <string.h>
+
+PsPrimitiveCache::PsPrimitiveCache() :
+	m_partition(PK_ENTITY_null),
+	m_dQuantum(1.0e-5)
+{
+	m_stats.budgetBytes = 64 * 1024 * 1024;
+}
+
+PsPrimitiveCache::~PsPrimitiveCache()
+{
+	// The session may be stopped already, the masters go with Terminate
+}
+
+PsPrimitiveCache::Key PsPrimitiveCache::makeKey(const int shape, const int paramCnt, const double* params) const
+{
+	Key key;
+	key.push_back(shape);
+
+	for (int i = 0; i < paramCnt; i++)
+	{
+		if (0.0 < m_dQuantum)
+		{
+			key.push_back(llround(params[i] / m_dQuantum));
+		}
+		else
+		{
+			long long bits;
+			memcpy(&bits, &params[i], sizeof(bits));
+			key.push_back(bits);
+		}
+	}
+
+	return key;
+}
+
+bool PsPrimitiveCache::Initialize()
+{
+	if (PK_ENTITY_null != m_partition)
+		return true;
+
+	if (PK_ERROR_no_errors != PK_PARTITION_create_empty(&m_partition))
+	{
+		m_partition = PK_ENTITY_null;
+		return false;
+	}
+
+	return true;
+}
+
+void PsPrimitiveCache::Terminate()
+{
+	if (PK_ENTITY_null != m_partition)
+	{
+		PK_PARTITION_delete_o_t delete_opts;
+		PK_PARTITION_delete_o_m(delete_opts);
+		delete_opts.delete_non_empty = PK_LOGICAL_true;
+		PK_PARTITION_delete(m_partition, &delete_opts);
+		m_partition = PK_ENTITY_null;
+	}
+
+	m_entryMap.clear();
+	m_lruList.clear();
+	m_stats.usedBytes = 0;
+}
+
+bool PsPrimitiveCache::isAlive(const Entry& entry) const
+{
+	// A rolled back master may have left its tag to a body of another partition
+	int n_bodies = 0;
+	PK_BODY_t* bodies = NULL;
+	if (PK_ERROR_no_errors != PK_PARTITION_ask_bodies(m_partition, &n_bodies, &bodies))
+		return false;
+
+	bool bAlive = false;
+	for (int i = 0; i < n_bodies && !bAlive; i++)
+		bAlive = (bodies[i] == entry.master);
+
+	if (n_bodies)
+		PK_MEMORY_free(bodies);
+
+	return bAlive;
+}
+
+void PsPrimitiveCache::sweep()
+{
+	// Construction bodies, and masters dropped then brought back by an undo
+	int n_bodies = 0;
+	PK_BODY_t* bodies = NULL;
+	if (PK_ERROR_no_errors != PK_PARTITION_ask_bodies(m_partition, &n_bodies, &bodies))
+		return;
+
+	std::set<PK_BODY_t> masterSet;
+	for (auto it = m_entryMap.begin(); it != m_entryMap.end(); it++)
+		masterSet.insert(it->second.master);
+
+	std::vector<PK_BODY_t> strayArr;
+	for (int i = 0; i < n_bodies; i++)
+	{
+		if (0 == masterSet.count(bodies[i]))
+			strayArr.push_back(bodies[i]);
+	}
+
+	if (n_bodies)
+		PK_MEMORY_free(bodies);
+
+	if (strayArr.size())
+		PK_ENTITY_delete((int)strayArr.size(), strayArr.data());
+}
+
+bool PsPrimitiveCache::buildMaster(const BuildFunc& fnBuild, Entry& entry)
+{
+	PK_ERROR_code_t error_code;
+
+	PK_PARTITION_t curPartition;
+	error_code = PK_SESSION_ask_curr_partition(&curPartition);
+
+	error_code = PK_PARTITION_set_current(m_partition);
+
+	PK_BODY_t master = PK_ENTITY_null;
+	bool bRet = PK_ERROR_no_errors == error_code && fnBuild(master) && PK_ENTITY_null != master;
+
+	error_code = PK_PARTITION_set_current(curPartition);
+
+	entry.master = bRet ? master : PK_ENTITY_null;
+	entry.bytes = 0;
+
+	if (bRet)
+	{
+		// The size of the master is the one of its transmitted form
+		PK_PART_transmit_o_t transmit_opts;
+		PK_PART_transmit_o_m(transmit_opts);
+		transmit_opts.transmit_format = PK_transmit_format_binary_c;
+
+		PK_MEMORY_block_t block;
+		if (PK_ERROR_no_errors == PK_PART_transmit_b(1, &master, &transmit_opts, &block))
+		{
+			for (const PK_MEMORY_block_t* pBlock = &block; NULL != pBlock; pBlock = pBlock->next)
+				entry.bytes += pBlock->n_bytes;
+			PK_MEMORY_block_f(&block);
+		}
+	}
+
+	return bRet;
+}
+
+bool PsPrimitiveCache::copy(const Entry& entry, PK_BODY_t& body)
+{
+	PK_ERROR_code_t error_code;
+
+	PK_PARTITION_t curPartition;
+	error_code = PK_SESSION_ask_curr_partition(&curPartition);
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+
+	PK_ENTITY_copy_o_t copy_opts;
+	PK_ENTITY_track_r_t en_tracking;
+	PK_ENTITY_copy_o_m(copy_opts);
+
+	PK_BODY_t copyBody = PK_ENTITY_null;
+	error_code = PK_ENTITY_copy_2(entry.master, &copy_opts, &copyBody, &en_tracking);
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+	PK_ENTITY_track_r_f(&en_tracking);
+
+	// The copy is made next to the master
+	error_code = PK_BODY_change_partition(copyBody, curPartition);
+	if (PK_ERROR_no_errors != error_code)
+	{
+		PK_ENTITY_delete(1, &copyBody);
+		return false;
+	}
+
+	body = copyBody;
+
+	return true;
+}
+
+bool PsPrimitiveCache::Instantiate(const int shape, const int paramCnt, const double* params, const BuildFunc& fnBuild, PK_BODY_t& body)
+{
+	if (PK_ENTITY_null == m_partition)
+		return false;
+
+	Key key = makeKey(shape, paramCnt, params);
+
+	auto it = m_entryMap.find(key);
+	if (m_entryMap.end() != it && !isAlive(it->second))
+	{
+		// Taken back by an undo
+		m_lruList.erase(it->second.lruIt);
+		m_stats.usedBytes -= it->second.bytes;
+		m_entryMap.erase(it);
+		it = m_entryMap.end();
+	}
+
+	if (m_entryMap.end() != it)
+	{
+		m_stats.hitCnt++;
+		m_lruList.splice(m_lruList.begin(), m_lruList, it->second.lruIt);
+
+		return copy(it->second, body);
+	}
+
+	m_stats.missCnt++;
+
+	sweep();
+
+	Entry entry;
+	bool bBuilt = buildMaster(fnBuild, entry);
+
+	// The construction bodies go, the new master stays
+	if (bBuilt)
+	{
+		m_lruList.push_front(key);
+		entry.lruIt = m_lruList.begin();
+		it = m_entryMap.insert(std::make_pair(key, entry)).first;
+		m_stats.usedBytes += entry.bytes;
+	}
+	sweep();
+
+	if (!bBuilt)
+		return false;
+
+	bool bRet = copy(it->second, body);
+
+	// The new master stays even over the budget
+	evict();
+
+	return bRet;
+}
+
+void PsPrimitiveCache::drop(std::map<Key, Entry>::iterator it)
+{
+	m_stats.usedBytes -= it->second.bytes;
+	if (PK_ENTITY_null != m_partition && isAlive(it->second))
+		PK_ENTITY_delete(1, &it->second.master);
+
+	m_lruList.erase(it->second.lruIt);
+	m_entryMap.erase(it);
+}
+
+void PsPrimitiveCache::evict()
+{
+	while (0 < m_stats.budgetBytes && m_stats.usedBytes > m_stats.budgetBytes && 1 < m_lruList.size())
+	{
+		drop(m_entryMap.find(m_lruList.back()));
+		m_stats.evictedCnt++;
+	}
+}
+
+void PsPrimitiveCache::SetBudget(const size_t budgetBytes)
+{
+	m_stats.budgetBytes = budgetBytes;
+	evict();
+}
+
+void PsPrimitiveCache::Clear()
+{
+	while (!m_entryMap.empty())
+		drop(m_entryMap.begin());
+
+	m_stats.usedBytes = 0;
+}
+
+PsPrimitiveCacheStats PsPrimitiveCache::GetStats() const
+{
+	PsPrimitiveCacheStats stats = m_stats;
+	stats.entryCnt = (int)m_entryMap.size();
+
+	return stats;
+}
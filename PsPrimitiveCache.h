@@ -0,0 +1,67 @@
+#pragma once
+#include "parasolid_kernel.h"
+#include <functional>
+#include <list>
+#include <map>
+#include <vector>
+
+struct PsPrimitiveCacheStats
+{
+	int hitCnt = 0;
+	int missCnt = 0;
+	int evictedCnt = 0;
+	int entryCnt = 0;
+	size_t usedBytes = 0;
+	size_t budgetBytes = 0;
+};
+
+// Primitive bodies by shape and quantized parameters. A master is built once in a private partition
+// and stays there as a live body. A request of the same primitive gets a copy of it moved to the current
+// partition, the caller places it. Marks roll the whole session, a master taken back by an undo is built again.
+// The least recently used masters are dropped beyond the memory budget.
+class PsPrimitiveCache
+{
+public:
+	// Called with the cache partition current, the master is made at the origin along Z
+	typedef std::function<bool(PK_BODY_t& body)> BuildFunc;
+
+	PsPrimitiveCache();
+	~PsPrimitiveCache();
+
+private:
+	typedef std::vector<long long> Key;
+
+	struct Entry
+	{
+		PK_BODY_t master;
+		size_t bytes;					// Transmitted size of the master
+		std::list<Key>::iterator lruIt;
+	};
+
+	PK_PARTITION_t m_partition;
+	std::map<Key, Entry> m_entryMap;
+	std::list<Key> m_lruList;		// Most recent first
+	double m_dQuantum;
+	PsPrimitiveCacheStats m_stats;
+
+	Key makeKey(const int shape, const int paramCnt, const double* params) const;
+	bool isAlive(const Entry& entry) const;
+	void sweep();
+	bool buildMaster(const BuildFunc& fnBuild, Entry& entry);
+	bool copy(const Entry& entry, PK_BODY_t& body);
+	void drop(std::map<Key, Entry>::iterator it);
+	void evict();
+
+public:
+	// Make the private partition, outside any mark so that an undo doesn't take it back
+	bool Initialize();
+	// Delete the masters and the partition, before the session stops
+	void Terminate();
+	// Return false if the primitive couldn't be made, nothing is left in the current partition then
+	bool Instantiate(const int shape, const int paramCnt, const double* params, const BuildFunc& fnBuild, PK_BODY_t& body);
+	// Parameters closer than the quantum share the master, 0 for exact matches only
+	void SetQuantum(const double quantum) { m_dQuantum = quantum; }
+	void SetBudget(const size_t budgetBytes);
+	void Clear();
+	PsPrimitiveCacheStats GetStats() const;
+};
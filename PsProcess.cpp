@@ -1,144 +1,18 @@
 #include "stdafx.h"
 #include "PsProcess.h"
 #include "ps_utilities.h"
-
-//////////////// Lower-level functions ////////////////
-// Calculates the dot product of two vectors.
-double dotProduct(PK_VECTOR_t a, PK_VECTOR_t b)
-{
-	double dotProduct = 0.0;
-	dotProduct = (a.coord[0] * b.coord[0]) + (a.coord[1] * b.coord[1]) + (a.coord[2] * b.coord[2]);
-	return dotProduct;
-}
-
-// Calculates the cross product of two vectors.
-PK_VECTOR_t findCrossProduct(PK_VECTOR_t a, PK_VECTOR_t b)
-{
-	PK_VECTOR_t findCrossProduct = { 0 };
-	findCrossProduct.coord[0] = (a.coord[1] * b.coord[2]) - (a.coord[2] * b.coord[1]);
-	findCrossProduct.coord[1] = (a.coord[2] * b.coord[0]) - (a.coord[0] * b.coord[2]);
-	findCrossProduct.coord[2] = (a.coord[0] * b.coord[1]) - (a.coord[1] * b.coord[0]);
-	return findCrossProduct;
-}
-
-// Calculates the magnitude of the specified vector.
-double findMagnitude(PK_VECTOR_t a)
-{
-	double squaredMagnitude = 0.0;
-	for (int i = 0; i < 3; i++)
-	{
-		squaredMagnitude += a.coord[i] * a.coord[i];
-	}
-	double mag = sqrt(squaredMagnitude);
-	return sqrt(squaredMagnitude);
-}
-
-//////////////// Geometric tests ////////////////
-// This function determines the angle between two axes of cylindrical surfaces.
-double findAngleBetweenAxes(PK_SURF_t surf1, PK_SURF_t surf2)
-{
-	// Initialisations ////////////////
-	double angle = 0;
-	PK_VECTOR1_t surf_axis1, surf_axis2;
-	///////////////////////////////////
-
-	// In this code example findAngleBetweenAxes is called on a cylinder face. This function could be written to consider other surface types not demonstrated in this
-	// code example.
-	PK_CYL_sf_t cylinder_sf_1;
-	PK_CYL_sf_t cylinder_sf_2;
-	PK_CYL_ask(surf1, &cylinder_sf_1);
-	PK_CYL_ask(surf2, &cylinder_sf_2);
-	surf_axis1 = cylinder_sf_1.basis_set.axis;
-	surf_axis2 = cylinder_sf_2.basis_set.axis;
-
-	// Find the angle. See Implementation notes for more detail on this calculation.
-	return angle = asin(findMagnitude(findCrossProduct(surf_axis1, surf_axis2)));
-}
-
-// This function finds the distance between two axes of cylindrical surfaces.
-double findDistanceBetweenAxes(PK_SURF_t surf1, PK_SURF_t surf2)
-{
-	// Initialisations ////////////////
-	double distance = 0;
-	PK_VECTOR1_t surf_axis1, surf_axis2, norm_axis_vec;
-	PK_VECTOR_t surf_location1 = { 0 }, surf_location2 = { 0 }, dist_vec = { 0 };
-	//////////////////////////////////
-
-	// In this code example findDistanceBetweenAxes is called on a cylinder face. This function could be written to consider other surface type not demonstrated in this
-	// code example.
-
-	PK_CYL_sf_t cylinder_sf_1;
-	PK_CYL_sf_t cylinder_sf_2;
-	PK_CYL_ask(surf1, &cylinder_sf_1);
-	PK_CYL_ask(surf2, &cylinder_sf_2);
-	surf_axis1 = cylinder_sf_1.basis_set.axis;
-	surf_axis2 = cylinder_sf_2.basis_set.axis;
-	surf_location1 = cylinder_sf_1.basis_set.location;
-	surf_location2 = cylinder_sf_2.basis_set.location;
-
-	// Find the distance vector between the cylinders' basis set location points.
-	dist_vec.coord[0] = surf_location1.coord[0] - surf_location2.coord[0];
-	dist_vec.coord[1] = surf_location1.coord[1] - surf_location2.coord[1];
-	dist_vec.coord[2] = surf_location1.coord[2] - surf_location2.coord[2];
-	// Normalise vector for one axis.
-	PK_VECTOR_normalise(surf_axis1, &norm_axis_vec);
-	// Final calculation to find the linear distance. See Implementation notes for more detail on this calculation.
-	return distance = findMagnitude(findCrossProduct(dist_vec, norm_axis_vec));
-}
-
-// This function finds the angle between two planes
-double findAngleBetweenPlanes(PK_PLANE_t plane1, PK_PLANE_t plane2)
-{
-	// Initialisations ////////////////
-	PK_PLANE_sf_t plane_info1;
-	PK_PLANE_sf_t plane_info2;
-	PK_VECTOR_t surf_normal1 = { 0 }, surf_normal2 = { 0 }, point1 = { 0 }, point2 = { 0 };
-	double angle = 0;
-	//////////////////////////////////
-	PK_PLANE_ask(plane1, &plane_info1);
-	PK_PLANE_ask(plane2, &plane_info2);
-	surf_normal1 = plane_info1.basis_set.axis;
-	surf_normal2 = plane_info2.basis_set.axis;
-
-	// Find the angle between the two surface normals.
-	return angle = asin(findMagnitude(findCrossProduct(surf_normal1, surf_normal2)));
-}
-
-// This function finds the distance between two planes. See Implementation notes for more detail on this calculation.
-/// This function assumes that the planes are coplanar or very nearly coplanar - the calculation in this function requires
-/// this condition to be met in order to give reliable results
-double findDistanceBetweenPlanes(PK_PLANE_t plane1, PK_PLANE_t plane2)
-{
-	// Initialisations ////////////////
-	PK_PLANE_sf_t plane_info1;
-	PK_PLANE_sf_t plane_info2;
-	PK_VECTOR1_t norm_axis_vec;
-	PK_VECTOR_t point = { 0 }, surf_normal = { 0 }, surf_location_norm2 = { 0 },
-		dist_vec = { 0 }, surf_location1 = { 0 }, surf_location2 = { 0 }, surf_normal2 = { 0 };
-	double distance = 0;
-	///////////////////////////////////
-
-	// Find information about plane1. We need a location on plane1, so use the one from the basis set and call it surf_location1.
-	PK_PLANE_ask(plane1, &plane_info1);
-	surf_location1 = plane_info1.basis_set.location;
-	surf_normal = plane_info1.basis_set.axis;
-
-	PK_PLANE_ask(plane2, &plane_info2);
-	surf_location2 = plane_info2.basis_set.location;
-
-	// Find the distance vector between the basis set location points.
-	dist_vec.coord[0] = surf_location1.coord[0] - surf_location2.coord[0];
-	dist_vec.coord[1] = surf_location1.coord[1] - surf_location2.coord[1];
-	dist_vec.coord[2] = surf_location1.coord[2] - surf_location2.coord[2];
-	// Normalise vector for one axis.
-	PK_VECTOR_normalise(surf_normal, &norm_axis_vec);
-
-	// Final calculation to find the linear distance. See Implementation notes for more detail on this calculation.
-	return distance = abs(dotProduct(dist_vec, norm_axis_vec));
-}
+#include "PsMemoryPool.h"
+#include "PsModelQuery.h"
+#include "PerfTrace.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 PsProcess::PsProcess() :
-	m_partition(PK_ENTITY_null)
+	m_partition(PK_ENTITY_null),
+	m_recognizer(m_dFRTol, m_dFRAngTol),
+	m_bInGroup(false),
+	m_groupMark(PK_ENTITY_null)
 {
 }
 
@@ -150,6 +24,9 @@ void PsProcess::Initialize()
 {
 	PK_ERROR_code_t error_code;
 
+	// Out of any mark, the masters of CreateSolid are kept there
+	m_primitiveCache.Initialize();
+
 	// Get current partation
 	PK_PARTITION_t old_partition;
 	error_code = PK_SESSION_ask_curr_partition(&old_partition);
@@ -163,137 +40,309 @@ void PsProcess::Initialize()
 	PK_PARTITION_delete_o_m(delete_opts);
 	delete_opts.delete_non_empty = PK_LOGICAL_true;
 	error_code = PK_PARTITION_delete(old_partition, &delete_opts);
+
+	// The marks of the old partition are gone, undone steps have to be rolled forward
+	m_journal.Clear();
+	m_bInGroup = false;
+	m_groupMark = PK_ENTITY_null;
+	InvalidateFRCache(PK_ENTITY_null);
+	error_code = PK_SESSION_set_roll_forward(PK_LOGICAL_true);
 }
 
-PK_ASSEMBLY_t PsProcess::findTopAssy()
+void PsProcess::Terminate()
 {
-	PK_ERROR_code_t error_code;
-	PK_ASSEMBLY_t topAssem = PK_ENTITY_null;
+	// The snapshot is written with the kernel memory
+	m_saveEngine.Wait();
 
-	PK_PARTITION_t partition;
-	int n_assy = 0;
-	PK_ASSEMBLY_t* assems;
-	PK_SESSION_ask_curr_partition(&partition);
-	error_code = PK_PARTITION_ask_assemblies(partition, &n_assy, &assems);
+	m_primitiveCache.Terminate();
+}
 
-	// chile-parent map
-	std::map<PK_ASSEMBLY_t, PK_ASSEMBLY_t> child_parent;
+bool PsProcess::beginOperation(PK_MARK_t& mark)
+{
+	// A new modelling change makes the undone steps unreachable
+	m_journal.DiscardRedo();
 
-	// Search assemblies and regiter to the map
-	for (int i = 0; i < n_assy; i++)
+	if (PK_ERROR_no_errors != PK_MARK_create(&mark))
 	{
-		PK_ASSEMBLY_t assem = assems[i];
-		PK_CLASS_t ent_class;
-		PK_ENTITY_ask_class(assem, &ent_class);
-
-		if (PK_CLASS_assembly == ent_class)
-			child_parent.insert(std::make_pair(assem, PK_ENTITY_null));
+		mark = PK_ENTITY_null;
+		return false;
 	}
 
-	for (auto itr = child_parent.begin(); itr != child_parent.end(); ++itr)
+	return true;
+}
+
+void PsProcess::commitOperation(const PK_MARK_t mark, PsJournalStep& step)
+{
+	if (m_bInGroup)
 	{
-		PK_ASSEMBLY_t assem = itr->first;
+		// The group mark is the one to go back to
+		if (PK_ENTITY_null != mark)
+			PK_MARK_delete(mark);
 
-		int n_inst;
-		PK_INSTANCE_t* instances;
-		PK_ASSEMBLY_ask_instances(assem, &n_inst, &instances);
+		mergeGroupStep(step);
 
-		for (int i = 0; i < n_inst; i++)
-		{
-			PK_INSTANCE_t instance = instances[i];
+		m_groupDelta.modifiedFaces.insert(m_groupDelta.modifiedFaces.end(), m_lastDelta.modifiedFaces.begin(), m_lastDelta.modifiedFaces.end());
+		m_groupDelta.createdFaces.insert(m_groupDelta.createdFaces.end(), m_lastDelta.createdFaces.begin(), m_lastDelta.createdFaces.end());
+		m_groupDelta.deletedTopols.insert(m_groupDelta.deletedTopols.end(), m_lastDelta.deletedTopols.begin(), m_lastDelta.deletedTopols.end());
+		return;
+	}
 
-			PK_INSTANCE_sf_s instance_sf;
-			error_code = PK_INSTANCE_ask(instance, &instance_sf);
+	if (PK_ENTITY_null == mark)
+		return;
 
-			// If instance part exists in the map, its pearent becomes current assem 
-			PK_CLASS_t ent_class;
-			PK_ENTITY_ask_class(instance_sf.part, &ent_class);
-			PK_PART_t part = instance_sf.part;
+	step.mark = mark;
+	m_journal.Record(step);
+}
 
-			if (PK_CLASS_assembly == ent_class)
-			{
-				for (auto itr2 = child_parent.begin(); itr2 != child_parent.end(); ++itr2)
-				{
-					if (part == itr2->first)
-						itr2->second = assem;
-				}
-			}
-		}
+void PsProcess::mergeGroupStep(const PsJournalStep& step)
+{
+	std::vector<PK_BODY_t>& createdArr = m_groupStep.createdBodies;
+	std::vector<PK_BODY_t>& modifiedArr = m_groupStep.modifiedBodies;
+
+	for (size_t i = 0; i < step.createdBodies.size(); i++)
+		createdArr.push_back(step.createdBodies[i]);
+
+	// A body created in the group stays a created one
+	for (size_t i = 0; i < step.modifiedBodies.size(); i++)
+	{
+		PK_BODY_t body = step.modifiedBodies[i];
+		if (createdArr.end() == std::find(createdArr.begin(), createdArr.end(), body) &&
+			modifiedArr.end() == std::find(modifiedArr.begin(), modifiedArr.end(), body))
+			modifiedArr.push_back(body);
 	}
 
-	//Assem which doesn't have a parent becomes top assem
-	for (auto itr = child_parent.begin(); itr != child_parent.end(); ++itr)
+	// A body created and deleted in the group never existed for the journal
+	for (size_t i = 0; i < step.deletedBodies.size(); i++)
 	{
-		if (PK_ENTITY_null == itr->second)
-		{
-			topAssem = itr->first;
-			return topAssem;
-		}
+		PK_BODY_t body = step.deletedBodies[i];
+		modifiedArr.erase(std::remove(modifiedArr.begin(), modifiedArr.end(), body), modifiedArr.end());
+
+		auto it = std::find(createdArr.begin(), createdArr.end(), body);
+		if (createdArr.end() != it)
+			createdArr.erase(it);
+		else
+			m_groupStep.deletedBodies.push_back(body);
 	}
-	return topAssem;
 }
 
-bool PsProcess::Save()
+bool PsProcess::BeginGroup()
+{
+	if (m_bInGroup)
+		return false;
+
+	if (!beginOperation(m_groupMark))
+		return false;
+
+	m_bInGroup = true;
+	m_groupStep = PsJournalStep();
+	m_groupDelta.Clear();
+
+	return true;
+}
+
+bool PsProcess::EndGroup(const bool bCommit, PsJournalStep& step)
+{
+	if (!m_bInGroup)
+		return false;
+
+	m_bInGroup = false;
+	step = m_groupStep;
+	m_groupStep = PsJournalStep();
+
+	if (!bCommit)
+	{
+		abortOperation(m_groupMark);
+		m_groupMark = PK_ENTITY_null;
+
+		// The caches may have followed the rolled back operations
+		invalidateStep(step);
+		m_lastDelta.Clear();
+		m_groupDelta.Clear();
+
+		return true;
+	}
+
+	m_lastDelta = m_groupDelta;
+	m_groupDelta.Clear();
+
+	// Same faces may have been touched by several operations
+	std::sort(m_lastDelta.createdFaces.begin(), m_lastDelta.createdFaces.end());
+	m_lastDelta.createdFaces.erase(std::unique(m_lastDelta.createdFaces.begin(), m_lastDelta.createdFaces.end()), m_lastDelta.createdFaces.end());
+
+	std::sort(m_lastDelta.modifiedFaces.begin(), m_lastDelta.modifiedFaces.end());
+	m_lastDelta.modifiedFaces.erase(std::unique(m_lastDelta.modifiedFaces.begin(), m_lastDelta.modifiedFaces.end()), m_lastDelta.modifiedFaces.end());
+
+	std::sort(m_lastDelta.deletedTopols.begin(), m_lastDelta.deletedTopols.end());
+	m_lastDelta.deletedTopols.erase(std::unique(m_lastDelta.deletedTopols.begin(), m_lastDelta.deletedTopols.end()), m_lastDelta.deletedTopols.end());
+
+	commitOperation(m_groupMark, step);
+	m_groupMark = PK_ENTITY_null;
+
+	return true;
+}
+
+void PsProcess::abortOperation(const PK_MARK_t mark)
+{
+	if (PK_ENTITY_null == mark)
+		return;
+
+	PK_MARK_goto_o_t goto_ots;
+	PK_MARK_goto_r_t goto_result;
+	PK_MARK_goto_o_m(goto_ots);
+	if (PK_ERROR_no_errors == PK_MARK_goto_2(mark, &goto_ots, &goto_result))
+		PK_MARK_goto_r_f(&goto_result);
+
+	PK_MARK_delete(mark);
+}
+
+void PsProcess::invalidateStep(const PsJournalStep& step)
+{
+	for (size_t i = 0; i < step.modifiedBodies.size(); i++)
+		InvalidateFRCache(step.modifiedBodies[i]);
+	for (size_t i = 0; i < step.createdBodies.size(); i++)
+		InvalidateFRCache(step.createdBodies[i]);
+	for (size_t i = 0; i < step.deletedBodies.size(); i++)
+		InvalidateFRCache(step.deletedBodies[i]);
+}
+
+bool PsProcess::Undo(PsJournalStep& step)
+{
+	PERF_TRACE_SCOPE("ps", "PsProcess::Undo");
+	PsMemoryScope memScope("Undo");
+
+	if (m_bInGroup || !m_journal.Undo(step))
+		return false;
+
+	m_lastDelta.Clear();
+	invalidateStep(step);
+
+	return true;
+}
+
+bool PsProcess::Redo(PsJournalStep& step)
+{
+	PERF_TRACE_SCOPE("ps", "PsProcess::Redo");
+	PsMemoryScope memScope("Redo");
+
+	if (m_bInGroup || !m_journal.Redo(step))
+		return false;
+
+	m_lastDelta.Clear();
+	invalidateStep(step);
+
+	return true;
+}
+
+PK_ASSEMBLY_t PsProcess::findTopAssy()
+{
+	return PsModelQuery(PsKernel::Current()).FindTopAssy();
+}
+
+bool PsProcess::Save(const char* filePath, const PK_transmit_format_t format, const PsSaveMode mode)
 {
+	if (NULL == filePath)
+		return false;
+
 	PK_ERROR_code_t error_code;
 
 	int n_parts = 0;
 	PK_PART_t* parts = NULL;
+	std::vector<PK_PART_t> partArr;
 
 	int n_assy = 0;
-	PK_ASSEMBLY_t* assems;
+	PK_ASSEMBLY_t* assems = NULL;
 	PK_PARTITION_t partition;
 
 	PK_SESSION_ask_curr_partition(&partition);
 	error_code = PK_PARTITION_ask_assemblies(partition, &n_assy, &assems);
+	if (0 < n_assy)
+		PK_MEMORY_free(assems);
 
 	if (0 < n_assy)
 	{
 		PK_ASSEMBLY_t topAssy = findTopAssy();
 
 		if (PK_ENTITY_null != topAssy)
-		{
-			n_parts = 1;
-			parts = new PK_PART_t[1];
-			parts[0] = topAssy;
-		}
+			partArr.push_back(topAssy);
 	}
 	else
 	{
 		PK_SESSION_ask_parts(&n_parts, &parts);
+		if (0 < n_parts)
+		{
+			partArr.assign(parts, parts + n_parts);
+			PK_MEMORY_free(parts);
+		}
 	}
 
-	if (0 < n_parts)
-	{
-		PK_PART_transmit_o_t transmit_opts;
-		PK_PART_transmit_o_m(transmit_opts);
-		transmit_opts.transmit_format = PK_transmit_format_text_c;
-		transmit_opts.transmit_version = 320;
+	if (0 == partArr.size())
+		return false;
 
-		char filePath[256];
-		sprintf(filePath, "C:\\temp\\debug.x_t");
-		error_code = PK_PART_transmit(n_parts, parts, filePath, &transmit_opts);
+	if (PsSaveMode::FRUSTRUM == mode)
+		return m_saveEngine.Transmit((int)partArr.size(), partArr.data(), filePath, format, 320);
 
-		if (PK_ERROR_no_errors == error_code)
-			return true;
-		else
+	return m_saveEngine.Start((int)partArr.size(), partArr.data(), filePath, format, 320);
+}
+
+void PsProcess::addFaceDelta(const PK_TOPOL_t topol, std::vector<PK_FACE_t>& faceArr)
+{
+	PK_CLASS_t topol_class;
+	if (PK_ERROR_no_errors != PK_ENTITY_ask_class(topol, &topol_class))
+		return;
+
+	if (PK_CLASS_face == topol_class)
+		faceArr.push_back(topol);
+}
+
+void PsProcess::setDeltaFromTracking(const PK_TOPOL_track_r_t& tracking)
+{
+	for (int i = 0; i < tracking.n_track_records; i++)
+	{
+		const PK_TOPOL_track_record_t& record = tracking.track_records[i];
+
+		switch (record.track)
 		{
-			return false;
+		case PK_TOPOL_track_create_c:
+			for (int j = 0; j < record.n_product_topols; j++)
+				addFaceDelta(record.product_topols[j], m_lastDelta.createdFaces);
+			break;
+		case PK_TOPOL_track_delete_c:
+			for (int j = 0; j < record.n_original_topols; j++)
+				m_lastDelta.deletedTopols.push_back(record.original_topols[j]);
+			break;
+		default:
+			// Split, merge, transfer etc. keep the products on the body but change their geometry or bounds
+			for (int j = 0; j < record.n_product_topols; j++)
+				addFaceDelta(record.product_topols[j], m_lastDelta.modifiedFaces);
+			break;
 		}
 	}
 
-	return false;
+	// A face can appear in several records
+	std::sort(m_lastDelta.createdFaces.begin(), m_lastDelta.createdFaces.end());
+	m_lastDelta.createdFaces.erase(std::unique(m_lastDelta.createdFaces.begin(), m_lastDelta.createdFaces.end()), m_lastDelta.createdFaces.end());
+
+	std::sort(m_lastDelta.modifiedFaces.begin(), m_lastDelta.modifiedFaces.end());
+	m_lastDelta.modifiedFaces.erase(std::unique(m_lastDelta.modifiedFaces.begin(), m_lastDelta.modifiedFaces.end()), m_lastDelta.modifiedFaces.end());
+
+	std::sort(m_lastDelta.deletedTopols.begin(), m_lastDelta.deletedTopols.end());
+	m_lastDelta.deletedTopols.erase(std::unique(m_lastDelta.deletedTopols.begin(), m_lastDelta.deletedTopols.end()), m_lastDelta.deletedTopols.end());
 }
 
 bool PsProcess::BlendRC(const PsBlendType blendType, const double inBlendR, const double blendC2, const PK_BODY_t body, 
 	const int edgeCnt, const PK_EDGE_t* edges, const PK_FACE_t* faces)
 {
+	PERF_TRACE_SCOPE("ps", "PsProcess::BlendRC");
+	PsMemoryScope memScope("BlendRC");
+
 	// Parasolid session
 	PK_ERROR_code_t error_code;
 
+	m_lastDelta.Clear();
+
 	// Set mark
-	PK_PMARK_t mark;
-	error_code = PK_MARK_create(&mark);
+	PK_MARK_t mark;
+	beginOperation(mark);
 
 	int n_blend_edges = 0;
 	PK_EDGE_t* blend_edges = NULL;
@@ -344,24 +393,61 @@ bool PsProcess::BlendRC(const PsBlendType blendType, const double inBlendR, cons
 	}
 #endif
 
+	if (PK_blend_fault_no_fault_c == fault)
+	{
+		// Blend faces are new, the faces they were fixed on are trimmed
+		for (int i = 0; i < n_blends; i++)
+		{
+			m_lastDelta.createdFaces.push_back(blends[i]);
+
+			for (int j = 0; j < unders[i].length; j++)
+				addFaceDelta(unders[i].array[j], m_lastDelta.modifiedFaces);
+		}
+		std::sort(m_lastDelta.modifiedFaces.begin(), m_lastDelta.modifiedFaces.end());
+		m_lastDelta.modifiedFaces.erase(std::unique(m_lastDelta.modifiedFaces.begin(), m_lastDelta.modifiedFaces.end()), m_lastDelta.modifiedFaces.end());
+	}
+
+	// Free memory
+	if (n_blends)
+	{
+		for (int i = 0; i < n_blends; i++)
+			PK_MEMORY_free(unders[i].array);
+		PK_MEMORY_free(blends);
+		PK_MEMORY_free(unders);
+		PK_MEMORY_free(topols);
+	}
+
 	if (PK_blend_fault_no_fault_c != fault)
 	{
+		m_lastDelta.Clear();
+
 		// Undo operation
-		PK_MARK_goto_o_t goto_ots;
-		PK_MARK_goto_r_t goto_result;
-		PK_MARK_goto_o_m(goto_ots);
-		error_code = PK_MARK_goto_2(mark, &goto_ots, &goto_result);
+		abortOperation(mark);
 
 		return false;
 	}
 
+	updateFRCache(body);
+
+	PsJournalStep step;
+	step.modifiedBodies.push_back(body);
+	commitOperation(mark, step);
+
 	return true;
 }
 
 bool PsProcess::Hollow(const double thisckness, const PK_BODY_t body, const int faceCnt, const PK_FACE_t* pierceFaces)
 {
+	PERF_TRACE_SCOPE("ps", "PsProcess::Hollow");
+	PsMemoryScope memScope("Hollow");
+
 	PK_ERROR_code_t error_code;
 
+	m_lastDelta.Clear();
+
+	PK_MARK_t mark;
+	beginOperation(mark);
+
 	PK_TOPOL_track_r_t   tracking;
 	PK_TOPOL_local_r_t   results;
 	PK_BODY_hollow_o_t   hollow_opts;
@@ -376,7 +462,24 @@ bool PsProcess::Hollow(const double thisckness, const PK_BODY_t body, const int
 	error_code = PK_BODY_hollow_2(body, thisckness / m_dUnit, 1.0e-06, &hollow_opts, &tracking, &results);
 
 	if (PK_ERROR_no_errors != error_code)
+	{
+		abortOperation(mark);
 		return false;
+	}
+
+	setDeltaFromTracking(tracking);
+
+	// Free memory
+	PK_TOPOL_track_r_f(&tracking);
+	PK_TOPOL_local_r_f(&results);
+
+	// The offset creates as many faces as the body has, cheaper to build the geometry index again at the next query
+	m_recognizer.DropGeomIndex(body);
+	updateFRCache(body);
+
+	PsJournalStep step;
+	step.modifiedBodies.push_back(body);
+	commitOperation(mark, step);
 
 	return true;
 }
@@ -430,6 +533,52 @@ void PsProcess::setBasisSet(const double* in_offset, const double* in_dir, PK_AX
 	basis_set.ref_direction = xDir;
 }
 
+bool PsProcess::placeBody(const PK_AXIS2_sf_s& basis_set, const PK_BODY_t body)
+{
+	PK_ERROR_code_t error_code;
+
+	// Body made on the global frame moved to the basis set, columns are ref direction, axis x ref direction and axis
+	const PK_VECTOR_t& x = basis_set.ref_direction;
+	const PK_VECTOR_t& z = basis_set.axis;
+	double y[3] = {
+		z.coord[1] * x.coord[2] - z.coord[2] * x.coord[1],
+		z.coord[2] * x.coord[0] - z.coord[0] * x.coord[2],
+		z.coord[0] * x.coord[1] - z.coord[1] * x.coord[0] };
+
+	PK_TRANSF_sf_t transf_sf;
+	for (int i = 0; i < 3; i++)
+	{
+		transf_sf.matrix[i][0] = x.coord[i];
+		transf_sf.matrix[i][1] = y[i];
+		transf_sf.matrix[i][2] = z.coord[i];
+		transf_sf.matrix[i][3] = basis_set.location.coord[i];
+		transf_sf.matrix[3][i] = 0.0;
+	}
+	transf_sf.matrix[3][3] = 1.0;
+
+	PK_TRANSF_t transf;
+	error_code = PK_TRANSF_create(&transf_sf, &transf);
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+
+	PK_BODY_transform_o_t transf_opts;
+	PK_TOPOL_track_r_t tracking;
+	PK_TOPOL_local_r_t local_res;
+
+	PK_BODY_transform_o_m(transf_opts);
+
+	error_code = PK_BODY_transform_2(body, transf, m_dTol, &transf_opts, &tracking, &local_res);
+
+	PK_TOPOL_track_r_f(&tracking);
+	PK_TOPOL_local_r_f(&local_res);
+	PK_ENTITY_delete(1, &transf);
+
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+
+	return true;
+}
+
 bool PsProcess::createBlock(const double* in_size, const double* in_offset, const double* in_dir, PK_BODY_t& body)
 {
 	PK_ERROR_code_t error_code;
@@ -680,7 +829,7 @@ bool PsProcess::createSpring(const double in_outDia, const double in_L, const do
 
 	PK_CURVE_make_wire_body_o_t make_wire_body_opts;
 	PK_CURVE_make_wire_body_o_m(make_wire_body_opts);
-	static PK_BODY_t path_body = PK_ENTITY_null;
+	PK_BODY_t path_body = PK_ENTITY_null;
 	int n_edges = 0;
 	PK_EDGE_t* new_edges = PK_ENTITY_null;
 	int* edge_index = NULL;
@@ -734,7 +883,7 @@ bool PsProcess::createSpring(const double in_outDia, const double in_L, const do
 	delete[] intervals_array;
 
 	// Create a circular sheet (profile)
-	static PK_BODY_t profile = PK_ENTITY_null;
+	PK_BODY_t profile = PK_ENTITY_null;
 	{
 		// Set up the basis set for the profile
 		PK_AXIS2_sf_s basis_set;
@@ -792,16 +941,12 @@ bool PsProcess::createSpring(const double in_outDia, const double in_L, const do
 	}
 
 	// Ensure the correct start vertex is selected for the sweep and not just the first vertex returned in the array of vertices
-	static PK_BODY_tracked_sweep_2_r_t swept_res;
+	PK_BODY_tracked_sweep_2_r_t swept_res;
 	error_code = PK_BODY_make_swept_body_2(1, &profile, path_body, &start_vertex, &sweep_opts, &swept_res);
 
 	// Check for error and the status
 	if ((error_code == PK_ERROR_no_errors) && (swept_res.status.fault == PK_BODY_sweep_ok_c))
 	{
-		// Assign the relevant return information into the relevant variables so that they can be referred to easily
-
-		// The status
-		static PK_BODY_sweep_status_2_r_t  status = swept_res.status;
 		// The swept body
 		body = swept_res.body;
 	}
@@ -841,32 +986,48 @@ void PsProcess::setPartColor(const PK_PART_t in_part, const double* in_color)
 
 bool PsProcess::CreateSolid(const SolidShape solidShape, const double* in_size, const double* in_offset, const double* in_dir, PK_BODY_t& body)
 {
+	PERF_TRACE_SCOPE("ps", "PsProcess::CreateSolid");
+	PsMemoryScope memScope("CreateSolid");
+
 	PK_ERROR_code_t error_code;
 	
-	bool bRet = false;
+	PK_MARK_t mark;
+	beginOperation(mark);
+
+	// The master is made at the origin along Z, then the copy is moved where it is asked.
+	// The spring is always made on the global frame
+	const double zero[] = { 0.0, 0.0, 0.0 };
+	const double zDir[] = { 0.0, 0.0, 1.0 };
+
+	int paramCnt = 0;
+	PsPrimitiveCache::BuildFunc fnBuild;
 	switch (solidShape)
 	{
 	case BLOCK:
 	{
-		bRet =  createBlock(in_size, in_offset, in_dir, body);
+		paramCnt = 3;
+		fnBuild = [=](PK_BODY_t& master) { return createBlock(in_size, zero, zDir, master); };
 	} break;
 	case CYLINDER:
 	{
 		double rad = in_size[0];
 		double height = in_size[1];
-		bRet = createCylinder(rad, height, in_offset, in_dir, body);
+		paramCnt = 2;
+		fnBuild = [=](PK_BODY_t& master) { return createCylinder(rad, height, zero, zDir, master); };
 	} break;
 	case CONE:
 	{
 		double rad = in_size[0];
 		double height = in_size[1];
 		double angle = in_size[2];
-		bRet = createCone(rad, height, angle, in_offset, in_dir, body);
+		paramCnt = 3;
+		fnBuild = [=](PK_BODY_t& master) { return createCone(rad, height, angle, zero, zDir, master); };
 	} break;
 	case SPHERE:
 	{
 		double rad = in_size[0];
-		bRet = createSphere(rad, in_offset, in_dir, body);
+		paramCnt = 1;
+		fnBuild = [=](PK_BODY_t& master) { return createSphere(rad, zero, zDir, master); };
 	} break;
 	case SPRING:
 	{
@@ -874,36 +1035,85 @@ bool PsProcess::CreateSolid(const SolidShape solidShape, const double* in_size,
 		double H = in_size[1];
 		double wireD = in_size[2];
 		double ang = in_size[3];
-		bRet = createSpring(D, H, wireD, ang, body);
+		paramCnt = 4;
+		fnBuild = [=](PK_BODY_t& master) { return createSpring(D, H, wireD, ang, master); };
 	} break;
 	default:
 		break;
 	}
 
+	bool bRet = false;
+	body = PK_ENTITY_null;
+	if (fnBuild)
+		bRet = m_primitiveCache.Instantiate(solidShape, paramCnt, in_size, fnBuild, body);
+
+	if (bRet && SPRING != solidShape)
+	{
+		PK_AXIS2_sf_s basis_set;
+		setBasisSet(in_offset, in_dir, basis_set);
+		bRet = placeBody(basis_set, body);
+	}
+
+	if (!bRet)
+	{
+		abortOperation(mark);
+		body = PK_ENTITY_null;
+		return false;
+	}
+
 	// Set body color
 	double color[] = { 128.0/255.0, 128.0/255.0, 128/255.0 };
 	setPartColor(body, color);
 
-	return bRet;
+	PsJournalStep step;
+	step.createdBodies.push_back(body);
+	commitOperation(mark, step);
+
+	return true;
 }
 
 bool PsProcess::DeleteBody(const PK_BODY_t body)
 {
+	PERF_TRACE_SCOPE("ps", "PsProcess::DeleteBody");
+	PsMemoryScope memScope("DeleteBody");
+
+	PK_MARK_t mark;
+	beginOperation(mark);
+
 	PK_ERROR_code_t error_code = PK_ENTITY_delete(1, &body);
 
 	if (PK_ERROR_no_errors != error_code)
+	{
+		abortOperation(mark);
 		return false;
+	}
+
+	InvalidateFRCache(body);
+
+	PsJournalStep step;
+	step.deletedBodies.push_back(body);
+	commitOperation(mark, step);
 
 	return true;
 }
 
 bool PsProcess::DeleteFace(const int faceCnt, const PK_FACE_t* faces)
 {
+	PERF_TRACE_SCOPE("ps", "PsProcess::DeleteFace");
+	PsMemoryScope memScope("DeleteFace");
+
 	PK_ERROR_code_t error_code;
 
+	m_lastDelta.Clear();
+
+	// The faces are dead after the operation
+	PK_BODY_t body = PK_ENTITY_null;
+	if (faceCnt)
+		PK_FACE_ask_body(faces[0], &body);
+
 	// Set mark
-	PK_PMARK_t mark;
-	error_code = PK_MARK_create(&mark);
+	PK_MARK_t mark;
+	beginOperation(mark);
 
 	PK_FACE_delete_o_t del_ots;
 	PK_FACE_delete_o_m(del_ots);
@@ -913,23 +1123,39 @@ bool PsProcess::DeleteFace(const int faceCnt, const PK_FACE_t* faces)
 	if (PK_ERROR_no_errors != error_code)
 	{
 		// Undo operation
-		PK_MARK_goto_o_t goto_ots;
-		PK_MARK_goto_r_t goto_result;
-		PK_MARK_goto_o_m(goto_ots);
-		error_code = PK_MARK_goto_2(mark, &goto_ots, &goto_result);
+		abortOperation(mark);
 
 		return false;
 	}
+
+	// Deleted faces are not always reported as delete records
+	for (int i = 0; i < faceCnt; i++)
+		m_lastDelta.deletedTopols.push_back(faces[i]);
+
+	setDeltaFromTracking(track);
+	PK_TOPOL_track_r_f(&track);
+
+	updateFRCache(body);
+
+	PsJournalStep step;
+	step.modifiedBodies.push_back(body);
+	commitOperation(mark, step);
+
 	return true;
 }
 
 bool PsProcess::Boolean(const PsBoolType boolType, const PK_BODY_t targetBody, const int toolCnt, const PK_BODY_t* toolBodies, int& bodyCnt, PK_BODY_t*& bodies)
 {
+	PERF_TRACE_SCOPE("ps", "PsProcess::Boolean");
+	PsMemoryScope memScope("Boolean");
+
 	PK_ERROR_code_t error_code;
 
+	m_lastDelta.Clear();
+
 	// Set mark
-	PK_PMARK_t mark;
-	error_code = PK_MARK_create(&mark);
+	PK_MARK_t mark;
+	beginOperation(mark);
 
 	PK_BODY_boolean_o_t options;
 	PK_TOPOL_track_r_t tracking;
@@ -942,9 +1168,26 @@ bool PsProcess::Boolean(const PsBoolType boolType, const PK_BODY_t targetBody, c
 	case PsBoolType::UNITE: options.function = PK_boolean_unite_c; break;
 	case PsBoolType::SUBTRACT: options.function = PK_boolean_subtract_c; break;
 	case PsBoolType::INTERSECT: options.function = PK_boolean_intersect_c; break;
-	default: return false; break;
+	default: abortOperation(mark); return false; break;
 	}
 	options.merge_imprinted = PK_LOGICAL_true;
+	options.tracking = PK_LOGICAL_true;
+
+	// Faces of the tools which remain are transferred to the target
+	std::vector<PK_FACE_t> toolFaceArr;
+	if (m_recognizer.IsCached(targetBody))
+	{
+		for (int i = 0; i < toolCnt; i++)
+		{
+			int n_faces = 0;
+			PK_FACE_t* faces = NULL;
+			if (PK_ERROR_no_errors == PK_BODY_ask_faces(toolBodies[i], &n_faces, &faces) && n_faces)
+			{
+				toolFaceArr.insert(toolFaceArr.end(), faces, faces + n_faces);
+				PK_MEMORY_free(faces);
+			}
+		}
+	}
 
 	// perform the Boolean operation
 	error_code = PK_BODY_boolean_2(targetBody, toolCnt, toolBodies, &options, &tracking, &results);
@@ -952,10 +1195,7 @@ bool PsProcess::Boolean(const PsBoolType boolType, const PK_BODY_t targetBody, c
 	if (PK_ERROR_no_errors != error_code)
 	{
 		// Undo operation
-		PK_MARK_goto_o_t goto_ots;
-		PK_MARK_goto_r_t goto_result;
-		PK_MARK_goto_o_m(goto_ots);
-		error_code = PK_MARK_goto_2(mark, &goto_ots, &goto_result);
+		abortOperation(mark);
 
 		return false;
 	}
@@ -971,189 +1211,293 @@ bool PsProcess::Boolean(const PsBoolType boolType, const PK_BODY_t targetBody, c
 	}
 #endif
 
+	setDeltaFromTracking(tracking);
+	PK_TOPOL_track_r_f(&tracking);
+
 	bodyCnt = results.n_bodies;
 	bodies = results.bodies;
+	PsMemoryScope::Keep(bodies);
+
+	for (int i = 0; i < toolCnt; i++)
+		InvalidateFRCache(toolBodies[i]);
+
+	// The faces may have been shared out to several result bodies
+	if (1 == bodyCnt && targetBody == bodies[0])
+		updateFRCache(targetBody, toolFaceArr);
+	else
+		InvalidateFRCache(targetBody);
+
+	PsJournalStep step;
+	step.modifiedBodies.push_back(targetBody);
+	step.deletedBodies.assign(toolBodies, toolBodies + toolCnt);
+	for (int i = 0; i < bodyCnt; i++)
+	{
+		if (targetBody != bodies[i])
+			step.createdBodies.push_back(bodies[i]);
+	}
+	commitOperation(mark, step);
 
 	return true;
 }
 
-bool PsProcess::FR_BOSS(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr)
+// Boxes of the bodies asked by chunks, each result is written to its own slot
+static void stFindBoxes(const std::vector<PK_BODY_t>& bodyArr, std::vector<PK_BOX_t>& boxArr, std::vector<char>& validArr, unsigned int workerCnt)
 {
-	PK_ERROR_code_t error_code;
-	
-	int n_edges = 0, edge_counter = 0;
-	PK_EDGE_t* concave_edges = NULL, * convex_edges = NULL, * edges = NULL;
-	PK_EDGE_ask_convexity_o_t convexity_opts;
-	PK_emboss_convexity_t convexity;
+	const int bodyCnt = (int)bodyArr.size();
+	boxArr.resize(bodyCnt);
+	validArr.assign(bodyCnt, 0);
 
-	error_code = PK_BODY_ask_edges(body, &n_edges, &edges);
-	if (PK_ERROR_no_errors != error_code)
-		return false;
+	if (workerCnt > (unsigned int)bodyCnt)
+		workerCnt = (unsigned int)bodyCnt;
 
-	if (0 != n_edges)
+	std::atomic<int> nextBody(0);
+	auto worker = [&]()
 	{
-		concave_edges = (PK_EDGE_t*)malloc(sizeof(PK_EDGE_t) * n_edges);
-
-		edge_counter = 0;
-		// Find all of the concave edges by looping through every edge on the body.
-		for (int i = 0; i < n_edges; i++)
-		{
-			PK_EDGE_ask_convexity_o_m(convexity_opts);
-			error_code = PK_EDGE_ask_convexity(edges[i], &convexity_opts, &convexity);
-			if ((convexity == PK_EDGE_convexity_concave_c) || (convexity == PK_EDGE_convexity_smooth_ccv_c))
-			{
-				(concave_edges[edge_counter++] = edges[i]);
-
-			}
-		}
+		for (int i = nextBody++; i < bodyCnt; i = nextBody++)
+			validArr[i] = PK_ERROR_no_errors == PK_TOPOL_find_box(bodyArr[i], &boxArr[i]) ? 1 : 0;
+	};
 
-		// Free memory.
-		PK_MEMORY_free(edges);
+	if (workerCnt <= 1)
+	{
+		worker();
+		return;
 	}
 
-	// Call PK_BODY_find_facesets with the concave_edges array and the input_face as the selecting topol.
-	PK_BODY_find_facesets_o_t facesets_opts;
-	PK_TOPOL_t selecting_topols_faces[1] = { PK_ENTITY_null };
-	PK_BODY_find_facesets_r_t results;
-
-	PK_BODY_find_facesets_o_m(facesets_opts);
-	facesets_opts.selector = PK_boolean_include_c;
-	facesets_opts.n_selecting_topol = 1;
-	selecting_topols_faces[0] = face;
-	facesets_opts.selecting_topol = selecting_topols_faces;
-	error_code = PK_BODY_find_facesets(body, edge_counter, concave_edges, &facesets_opts, &results);
-	if (PK_ERROR_no_errors != error_code)
-		return false;
+	std::vector<std::thread> threadArr;
+	for (unsigned int i = 0; i < workerCnt; i++)
+		threadArr.push_back(std::thread(worker));
+
+	for (auto& th : threadArr)
+		th.join();
+}
 
-	// PK_BODY_find_facesets returns the faces in sets so get A3DEntities of selected faces using PkMapper
-	for (int i = 0; i < results.n_selected_facesets; i++)
+static bool stBoxesOverlap(const PK_BOX_t& box1, const PK_BOX_t& box2, const double tol)
+{
+	for (int i = 0; i < 3; i++)
 	{
-		// Assign elements from faceset i.
-		for (int m = 0; m < results.selected_facesets[i].length; m++)
-		{
-			PK_FACE_t selectedFace = results.selected_facesets[i].array[m];
-			entityArr.push_back(selectedFace);
-		}
+		if (box1.coord[i + 3] + tol < box2.coord[i] || box2.coord[i + 3] + tol < box1.coord[i])
+			return false;
 	}
-
 	return true;
 }
 
-bool PsProcess::FR_CONCENTRIC(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr)
+bool PsProcess::BooleanBatch(const PsBoolType boolType, const std::vector<PsBoolSet>& setArr, std::vector<PsBoolSetResult>& resultArr, PsJournalStep& step)
 {
-	double tolerance = 1.0e-06;		/// Linear tolerance
-	double angular_tolerance = 1.0e-9; /// See implementation notes for reason for setting angular tolerance
+	PERF_TRACE_SCOPE("ps", "PsProcess::BooleanBatch");
+	PsMemoryScope memScope("BooleanBatch");
 
-	PK_SURF_t input_surf = PK_ENTITY_null, surf = PK_ENTITY_null;
-	int n_faces = 0;
-	PK_FACE_t* tempFaces = NULL;
-	PK_CLASS_t surf_class = PK_ENTITY_null;
+	PK_ERROR_code_t error_code;
 
-	// Find the concentric faces.
-	// Find the surface tag of the input face.
-	PK_FACE_ask_surf(face, &input_surf);
+	m_lastDelta.Clear();
+	resultArr.assign(setArr.size(), PsBoolSetResult());
+	step = PsJournalStep();
 
-	// Find every face on the body.
-	PK_BODY_ask_faces(body, &n_faces, &tempFaces);
+	PK_BODY_boolean_o_t options;
+	PK_BODY_boolean_o_m(options);
 
-	// Loop through every face and see if they match the criteria to be a cylindrical concentric face.
-	// (This loop could easily be adjusted to exclude the input face if required.)
-	for (int i = 0; i < n_faces; i++)
+	switch (boolType)
 	{
-		// Ask if the surface is a cylinder. If not, then it cannot be a concentric cylinder.
-		PK_FACE_ask_surf(tempFaces[i], &surf);
-		PK_ENTITY_ask_class(surf, &surf_class);
-		if (surf_class == PK_CLASS_cyl)
-		{
-			// Angular precision is 1000 times smaller than linear precision. See Implementation notes for details.
-			if ((findAngleBetweenAxes(input_surf, surf) <= angular_tolerance) && (findDistanceBetweenAxes(input_surf, surf) <= tolerance))
-			{
-				entityArr.push_back(tempFaces[i]);
-			}
-		}
+	case PsBoolType::UNITE: options.function = PK_boolean_unite_c; break;
+	case PsBoolType::SUBTRACT: options.function = PK_boolean_subtract_c; break;
+	case PsBoolType::INTERSECT: options.function = PK_boolean_intersect_c; break;
+	default: return false; break;
 	}
+	options.merge_imprinted = PK_LOGICAL_true;
+	options.tracking = PK_LOGICAL_true;
 
-	// Free the memory for faces.
-	if (n_faces)
+	// A tool shared by several sets is copied for all of them but the last one
+	std::map<PK_BODY_t, int> toolUseMap;
+	for (size_t i = 0; i < setArr.size(); i++)
 	{
-		PK_MEMORY_free(tempFaces);
+		for (size_t j = 0; j < setArr[i].toolBodies.size(); j++)
+			toolUseMap[setArr[i].toolBodies[j]]++;
 	}
 
-	return true;
-}
+	// A subtracted tool out of the box of its target changes nothing, the boxes are asked in parallel
+	std::map<PK_BODY_t, int> boxIdMap;
+	std::vector<PK_BODY_t> boxBodyArr;
+	std::vector<PK_BOX_t> boxArr;
+	std::vector<char> validArr;
+	if (PsBoolType::SUBTRACT == boolType)
+	{
+		for (size_t i = 0; i < setArr.size(); i++)
+		{
+			if (boxIdMap.insert(std::make_pair(setArr[i].targetBody, (int)boxBodyArr.size())).second)
+				boxBodyArr.push_back(setArr[i].targetBody);
+		}
+		for (auto it = toolUseMap.begin(); it != toolUseMap.end(); it++)
+		{
+			if (boxIdMap.insert(std::make_pair(it->first, (int)boxBodyArr.size())).second)
+				boxBodyArr.push_back(it->first);
+		}
 
-bool PsProcess::FR_COPLANAR(const PK_BODY_t body, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr)
-{
-	double tolerance = 1.0e-06;		/// Linear tolerance
-	double angular_tolerance = 1.0e-9; /// See implementation notes for reason for setting angular tolerance
-
-	PK_SURF_t input_surf = PK_ENTITY_null, surf = PK_ENTITY_null;
-	int n_faces = 0;
-	PK_FACE_t* tempFaces = NULL;
-	PK_CLASS_t surf_class = PK_ENTITY_null;
-
-	// Find the coplanar faces.
-// Find the tag of the input surf.
-	PK_FACE_ask_surf(face, &input_surf);
-	// Find every face on the body.
-	PK_BODY_ask_faces(body, &n_faces, &tempFaces);
-
-	// Loop through every face and see if they match the criteria to be a coplanar face.
-	for (int i = 0; i < n_faces; i++)
+		stFindBoxes(boxBodyArr, boxArr, validArr, m_recognizer.GetWorkerCount());
+	}
+
+	// Set mark
+	PK_MARK_t mark;
+	beginOperation(mark);
+
+	int succeededCnt = 0;
+	for (size_t i = 0; i < setArr.size(); i++)
 	{
-		// Ask if the surface is a plane. If not, then input_face and faces[i] cannot be coplanar.
-		PK_FACE_ask_surf(tempFaces[i], &surf);
-		PK_ENTITY_ask_class(surf, &surf_class);
-		if (surf_class == PK_CLASS_plane)
+		const PsBoolSet& boolSet = setArr[i];
+		PsBoolSetResult& result = resultArr[i];
+		result.bSucceeded = false;
+
+		// Each set can be rolled back alone
+		PK_MARK_t setMark;
+		if (PK_ERROR_no_errors != PK_MARK_create(&setMark))
+			setMark = PK_ENTITY_null;
+
+		std::vector<PK_BODY_t> toolArr;
+		std::vector<PK_BODY_t> consumedArr;	// Original tools gone with this set
+		bool bCopied = true;
+		for (size_t j = 0; j < boolSet.toolBodies.size(); j++)
+		{
+			PK_BODY_t tool = boolSet.toolBodies[j];
+			bool bLastUse = 0 == --toolUseMap[tool];
+
+			if (boxIdMap.size())
+			{
+				int iTarget = boxIdMap[boolSet.targetBody];
+				int iTool = boxIdMap[tool];
+				if (validArr[iTarget] && validArr[iTool] && !stBoxesOverlap(boxArr[iTarget], boxArr[iTool], m_dTol))
+				{
+					if (bLastUse)
+					{
+						PK_ENTITY_delete(1, &tool);
+						consumedArr.push_back(tool);
+					}
+					continue;
+				}
+			}
+
+			if (bLastUse)
+			{
+				toolArr.push_back(tool);
+				consumedArr.push_back(tool);
+				continue;
+			}
+
+			PK_ENTITY_copy_o_t copy_opts;
+			PK_ENTITY_track_r_t en_tracking;
+			PK_ENTITY_copy_o_m(copy_opts);
+
+			PK_BODY_t copyTool = PK_ENTITY_null;
+			error_code = PK_ENTITY_copy_2(tool, &copy_opts, &copyTool, &en_tracking);
+			if (PK_ERROR_no_errors != error_code)
+			{
+				bCopied = false;
+				break;
+			}
+			PK_ENTITY_track_r_f(&en_tracking);
+
+			toolArr.push_back(copyTool);
+		}
+
+		if (!bCopied)
+		{
+			abortOperation(setMark);
+			continue;
+		}
+
+		if (toolArr.empty())
+		{
+			// None of the tools reaches the target
+			result.bSucceeded = true;
+			result.bodies.push_back(boolSet.targetBody);
+		}
+		else
 		{
-			if ((findAngleBetweenPlanes(input_surf, surf) <= angular_tolerance) && (findDistanceBetweenPlanes(input_surf, surf) <= tolerance))
+			PK_TOPOL_track_r_t tracking;
+			PK_boolean_r_t results;
+
+			error_code = PK_BODY_boolean_2(boolSet.targetBody, (int)toolArr.size(), toolArr.data(), &options, &tracking, &results);
+			if (PK_ERROR_no_errors != error_code)
 			{
-				entityArr.push_back(tempFaces[i]);
+				abortOperation(setMark);
+				continue;
 			}
+
+			setDeltaFromTracking(tracking);
+			PK_TOPOL_track_r_f(&tracking);
+
+			result.bSucceeded = true;
+			result.bodies.assign(results.bodies, results.bodies + results.n_bodies);
+			PK_boolean_r_f(&results);
+		}
+
+		if (PK_ENTITY_null != setMark)
+			PK_MARK_delete(setMark);
+
+		succeededCnt++;
+
+		step.modifiedBodies.push_back(boolSet.targetBody);
+		step.deletedBodies.insert(step.deletedBodies.end(), consumedArr.begin(), consumedArr.end());
+		for (size_t j = 0; j < result.bodies.size(); j++)
+		{
+			if (boolSet.targetBody != result.bodies[j])
+				step.createdBodies.push_back(result.bodies[j]);
 		}
 	}
 
-	// Free the memory for faces.
-	if (n_faces)
+	if (0 == succeededCnt)
 	{
-		PK_MEMORY_free(tempFaces);
+		// Undo operation
+		abortOperation(mark);
+		m_lastDelta.Clear();
+		step = PsJournalStep();
+
+		return false;
 	}
 
+	// Several targets share the delta, cheaper to build their caches again at the next query
+	for (size_t i = 0; i < step.modifiedBodies.size(); i++)
+		InvalidateFRCache(step.modifiedBodies[i]);
+	for (size_t i = 0; i < step.deletedBodies.size(); i++)
+		InvalidateFRCache(step.deletedBodies[i]);
+
+	commitOperation(mark, step);
+
 	return true;
 }
 
-bool PsProcess::FR(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& pkFaceArr)
+void PsProcess::updateFRCache(const PK_BODY_t body, const std::vector<PK_FACE_t>& extraFaces)
 {
-	PK_ERROR_code_t error_code;
-	
-	bool bRet;
+	if (!m_recognizer.IsCached(body))
+		return;
 
-	// Get body tag
-	PK_BODY_t body;
-	error_code = PK_FACE_ask_body(face, &body);
+	std::vector<PK_FACE_t> changedFaces = m_lastDelta.modifiedFaces;
+	changedFaces.insert(changedFaces.end(), m_lastDelta.createdFaces.begin(), m_lastDelta.createdFaces.end());
+	changedFaces.insert(changedFaces.end(), extraFaces.begin(), extraFaces.end());
 
+	m_recognizer.Update(body, changedFaces, m_lastDelta.deletedTopols);
+}
 
-	switch (frType)
-	{
-	case PsFRType::BOSS:
-		bRet = FR_BOSS(body, face, pkFaceArr);
-		break;
-	case PsFRType::CONCENTRIC:
-		bRet = FR_CONCENTRIC(body, face, pkFaceArr);
-		break;
-	case PsFRType::COPLANAR:
-		bRet = FR_COPLANAR(body, face, pkFaceArr);
-		break;
-	default:
-		bRet = false;
-		break;
-	}
+void PsProcess::InvalidateFRCache(const PK_BODY_t body)
+{
+	m_recognizer.Invalidate(body);
+}
+
+void PsProcess::SetFRWorkerCount(const unsigned int workerCnt)
+{
+	m_recognizer.SetWorkerCount(workerCnt);
+}
+
+bool PsProcess::FR(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& pkFaceArr)
+{
+	PERF_TRACE_SCOPE("ps", "PsProcess::FR");
+	PsMemoryScope memScope("FR");
 
-	return bRet;
+	return m_recognizer.Find(frType, face, pkFaceArr);
 }
 
 bool PsProcess::MirrorBody(const PK_BODY_t in_body, const double* in_location, const double* in_normal, const double isCopy, const double isMerge, PK_BODY_t& mirror_body)
 {
+	PERF_TRACE_SCOPE("ps", "PsProcess::MirrorBody");
+	PsMemoryScope memScope("MirrorBody");
+
 	PK_ERROR_code_t error_code;
 
 	PK_VECTOR_t position, normal;
@@ -1165,7 +1509,14 @@ bool PsProcess::MirrorBody(const PK_BODY_t in_body, const double* in_location, c
 	normal.coord[1] = in_normal[1];
 	normal.coord[2] = in_normal[2];
 
+	// The mirrored copy is only united with the original
+	const bool bMerge = isCopy && isMerge;
+
 	mirror_body = in_body;
+	m_lastDelta.Clear();
+
+	PK_MARK_t mark;
+	beginOperation(mark);
 	
 	if (isCopy)
 	{
@@ -1176,6 +1527,13 @@ bool PsProcess::MirrorBody(const PK_BODY_t in_body, const double* in_location, c
 		PK_ENTITY_copy_o_m(copy_opts);
 
 		error_code = PK_ENTITY_copy_2(in_body, &copy_opts, &mirror_body, &en_tracking);
+		if (PK_ERROR_no_errors != error_code)
+		{
+			abortOperation(mark);
+			mirror_body = PK_ENTITY_null;
+			return false;
+		}
+		PK_ENTITY_track_r_f(&en_tracking);
 
 		// Set body color
 		double color[] = { 128.0 / 255.0, 128.0 / 255.0, 128 / 255.0 };
@@ -1185,6 +1543,12 @@ bool PsProcess::MirrorBody(const PK_BODY_t in_body, const double* in_location, c
 	// PK_TRANSF_create_reflection will create a transformation that when applied causes the body to be reflected in the plane defined by the given 'position' and 'normal'.
 	PK_TRANSF_t transf;
 	error_code = PK_TRANSF_create_reflection(position, normal, &transf);
+	if (PK_ERROR_no_errors != error_code)
+	{
+		abortOperation(mark);
+		mirror_body = PK_ENTITY_null;
+		return false;
+	}
 
 	// Call PK_BODY_transform_2 to apply the transform to the desired body.
 	PK_BODY_transform_o_t transf_opts;
@@ -1194,47 +1558,94 @@ bool PsProcess::MirrorBody(const PK_BODY_t in_body, const double* in_location, c
 	PK_BODY_transform_o_m(transf_opts);
 
 	error_code = PK_BODY_transform_2(mirror_body, transf, 1.0e-06, &transf_opts, &tracking, &local_res);
+	PK_ENTITY_delete(1, &transf);
+	if (PK_ERROR_no_errors != error_code)
+	{
+		abortOperation(mark);
+		mirror_body = PK_ENTITY_null;
+		return false;
+	}
+
+	bool bTransformed = PK_local_status_ok_c == local_res.status;
+	PK_TOPOL_track_r_f(&tracking);
+	PK_TOPOL_local_r_f(&local_res);
 
-	if (isMerge)
+	if (!bTransformed)
+	{
+		abortOperation(mark);
+		mirror_body = PK_ENTITY_null;
+		return false;
+	}
+
+	if (bMerge)
 	{
 		// Unite bodies
 		PK_BODY_boolean_o_t options;
+		PK_TOPOL_track_r_t bool_tracking;
 		PK_boolean_r_t results;
 
 		PK_BODY_boolean_o_m(options);
 		options.function = PK_boolean_unite_c;
 		options.merge_imprinted = PK_LOGICAL_true;
 
-		error_code = PK_BODY_boolean_2(in_body, 1, &mirror_body, &options, &tracking, &results);
+		error_code = PK_BODY_boolean_2(in_body, 1, &mirror_body, &options, &bool_tracking, &results);
+		if (PK_ERROR_no_errors != error_code)
+		{
+			abortOperation(mark);
+			mirror_body = PK_ENTITY_null;
+			return false;
+		}
+
+		bool bUnited = PK_boolean_result_success_c == results.result;
+		PK_TOPOL_track_r_f(&bool_tracking);
+		PK_boolean_r_f(&results);
+
+		if (!bUnited)
+		{
+			abortOperation(mark);
+			mirror_body = PK_ENTITY_null;
+			return false;
+		}
 
 		mirror_body = PK_ENTITY_null;
 	}
 
+	// The whole original moved or grew, a copy alone leaves it untouched
+	if (!isCopy || bMerge)
+	{
+		int n_faces = 0;
+		PK_FACE_t* faces = NULL;
+		if (PK_ERROR_no_errors == PK_BODY_ask_faces(in_body, &n_faces, &faces) && n_faces)
+		{
+			m_lastDelta.modifiedFaces.assign(faces, faces + n_faces);
+			PK_MEMORY_free(faces);
+		}
+	}
+
+	// Not tracked
+	InvalidateFRCache(in_body);
+	if (PK_ENTITY_null != mirror_body)
+		InvalidateFRCache(mirror_body);
+
+	PsJournalStep step;
+	if (PK_ENTITY_null != mirror_body && in_body != mirror_body)
+		step.createdBodies.push_back(mirror_body);
+	else
+		step.modifiedBodies.push_back(in_body);
+	commitOperation(mark, step);
+
 	return true;
 }
 
 bool PsProcess::GetPlaneInfo(const PK_FACE_t face, double* position, double* normal)
 {
-	PK_SURF_t surf;
-	PK_CLASS_t surf_class;
-
-	PK_FACE_ask_surf(face, &surf);
-	PK_ENTITY_ask_class(surf, &surf_class);
+	return PsModelQuery(PsKernel::Current()).GetPlaneInfo(face, m_dUnit, position, normal);
+}
 
-	if (PK_CLASS_plane == surf_class)
-	{
-		PK_PLANE_sf_t plane_sf;
-		PK_PLANE_ask(surf, &plane_sf);
-		position[0] = plane_sf.basis_set.location.coord[0] * m_dUnit;
-		position[1] = plane_sf.basis_set.location.coord[1] * m_dUnit;
-		position[2] = plane_sf.basis_set.location.coord[2] * m_dUnit;
-		
-		normal[0] = plane_sf.basis_set.axis.coord[0];
-		normal[1] = plane_sf.basis_set.axis.coord[1];
-		normal[2] = plane_sf.basis_set.axis.coord[2];
-	}
-	else
-		return false;
+bool PsProcess::FRGroups(const PsFRType frType, const PK_BODY_t body, std::vector<std::vector<PK_FACE_t>>& groupArr)
+{
+	PERF_TRACE_SCOPE("ps", "PsProcess::FRGroups");
+	PsMemoryScope memScope("FRGroups");
 
-	return true;
+	return m_recognizer.FindGroups(frType, body, groupArr);
 }
\ No newline at end of file
@@ -1,9 +1,14 @@
 #pragma once
-#include "A3DSDKIncludes.h"
 #include "parasolid_kernel.h"
+#include "PsFeatureRecognizer.h"
+#include "PsJournal.h"
+#include "PsSaveEngine.h"
+#include "PsPrimitiveCache.h"
 #include <map>
+#include <vector>
 
 #ifdef USING_EXCHANGE
+#include "A3DSDKIncludes.h"
 #include "sprk_exchange.h"
 #endif
 
@@ -14,13 +19,6 @@ enum PsBoolType
 	INTERSECT
 };
 
-enum PsFRType
-{
-	BOSS,
-	CONCENTRIC,
-	COPLANAR
-};
-
 enum SolidShape
 {
 	BLOCK,
@@ -36,6 +34,39 @@ enum PsBlendType
 	C
 };
 
+// Faces touched by the last modelling operation (collected from PK_TOPOL_track_r_t)
+struct PsTopolDelta
+{
+	std::vector<PK_FACE_t> modifiedFaces;
+	std::vector<PK_FACE_t> createdFaces;
+	std::vector<PK_TOPOL_t> deletedTopols;	// Dead tags, the class can't be asked anymore
+
+	void Clear()
+	{
+		modifiedFaces.clear();
+		createdFaces.clear();
+		deletedTopols.clear();
+	}
+
+	bool IsEmpty() const
+	{
+		return modifiedFaces.empty() && createdFaces.empty() && deletedTopols.empty();
+	}
+};
+
+// One target of a batch Boolean with its tools, a tool may be shared by several sets
+struct PsBoolSet
+{
+	PK_BODY_t targetBody;
+	std::vector<PK_BODY_t> toolBodies;
+};
+
+struct PsBoolSetResult
+{
+	bool bSucceeded;	// A failed set is rolled back alone, its target and tools are kept
+	std::vector<PK_BODY_t> bodies;
+};
+
 class PsProcess
 {
 public:
@@ -45,10 +76,22 @@ public:
 private:
 	const double m_dUnit = 1000.0;
 	const double m_dTol = 1.0e-8;
+	const double m_dFRTol = 1.0e-06;		/// Linear tolerance of coplanar / concentric
+	const double m_dFRAngTol = 1.0e-9;	/// Angular precision is 1000 times smaller than linear precision
 	PK_PARTITION_t m_partition;
+	PsTopolDelta m_lastDelta;
+	PsFeatureRecognizer m_recognizer;
+	PsJournal m_journal;
+	PsSaveEngine m_saveEngine;
+	bool m_bInGroup;
+	PK_MARK_t m_groupMark;
+	PsJournalStep m_groupStep;		// Bodies of the committed operations of the group
+	PsTopolDelta m_groupDelta;
+	PsPrimitiveCache m_primitiveCache;	// Masters of CreateSolid, they survive Initialize
 
 	PK_ASSEMBLY_t findTopAssy();
 	void setBasisSet(const double* in_offset, const double* in_dir, PK_AXIS2_sf_s& basis_set);
+	bool placeBody(const PK_AXIS2_sf_s& basis_set, const PK_BODY_t body);
 	bool createBlock(const double* in_size, const double* in_offset, const double* in_dir, PK_BODY_t& body);
 	bool createCylinder(const double rad, const double height, const double* in_offset, const double* in_dir, PK_BODY_t& body);
 	bool createCone(const double rad, const double height, const double in_angle, const double* in_offset, const double* in_dir, PK_BODY_t& body);
@@ -56,22 +99,66 @@ private:
 	bool createSpring(const double in_outDia, const double in_L, const double in_wireDia, const double in_hook_ang, PK_BODY_t& body);
 	void setPartName(const PK_PART_t in_part, const char* in_value);
 	void setPartColor(const PK_PART_t in_part, const double* in_color);
-	bool FR_BOSS(const PK_BODY_t, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr);
-	bool FR_CONCENTRIC(const PK_BODY_t, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr);
-	bool FR_COPLANAR(const PK_BODY_t, const PK_FACE_t face, std::vector<PK_ENTITY_t>& entityArr);
+	void addFaceDelta(const PK_TOPOL_t topol, std::vector<PK_FACE_t>& faceArr);
+	bool beginOperation(PK_MARK_t& mark);
+	void commitOperation(const PK_MARK_t mark, PsJournalStep& step);
+	void abortOperation(const PK_MARK_t mark);
+	void invalidateStep(const PsJournalStep& step);
+	void mergeGroupStep(const PsJournalStep& step);
+	void setDeltaFromTracking(const PK_TOPOL_track_r_t& tracking);
+	void updateFRCache(const PK_BODY_t body, const std::vector<PK_FACE_t>& extraFaces = std::vector<PK_FACE_t>());
 
 public:
 	void Initialize();
-	bool Save();
+	// Release the kernel data kept beyond the documents, before the session stops
+	void Terminate();
+	// BACKGROUND: the parts are snapshot in memory here and written to the file on a background thread.
+	// FRUSTRUM: written here through the frustrum, see PsSaveEngine::Transmit
+	bool Save(const char* filePath, const PK_transmit_format_t format = PK_transmit_format_binary_c, const PsSaveMode mode = PsSaveMode::BACKGROUND);
+	bool IsSaving() const { return m_saveEngine.IsRunning(); }
+	PsSaveStatus GetSaveStatus() const { return m_saveEngine.GetStatus(); }
+	// Wait the end of the file write, return its result
+	bool WaitSave() { return m_saveEngine.Wait(); }
 	bool BlendRC(const PsBlendType blendType, const double inBlendR, const double blendC2, const PK_BODY_t body, 
 		const int edgeCnt, const PK_EDGE_t *edges, const PK_FACE_t* faces);
 	bool Hollow(const double thisckness, const PK_BODY_t body, const int faceCnt, const PK_FACE_t* pierceFaces);
 	bool CreateSolid(const SolidShape solidShape, const double* in_size, const double* in_offset, const double* in_dir, PK_BODY_t& body);
+	PsPrimitiveCacheStats GetPrimitiveCacheStats() const { return m_primitiveCache.GetStats(); }
+	// 0 for no limit
+	void SetPrimitiveCacheBudget(const size_t budgetBytes) { m_primitiveCache.SetBudget(budgetBytes); }
+	void ClearPrimitiveCache() { m_primitiveCache.Clear(); }
 	bool DeleteBody(const PK_BODY_t body);
 	bool DeleteFace(const int faceCnt, const PK_FACE_t* faces);
+	// The caller frees the result bodies with PK_MEMORY_free
 	bool Boolean(const PsBoolType boolType, const PK_BODY_t targetBody, const int toolCnt, const PK_BODY_t* toolBodies, int& bodyCnt, PK_BODY_t*& bodies);
+	// All the sets in one journal step, the last delta and the step gather the changes of all of them.
+	// Return false if no set succeeded
+	bool BooleanBatch(const PsBoolType boolType, const std::vector<PsBoolSet>& setArr, std::vector<PsBoolSetResult>& resultArr, PsJournalStep& step);
 	bool FR(const PsFRType frType, const PK_FACE_t face, std::vector<PK_ENTITY_t>& pkFaceArr);
+	bool FRGroups(const PsFRType frType, const PK_BODY_t body, std::vector<std::vector<PK_FACE_t>>& groupArr);
 	bool MirrorBody(const PK_BODY_t body, const double* location, const double* normal, const double isCopy, const double isMerge, PK_BODY_t& mirror_body);
 	bool GetPlaneInfo(const PK_FACE_t face, double* position, double* normal);
+	const PsTopolDelta& GetLastDelta() const { return m_lastDelta; }
+	// The body was changed out of the tracked operations (geometry index and FR groups), PK_ENTITY_null for all the bodies
+	void InvalidateFRCache(const PK_BODY_t body);
+	// Only with a thread safe Parasolid session, 0 for the number of cores
+	void SetFRWorkerCount(const unsigned int workerCnt);
+
+	// The operations between BeginGroup and EndGroup share one mark and are journaled as one step.
+	// A failed operation is still rolled back alone. EndGroup without commit rolls back the whole group,
+	// with commit the last delta gathers the changes of all the operations
+	bool BeginGroup();
+	bool EndGroup(const bool bCommit, PsJournalStep& step);
+	bool IsInGroup() const { return m_bInGroup; }
+
+	// Undo / redo of the modelling operations, the step tells which bodies have to be updated on the display
+	bool Undo(PsJournalStep& step);
+	bool Redo(PsJournalStep& step);
+	bool CanUndo() const { return m_journal.CanUndo(); }
+	bool CanRedo() const { return m_journal.CanRedo(); }
+	void ClearJournal() { m_journal.Clear(); }
+	void SetJournalSize(const size_t maxStepCnt) { m_journal.SetMaxStepCount(maxStepCnt); }
+	int GetJournalStepId() const { return m_journal.GetCurrentId(); }
+	int GetJournalOldestId() const { return m_journal.GetOldestId(); }
 };
 
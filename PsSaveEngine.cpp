@@ -0,0 +1,210 @@
+#include "stdafx.h"
+#include "PsSaveEngine.h"
+#include "PsFrustrumWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+// Small blocks are gathered up to this size before being written
+static const size_t s_writeChunk = 8 * 1024 * 1024;
+
+PsSaveEngine::PsSaveEngine() :
+	m_writtenBytes(0),
+	m_bBlock(false)
+{
+}
+
+PsSaveEngine::~PsSaveEngine()
+{
+	if (m_thread.joinable())
+		m_thread.join();
+
+	releaseBlock();
+}
+
+void PsSaveEngine::releaseBlock()
+{
+	if (m_bBlock)
+		PK_MEMORY_block_f(&m_block);
+
+	m_bBlock = false;
+}
+
+bool PsSaveEngine::Start(const int n_parts, const PK_PART_t* parts, const char* filePath, const PK_transmit_format_t format, const int version)
+{
+	if (IsRunning() || 0 >= n_parts || NULL == filePath)
+		return false;
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	releaseBlock();
+
+	auto t0 = std::chrono::steady_clock::now();
+
+	PK_PART_transmit_o_t transmit_opts;
+	PK_PART_transmit_o_m(transmit_opts);
+	transmit_opts.transmit_format = format;
+	transmit_opts.transmit_version = version;
+
+	PK_ERROR_code_t error_code = PK_PART_transmit_b(n_parts, parts, &transmit_opts, &m_block);
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+	m_bBlock = true;
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	size_t totalBytes = 0;
+	for (const PK_MEMORY_block_t* pBlock = &m_block; NULL != pBlock; pBlock = pBlock->next)
+		totalBytes += pBlock->n_bytes;
+
+	{
+		std::lock_guard<std::mutex> lock(m_statusMutex);
+		m_status = PsSaveStatus();
+		m_status.bRunning = true;
+		m_status.totalBytes = totalBytes;
+		m_status.transmitMsec = std::chrono::duration<double, std::milli>(t1 - t0).count();
+	}
+	m_writtenBytes = 0;
+
+	m_thread = std::thread(&PsSaveEngine::writeFile, this, std::string(filePath));
+
+	return true;
+}
+
+void PsSaveEngine::writeFile(const std::string filePath)
+{
+	auto t0 = std::chrono::steady_clock::now();
+
+	bool bOk = false;
+	FILE* fp = fopen(filePath.c_str(), "wb");
+	if (NULL != fp)
+	{
+		// The blocks are written as they are, the stdio buffer is not used
+		setvbuf(fp, NULL, _IONBF, 0);
+
+		std::vector<char> chunk;
+		chunk.reserve(s_writeChunk);
+
+		bOk = true;
+		for (const PK_MEMORY_block_t* pBlock = &m_block; NULL != pBlock && bOk; pBlock = pBlock->next)
+		{
+			if (s_writeChunk <= pBlock->n_bytes)
+			{
+				if (chunk.size())
+				{
+					bOk = chunk.size() == fwrite(chunk.data(), 1, chunk.size(), fp);
+					m_writtenBytes += chunk.size();
+					chunk.clear();
+				}
+
+				if (bOk)
+				{
+					bOk = pBlock->n_bytes == fwrite(pBlock->data, 1, pBlock->n_bytes, fp);
+					m_writtenBytes += pBlock->n_bytes;
+				}
+				continue;
+			}
+
+			if (s_writeChunk < chunk.size() + pBlock->n_bytes)
+			{
+				bOk = chunk.size() == fwrite(chunk.data(), 1, chunk.size(), fp);
+				m_writtenBytes += chunk.size();
+				chunk.clear();
+			}
+			chunk.insert(chunk.end(), pBlock->data, pBlock->data + pBlock->n_bytes);
+		}
+
+		if (bOk && chunk.size())
+		{
+			bOk = chunk.size() == fwrite(chunk.data(), 1, chunk.size(), fp);
+			m_writtenBytes += chunk.size();
+		}
+
+		if (0 != fclose(fp))
+			bOk = false;
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(m_statusMutex);
+	m_status.bRunning = false;
+	m_status.bSucceeded = bOk;
+	m_status.writtenBytes = m_writtenBytes;
+	m_status.writeMsec = std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+bool PsSaveEngine::Transmit(const int n_parts, const PK_PART_t* parts, const char* filePath, const PK_transmit_format_t format, const int version)
+{
+	if (IsRunning() || 0 >= n_parts || NULL == filePath)
+		return false;
+
+	if (m_thread.joinable())
+		m_thread.join();
+
+	releaseBlock();
+
+	// The frustrum is given the key, it adds the extension of the format
+	std::string key = filePath;
+	size_t dot = key.find_last_of('.');
+	if (std::string::npos != dot)
+	{
+		std::string ext = key.substr(dot);
+		std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+		if (".x_t" == ext || ".x_b" == ext || ".xmt_txt" == ext || ".xmt_bin" == ext)
+			key.erase(dot);
+	}
+
+	const size_t writtenBytes = PsFrustrumWriter::GetWrittenBytes();
+	auto t0 = std::chrono::steady_clock::now();
+
+	PK_PART_transmit_o_t transmit_opts;
+	PK_PART_transmit_o_m(transmit_opts);
+	transmit_opts.transmit_format = format;
+	transmit_opts.transmit_version = version;
+
+	PK_ERROR_code_t error_code = PK_PART_transmit(n_parts, parts, key.c_str(), &transmit_opts);
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(m_statusMutex);
+	m_status = PsSaveStatus();
+	m_status.bSucceeded = PK_ERROR_no_errors == error_code;
+	m_status.transmitMsec = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+	// Only counted by the buffered writer
+	m_status.totalBytes = PsFrustrumWriter::GetWrittenBytes() - writtenBytes;
+	m_status.writtenBytes = m_status.totalBytes;
+	m_status.writeMsec = m_status.transmitMsec;
+	m_writtenBytes = m_status.writtenBytes;
+
+	return m_status.bSucceeded;
+}
+
+bool PsSaveEngine::IsRunning() const
+{
+	std::lock_guard<std::mutex> lock(m_statusMutex);
+	return m_status.bRunning;
+}
+
+PsSaveStatus PsSaveEngine::GetStatus() const
+{
+	std::lock_guard<std::mutex> lock(m_statusMutex);
+	PsSaveStatus status = m_status;
+	if (status.bRunning)
+		status.writtenBytes = m_writtenBytes;
+
+	return status;
+}
+
+bool PsSaveEngine::Wait()
+{
+	if (m_thread.joinable())
+		m_thread.join();
+
+	// The kernel memory is given back on the modelling thread
+	releaseBlock();
+
+	return GetStatus().bSucceeded;
+}
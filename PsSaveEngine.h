@@ -0,0 +1,58 @@
+#pragma once
+#include "parasolid_kernel.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class PsSaveMode
+{
+	BACKGROUND,		// Snapshot in kernel memory, file written on a background thread
+	FRUSTRUM		// Transmit to the file through the frustrum, on the calling thread
+};
+
+// Progress of an asynchronous save
+struct PsSaveStatus
+{
+	bool bRunning = false;
+	bool bSucceeded = false;
+	size_t totalBytes = 0;
+	size_t writtenBytes = 0;
+	double transmitMsec = 0.0;	// Snapshot of the parts into memory, on the calling thread
+	double writeMsec = 0.0;		// File write, on the background thread
+
+	double Progress() const { return totalBytes ? (double)writtenBytes / (double)totalBytes : 0.0; }
+	double MBytePerSec() const { return (0.0 < writeMsec) ? ((double)writtenBytes / (1024.0 * 1024.0)) / (writeMsec / 1000.0) : 0.0; }
+};
+
+// Parts are transmitted into kernel memory blocks first, this is the consistent snapshot of the partition
+// and the only step which has to run on the modelling thread. The blocks are written to the file on a
+// background thread with large writes, the model can be edited meanwhile.
+class PsSaveEngine
+{
+public:
+	PsSaveEngine();
+	~PsSaveEngine();
+
+private:
+	std::thread m_thread;
+	mutable std::mutex m_statusMutex;
+	PsSaveStatus m_status;
+	std::atomic<size_t> m_writtenBytes;
+	PK_MEMORY_block_t m_block;
+	bool m_bBlock;
+
+	void writeFile(const std::string filePath);
+	void releaseBlock();
+
+public:
+	// Return false if a save is running or the transmit failed
+	bool Start(const int n_parts, const PK_PART_t* parts, const char* filePath, const PK_transmit_format_t format, const int version);
+	// No snapshot in memory, for the partitions too large to be held twice. The writes of the frustrum
+	// are gathered when PsFrustrumWriter wraps it
+	bool Transmit(const int n_parts, const PK_PART_t* parts, const char* filePath, const PK_transmit_format_t format, const int version);
+	bool IsRunning() const;
+	PsSaveStatus GetStatus() const;
+	// Wait the end of the running save, return its result
+	bool Wait();
+};
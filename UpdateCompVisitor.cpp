@@ -6,29 +6,75 @@ SearchCompIdVisitor::SearchCompIdVisitor(A3DVisitorContainer* psContainer, std::
 	, m_iRiBrepId(0)
 	, m_iPOId(0)
 {
+	// Only one entry per component is effective: a delete wins over updates, otherwise the latest update
+	for (size_t i = 0; i < m_updatedComp.size(); i++)
+	{
+		m_updatedComp[i].iCompId = -1;
+
+		auto it = m_entityMap.find(m_updatedComp[i].pTargetComp);
+		if (m_entityMap.end() == it)
+			m_entityMap[m_updatedComp[i].pTargetComp] = i;
+		else if (UpdatedType::UPDATE == m_updatedComp[it->second].updateType)
+			it->second = i;
+	}
 }
 
 SearchCompIdVisitor::~SearchCompIdVisitor()
 {
 }
 
-A3DStatus SearchCompIdVisitor::visitLeave(const A3DRiBrepModelConnector& sConnector)
+A3DStatus SearchCompIdVisitor::visitEnter(const A3DProductOccurrenceConnector& sConnector)
 {
-	A3DStatus iRet = A3D_SUCCESS;
+	A3DStatus iRet = A3DTreeVisitor::visitEnter(sConnector);
 
-	A3DRiBrepModel* pRiBrepModel = (A3DRiBrepModel*)sConnector.GetA3DEntity();
+	A3DAsmProductOccurrence* pPO = (A3DAsmProductOccurrence*)sConnector.GetA3DEntity();
+
+	int iPoId = m_iPOId++;
 
-	A3DRiBrepModelData sData = sConnector.m_sRiBrepModelData;
+	UpdatePlanPONode node = { 0, 0, false, false };
+	m_plan.poNodeArr.push_back(node);
 
-	int iTarget = -1;
-	for (A3DUns32 ui = 0; ui < m_updatedComp.size(); ui++)
+	A3DAsmPartDefinition* pPart = A3D_NULL_HANDLE;
+	sConnector.GetPart(pPart);
+	m_poPartArr.push_back(pPart);
+
+	auto it = m_entityMap.find(pPO);
+	if (m_entityMap.end() != it)
 	{
-		if (m_updatedComp[ui].pTargetComp == pRiBrepModel)
+		m_updatedComp[it->second].iCompId = iPoId;
+
+		if (UpdatedType::DELEATE_PART == m_updatedComp[it->second].updateType)
 		{
-			m_updatedComp[ui].iCompId = m_iRiBrepId;
+			m_plan.deletePOSet.insert(iPoId);
+
+			// The father PO removes it
+			if (m_poStack.size())
+				m_plan.poNodeArr[m_poStack.back()].bDirty = true;
 		}
 	}
 
+	m_poStack.push_back(iPoId);
+	m_riBrepStartArr.push_back(m_iRiBrepId);
+
+	return iRet;
+}
+
+A3DStatus SearchCompIdVisitor::visitLeave(const A3DRiBrepModelConnector& sConnector)
+{
+	A3DStatus iRet = A3D_SUCCESS;
+
+	A3DRiBrepModel* pRiBrepModel = (A3DRiBrepModel*)sConnector.GetA3DEntity();
+
+	auto it = m_entityMap.find(pRiBrepModel);
+	if (m_entityMap.end() != it)
+	{
+		m_updatedComp[it->second].iCompId = m_iRiBrepId;
+		m_plan.riBrepMap[m_iRiBrepId] = it->second;
+
+		if (m_poStack.size())
+			m_plan.poNodeArr[m_poStack.back()].bDirty = true;
+	}
+
 	m_iRiBrepId++;
 
 	iRet = A3DTreeVisitor::visitLeave(sConnector);
@@ -39,24 +85,52 @@ A3DStatus SearchCompIdVisitor::visitLeave(const A3DProductOccurrenceConnector& s
 {
 	A3DStatus iRet = A3D_SUCCESS;
 
-	A3DAsmProductOccurrence* pPO = (A3DAsmProductOccurrence*)sConnector.GetA3DEntity();
+	int iPoId = m_poStack.back();
+	m_poStack.pop_back();
 
-	for (A3DUns32 ui = 0; ui < m_updatedComp.size(); ui++)
-	{
-		if (m_updatedComp[ui].pTargetComp == pPO)
-		{
-			m_updatedComp[ui].iCompId = m_iPOId;
-		}
-	}
-	m_iPOId++;
+	UpdatePlanPONode& node = m_plan.poNodeArr[iPoId];
+	node.iPOCnt = m_iPOId - iPoId;
+	node.iRiBrepCnt = m_iRiBrepId - m_riBrepStartArr.back();
+	m_riBrepStartArr.pop_back();
+
+	if (node.bDirty && m_poStack.size())
+		m_plan.poNodeArr[m_poStack.back()].bDirty = true;
 
 	iRet = A3DTreeVisitor::visitLeave(sConnector);
 	return iRet;
 }
 
-UpdatedCompVisitor::UpdatedCompVisitor(A3DVisitorContainer* psContainer, std::vector<UpdatedComponent> updatedRiBrepArr)
+UpdatePlan SearchCompIdVisitor::GetUpdatePlan() const
+{
+	UpdatePlan plan = m_plan;
+
+	// A part referenced from several POs is traversed only at its first occurrence,
+	// so a subtree containing it can't be skipped without shifting the running ids
+	std::unordered_map<A3DAsmPartDefinition*, int> partRefCnt;
+	for (size_t i = 0; i < m_poPartArr.size(); i++)
+	{
+		if (A3D_NULL_HANDLE != m_poPartArr[i])
+			partRefCnt[m_poPartArr[i]]++;
+	}
+
+	// PO ids are given in pre-order, a subtree is the id range [iPoId, iPoId + iPOCnt)
+	std::vector<int> sharedSum(m_poPartArr.size() + 1, 0);
+	for (size_t i = 0; i < m_poPartArr.size(); i++)
+	{
+		bool bShared = A3D_NULL_HANDLE != m_poPartArr[i] && 1 < partRefCnt[m_poPartArr[i]];
+		sharedSum[i + 1] = sharedSum[i] + (bShared ? 1 : 0);
+	}
+
+	for (size_t i = 0; i < plan.poNodeArr.size(); i++)
+		plan.poNodeArr[i].bShared = sharedSum[i] != sharedSum[i + plan.poNodeArr[i].iPOCnt];
+
+	return plan;
+}
+
+UpdatedCompVisitor::UpdatedCompVisitor(A3DVisitorContainer* psContainer, std::vector<UpdatedComponent> updatedRiBrepArr, const UpdatePlan& plan)
 	: A3DTreeVisitor(psContainer)
 	, m_updatedComp(updatedRiBrepArr)
+	, m_plan(plan)
 	, m_iRiBrepId(0)
 	, m_iPoId(0)
 {
@@ -72,15 +146,19 @@ A3DStatus UpdatedCompVisitor::visitEnter(const A3DProductOccurrenceConnector& sC
 
 	A3DAsmProductOccurrence* pPO = (A3DAsmProductOccurrence*)sConnector.GetA3DEntity();
 
-	for (A3DUns32 ui = 0; ui < m_updatedComp.size(); ui++)
+	int iPoId = m_iPoId++;
+
+	if (m_plan.deletePOSet.count(iPoId))
+		m_targetPOSet.insert(pPO);
+
+	if (m_plan.CanSkip(iPoId))
 	{
-		if (UpdatedType::DELEATE_PART == m_updatedComp[ui].updateType)
-		{
-			if (m_iPoId == m_updatedComp[ui].iCompId)
-			{
-				m_targetPOArr.push_back(pPO);
-			}
-		}
+		// Nothing to update under this PO, advance the running ids as if it was traversed
+		const UpdatePlanPONode& node = m_plan.poNodeArr[iPoId];
+		m_iPoId += node.iPOCnt - 1;
+		m_iRiBrepId += node.iRiBrepCnt;
+
+		m_psContainer->SetSkipSons(true);
 	}
 
 	return iRet;
@@ -90,9 +168,7 @@ A3DStatus UpdatedCompVisitor::visitEnter(const A3DPartConnector& sConnector)
 {
 	A3DStatus iRet = A3DTreeVisitor::visitEnter(sConnector);
 
-	m_targetRiBrep.clear();
-	m_newRiBrepArr.clear();
-	m_iDeletedCnt = 0;
+	m_targetRiBrepMap.clear();
 
 	return iRet;
 }
@@ -103,22 +179,15 @@ A3DStatus UpdatedCompVisitor::visitLeave(const A3DRiBrepModelConnector& sConnect
 
 	A3DRiBrepModel* pRiBrepModel = (A3DRiBrepModel*)sConnector.GetA3DEntity();
 
-	for (A3DUns32 ui = 0; ui < m_updatedComp.size(); ui++)
+	auto it = m_plan.riBrepMap.find(m_iRiBrepId);
+	if (m_plan.riBrepMap.end() != it)
 	{
-		if (m_iRiBrepId == m_updatedComp[ui].iCompId)
-		{
-			m_targetRiBrep.push_back(pRiBrepModel);
+		const UpdatedComponent& updatedComp = m_updatedComp[it->second];
 
-			if (UpdatedType::UPDATE == m_updatedComp[ui].updateType)
-			{
-				m_newRiBrepArr.push_back(m_updatedComp[ui].pNewRiBrep);
-			}
-			else
-			{
-				m_iDeletedCnt++;
-				m_newRiBrepArr.push_back(NULL);
-			}
-		}
+		if (UpdatedType::UPDATE == updatedComp.updateType)
+			m_targetRiBrepMap[pRiBrepModel] = updatedComp.pNewRiBrep;
+		else
+			m_targetRiBrepMap[pRiBrepModel] = NULL;
 	}
 
 	m_iRiBrepId++;
@@ -127,23 +196,31 @@ A3DStatus UpdatedCompVisitor::visitLeave(const A3DRiBrepModelConnector& sConnect
 	return iRet;
 }
 
+bool UpdatedCompVisitor::replaceRepItem(A3DRiRepresentationItem* pRiItem, std::vector<A3DRiRepresentationItem*>& pRepItemArr)
+{
+	auto it = m_targetRiBrepMap.find(pRiItem);
+	if (m_targetRiBrepMap.end() == it)
+	{
+		pRepItemArr.push_back(pRiItem);
+		return false;
+	}
+
+	// Deleted body is just not added
+	if (NULL != it->second)
+		pRepItemArr.push_back(it->second);
+
+	return true;
+}
+
 A3DStatus UpdatedCompVisitor::visitLeave(const A3DPartConnector& sConnector)
 {
 	A3DStatus iRet = A3D_SUCCESS;
 
 	A3DAsmPartDefinition* pPart = (A3DAsmPartDefinition*)sConnector.GetA3DEntity();
 
-	A3DAsmProductOccurrence* pPO = (A3DAsmProductOccurrence*)sConnector.GetProductOccurrenceFather();
-	A3DRootBaseData sBaseData;
-	A3D_INITIALIZE_DATA(A3DRootBaseData, sBaseData);
-	A3DRootBaseGet(pPO, &sBaseData);
-
 	A3DAsmPartDefinitionData sData = sConnector.m_sPartData;
 
-	// kA3DTypeRiBrepModel
-
-
-	if (m_targetRiBrep.size())
+	if (m_targetRiBrepMap.size())
 	{
 		std::vector<A3DRiRepresentationItem*> pRepItemArr;
 		for (A3DUns32 ui = 0; ui < sData.m_uiRepItemsSize; ui++)
@@ -155,20 +232,7 @@ A3DStatus UpdatedCompVisitor::visitLeave(const A3DPartConnector& sConnector)
 
 			if (kA3DTypeRiBrepModel == eType)
 			{
-				bool bFlg = false;
-				for (A3DUns32 uj = 0; uj < m_targetRiBrep.size(); uj++)
-				{
-					if (sData.m_ppRepItems[ui] == m_targetRiBrep[uj])
-					{
-						if (NULL != m_newRiBrepArr[uj])
-							pRepItemArr.push_back(m_newRiBrepArr[uj]);
-
-						bFlg = true;
-						break;
-					}
-				}
-				if (!bFlg)
-					pRepItemArr.push_back(pRiItem);
+				replaceRepItem(pRiItem, pRepItemArr);
 			}
 			else if (kA3DTypeRiSet == eType)
 			{
@@ -180,19 +244,8 @@ A3DStatus UpdatedCompVisitor::visitLeave(const A3DPartConnector& sConnector)
 				bool bSubFlg = false;
 				for (A3DUns32 uk = 0; uk < sSetData.m_uiRepItemsSize; uk++)
 				{
-					for (A3DUns32 uj = 0; uj < m_targetRiBrep.size(); uj++)
-					{
-						if (sSetData.m_ppRepItems[uk] == m_targetRiBrep[uj])
-						{
-							if (NULL != m_newRiBrepArr[uj])
-								pSucRepItemArr.push_back(m_newRiBrepArr[uj]);
-
-							bSubFlg = true;
-							break;
-						}
-					}
-					if (!bSubFlg)
-						pSucRepItemArr.push_back(sSetData.m_ppRepItems[uk]);
+					if (replaceRepItem(sSetData.m_ppRepItems[uk], pSucRepItemArr))
+						bSubFlg = true;
 				}
 
 				if (bSubFlg)
@@ -203,6 +256,10 @@ A3DStatus UpdatedCompVisitor::visitLeave(const A3DPartConnector& sConnector)
 				}
 				pRepItemArr.push_back(pRiItem);
 			}
+			else
+			{
+				pRepItemArr.push_back(pRiItem);
+			}
 		}
 
 		sData.m_uiRepItemsSize = pRepItemArr.size();
@@ -222,33 +279,24 @@ A3DStatus UpdatedCompVisitor::visitLeave(const A3DProductOccurrenceConnector& sC
 	A3DAsmProductOccurrence* pPO = (A3DAsmProductOccurrence*)sConnector.GetA3DEntity();
 	A3DAsmProductOccurrenceData sData = sConnector.m_sProductOccurrenceData;
 
-	std::vector<A3DAsmProductOccurrence*> pNewPOArr;
-	for (A3DUns32 ui = 0; ui < sData.m_uiPOccurrencesSize; ui++)
+	if (m_targetPOSet.size())
 	{
-		bool bFlg = false;
-		for (A3DUns32 uj = 0; uj < m_targetPOArr.size(); uj++)
+		std::vector<A3DAsmProductOccurrence*> pNewPOArr;
+		for (A3DUns32 ui = 0; ui < sData.m_uiPOccurrencesSize; ui++)
 		{
-			if (sData.m_ppPOccurrences[ui] == m_targetPOArr[uj])
-			{
-				bFlg = true;
-				break;
-			}
-
+			if (0 == m_targetPOSet.count(sData.m_ppPOccurrences[ui]))
+				pNewPOArr.push_back(sData.m_ppPOccurrences[ui]);
 		}
-		if (!bFlg)
-			pNewPOArr.push_back(sData.m_ppPOccurrences[ui]);
-	}
 
-	if (pNewPOArr.size() < sData.m_uiPOccurrencesSize)
-	{
-		sData.m_uiPOccurrencesSize = pNewPOArr.size();
-		sData.m_ppPOccurrences = pNewPOArr.data();
+		if (pNewPOArr.size() < sData.m_uiPOccurrencesSize)
+		{
+			sData.m_uiPOccurrencesSize = pNewPOArr.size();
+			sData.m_ppPOccurrences = pNewPOArr.data();
 
-		iRet = A3DAsmProductOccurrenceEdit(&sData, pPO);
+			iRet = A3DAsmProductOccurrenceEdit(&sData, pPO);
+		}
 	}
 
-	m_iPoId++;
-
 	iRet = A3DTreeVisitor::visitLeave(sConnector);
 	return iRet;
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "visitor/VisitorTree.h"
+#include <unordered_map>
+#include <unordered_set>
 
 enum UpdatedType
 {
@@ -12,10 +14,35 @@ struct UpdatedComponent
 	A3DEntity* pTargetComp;
 	int body;
 	UpdatedType updateType;
-	int iCompId;
+	int iCompId;	// Running id found by SearchCompIdVisitor, -1 if the entry has no effect
 	A3DRiBrepModel* pNewRiBrep;
 };
 
+struct UpdatePlanPONode
+{
+	int iPOCnt;			// POs of the subtree including itself
+	int iRiBrepCnt;		// RiBrepModels traversed in the subtree
+	bool bDirty;		// The subtree has a pending update or delete
+	bool bShared;		// The subtree has a part which is also referenced from another PO
+};
+
+// Pending actions indexed by running node id, built once by SearchCompIdVisitor
+struct UpdatePlan
+{
+	std::unordered_map<int, size_t> riBrepMap;	// RiBrep id => index of the updated component array
+	std::unordered_set<int> deletePOSet;			// PO ids to be removed from their father
+	std::vector<UpdatePlanPONode> poNodeArr;		// Indexed by PO id
+
+	// The subtree can be skipped while the running ids stay in sync with the search traversal
+	bool CanSkip(int iPoId) const
+	{
+		if (iPoId < 0 || (int)poNodeArr.size() <= iPoId)
+			return false;
+
+		return !poNodeArr[iPoId].bDirty && !poNodeArr[iPoId].bShared;
+	}
+};
+
 class SearchCompIdVisitor :
 	public A3DTreeVisitor
 {
@@ -26,30 +53,37 @@ public:
 private:
 	int m_iRiBrepId;
 	int m_iPOId;
+	std::unordered_map<A3DEntity*, size_t> m_entityMap;	// Target => effective entry of m_updatedComp
+	std::vector<int> m_poStack;
+	std::vector<int> m_riBrepStartArr;
+	std::vector<A3DAsmPartDefinition*> m_poPartArr;
+	UpdatePlan m_plan;
 
 public:
 	std::vector<UpdatedComponent> m_updatedComp;
+	virtual A3DStatus visitEnter(const A3DProductOccurrenceConnector& sConnector) override;
 	virtual A3DStatus visitLeave(const A3DRiBrepModelConnector& sConnector) override;
 	virtual A3DStatus visitLeave(const A3DProductOccurrenceConnector& sConnector) override;
 
+	UpdatePlan GetUpdatePlan() const;
 };
 
 class UpdatedCompVisitor :
 	public A3DTreeVisitor
 {
 public:
-	UpdatedCompVisitor(A3DVisitorContainer* psContainer, std::vector<UpdatedComponent> updatedRiBrepArr);
+	UpdatedCompVisitor(A3DVisitorContainer* psContainer, std::vector<UpdatedComponent> updatedRiBrepArr, const UpdatePlan& plan);
 	~UpdatedCompVisitor();
 
 private:
 	std::vector<UpdatedComponent> m_updatedComp;
-	std::vector<A3DRiBrepModel*> m_targetRiBrep;
-	std::vector<A3DRiBrepModel*> m_newRiBrepArr;
-	std::vector<A3DRiBrepModel*> m_emptyPartArr;
+	UpdatePlan m_plan;
+	std::unordered_map<A3DRiRepresentationItem*, A3DRiBrepModel*> m_targetRiBrepMap;	// Target => new RiBrep (NULL: delete)
 	int m_iRiBrepId;
-	int m_iDeletedCnt;
 	int m_iPoId;
-	std::vector<A3DAsmProductOccurrence*> m_targetPOArr;
+	std::unordered_set<A3DAsmProductOccurrence*> m_targetPOSet;
+
+	bool replaceRepItem(A3DRiRepresentationItem* pRiItem, std::vector<A3DRiRepresentationItem*>& pRepItemArr);
 
 public:
 	virtual A3DStatus visitEnter(const A3DProductOccurrenceConnector& sConnector) override;
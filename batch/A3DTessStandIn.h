@@ -0,0 +1,148 @@
+#pragma once
+// A3D tessellation types, structures and functions used by visitor/TessConnector, for the builds without HOOPS Exchange (A3D_TESS_STANDIN).
+// The layouts and flag values follow A3DSDKTessellation.h, a tessellation is its two data structures given by the caller.
+#include <stddef.h>
+#include <string.h>
+
+typedef unsigned char A3DUns8;
+typedef unsigned short A3DUns16;
+typedef unsigned int A3DUns32;
+typedef bool A3DBool;
+typedef double A3DDouble;
+typedef int A3DStatus;
+typedef int A3DEEntityType;
+typedef void A3DEntity;
+typedef void A3DTessBase;
+typedef void A3DTess3D;
+typedef void A3DTess3DWire;
+
+#define A3D_SUCCESS 0
+#define A3D_ERROR -1
+#define A3D_NULL_HANDLE 0
+#define kA3DTypeUnknown 0
+
+#define kA3DTessFaceDataTriangle							0x0001
+#define kA3DTessFaceDataTriangleFan							0x0002
+#define kA3DTessFaceDataTriangleStripe						0x0004
+#define kA3DTessFaceDataTriangleOneNormal					0x0008
+#define kA3DTessFaceDataTriangleFanOneNormal				0x0010
+#define kA3DTessFaceDataTriangleStripeOneNormal				0x0020
+#define kA3DTessFaceDataTriangleTextured					0x0040
+#define kA3DTessFaceDataTriangleFanTextured					0x0080
+#define kA3DTessFaceDataTriangleStripeTextured				0x0100
+#define kA3DTessFaceDataTriangleOneNormalTextured			0x0200
+#define kA3DTessFaceDataTriangleFanOneNormalTextured		0x0400
+#define kA3DTessFaceDataTriangleStripeOneNormalTextured		0x0800
+
+#define kA3DTessFaceDataWireIsNotDrawn						0x4000
+#define kA3DTessFaceDataWireIsClosing						0x8000
+#define kA3DTessFaceDataNormalSingle						0x40000000
+#define kA3DTessFaceDataNormalMask							0x3FFFFFFF
+
+#define A3D_INITIALIZE_DATA(type, data) { memset(&(data), 0, sizeof(type)); (data).m_usStructSize = (A3DUns16)sizeof(type); }
+
+struct A3DTessBaseData
+{
+	A3DUns16 m_usStructSize;
+	A3DBool m_bIsCalculated;
+	A3DUns32 m_uiCoordSize;
+	A3DDouble* m_pdCoords;
+};
+
+struct A3DTessFaceData
+{
+	A3DUns16 m_usStructSize;
+	A3DUns32 m_uiStyleIndexesSize;
+	A3DUns32* m_puiStyleIndexes;
+	A3DUns32 m_uiStartTriangulated;
+	A3DUns32 m_uiSizesTriangulatedSize;
+	A3DUns32* m_puiSizesTriangulated;
+	A3DUns32 m_uiStartWire;
+	A3DUns32 m_uiSizesWiresSize;
+	A3DUns32* m_puiSizesWires;
+	A3DUns16 m_usUsedEntitiesFlags;
+	A3DUns32 m_uiTextureCoordIndexesSize;
+	A3DUns32 m_uiBehaviour;
+	A3DBool m_bIsRGBA;
+	A3DUns32 m_uiRGBAVerticesSize;
+	A3DUns8* m_pucRGBAVertices;
+};
+
+struct A3DTess3DData
+{
+	A3DUns16 m_usStructSize;
+	A3DUns32 m_uiNormalSize;
+	A3DDouble* m_pdNormals;
+	A3DUns32 m_uiWireIndexSize;
+	A3DUns32* m_puiWireIndexes;
+	A3DUns32 m_uiTriangulatedIndexSize;
+	A3DUns32* m_puiTriangulatedIndexes;
+	A3DUns32 m_uiFaceTessSize;
+	A3DTessFaceData* m_psFaceTessData;
+	A3DUns32 m_uiTextureCoordSize;
+	A3DDouble* m_pdTextureCoords;
+	A3DBool m_bHasFaces;
+	A3DBool m_bHasLoops;
+	A3DBool m_bMustRecalculateNormals;
+	A3DUns8 m_ucNormalsRecalculationFlags;
+	A3DDouble m_dCreaseAngle;
+};
+
+struct A3DTess3DWireData
+{
+	A3DUns16 m_usStructSize;
+	A3DUns32 m_uiSizesWiresSize;
+	A3DUns32* m_puiSizesWires;
+	A3DBool m_bIsRGBA;
+	A3DBool m_bIsSegmentColor;
+	A3DUns32 m_uiRGBAVerticesSize;
+	A3DUns8* m_pucRGBAVertices;
+};
+
+// What the handles of the stand-in point to
+struct A3DTessStandIn
+{
+	A3DTessBaseData m_sBaseData;
+	A3DTess3DData m_s3DData;
+	A3DTess3DWireData m_sWireData;
+};
+
+// The data stays owned by the A3DTessStandIn, a NULL handle only resets the structure
+inline A3DStatus A3DTessBaseGet(const A3DTessBase* pTess, A3DTessBaseData* pData)
+{
+	if (A3D_NULL_HANDLE == pTess)
+		A3D_INITIALIZE_DATA(A3DTessBaseData, *pData)
+	else
+		*pData = ((const A3DTessStandIn*)pTess)->m_sBaseData;
+	return A3D_SUCCESS;
+}
+
+inline A3DStatus A3DTess3DGet(const A3DTess3D* pTess, A3DTess3DData* pData)
+{
+	if (A3D_NULL_HANDLE == pTess)
+		A3D_INITIALIZE_DATA(A3DTess3DData, *pData)
+	else
+		*pData = ((const A3DTessStandIn*)pTess)->m_s3DData;
+	return A3D_SUCCESS;
+}
+
+inline A3DStatus A3DTess3DWireGet(const A3DTess3DWire* pTess, A3DTess3DWireData* pData)
+{
+	if (A3D_NULL_HANDLE == pTess)
+		A3D_INITIALIZE_DATA(A3DTess3DWireData, *pData)
+	else
+		*pData = ((const A3DTessStandIn*)pTess)->m_sWireData;
+	return A3D_SUCCESS;
+}
+
+// The connectors are traversed by the visitors of the application only
+class A3DVisitorContainer
+{
+public:
+	template <class T> A3DStatus visitEnter(const T&) { return A3D_SUCCESS; }
+	template <class T> A3DStatus visitLeave(const T&) { return A3D_SUCCESS; }
+};
+
+#ifndef CHECK_RET
+#define CHECK_RET(function) { if ((iRet = function)!=A3D_SUCCESS) { return iRet; }}
+#endif
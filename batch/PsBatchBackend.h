@@ -0,0 +1,41 @@
+#pragma once
+#include "PsBatchJournal.h"
+#include <string>
+#include <time.h>
+
+struct PsBatchOpResult
+{
+	bool bSucceeded = false;
+	double kernelMsec = 0.0;		// Wall time of the kernel call alone
+	double cpuMsec = 0.0;			// Process CPU time of the kernel call, all the threads
+	unsigned long long allocCnt = 0;	// Kernel arrays of the call (memory pool scope)
+	long long peakBytes = 0;
+	int releasedCnt = 0;			// Arrays left by the call, released by the scope
+	int bodyCnt = 0;				// Alive bodies after the operation
+	int faceCnt = 0;
+	int resultCnt = 0;				// Faces found by FR, groups of FR groups, bodies made
+	std::string message;
+};
+
+// Kernel the journal is run against
+class PsBatchBackend
+{
+public:
+	virtual ~PsBatchBackend() {}
+
+	virtual const char* GetName() const = 0;
+	virtual bool Start(std::string& error) = 0;
+	virtual void Stop() = 0;
+	virtual bool Run(const PsBatchOp& op, PsBatchOpResult& result) = 0;
+};
+
+// NULL when the runner is built without the Parasolid kernel
+PsBatchBackend* PsBatchCreateKernelBackend();
+PsBatchBackend* PsBatchCreateStandInBackend();
+
+inline double PsBatchCpuMsec()
+{
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1.0e6;
+}
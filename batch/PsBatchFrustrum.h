@@ -0,0 +1,19 @@
+#pragma once
+// Entry points of the frustrum linked with the runner, PS_FRUSTRUM_SOURCE (the sample frustrum of the Parasolid SDK)
+
+extern "C"
+{
+	void FSTART(int* ifail);
+	void FABORT(int* ifail);
+	void FSTOP(int* ifail);
+	void FMALLO(int* nbytes, char** memory, int* ifail);
+	void FMFREE(int* nbytes, char** memory, int* ifail);
+	void FFOPRD(const int* guise, const int* format, const char* name, const int* namlen, const int* skiphd, int* strid, int* ifail);
+	void FFOPWR(const int* guise, const int* format, const char* name, const int* namlen, const char* pd2hdr, const int* pd2len, int* strid, int* ifail);
+	void FFCLOS(const int* guise, const int* strid, const int* action, int* ifail);
+	void FFREAD(const int* guise, const int* strid, const int* nmax, char* buffer, int* nactual, int* ifail);
+	void FFWRIT(const int* guise, const int* strid, const int* nchars, const char* buffer, int* ifail);
+	void FFOPRB(const int* guise, const int* minsiz, const int* maxsiz, int* actsiz, int* strid, int* ifail);
+	void FFSEEK(const int* guise, const int* strid, const int* pos, int* ifail);
+	void FFTELL(const int* guise, const int* strid, int* pos, int* ifail);
+}
@@ -0,0 +1,273 @@
+#include "PsBatchJournal.h"
+#include <fstream>
+#include <sstream>
+
+static int stFindWord(const std::string& word, const char* const* words, const int wordCnt)
+{
+	for (int i = 0; i < wordCnt; i++)
+	{
+		if (word == words[i])
+			return i;
+	}
+
+	return -1;
+}
+
+static bool stReadInts(std::istringstream& iss, std::vector<int>& valueArr)
+{
+	int value;
+	while (iss >> value)
+		valueArr.push_back(value);
+
+	return iss.eof();
+}
+
+static bool stParseLine(const std::string& keyword, std::istringstream& iss, PsBatchOp& op, std::string& error)
+{
+	// Same order as PsBoolType, SolidShape and PsFRType
+	static const char* const boolWords[] = { "unite", "subtract", "intersect" };
+	static const char* const shapeWords[] = { "block", "cylinder", "cone", "sphere", "spring" };
+	static const int shapeSizeCnt[] = { 3, 2, 3, 1, 4 };
+	static const char* const frWords[] = { "boss", "concentric", "coplanar" };
+
+	std::string word;
+	double value;
+
+	if ("load" == keyword)
+	{
+		op.type = PsBatchOpType::LOAD;
+		std::getline(iss >> std::ws, op.path);
+		if (op.path.empty())
+		{
+			error = "missing file";
+			return false;
+		}
+	}
+	else if ("blend" == keyword)
+	{
+		op.type = PsBatchOpType::BLEND;
+		if (!(iss >> value >> op.body) || !stReadInts(iss, op.entities) || op.entities.empty())
+		{
+			error = "expected <radius> <body> <edge>...";
+			return false;
+		}
+		op.values.push_back(value);
+	}
+	else if ("chamfer" == keyword)
+	{
+		op.type = PsBatchOpType::CHAMFER;
+		double value2;
+		if (!(iss >> value >> value2 >> op.body) || !stReadInts(iss, op.entities) || op.entities.empty() || op.entities.size() % 2)
+		{
+			error = "expected <distance1> <distance2> <body> <edge> <face>...";
+			return false;
+		}
+		op.values.push_back(value);
+		op.values.push_back(value2);
+	}
+	else if ("hollow" == keyword)
+	{
+		op.type = PsBatchOpType::HOLLOW;
+		if (!(iss >> value >> op.body) || !stReadInts(iss, op.entities))
+		{
+			error = "expected <thickness> <body> <face>...";
+			return false;
+		}
+		op.values.push_back(value);
+	}
+	else if ("boolean" == keyword)
+	{
+		op.type = PsBatchOpType::BOOLEAN;
+		if (!(iss >> word) || 0 > (op.subType = stFindWord(word, boolWords, 3)) ||
+			!(iss >> op.body) || !stReadInts(iss, op.bodies) || op.bodies.empty())
+		{
+			error = "expected unite|subtract|intersect <target> <tool>...";
+			return false;
+		}
+	}
+	else if ("boolean_batch" == keyword)
+	{
+		op.type = PsBatchOpType::BOOLEAN_BATCH;
+		int target;
+		if (iss >> word)
+			op.subType = stFindWord(word, boolWords, 3);
+		while (iss >> target)
+			op.targets.push_back(target);
+		iss.clear();
+
+		if (0 > op.subType || op.targets.empty() || !(iss >> word) || "with" != word || !stReadInts(iss, op.bodies) || op.bodies.empty())
+		{
+			error = "expected unite|subtract|intersect <target>... with <tool>...";
+			return false;
+		}
+	}
+	else if ("mirror" == keyword)
+	{
+		op.type = PsBatchOpType::MIRROR;
+		int face;
+		if (!(iss >> op.body >> face))
+		{
+			error = "expected <body> <planar face> [copy] [merge]";
+			return false;
+		}
+		op.entities.push_back(face);
+
+		while (iss >> word)
+		{
+			if ("copy" == word)
+				op.bCopy = true;
+			else if ("merge" == word)
+				op.bMerge = true;
+			else
+			{
+				error = "unknown mirror option " + word;
+				return false;
+			}
+		}
+	}
+	else if ("delete_face" == keyword)
+	{
+		op.type = PsBatchOpType::DELETE_FACE;
+		if (!(iss >> op.body) || !stReadInts(iss, op.entities) || op.entities.empty())
+		{
+			error = "expected <body> <face>...";
+			return false;
+		}
+	}
+	else if ("create_solid" == keyword)
+	{
+		op.type = PsBatchOpType::CREATE_SOLID;
+		if (!(iss >> word) || 0 > (op.subType = stFindWord(word, shapeWords, 5)))
+		{
+			error = "expected block|cylinder|cone|sphere|spring";
+			return false;
+		}
+
+		for (int i = 0; i < shapeSizeCnt[op.subType]; i++)
+		{
+			if (!(iss >> value))
+			{
+				error = "missing size of " + word;
+				return false;
+			}
+			op.values.push_back(value);
+		}
+
+		while (iss >> word)
+		{
+			double* pVect = ("at" == word) ? op.offset : ("dir" == word) ? op.dir : NULL;
+			if (NULL == pVect || !(iss >> pVect[0] >> pVect[1] >> pVect[2]))
+			{
+				error = "expected [at <x> <y> <z>] [dir <x> <y> <z>]";
+				return false;
+			}
+		}
+	}
+	else if ("fr" == keyword || "fr_groups" == keyword)
+	{
+		op.type = ("fr" == keyword) ? PsBatchOpType::FR : PsBatchOpType::FR_GROUPS;
+		if (!(iss >> word) || 0 > (op.subType = stFindWord(word, frWords, 3)) || !(iss >> op.body))
+		{
+			error = "expected boss|concentric|coplanar <body>";
+			return false;
+		}
+
+		if (PsBatchOpType::FR == op.type)
+		{
+			int face;
+			if (!(iss >> face))
+			{
+				error = "missing seed face";
+				return false;
+			}
+			op.entities.push_back(face);
+		}
+	}
+	else if ("undo" == keyword)
+	{
+		op.type = PsBatchOpType::UNDO;
+	}
+	else if ("redo" == keyword)
+	{
+		op.type = PsBatchOpType::REDO;
+	}
+	else if ("group" == keyword)
+	{
+		op.type = PsBatchOpType::GROUP;
+	}
+	else if ("end_group" == keyword)
+	{
+		op.type = PsBatchOpType::END_GROUP;
+	}
+	else if ("save" == keyword)
+	{
+		op.type = PsBatchOpType::SAVE;
+		if (!(iss >> op.path))
+		{
+			error = "missing file";
+			return false;
+		}
+
+		// Written in background by default
+		if (iss >> word)
+		{
+			if ("frustrum" != word)
+			{
+				error = "expected frustrum after the file";
+				return false;
+			}
+			op.subType = 1;
+		}
+	}
+	else
+	{
+		error = "unknown operation " + keyword;
+		return false;
+	}
+
+	if (iss >> word)
+	{
+		error = "unexpected " + word;
+		return false;
+	}
+
+	return true;
+}
+
+bool PsBatchReadJournal(const char* filePath, std::vector<PsBatchOp>& opArr, std::string& error)
+{
+	std::ifstream ifs(filePath);
+	if (!ifs)
+	{
+		error = std::string("cannot open ") + filePath;
+		return false;
+	}
+
+	std::string line;
+	for (int lineNo = 1; std::getline(ifs, line); lineNo++)
+	{
+		size_t comment = line.find('#');
+		if (std::string::npos != comment)
+			line.erase(comment);
+
+		std::istringstream iss(line);
+		std::string keyword;
+		if (!(iss >> keyword))
+			continue;
+
+		PsBatchOp op;
+		op.line = lineNo;
+		op.name = keyword;
+
+		std::string lineError;
+		if (!stParseLine(keyword, iss, op, lineError))
+		{
+			error = std::string(filePath) + ":" + std::to_string(lineNo) + ": " + lineError;
+			return false;
+		}
+
+		opArr.push_back(op);
+	}
+
+	return true;
+}
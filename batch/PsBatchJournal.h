@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+
+enum class PsBatchOpType
+{
+	LOAD,
+	BLEND,
+	CHAMFER,
+	HOLLOW,
+	BOOLEAN,
+	BOOLEAN_BATCH,
+	MIRROR,
+	DELETE_FACE,
+	CREATE_SOLID,
+	FR,
+	FR_GROUPS,
+	UNDO,
+	REDO,
+	SAVE,
+	GROUP,
+	END_GROUP
+};
+
+// One line of the journal. Bodies are numbered from 0 in the order they appear (loaded, created,
+// extra pieces of a Boolean, mirror copies), faces and edges in the order the body returns them
+struct PsBatchOp
+{
+	PsBatchOpType type = PsBatchOpType::UNDO;
+	int line = 0;
+	std::string name;				// Keyword of the line
+	std::string path;				// LOAD, SAVE
+	int subType = 0;				// PsBoolType, SolidShape, PsFRType or PsSaveMode value
+	std::vector<double> values;		// Radius, distances, thickness or solid size in mm
+	int body = -1;					// Target body
+	std::vector<int> targets;		// Target bodies of BOOLEAN_BATCH, each one with all the tools
+	std::vector<int> bodies;		// Tool bodies
+	std::vector<int> entities;		// Faces or edges of the target, chamfer pairs edge / face
+	bool bCopy = false;
+	bool bMerge = false;
+	double offset[3] = { 0.0, 0.0, 0.0 };
+	double dir[3] = { 0.0, 0.0, 1.0 };
+};
+
+// Plain text, one operation per line, '#' starts a comment:
+//   load <file>
+//   blend <radius> <body> <edge>...
+//   chamfer <distance1> <distance2> <body> <edge> <face> [<edge> <face>]...
+//   hollow <thickness> <body> <face>...
+//   boolean unite|subtract|intersect <target> <tool>...
+//   boolean_batch unite|subtract|intersect <target>... with <tool>...
+//   mirror <body> <planar face> [copy] [merge]
+//   delete_face <body> <face>...
+//   create_solid block|cylinder|cone|sphere|spring <size>... [at <x> <y> <z>] [dir <x> <y> <z>]
+//   fr boss|concentric|coplanar <body> <face>
+//   fr_groups boss|concentric|coplanar <body>
+//   undo
+//   redo
+//   group
+//   end_group
+//   save <file.x_b|file.x_t> [frustrum]
+// The operations between group and end_group share one kernel mark and are one step of the journal,
+// end_group rolls the whole group back if one of them failed
+bool PsBatchReadJournal(const char* filePath, std::vector<PsBatchOp>& opArr, std::string& error);
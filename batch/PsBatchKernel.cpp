@@ -0,0 +1,501 @@
+#include "PsBatchBackend.h"
+
+#ifdef PS_BATCH_KERNEL
+#include "stdafx.h"
+#include "PsProcess.h"
+#include "PsMemoryPool.h"
+#include "PsFrustrumWriter.h"
+#include "PsBatchFrustrum.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+
+// Runs the journal through PsProcess, the same calls as the dialogs
+class PsBatchKernel : public PsBatchBackend
+{
+public:
+	PsBatchKernel();
+	~PsBatchKernel();
+
+	const char* GetName() const override { return "parasolid"; }
+	bool Start(std::string& error) override;
+	void Stop() override;
+	bool Run(const PsBatchOp& op, PsBatchOpResult& result) override;
+
+private:
+	bool m_bSession;
+	bool m_bGroupFailed;	// An operation of the running group failed
+	PsProcess m_process;
+	std::vector<PK_BODY_t> m_bodyArr;	// Index of the journal to tag, dead tags stay
+
+	PK_BODY_t findBody(const int body) const;
+	bool findEntities(const PK_BODY_t body, const bool bFace, const std::vector<int>& indexArr, std::vector<PK_ENTITY_t>& entityArr) const;
+	bool load(const std::string& filePath, PsBatchOpResult& result);
+	bool runOp(const PsBatchOp& op, PsBatchOpResult& result);
+	bool booleanBatch(const PsBatchOp& op, PsBatchOpResult& result);
+	bool callKernel(PsBatchOpResult& result, const std::function<bool()>& fnCall);
+};
+
+PsBatchKernel::PsBatchKernel() :
+	m_bSession(false),
+	m_bGroupFailed(false)
+{
+}
+
+PsBatchKernel::~PsBatchKernel()
+{
+	if (m_bSession)
+	{
+		m_process.Terminate();
+		PK_SESSION_stop();
+	}
+}
+
+bool PsBatchKernel::Start(std::string& error)
+{
+	if (!m_bSession)
+	{
+		// The arrays returned by the kernel come from the pool like in the application
+		PsMemoryPool::Register();
+
+		PK_SESSION_frustrum_t fru;
+		PK_SESSION_frustrum_o_m(fru);
+		fru.fstart = FSTART;
+		fru.fabort = FABORT;
+		fru.fstop = FSTOP;
+		fru.fmallo = FMALLO;
+		fru.fmfree = FMFREE;
+		fru.ffoprd = FFOPRD;
+		fru.ffopwr = FFOPWR;
+		fru.ffclos = FFCLOS;
+		fru.ffread = FFREAD;
+		fru.ffwrit = FFWRIT;
+		fru.ffoprb = FFOPRB;
+		fru.ffseek = FFSEEK;
+		fru.fftell = FFTELL;
+
+		// The session is ours, the transmit writes are gathered
+		PsFrustrumWriter::Wrap(fru);
+
+		if (PK_ERROR_no_errors != PK_SESSION_register_frustrum(&fru))
+		{
+			error = "PK_SESSION_register_frustrum failed";
+			return false;
+		}
+
+		PK_SESSION_start_o_t start_opts;
+		PK_SESSION_start_o_m(start_opts);
+		if (PK_ERROR_no_errors != PK_SESSION_start(&start_opts))
+		{
+			error = "PK_SESSION_start failed";
+			return false;
+		}
+
+		m_bSession = true;
+	}
+
+	// Every pass in a new partition
+	m_process.Initialize();
+	m_bodyArr.clear();
+	m_bGroupFailed = false;
+
+	return true;
+}
+
+void PsBatchKernel::Stop()
+{
+	// A group left open at the end of the journal isn't committed
+	PsJournalStep step;
+	if (m_process.IsInGroup())
+		m_process.EndGroup(false, step);
+
+	m_process.WaitSave();
+	m_bodyArr.clear();
+}
+
+PK_BODY_t PsBatchKernel::findBody(const int body) const
+{
+	if (0 > body || (int)m_bodyArr.size() <= body)
+		return PK_ENTITY_null;
+
+	PK_CLASS_t entity_class;
+	if (PK_ERROR_no_errors != PK_ENTITY_ask_class(m_bodyArr[body], &entity_class) || PK_CLASS_body != entity_class)
+		return PK_ENTITY_null;
+
+	return m_bodyArr[body];
+}
+
+bool PsBatchKernel::findEntities(const PK_BODY_t body, const bool bFace, const std::vector<int>& indexArr, std::vector<PK_ENTITY_t>& entityArr) const
+{
+	int n_entities = 0;
+	PK_ENTITY_t* entities = NULL;
+	PK_ERROR_code_t error_code = bFace ? PK_BODY_ask_faces(body, &n_entities, &entities) : PK_BODY_ask_edges(body, &n_entities, &entities);
+	if (PK_ERROR_no_errors != error_code)
+		return false;
+
+	bool bRet = true;
+	for (size_t i = 0; i < indexArr.size(); i++)
+	{
+		if (0 > indexArr[i] || n_entities <= indexArr[i])
+		{
+			bRet = false;
+			break;
+		}
+		entityArr.push_back(entities[indexArr[i]]);
+	}
+
+	if (n_entities)
+		PK_MEMORY_free(entities);
+
+	return bRet;
+}
+
+bool PsBatchKernel::load(const std::string& filePath, PsBatchOpResult& result)
+{
+	// The frustrum is given the key, the format comes from the extension
+	std::string key = filePath;
+	PK_transmit_format_t format = PK_transmit_format_text_c;
+
+	size_t dot = key.find_last_of('.');
+	if (std::string::npos != dot)
+	{
+		std::string ext = key.substr(dot);
+		std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+		if (".x_b" == ext || ".xmt_bin" == ext)
+			format = PK_transmit_format_binary_c;
+		if (".x_t" == ext || ".xmt_txt" == ext || PK_transmit_format_binary_c == format)
+			key.erase(dot);
+	}
+
+	PK_PART_receive_o_t receive_opts;
+	PK_PART_receive_o_m(receive_opts);
+	receive_opts.transmit_format = format;
+
+	int n_parts = 0;
+	PK_PART_t* parts = NULL;
+	if (PK_ERROR_no_errors != PK_PART_receive(key.c_str(), &receive_opts, &n_parts, &parts))
+	{
+		result.message = "cannot receive " + filePath;
+		return false;
+	}
+
+	// The bodies of the assemblies are numbered too
+	std::vector<PK_PART_t> partArr(parts, parts + n_parts);
+	if (n_parts)
+		PK_MEMORY_free(parts);
+
+	for (size_t i = 0; i < partArr.size(); i++)
+	{
+		PK_CLASS_t part_class;
+		PK_ENTITY_ask_class(partArr[i], &part_class);
+
+		if (PK_CLASS_body == part_class)
+		{
+			m_bodyArr.push_back(partArr[i]);
+			result.resultCnt++;
+		}
+		else if (PK_CLASS_assembly == part_class)
+		{
+			int n_sub_parts = 0;
+			PK_PART_t* sub_parts = NULL;
+			if (PK_ERROR_no_errors == PK_ASSEMBLY_ask_parts(partArr[i], &n_sub_parts, &sub_parts) && n_sub_parts)
+			{
+				partArr.insert(partArr.end(), sub_parts, sub_parts + n_sub_parts);
+				PK_MEMORY_free(sub_parts);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool PsBatchKernel::callKernel(PsBatchOpResult& result, const std::function<bool()>& fnCall)
+{
+	double cpu0 = PsBatchCpuMsec();
+	auto t0 = std::chrono::steady_clock::now();
+
+	bool bRet;
+	{
+		// Outermost scope, the scopes of PsProcess join it
+		PsMemoryScope memScope("batch");
+		bRet = fnCall();
+	}
+
+	result.kernelMsec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	result.cpuMsec = PsBatchCpuMsec() - cpu0;
+
+	PsMemoryScopeStats memStats = PsMemoryPool::GetLastScopeStats();
+	result.allocCnt = memStats.allocCnt;
+	result.peakBytes = (long long)memStats.peakBytes;
+	result.releasedCnt = memStats.releasedCnt;
+
+	return bRet;
+}
+
+bool PsBatchKernel::Run(const PsBatchOp& op, PsBatchOpResult& result)
+{
+	result.bSucceeded = runOp(op, result);
+
+	if (!result.bSucceeded && m_process.IsInGroup())
+		m_bGroupFailed = true;
+
+	for (size_t i = 0; i < m_bodyArr.size(); i++)
+	{
+		if (PK_ENTITY_null == findBody((int)i))
+			continue;
+
+		int n_faces = 0;
+		PK_FACE_t* faces = NULL;
+		if (PK_ERROR_no_errors == PK_BODY_ask_faces(m_bodyArr[i], &n_faces, &faces) && n_faces)
+			PK_MEMORY_free(faces);
+
+		result.bodyCnt++;
+		result.faceCnt += n_faces;
+	}
+
+	return result.bSucceeded;
+}
+
+bool PsBatchKernel::runOp(const PsBatchOp& op, PsBatchOpResult& result)
+{
+	if (PsBatchOpType::LOAD == op.type)
+		return callKernel(result, [&]() { return load(op.path, result); });
+
+	if (PsBatchOpType::SAVE == op.type)
+	{
+		std::string ext = op.path.substr(std::min(op.path.size(), op.path.find_last_of('.')));
+		std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+		PK_transmit_format_t format = (".x_t" == ext || ".xmt_txt" == ext) ? PK_transmit_format_text_c : PK_transmit_format_binary_c;
+
+		// The background write is part of the operation here
+		bool bRet = callKernel(result, [&]() { return m_process.Save(op.path.c_str(), format, (PsSaveMode)op.subType) && m_process.WaitSave(); });
+
+		PsSaveStatus status = m_process.GetSaveStatus();
+		char buf[128];
+		snprintf(buf, sizeof(buf), "%zu bytes, transmit %.1f ms, write %.1f ms, %.1f MB/s",
+			status.writtenBytes, status.transmitMsec, status.writeMsec, status.MBytePerSec());
+		result.message = buf;
+
+		return bRet;
+	}
+
+	if (PsBatchOpType::UNDO == op.type || PsBatchOpType::REDO == op.type)
+	{
+		PsJournalStep step;
+		return callKernel(result, [&]() { return (PsBatchOpType::UNDO == op.type) ? m_process.Undo(step) : m_process.Redo(step); });
+	}
+
+	if (PsBatchOpType::GROUP == op.type)
+	{
+		m_bGroupFailed = false;
+		return callKernel(result, [&]() { return m_process.BeginGroup(); });
+	}
+
+	if (PsBatchOpType::END_GROUP == op.type)
+	{
+		// All or nothing as the pipeline of the application
+		PsJournalStep step;
+		bool bCommit = !m_bGroupFailed;
+		if (!callKernel(result, [&]() { return m_process.EndGroup(bCommit, step); }))
+			return false;
+
+		result.message = bCommit ? "committed" : "rolled back";
+		return bCommit;
+	}
+
+	if (PsBatchOpType::CREATE_SOLID == op.type)
+	{
+		double size[4] = { 0.0, 0.0, 0.0, 0.0 };
+		std::copy(op.values.begin(), op.values.end(), size);
+
+		PK_BODY_t body = PK_ENTITY_null;
+		if (!callKernel(result, [&]() { return m_process.CreateSolid((SolidShape)op.subType, size, op.offset, op.dir, body); }))
+			return false;
+
+		m_bodyArr.push_back(body);
+		result.resultCnt = 1;
+		return true;
+	}
+
+	if (PsBatchOpType::BOOLEAN_BATCH == op.type)
+		return booleanBatch(op, result);
+
+	// Resolve the indices before the timing
+	PK_BODY_t body = findBody(op.body);
+	if (PK_ENTITY_null == body)
+	{
+		result.message = "no body " + std::to_string(op.body);
+		return false;
+	}
+
+	std::vector<PK_ENTITY_t> entityArr;
+	if (PsBatchOpType::CHAMFER == op.type)
+	{
+		std::vector<int> edgeIndexArr, faceIndexArr;
+		for (size_t i = 0; i < op.entities.size(); i += 2)
+		{
+			edgeIndexArr.push_back(op.entities[i]);
+			faceIndexArr.push_back(op.entities[i + 1]);
+		}
+
+		if (!findEntities(body, false, edgeIndexArr, entityArr) || !findEntities(body, true, faceIndexArr, entityArr))
+		{
+			result.message = "entity index out of range";
+			return false;
+		}
+	}
+	else if (!findEntities(body, PsBatchOpType::BLEND != op.type, op.entities, entityArr))
+	{
+		result.message = "entity index out of range";
+		return false;
+	}
+
+	const int entityCnt = (int)entityArr.size();
+
+	switch (op.type)
+	{
+	case PsBatchOpType::BLEND:
+		return callKernel(result, [&]() { return m_process.BlendRC(PsBlendType::R, op.values[0], 0.0, body, entityCnt, entityArr.data(), NULL); });
+	case PsBatchOpType::CHAMFER:
+		return callKernel(result, [&]() { return m_process.BlendRC(PsBlendType::C, op.values[0], op.values[1], body, entityCnt / 2, entityArr.data(), entityArr.data() + entityCnt / 2); });
+	case PsBatchOpType::HOLLOW:
+		return callKernel(result, [&]() { return m_process.Hollow(op.values[0], body, entityCnt, entityArr.data()); });
+	case PsBatchOpType::DELETE_FACE:
+		return callKernel(result, [&]() { return m_process.DeleteFace(entityCnt, entityArr.data()); });
+	case PsBatchOpType::BOOLEAN:
+	{
+		std::vector<PK_BODY_t> toolArr;
+		for (size_t i = 0; i < op.bodies.size(); i++)
+		{
+			PK_BODY_t tool = findBody(op.bodies[i]);
+			if (PK_ENTITY_null == tool)
+			{
+				result.message = "no body " + std::to_string(op.bodies[i]);
+				return false;
+			}
+			toolArr.push_back(tool);
+		}
+
+		int bodyCnt = 0;
+		PK_BODY_t* bodies = NULL;
+		if (!callKernel(result, [&]() { return m_process.Boolean((PsBoolType)op.subType, body, (int)toolArr.size(), toolArr.data(), bodyCnt, bodies); }))
+			return false;
+
+		// The other pieces are new bodies
+		for (int i = 0; i < bodyCnt; i++)
+		{
+			if (body != bodies[i])
+				m_bodyArr.push_back(bodies[i]);
+		}
+		result.resultCnt = bodyCnt;
+		if (bodyCnt)
+			PK_MEMORY_free(bodies);
+
+		return true;
+	}
+	case PsBatchOpType::MIRROR:
+	{
+		double position[3], normal[3];
+		PK_BODY_t mirror_body = PK_ENTITY_null;
+		if (!callKernel(result, [&]() {
+			return m_process.GetPlaneInfo(entityArr[0], position, normal) &&
+				m_process.MirrorBody(body, position, normal, op.bCopy ? 1.0 : 0.0, op.bMerge ? 1.0 : 0.0, mirror_body); }))
+			return false;
+
+		if (op.bCopy && !op.bMerge && PK_ENTITY_null != mirror_body)
+		{
+			m_bodyArr.push_back(mirror_body);
+			result.resultCnt = 1;
+		}
+		return true;
+	}
+	case PsBatchOpType::FR:
+	{
+		std::vector<PK_ENTITY_t> faceArr;
+		bool bRet = callKernel(result, [&]() { return m_process.FR((PsFRType)op.subType, entityArr[0], faceArr); });
+		result.resultCnt = (int)faceArr.size();
+		return bRet;
+	}
+	case PsBatchOpType::FR_GROUPS:
+	{
+		std::vector<std::vector<PK_FACE_t>> groupArr;
+		bool bRet = callKernel(result, [&]() { return m_process.FRGroups((PsFRType)op.subType, body, groupArr); });
+		result.resultCnt = (int)groupArr.size();
+		return bRet;
+	}
+	default:
+		break;
+	}
+
+	return false;
+}
+
+// Every target with all the tools in one PsProcess::BooleanBatch, a failed set doesn't fail the line
+bool PsBatchKernel::booleanBatch(const PsBatchOp& op, PsBatchOpResult& result)
+{
+	std::vector<PK_BODY_t> toolArr;
+	for (size_t i = 0; i < op.bodies.size(); i++)
+	{
+		PK_BODY_t tool = findBody(op.bodies[i]);
+		if (PK_ENTITY_null == tool)
+		{
+			result.message = "no body " + std::to_string(op.bodies[i]);
+			return false;
+		}
+		toolArr.push_back(tool);
+	}
+
+	std::vector<PsBoolSet> setArr;
+	for (size_t i = 0; i < op.targets.size(); i++)
+	{
+		PsBoolSet boolSet;
+		boolSet.targetBody = findBody(op.targets[i]);
+		if (PK_ENTITY_null == boolSet.targetBody)
+		{
+			result.message = "no body " + std::to_string(op.targets[i]);
+			return false;
+		}
+		boolSet.toolBodies = toolArr;
+		setArr.push_back(boolSet);
+	}
+
+	std::vector<PsBoolSetResult> resultArr;
+	PsJournalStep step;
+	if (!callKernel(result, [&]() { return m_process.BooleanBatch((PsBoolType)op.subType, setArr, resultArr, step); }))
+		return false;
+
+	// The other pieces are new bodies
+	int succeededCnt = 0;
+	for (size_t i = 0; i < resultArr.size(); i++)
+	{
+		if (!resultArr[i].bSucceeded)
+			continue;
+
+		succeededCnt++;
+		for (size_t j = 0; j < resultArr[i].bodies.size(); j++)
+		{
+			if (setArr[i].targetBody != resultArr[i].bodies[j])
+				m_bodyArr.push_back(resultArr[i].bodies[j]);
+		}
+		result.resultCnt += (int)resultArr[i].bodies.size();
+	}
+
+	result.message = std::to_string(succeededCnt) + " of " + std::to_string(setArr.size()) + " sets";
+
+	return true;
+}
+
+PsBatchBackend* PsBatchCreateKernelBackend()
+{
+	return new PsBatchKernel();
+}
+
+#else
+
+PsBatchBackend* PsBatchCreateKernelBackend()
+{
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include "PsBatchBackend.h"
+#include "PsKernelStandIn.h"
+#include "PsFeatureRecognizer.h"
+#include <chrono>
+#include <math.h>
+
+static const double s_unit = 1000.0;		// PsProcess::m_dUnit
+static const double s_tol = 1.0e-06;		// PsProcess::m_dFRTol
+static const double s_angTol = 1.0e-9;		// PsProcess::m_dFRAngTol
+static const int s_block = 0;				// SolidShape::BLOCK
+static const int s_cylinder = 1;			// SolidShape::CYLINDER
+
+// Runs the journal on the in-memory B-rep of PsKernelStandIn, FR goes through the same PsFeatureRecognizer as PsProcess.
+// The stand-in has no modelling: only the blocks and cylinders of create_solid are made, the other operations fail.
+class PsBatchKernelStandIn : public PsBatchBackend
+{
+public:
+	PsBatchKernelStandIn();
+	~PsBatchKernelStandIn();
+
+	const char* GetName() const override { return m_kernel.GetName(); }
+	bool Start(std::string& error) override;
+	void Stop() override;
+	bool Run(const PsBatchOp& op, PsBatchOpResult& result) override;
+
+private:
+	PsKernelStandIn m_kernel;
+	PsFeatureRecognizer m_recognizer;
+	std::vector<PK_BODY_t> m_bodyArr;	// Index of the journal to tag
+
+	PK_BODY_t findBody(const int body) const;
+	bool findFace(const PK_BODY_t body, const int face, PK_FACE_t& faceTag) const;
+	PK_BODY_t createSolid(const PsBatchOp& op);
+	bool runOp(const PsBatchOp& op, PsBatchOpResult& result);
+};
+
+// Frame of create_solid: unit axis along dir and a perpendicular x
+static void stSetFrame(const double* dir, double* z, double* x)
+{
+	double len = sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+	for (int i = 0; i < 3; i++)
+		z[i] = (0.0 < len) ? dir[i] / len : (2 == i ? 1.0 : 0.0);
+
+	double ref[3] = { 1.0, 0.0, 0.0 };
+	if (0.9 < fabs(z[0]))
+	{
+		ref[0] = 0.0;
+		ref[1] = 1.0;
+	}
+
+	double dot = ref[0] * z[0] + ref[1] * z[1] + ref[2] * z[2];
+	for (int i = 0; i < 3; i++)
+		x[i] = ref[i] - dot * z[i];
+
+	len = sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	for (int i = 0; i < 3; i++)
+		x[i] /= len;
+}
+
+PsBatchKernelStandIn::PsBatchKernelStandIn() :
+	m_recognizer(s_tol, s_angTol)
+{
+}
+
+PsBatchKernelStandIn::~PsBatchKernelStandIn()
+{
+	Stop();
+}
+
+bool PsBatchKernelStandIn::Start(std::string& /*error*/)
+{
+	// Every pass on an empty model
+	m_kernel.Clear();
+	m_recognizer.Invalidate(PK_ENTITY_null);
+	m_bodyArr.clear();
+
+	PsKernel::SetCurrent(&m_kernel);
+
+	return true;
+}
+
+void PsBatchKernelStandIn::Stop()
+{
+	PsKernel::SetCurrent(NULL);
+	m_bodyArr.clear();
+}
+
+PK_BODY_t PsBatchKernelStandIn::findBody(const int body) const
+{
+	if (0 > body || (int)m_bodyArr.size() <= body)
+		return PK_ENTITY_null;
+
+	return m_bodyArr[body];
+}
+
+bool PsBatchKernelStandIn::findFace(const PK_BODY_t body, const int face, PK_FACE_t& faceTag) const
+{
+	std::vector<PK_FACE_t> faceArr;
+	if (PK_ERROR_no_errors != m_kernel.AskBodyFaces(body, faceArr) || 0 > face || (int)faceArr.size() <= face)
+		return false;
+
+	faceTag = faceArr[face];
+
+	return true;
+}
+
+// Faces and edges of PK_BODY_create_solid_block / PK_BODY_create_solid_cyl, the base on the offset
+PK_BODY_t PsBatchKernelStandIn::createSolid(const PsBatchOp& op)
+{
+	double z[3], x[3];
+	stSetFrame(op.dir, z, x);
+	double y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+	double base[3] = { op.offset[0] / s_unit, op.offset[1] / s_unit, op.offset[2] / s_unit };
+	double minusZ[3] = { -z[0], -z[1], -z[2] };
+
+	double height = (s_block == op.subType ? op.values[2] : op.values[1]) / s_unit;
+	double top[3] = { base[0] + height * z[0], base[1] + height * z[1], base[2] + height * z[2] };
+
+	PK_BODY_t body = m_kernel.CreateBody();
+	PK_FACE_t bottomFace = m_kernel.AddPlane(body, base, minusZ);
+	PK_FACE_t topFace = m_kernel.AddPlane(body, top, z);
+
+	if (s_cylinder == op.subType)
+	{
+		PK_FACE_t wallFace = m_kernel.AddCylinder(body, base, z, op.values[0] / s_unit);
+		m_kernel.AddEdge(wallFace, bottomFace, PK_EDGE_convexity_convex_c);
+		m_kernel.AddEdge(wallFace, topFace, PK_EDGE_convexity_convex_c);
+		return body;
+	}
+
+	// Sides +x, +y, -x, -y around the axis
+	const double half[2] = { op.values[0] / s_unit / 2.0, op.values[1] / s_unit / 2.0 };
+	PK_FACE_t sideFaces[4];
+	for (int i = 0; i < 4; i++)
+	{
+		const double* dir = (0 == i % 2) ? x : y;
+		double sign = (2 > i) ? 1.0 : -1.0;
+		double d = half[i % 2] * sign;
+		double location[3] = { base[0] + d * dir[0], base[1] + d * dir[1], base[2] + d * dir[2] };
+		double normal[3] = { sign * dir[0], sign * dir[1], sign * dir[2] };
+		sideFaces[i] = m_kernel.AddPlane(body, location, normal);
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		m_kernel.AddEdge(sideFaces[i], bottomFace, PK_EDGE_convexity_convex_c);
+		m_kernel.AddEdge(sideFaces[i], topFace, PK_EDGE_convexity_convex_c);
+		m_kernel.AddEdge(sideFaces[i], sideFaces[(i + 1) % 4], PK_EDGE_convexity_convex_c);
+	}
+
+	return body;
+}
+
+bool PsBatchKernelStandIn::Run(const PsBatchOp& op, PsBatchOpResult& result)
+{
+	double cpu0 = PsBatchCpuMsec();
+	auto t0 = std::chrono::steady_clock::now();
+
+	result.bSucceeded = runOp(op, result);
+
+	result.kernelMsec = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	result.cpuMsec = PsBatchCpuMsec() - cpu0;
+
+	std::vector<PK_FACE_t> faceArr;
+	for (size_t i = 0; i < m_bodyArr.size(); i++)
+	{
+		if (PK_ERROR_no_errors != m_kernel.AskBodyFaces(m_bodyArr[i], faceArr))
+			continue;
+
+		result.bodyCnt++;
+		result.faceCnt += (int)faceArr.size();
+	}
+
+	return result.bSucceeded;
+}
+
+bool PsBatchKernelStandIn::runOp(const PsBatchOp& op, PsBatchOpResult& result)
+{
+	if (PsBatchOpType::CREATE_SOLID == op.type)
+	{
+		if (s_block != op.subType && s_cylinder != op.subType)
+		{
+			result.message = "only blocks and cylinders on the stand-in";
+			return false;
+		}
+
+		m_bodyArr.push_back(createSolid(op));
+		result.resultCnt = 1;
+		return true;
+	}
+
+	if (PsBatchOpType::FR != op.type && PsBatchOpType::FR_GROUPS != op.type)
+	{
+		result.message = op.name + " needs the Parasolid kernel";
+		return false;
+	}
+
+	PK_BODY_t body = findBody(op.body);
+	if (PK_ENTITY_null == body)
+	{
+		result.message = "no body " + std::to_string(op.body);
+		return false;
+	}
+
+	if (PsBatchOpType::FR_GROUPS == op.type)
+	{
+		std::vector<std::vector<PK_FACE_t>> groupArr;
+		bool bRet = m_recognizer.FindGroups((PsFRType)op.subType, body, groupArr);
+		result.resultCnt = (int)groupArr.size();
+		return bRet;
+	}
+
+	PK_FACE_t face;
+	if (!findFace(body, op.entities[0], face))
+	{
+		result.message = "entity index out of range";
+		return false;
+	}
+
+	std::vector<PK_ENTITY_t> faceArr;
+	bool bRet = m_recognizer.Find((PsFRType)op.subType, face, faceArr);
+	result.resultCnt = (int)faceArr.size();
+	return bRet;
+}
+
+PsBatchBackend* PsBatchCreateStandInBackend()
+{
+	return new PsBatchKernelStandIn();
+}
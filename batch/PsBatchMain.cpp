@@ -0,0 +1,148 @@
+#include "PsBatchBackend.h"
+#include "PerfTrace.h"
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Resident memory of the process
+static long long stRssKB()
+{
+	long long pageCnt = 0;
+	long long residentCnt = 0;
+
+	FILE* fp = fopen("/proc/self/statm", "r");
+	if (NULL == fp)
+		return 0;
+
+	if (2 != fscanf(fp, "%lld %lld", &pageCnt, &residentCnt))
+		residentCnt = 0;
+	fclose(fp);
+
+	return residentCnt * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void stUsage()
+{
+	fprintf(stderr,
+		"Usage: ps_batch [--standin] [--repeat <n>] [--csv <file>] [--trace <file>] <journal>\n"
+		"  --standin     run against the in-memory B-rep instead of the Parasolid kernel, only create_solid block / cylinder, fr and fr_groups\n"
+		"  --repeat <n>  run the journal n times, each pass from a new session\n"
+		"  --csv <file>  write the per-operation rows to the file instead of stdout\n"
+		"  --trace <file> write the spans of the operations as Chrome trace events\n");
+}
+
+int main(int argc, char* argv[])
+{
+	bool bStandIn = false;
+	int passCnt = 1;
+	const char* csvPath = NULL;
+	const char* tracePath = NULL;
+	const char* journalPath = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--standin"))
+			bStandIn = true;
+		else if (0 == strcmp(argv[i], "--repeat") && i + 1 < argc)
+			passCnt = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "--csv") && i + 1 < argc)
+			csvPath = argv[++i];
+		else if (0 == strcmp(argv[i], "--trace") && i + 1 < argc)
+			tracePath = argv[++i];
+		else if ('-' != argv[i][0] && NULL == journalPath)
+			journalPath = argv[i];
+		else
+		{
+			stUsage();
+			return 2;
+		}
+	}
+
+	if (NULL == journalPath || 0 >= passCnt)
+	{
+		stUsage();
+		return 2;
+	}
+
+	if (NULL != tracePath)
+	{
+		PerfTrace::SetThreadName("main");
+		PerfTrace::Enable(true);
+	}
+
+	std::vector<PsBatchOp> opArr;
+	std::string error;
+	if (!PsBatchReadJournal(journalPath, opArr, error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 2;
+	}
+
+	std::unique_ptr<PsBatchBackend> pBackend;
+	if (!bStandIn)
+		pBackend.reset(PsBatchCreateKernelBackend());
+	if (!pBackend)
+	{
+		if (!bStandIn)
+			fprintf(stderr, "Built without the Parasolid kernel, running against the stand-in\n");
+		pBackend.reset(PsBatchCreateStandInBackend());
+	}
+
+	FILE* fp = stdout;
+	if (NULL != csvPath && NULL == (fp = fopen(csvPath, "w")))
+	{
+		fprintf(stderr, "Cannot write %s\n", csvPath);
+		return 2;
+	}
+
+	fprintf(fp, "kernel,pass,index,line,op,status,wall_ms,kernel_ms,cpu_ms,allocs,peak_bytes,released,rss_kb,bodies,faces,results,message\n");
+
+	int failedCnt = 0;
+	double totalMsec = 0.0;
+	for (int pass = 0; pass < passCnt; pass++)
+	{
+		if (!pBackend->Start(error))
+		{
+			fprintf(stderr, "Cannot start the %s kernel: %s\n", pBackend->GetName(), error.c_str());
+			return 2;
+		}
+
+		for (size_t i = 0; i < opArr.size(); i++)
+		{
+			const PsBatchOp& op = opArr[i];
+
+			// The names of the journal are kept until the dump
+			PsBatchOpResult result;
+			double wallMsec;
+			{
+				PerfTraceSpan span("batch", op.name.c_str(), true);
+				pBackend->Run(op, result);
+				wallMsec = span.ElapsedMsec();
+			}
+
+			totalMsec += wallMsec;
+			if (!result.bSucceeded)
+				failedCnt++;
+
+			fprintf(fp, "%s,%d,%d,%d,%s,%s,%.3f,%.3f,%.3f,%llu,%lld,%d,%lld,%d,%d,%d,\"%s\"\n",
+				pBackend->GetName(), pass, (int)i, op.line, op.name.c_str(), result.bSucceeded ? "ok" : "failed",
+				wallMsec, result.kernelMsec, result.cpuMsec, result.allocCnt, result.peakBytes, result.releasedCnt,
+				stRssKB(), result.bodyCnt, result.faceCnt, result.resultCnt, result.message.c_str());
+		}
+
+		pBackend->Stop();
+	}
+
+	if (stdout != fp)
+		fclose(fp);
+
+	if (NULL != tracePath && !PerfTrace::Dump(tracePath))
+		fprintf(stderr, "Cannot write %s\n", tracePath);
+
+	size_t opCnt = opArr.size() * (size_t)passCnt;
+	fprintf(stderr, "%s: %zu operations, %d failed, %.1f ms, %.1f operations/s\n", pBackend->GetName(), opCnt, failedCnt,
+		totalMsec, (0.0 < totalMsec) ? (double)opCnt / (totalMsec / 1000.0) : 0.0);
+
+	return failedCnt ? 1 : 0;
+}
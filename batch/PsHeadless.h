@@ -0,0 +1,9 @@
+#pragma once
+// Replaces the precompiled header of the MFC projects when the kernel sources are built headless
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Debugger output of the Windows builds
+inline void OutputDebugStringA(const char* str) { fputs(str, stderr); }
@@ -0,0 +1,473 @@
+#include "PsKernelStandIn.h"
+#include "PsFeatureCache.h"
+#include "PsGeomIndex.h"
+#include "PsModelQuery.h"
+#include "PerfTrace.h"
+#include "TessConnector.h"
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+// FR and assembly algorithms of PsProcess on synthetic stand-in models:
+// a plate of cells on a few levels (coplanar sets), steps between the levels (concave / convex edges)
+// and bosses with counterbores (concentric sets), plus a balanced assembly tree.
+// The triangle indices of visitor/TessConnector are extracted from a synthetic A3DTess3DData.
+
+static const double s_tol = 1.0e-06;		// PsProcess::m_dFRTol
+static const double s_angTol = 1.0e-9;		// PsProcess::m_dFRAngTol
+
+struct BenchOptions
+{
+	int faceCnt = 100000;
+	int assyCnt = 10000;
+	int queryCnt = 10000;
+	int tessFaceCnt = 20000;
+	unsigned int workerCnt = 1;
+	unsigned int seed = 1;
+	const char* tracePath = NULL;
+};
+
+class BenchTimer
+{
+public:
+	BenchTimer(const char* name, const size_t itemCnt) :
+		m_name(name), m_itemCnt(itemCnt), m_span("bench", name, true)
+	{
+	}
+
+	~BenchTimer()
+	{
+		double msec = m_span.ElapsedMsec();
+		printf("%-28s %10zu %12.3f %12.3f\n", m_name, m_itemCnt, msec, m_itemCnt ? msec * 1000.0 / (double)m_itemCnt : 0.0);
+	}
+
+private:
+	const char* m_name;
+	size_t m_itemCnt;
+	PerfTraceSpan m_span;
+};
+
+// Body of at least faceCnt faces, the seed faces of the queries are taken among them
+static PK_BODY_t stBuildPlate(PsKernelStandIn& kernel, const int faceCnt, std::mt19937& rng)
+{
+	const double pitch = 10.0;
+	const int levelCnt = 16;
+	const double radii[4] = { 1.0, 1.5, 2.0, 2.5 };
+	const double up[3] = { 0.0, 0.0, 1.0 };
+	const double xDir[3] = { 1.0, 0.0, 0.0 };
+
+	// About 1.8 faces per cell with the steps and the bosses
+	int width = (int)ceil(sqrt(faceCnt / 1.8));
+
+	PK_BODY_t body = kernel.CreateBody();
+
+	std::vector<int> levelArr;
+	std::vector<PK_FACE_t> topArr;
+	int cellFaceCnt = 0;
+	for (int j = 0; cellFaceCnt < faceCnt; j++)
+	{
+		for (int i = 0; i < width && cellFaceCnt < faceCnt; i++)
+		{
+			int cell = j * width + i;
+			int level = (int)(rng() % levelCnt);
+			double cx = (i + 0.5) * pitch, cy = (j + 0.5) * pitch, z = level * 2.0;
+
+			double top[3] = { cx, cy, z };
+			PK_FACE_t topFace = kernel.AddPlane(body, top, up);
+			cellFaceCnt++;
+
+			levelArr.push_back(level);
+			topArr.push_back(topFace);
+
+			// Step to the previous cell of the row, the higher top is convex to it and the lower one concave
+			if (0 < i && levelArr[cell - 1] != level)
+			{
+				double loc[3] = { i * pitch, cy, 0.0 };
+				PK_FACE_t stepFace = kernel.AddPlane(body, loc, xDir);
+				cellFaceCnt++;
+
+				bool bHigher = levelArr[cell - 1] < level;
+				kernel.AddEdge(topArr[cell - 1], stepFace, bHigher ? PK_EDGE_convexity_concave_c : PK_EDGE_convexity_convex_c);
+				kernel.AddEdge(topFace, stepFace, bHigher ? PK_EDGE_convexity_convex_c : PK_EDGE_convexity_concave_c);
+			}
+			else if (0 < i)
+				kernel.AddEdge(topArr[cell - 1], topFace, PK_EDGE_convexity_smooth_cvx_c);
+
+			if (0 < j)
+				kernel.AddEdge(topArr[cell - width], topFace, levelArr[cell - width] == level ? PK_EDGE_convexity_smooth_cvx_c : PK_EDGE_convexity_convex_c);
+
+			// Boss with a cap, every other one with a counterbore on the same axis
+			if (0 == cell % 5)
+			{
+				double radius = radii[rng() % 4];
+				double capLoc[3] = { cx, cy, z + 3.0 };
+
+				PK_FACE_t wallFace = kernel.AddCylinder(body, top, up, radius);
+				PK_FACE_t capFace = kernel.AddPlane(body, capLoc, up);
+				cellFaceCnt += 2;
+
+				kernel.AddEdge(topFace, wallFace, PK_EDGE_convexity_concave_c);
+				kernel.AddEdge(wallFace, capFace, PK_EDGE_convexity_convex_c);
+
+				if (0 == cell % 10)
+				{
+					PK_FACE_t boreFace = kernel.AddCylinder(body, capLoc, up, radius * 0.5);
+					cellFaceCnt++;
+
+					kernel.AddEdge(capFace, boreFace, PK_EDGE_convexity_convex_c);
+				}
+			}
+		}
+	}
+
+	return body;
+}
+
+// Balanced tree of assyCnt assemblies, the leaves instance the body
+static void stBuildAssemblies(PsKernelStandIn& kernel, const int assyCnt, const PK_BODY_t body, std::mt19937& rng)
+{
+	const int fanOut = 8;
+
+	std::vector<PK_ASSEMBLY_t> assyArr;
+	for (int i = 0; i < assyCnt; i++)
+		assyArr.push_back(kernel.CreateAssembly());
+
+	// The tags of the tree are shuffled so that the top isn't the first assembly asked
+	std::vector<PK_ASSEMBLY_t> treeArr = assyArr;
+	std::shuffle(treeArr.begin(), treeArr.end(), rng);
+
+	for (int i = 0; i < assyCnt; i++)
+	{
+		bool bLeaf = true;
+		for (int k = 1; k <= fanOut && i * fanOut + k < assyCnt; k++)
+		{
+			kernel.AddInstance(treeArr[i], treeArr[i * fanOut + k]);
+			bLeaf = false;
+		}
+
+		if (bLeaf)
+			kernel.AddInstance(treeArr[i], body);
+	}
+}
+
+// Tessellation of tessFaceCnt faces, each one with a triangle list, fans and stripes of one of the three kinds:
+// normal per vertex, one normal (per triangle / per fan or stripe) and textured
+struct TessModel
+{
+	A3DTessStandIn tess;
+	std::vector<A3DTessFaceData> faceArr;
+	std::vector<A3DUns32> indexArr;
+	std::vector<A3DUns32> sizeArr;
+	size_t triangleCnt = 0;
+};
+
+static void stBuildTess(TessModel& model, const int tessFaceCnt, std::mt19937& rng)
+{
+	const A3DUns32 listCnt = 16;			// triangles of the list
+	const A3DUns32 stripCnt = 2;			// fans and stripes of the face
+	const A3DUns32 pointCnt = 10;			// points of a fan or a stripe
+	const A3DUns16 kindFlags[3][3] = {
+		{ kA3DTessFaceDataTriangle, kA3DTessFaceDataTriangleFan, kA3DTessFaceDataTriangleStripe },
+		{ kA3DTessFaceDataTriangleOneNormal, kA3DTessFaceDataTriangleFanOneNormal, kA3DTessFaceDataTriangleStripeOneNormal },
+		{ kA3DTessFaceDataTriangleTextured, kA3DTessFaceDataTriangleFanTextured, kA3DTessFaceDataTriangleStripeTextured } };
+
+	std::vector<A3DUns32> sizeStartArr;
+	for (int f = 0; f < tessFaceCnt; f++)
+	{
+		int kind = f % 3;
+		A3DUns32 stride = 2 == kind ? 3 : 2;	// normal, point (, texture) of a vertex
+
+		A3DTessFaceData faceData;
+		A3D_INITIALIZE_DATA(A3DTessFaceData, faceData);
+		faceData.m_usUsedEntitiesFlags = (A3DUns16)(kindFlags[kind][0] | kindFlags[kind][1] | kindFlags[kind][2]);
+		faceData.m_uiStartTriangulated = (A3DUns32)model.indexArr.size();
+		sizeStartArr.push_back((A3DUns32)model.sizeArr.size());
+
+		// Triangle list: 3 vertices, or normal and 3 points
+		model.sizeArr.push_back(listCnt);
+		A3DUns32 indexCnt = listCnt * (1 == kind ? 4 : 3 * stride);
+
+		// Fans then stripes: a vertex per point, or the normal and a point per point
+		for (int s = 0; s < 2; s++)
+		{
+			model.sizeArr.push_back(stripCnt);
+			for (A3DUns32 i = 0; i < stripCnt; i++)
+			{
+				model.sizeArr.push_back(1 == kind ? (pointCnt | kA3DTessFaceDataNormalSingle) : pointCnt);
+				indexCnt += 1 == kind ? pointCnt + 1 : pointCnt * stride;
+			}
+		}
+
+		for (A3DUns32 i = 0; i < indexCnt; i++)
+			model.indexArr.push_back((A3DUns32)(rng() % 65536) * 3);
+
+		faceData.m_uiSizesTriangulatedSize = (A3DUns32)model.sizeArr.size() - sizeStartArr.back();
+		model.faceArr.push_back(faceData);
+		model.triangleCnt += listCnt + 2 * stripCnt * (pointCnt - 2);
+	}
+
+	for (size_t f = 0; f < model.faceArr.size(); f++)
+		model.faceArr[f].m_puiSizesTriangulated = model.sizeArr.data() + sizeStartArr[f];
+
+	A3D_INITIALIZE_DATA(A3DTessBaseData, model.tess.m_sBaseData);
+	A3D_INITIALIZE_DATA(A3DTess3DData, model.tess.m_s3DData);
+	A3D_INITIALIZE_DATA(A3DTess3DWireData, model.tess.m_sWireData);
+	model.tess.m_s3DData.m_uiTriangulatedIndexSize = (A3DUns32)model.indexArr.size();
+	model.tess.m_s3DData.m_puiTriangulatedIndexes = model.indexArr.data();
+	model.tess.m_s3DData.m_uiFaceTessSize = (A3DUns32)model.faceArr.size();
+	model.tess.m_s3DData.m_psFaceTessData = model.faceArr.data();
+}
+
+// The vector functions of the connector against the two-pass ones, false if their indices differ
+static bool stBenchTess(const int tessFaceCnt, std::mt19937& rng)
+{
+	TessModel model;
+	stBuildTess(model, tessFaceCnt, rng);
+
+	A3DTessDataConnector connector(&model.tess);
+	unsigned faceCnt = connector.FacesSize();
+
+	std::vector<unsigned> vectorArr, vectorUVArr;
+	{
+		BenchTimer timer("tess_indices_vector", model.triangleCnt);
+		connector.IndicesAsTriangle(vectorArr, vectorUVArr);
+	}
+
+	std::vector<unsigned> twoPassArr, twoPassUVArr;
+	{
+		BenchTimer timer("tess_indices_two_pass", model.triangleCnt);
+		connector.IndicesAsTriangleTwoPass(twoPassArr, twoPassUVArr);
+	}
+
+	// Per face with buffers kept across the faces, as A3DVisitorTessellation
+	size_t faceIndexCnt = 0, faceFillCnt = 0;
+	{
+		BenchTimer timer("tess_face_vector", model.triangleCnt);
+		std::vector<unsigned> indexArr, indexUVArr;
+		for (unsigned f = 0; f < faceCnt; f++)
+		{
+			indexArr.clear();
+			indexUVArr.clear();
+			connector.IndicesPerFaceAsTriangle(f, indexArr, indexUVArr);
+			faceIndexCnt += indexArr.size() + indexUVArr.size();
+		}
+	}
+	{
+		BenchTimer timer("tess_face_fill", model.triangleCnt);
+		std::vector<unsigned> indexArr, indexUVArr;
+		for (unsigned f = 0; f < faceCnt; f++)
+		{
+			unsigned size = 0, sizeUV = 0;
+			connector.IndicesPerFaceAsTriangleSize(f, size, sizeUV);
+			if (indexArr.size() < size)
+				indexArr.resize(size);
+			if (indexUVArr.size() < sizeUV)
+				indexUVArr.resize(sizeUV);
+
+			connector.IndicesPerFaceAsTriangleFill(f, indexArr.data(), indexUVArr.data());
+			faceFillCnt += size + sizeUV;
+		}
+	}
+
+	return vectorArr == twoPassArr && vectorUVArr == twoPassUVArr && faceIndexCnt == faceFillCnt &&
+		vectorArr.size() + vectorUVArr.size() == faceIndexCnt;
+}
+
+static void stUsage()
+{
+	fprintf(stderr, "usage: ps_kernel_bench [--faces n] [--assemblies n] [--queries n] [--tess-faces n] [--workers n] [--seed n] [--trace file]\n");
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions opts;
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && 0 == strcmp(argv[i], "--faces"))
+			opts.faceCnt = atoi(argv[++i]);
+		else if (i + 1 < argc && 0 == strcmp(argv[i], "--assemblies"))
+			opts.assyCnt = atoi(argv[++i]);
+		else if (i + 1 < argc && 0 == strcmp(argv[i], "--queries"))
+			opts.queryCnt = atoi(argv[++i]);
+		else if (i + 1 < argc && 0 == strcmp(argv[i], "--tess-faces"))
+			opts.tessFaceCnt = atoi(argv[++i]);
+		else if (i + 1 < argc && 0 == strcmp(argv[i], "--workers"))
+			opts.workerCnt = (unsigned int)atoi(argv[++i]);
+		else if (i + 1 < argc && 0 == strcmp(argv[i], "--seed"))
+			opts.seed = (unsigned int)atoi(argv[++i]);
+		else if (i + 1 < argc && 0 == strcmp(argv[i], "--trace"))
+			opts.tracePath = argv[++i];
+		else
+		{
+			stUsage();
+			return 2;
+		}
+	}
+
+	if (opts.faceCnt <= 0 || opts.assyCnt < 0 || opts.queryCnt < 0 || opts.tessFaceCnt < 0)
+	{
+		stUsage();
+		return 2;
+	}
+
+	if (0 == opts.workerCnt)
+		opts.workerCnt = std::max(1u, std::thread::hardware_concurrency());
+
+	if (opts.tracePath)
+	{
+		PerfTrace::SetThreadName("main");
+		PerfTrace::Enable(true);
+	}
+
+	PsKernelStandIn kernel;
+	PsKernel::SetCurrent(&kernel);
+
+	std::mt19937 rng(opts.seed);
+
+	printf("%-28s %10s %12s %12s\n", "step", "items", "total_ms", "per_item_us");
+
+	PK_BODY_t body;
+	{
+		BenchTimer timer("build_body", (size_t)opts.faceCnt);
+		body = stBuildPlate(kernel, opts.faceCnt, rng);
+	}
+
+	std::vector<PK_FACE_t> faceArr;
+	std::vector<PK_EDGE_t> edgeArr;
+	kernel.AskBodyFaces(body, faceArr);
+	kernel.AskBodyEdges(body, edgeArr);
+
+	// Seeds of the queries
+	std::vector<PK_FACE_t> seedArr;
+	for (int i = 0; i < opts.queryCnt; i++)
+		seedArr.push_back(faceArr[rng() % faceArr.size()]);
+
+	PsGeomIndex geomIndex;
+	{
+		BenchTimer timer("geom_index_build", faceArr.size());
+		geomIndex.Build(body);
+	}
+
+	std::vector<std::vector<PK_FACE_t>> coplanarArr, concentricArr;
+	{
+		BenchTimer timer("group_coplanar", faceArr.size());
+		geomIndex.GroupCoplanar(s_tol, s_angTol, coplanarArr);
+	}
+	{
+		BenchTimer timer("group_concentric", faceArr.size());
+		geomIndex.GroupConcentric(s_tol, s_angTol, concentricArr);
+	}
+
+	size_t resultCnt = 0;
+	{
+		BenchTimer timer("find_coplanar", seedArr.size());
+		std::vector<PK_ENTITY_t> entityArr;
+		for (size_t i = 0; i < seedArr.size(); i++)
+		{
+			entityArr.clear();
+			geomIndex.FindCoplanar(seedArr[i], s_tol, s_angTol, entityArr);
+			resultCnt += entityArr.size();
+		}
+	}
+	{
+		BenchTimer timer("find_concentric", seedArr.size());
+		std::vector<PK_ENTITY_t> entityArr;
+		for (size_t i = 0; i < seedArr.size(); i++)
+		{
+			entityArr.clear();
+			geomIndex.FindConcentric(seedArr[i], s_tol, s_angTol, entityArr);
+			resultCnt += entityArr.size();
+		}
+	}
+
+	PsFeatureCache featureCache;
+	{
+		BenchTimer timer("feature_cache_classify", faceArr.size());
+		featureCache.Classify(body, geomIndex, s_tol, s_angTol, opts.workerCnt);
+	}
+	{
+		BenchTimer timer("feature_cache_find", seedArr.size() * 3);
+		std::vector<PK_ENTITY_t> entityArr;
+		for (size_t i = 0; i < seedArr.size(); i++)
+		{
+			for (int frType = PsFRType::BOSS; frType <= PsFRType::COPLANAR; frType++)
+			{
+				entityArr.clear();
+				featureCache.Find((PsFRType)frType, seedArr[i], entityArr);
+				resultCnt += entityArr.size();
+			}
+		}
+	}
+
+	// An operation touching a few faces, only they are grouped again
+	{
+		std::vector<PK_FACE_t> changedArr(seedArr.begin(), seedArr.begin() + std::min<size_t>(seedArr.size(), 1000));
+		BenchTimer timer("feature_cache_update", changedArr.size());
+		geomIndex.Update(changedArr, std::vector<PK_TOPOL_t>());
+		featureCache.UpdateEdges(changedArr, std::vector<PK_TOPOL_t>(), opts.workerCnt);
+		featureCache.Classify(body, geomIndex, s_tol, s_angTol, opts.workerCnt);
+	}
+
+	PsModelQuery query(kernel);
+
+	// A full convexity scan per query, as the fallback of PsProcess::FR
+	{
+		size_t bossCnt = std::min<size_t>(seedArr.size(), 10);
+		BenchTimer timer("find_boss_scan", bossCnt);
+		std::vector<PK_ENTITY_t> entityArr;
+		for (size_t i = 0; i < bossCnt; i++)
+		{
+			entityArr.clear();
+			query.FindBoss(body, seedArr[i], entityArr);
+			resultCnt += entityArr.size();
+		}
+	}
+
+	int planeCnt = 0;
+	{
+		BenchTimer timer("get_plane_info", faceArr.size());
+		double position[3], normal[3];
+		for (size_t i = 0; i < faceArr.size(); i++)
+		{
+			if (query.GetPlaneInfo(faceArr[i], 1000.0, position, normal))
+				planeCnt++;
+		}
+	}
+
+	PK_ASSEMBLY_t topAssy = PK_ENTITY_null;
+	if (opts.assyCnt)
+	{
+		stBuildAssemblies(kernel, opts.assyCnt, body, rng);
+
+		BenchTimer timer("find_top_assy", (size_t)opts.assyCnt);
+		topAssy = query.FindTopAssy();
+	}
+
+	bool bTessMatch = true;
+	if (opts.tessFaceCnt)
+		bTessMatch = stBenchTess(opts.tessFaceCnt, rng);
+
+	printf("\nkernel %s, %zu faces, %zu edges, %d planes, %zu coplanar sets, %zu concentric sets, %d boss sets, %zu results, top assembly %d\n",
+		kernel.GetName(), faceArr.size(), edgeArr.size(), planeCnt, coplanarArr.size(), concentricArr.size(),
+		featureCache.GetGroupCount(PsFRType::BOSS, 1), resultCnt, topAssy);
+
+	PsKernel::SetCurrent(NULL);
+
+	if (!bTessMatch)
+	{
+		fprintf(stderr, "The two-pass triangle indices differ from IndicesAsTriangle\n");
+		return 1;
+	}
+
+	if (opts.tracePath && !PerfTrace::Dump(opts.tracePath))
+	{
+		fprintf(stderr, "Cannot write %s\n", opts.tracePath);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,381 @@
+#include "PsKernelStandIn.h"
+#include <math.h>
+#include <numeric>
+
+#ifdef PS_KERNEL_STANDIN
+// The headless tools built without the Parasolid SDK run on the stand-in
+PsKernel* PsKernelCreateDefault()
+{
+	return new PsKernelStandIn();
+}
+#endif
+
+// Unit vector, and a unit vector perpendicular to it
+static void stSetAxis(const double* axis, PK_VECTOR1_t& unitAxis, PK_VECTOR1_t& refDirection)
+{
+	double len = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	for (int i = 0; i < 3; i++)
+		unitAxis.coord[i] = (0.0 < len) ? axis[i] / len : (2 == i ? 1.0 : 0.0);
+
+	// Cross with the world axis the least aligned to the axis
+	int iMin = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (fabs(unitAxis.coord[i]) < fabs(unitAxis.coord[iMin]))
+			iMin = i;
+	}
+
+	double world[3] = { 0.0, 0.0, 0.0 };
+	world[iMin] = 1.0;
+
+	const double* a = unitAxis.coord;
+	double ref[3] = {
+		a[1] * world[2] - a[2] * world[1],
+		a[2] * world[0] - a[0] * world[2],
+		a[0] * world[1] - a[1] * world[0] };
+	len = sqrt(ref[0] * ref[0] + ref[1] * ref[1] + ref[2] * ref[2]);
+	for (int i = 0; i < 3; i++)
+		refDirection.coord[i] = ref[i] / len;
+}
+
+static int stFindRoot(std::vector<int>& parentArr, int i)
+{
+	while (parentArr[i] != i)
+	{
+		parentArr[i] = parentArr[parentArr[i]];
+		i = parentArr[i];
+	}
+	return i;
+}
+
+PsKernelStandIn::PsKernelStandIn()
+{
+}
+
+PsKernelStandIn::~PsKernelStandIn()
+{
+}
+
+void PsKernelStandIn::Clear()
+{
+	m_entityArr.clear();
+	m_bodyArr.clear();
+	m_faceArr.clear();
+	m_edgeArr.clear();
+	m_surfArr.clear();
+	m_assyArr.clear();
+}
+
+PK_ENTITY_t PsKernelStandIn::addEntity(const PK_CLASS_t entityClass, const int index)
+{
+	Entity entity = { entityClass, index };
+	m_entityArr.push_back(entity);
+
+	return (PK_ENTITY_t)m_entityArr.size();
+}
+
+const PsKernelStandIn::Entity* PsKernelStandIn::findEntity(const PK_ENTITY_t entity, const PK_CLASS_t entityClass) const
+{
+	if (entity <= 0 || (int)m_entityArr.size() < entity)
+		return NULL;
+
+	const Entity* pEntity = &m_entityArr[entity - 1];
+	if (entityClass != pEntity->entityClass)
+		return NULL;
+
+	return pEntity;
+}
+
+PK_SURF_t PsKernelStandIn::addSurf(const PK_CLASS_t surfClass, const double* location, const double* axis, const double radius)
+{
+	Surf surf;
+	for (int i = 0; i < 3; i++)
+		surf.basis_set.location.coord[i] = location[i];
+	stSetAxis(axis, surf.basis_set.axis, surf.basis_set.ref_direction);
+	surf.radius = radius;
+
+	m_surfArr.push_back(surf);
+
+	return addEntity(surfClass, (int)m_surfArr.size() - 1);
+}
+
+PK_FACE_t PsKernelStandIn::addFace(const PK_BODY_t body, const PK_SURF_t surf)
+{
+	Body& bodyData = m_bodyArr[m_entityArr[body - 1].index];
+
+	Face face;
+	face.body = body;
+	face.surf = surf;
+	face.bodyIndex = (int)bodyData.faceArr.size();
+	m_faceArr.push_back(face);
+
+	PK_FACE_t faceTag = addEntity(PK_CLASS_face, (int)m_faceArr.size() - 1);
+	bodyData.faceArr.push_back(faceTag);
+
+	return faceTag;
+}
+
+PK_BODY_t PsKernelStandIn::CreateBody()
+{
+	m_bodyArr.push_back(Body());
+
+	return addEntity(PK_CLASS_body, (int)m_bodyArr.size() - 1);
+}
+
+PK_FACE_t PsKernelStandIn::AddPlane(const PK_BODY_t body, const double* location, const double* normal)
+{
+	if (NULL == findEntity(body, PK_CLASS_body))
+		return PK_ENTITY_null;
+
+	return addFace(body, addSurf(PK_CLASS_plane, location, normal, 0.0));
+}
+
+PK_FACE_t PsKernelStandIn::AddCylinder(const PK_BODY_t body, const double* location, const double* axis, const double radius)
+{
+	if (NULL == findEntity(body, PK_CLASS_body))
+		return PK_ENTITY_null;
+
+	return addFace(body, addSurf(PK_CLASS_cyl, location, axis, radius));
+}
+
+PK_EDGE_t PsKernelStandIn::AddEdge(const PK_FACE_t face1, const PK_FACE_t face2, const PK_emboss_convexity_t convexity)
+{
+	const Entity* pFace1 = findEntity(face1, PK_CLASS_face);
+	const Entity* pFace2 = findEntity(face2, PK_CLASS_face);
+	if (NULL == pFace1 || NULL == pFace2 || m_faceArr[pFace1->index].body != m_faceArr[pFace2->index].body)
+		return PK_ENTITY_null;
+
+	// The entity table grows below
+	int iFace1 = pFace1->index;
+	int iFace2 = pFace2->index;
+
+	Edge edge = { { face1, face2 }, convexity };
+	m_edgeArr.push_back(edge);
+
+	PK_EDGE_t edgeTag = addEntity(PK_CLASS_edge, (int)m_edgeArr.size() - 1);
+
+	m_faceArr[iFace1].edgeArr.push_back(edgeTag);
+	if (face1 != face2)
+		m_faceArr[iFace2].edgeArr.push_back(edgeTag);
+
+	PK_BODY_t body = m_faceArr[iFace1].body;
+	m_bodyArr[m_entityArr[body - 1].index].edgeArr.push_back(edgeTag);
+
+	return edgeTag;
+}
+
+PK_ASSEMBLY_t PsKernelStandIn::CreateAssembly()
+{
+	Assy assy;
+	assy.assy = (PK_ASSEMBLY_t)m_entityArr.size() + 1;
+	m_assyArr.push_back(assy);
+
+	return addEntity(PK_CLASS_assembly, (int)m_assyArr.size() - 1);
+}
+
+bool PsKernelStandIn::AddInstance(const PK_ASSEMBLY_t assy, const PK_PART_t part)
+{
+	const Entity* pAssy = findEntity(assy, PK_CLASS_assembly);
+	if (NULL == pAssy || (NULL == findEntity(part, PK_CLASS_body) && NULL == findEntity(part, PK_CLASS_assembly)))
+		return false;
+
+	m_assyArr[pAssy->index].partArr.push_back(part);
+
+	return true;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskClass(const PK_ENTITY_t entity, PK_CLASS_t& entityClass) const
+{
+	if (entity <= 0 || (int)m_entityArr.size() < entity)
+		return PK_ERROR_not_an_entity;
+
+	entityClass = m_entityArr[entity - 1].entityClass;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskBodyFaces(const PK_BODY_t body, std::vector<PK_FACE_t>& faceArr) const
+{
+	const Entity* pBody = findEntity(body, PK_CLASS_body);
+	if (NULL == pBody)
+		return PK_ERROR_wrong_entity;
+
+	faceArr = m_bodyArr[pBody->index].faceArr;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskBodyEdges(const PK_BODY_t body, std::vector<PK_EDGE_t>& edgeArr) const
+{
+	const Entity* pBody = findEntity(body, PK_CLASS_body);
+	if (NULL == pBody)
+		return PK_ERROR_wrong_entity;
+
+	edgeArr = m_bodyArr[pBody->index].edgeArr;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskFaceBody(const PK_FACE_t face, PK_BODY_t& body) const
+{
+	const Entity* pFace = findEntity(face, PK_CLASS_face);
+	if (NULL == pFace)
+		return PK_ERROR_wrong_entity;
+
+	body = m_faceArr[pFace->index].body;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskFaceEdges(const PK_FACE_t face, std::vector<PK_EDGE_t>& edgeArr) const
+{
+	const Entity* pFace = findEntity(face, PK_CLASS_face);
+	if (NULL == pFace)
+		return PK_ERROR_wrong_entity;
+
+	edgeArr = m_faceArr[pFace->index].edgeArr;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskEdgeConvexity(const PK_EDGE_t edge, PK_emboss_convexity_t& convexity) const
+{
+	const Entity* pEdge = findEntity(edge, PK_CLASS_edge);
+	if (NULL == pEdge)
+		return PK_ERROR_wrong_entity;
+
+	convexity = m_edgeArr[pEdge->index].convexity;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::FindFacesets(const PK_BODY_t body, const std::vector<PK_EDGE_t>& boundEdgeArr, const PK_FACE_t selectingFace,
+	std::vector<std::vector<PK_FACE_t>>& facesetArr) const
+{
+	const Entity* pBody = findEntity(body, PK_CLASS_body);
+	if (NULL == pBody)
+		return PK_ERROR_wrong_entity;
+
+	const Body& bodyData = m_bodyArr[pBody->index];
+
+	// Bounding edges have to be edges of the body, as the kernel checks
+	std::vector<char> boundArr(m_edgeArr.size(), 0);
+	for (size_t i = 0; i < boundEdgeArr.size(); i++)
+	{
+		const Entity* pEdge = findEntity(boundEdgeArr[i], PK_CLASS_edge);
+		if (NULL == pEdge || body != m_faceArr[m_entityArr[m_edgeArr[pEdge->index].faces[0] - 1].index].body)
+			return PK_ERROR_wrong_entity;
+
+		boundArr[pEdge->index] = 1;
+	}
+
+	int iSelecting = -1;
+	if (PK_ENTITY_null != selectingFace)
+	{
+		const Entity* pFace = findEntity(selectingFace, PK_CLASS_face);
+		if (NULL == pFace || body != m_faceArr[pFace->index].body)
+			return PK_ERROR_wrong_entity;
+
+		iSelecting = m_faceArr[pFace->index].bodyIndex;
+	}
+
+	// Faces joined by an edge which is not a bound are in the same faceset
+	std::vector<int> parentArr(bodyData.faceArr.size());
+	std::iota(parentArr.begin(), parentArr.end(), 0);
+
+	for (size_t i = 0; i < bodyData.edgeArr.size(); i++)
+	{
+		int iEdge = m_entityArr[bodyData.edgeArr[i] - 1].index;
+		if (boundArr[iEdge])
+			continue;
+
+		const Edge& edge = m_edgeArr[iEdge];
+		int root1 = stFindRoot(parentArr, m_faceArr[m_entityArr[edge.faces[0] - 1].index].bodyIndex);
+		int root2 = stFindRoot(parentArr, m_faceArr[m_entityArr[edge.faces[1] - 1].index].bodyIndex);
+		if (root1 != root2)
+			parentArr[root2] = root1;
+	}
+
+	// Facesets in the order of their first face
+	facesetArr.clear();
+	if (0 <= iSelecting)
+	{
+		int root = stFindRoot(parentArr, iSelecting);
+		facesetArr.resize(1);
+		for (size_t i = 0; i < bodyData.faceArr.size(); i++)
+		{
+			if (root == stFindRoot(parentArr, (int)i))
+				facesetArr[0].push_back(bodyData.faceArr[i]);
+		}
+		return PK_ERROR_no_errors;
+	}
+
+	std::vector<int> facesetIndexArr(bodyData.faceArr.size(), -1);
+	for (size_t i = 0; i < bodyData.faceArr.size(); i++)
+	{
+		int root = stFindRoot(parentArr, (int)i);
+		if (-1 == facesetIndexArr[root])
+		{
+			facesetIndexArr[root] = (int)facesetArr.size();
+			facesetArr.push_back(std::vector<PK_FACE_t>());
+		}
+		facesetArr[facesetIndexArr[root]].push_back(bodyData.faceArr[i]);
+	}
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskFaceSurf(const PK_FACE_t face, PK_SURF_t& surf) const
+{
+	const Entity* pFace = findEntity(face, PK_CLASS_face);
+	if (NULL == pFace)
+		return PK_ERROR_wrong_entity;
+
+	surf = m_faceArr[pFace->index].surf;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskPlane(const PK_PLANE_t plane, PK_PLANE_sf_t& plane_sf) const
+{
+	const Entity* pSurf = findEntity(plane, PK_CLASS_plane);
+	if (NULL == pSurf)
+		return PK_ERROR_wrong_entity;
+
+	plane_sf.basis_set = m_surfArr[pSurf->index].basis_set;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskCyl(const PK_CYL_t cyl, PK_CYL_sf_t& cyl_sf) const
+{
+	const Entity* pSurf = findEntity(cyl, PK_CLASS_cyl);
+	if (NULL == pSurf)
+		return PK_ERROR_wrong_entity;
+
+	cyl_sf.basis_set = m_surfArr[pSurf->index].basis_set;
+	cyl_sf.radius = m_surfArr[pSurf->index].radius;
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskAssemblies(std::vector<PK_ASSEMBLY_t>& assyArr) const
+{
+	assyArr.clear();
+	assyArr.reserve(m_assyArr.size());
+	for (size_t i = 0; i < m_assyArr.size(); i++)
+		assyArr.push_back(m_assyArr[i].assy);
+
+	return PK_ERROR_no_errors;
+}
+
+PK_ERROR_code_t PsKernelStandIn::AskInstanceParts(const PK_ASSEMBLY_t assy, std::vector<PK_PART_t>& partArr) const
+{
+	const Entity* pAssy = findEntity(assy, PK_CLASS_assembly);
+	if (NULL == pAssy)
+		return PK_ERROR_wrong_entity;
+
+	partArr = m_assyArr[pAssy->index].partArr;
+
+	return PK_ERROR_no_errors;
+}
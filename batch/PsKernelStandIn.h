@@ -0,0 +1,96 @@
+#pragma once
+#include "PsKernel.h"
+
+// In-memory B-rep for PsKernel: bodies of planar and cylindrical faces joined by edges of a given convexity,
+// and assemblies instancing parts. Only the enquiries are implemented, the model is built by the caller.
+// Tags are the indices in the entity table plus one, they are never reused until Clear().
+// Enquiries don't modify the model, so they can run on several threads while nothing is added.
+class PsKernelStandIn : public PsKernel
+{
+public:
+	PsKernelStandIn();
+	~PsKernelStandIn();
+
+private:
+	struct Entity
+	{
+		PK_CLASS_t entityClass;
+		int index;
+	};
+
+	struct Body
+	{
+		std::vector<PK_FACE_t> faceArr;
+		std::vector<PK_EDGE_t> edgeArr;
+	};
+
+	struct Face
+	{
+		PK_BODY_t body;
+		PK_SURF_t surf;
+		int bodyIndex;		// In Body::faceArr
+		std::vector<PK_EDGE_t> edgeArr;
+	};
+
+	struct Edge
+	{
+		PK_FACE_t faces[2];
+		PK_emboss_convexity_t convexity;
+	};
+
+	struct Surf
+	{
+		PK_AXIS2_sf_t basis_set;
+		double radius;
+	};
+
+	struct Assy
+	{
+		PK_ASSEMBLY_t assy;
+		std::vector<PK_PART_t> partArr;	// Instanced parts
+	};
+
+	std::vector<Entity> m_entityArr;
+	std::vector<Body> m_bodyArr;
+	std::vector<Face> m_faceArr;
+	std::vector<Edge> m_edgeArr;
+	std::vector<Surf> m_surfArr;
+	std::vector<Assy> m_assyArr;
+
+	PK_ENTITY_t addEntity(const PK_CLASS_t entityClass, const int index);
+	const Entity* findEntity(const PK_ENTITY_t entity, const PK_CLASS_t entityClass) const;
+	PK_SURF_t addSurf(const PK_CLASS_t surfClass, const double* location, const double* axis, const double radius);
+	PK_FACE_t addFace(const PK_BODY_t body, const PK_SURF_t surf);
+
+public:
+	void Clear();
+	size_t GetEntityCount() const { return m_entityArr.size(); }
+
+	// Model building, PK_ENTITY_null if an argument isn't of the expected class
+	PK_BODY_t CreateBody();
+	PK_FACE_t AddPlane(const PK_BODY_t body, const double* location, const double* normal);
+	PK_FACE_t AddCylinder(const PK_BODY_t body, const double* location, const double* axis, const double radius);
+	PK_EDGE_t AddEdge(const PK_FACE_t face1, const PK_FACE_t face2, const PK_emboss_convexity_t convexity);
+	PK_ASSEMBLY_t CreateAssembly();
+	bool AddInstance(const PK_ASSEMBLY_t assy, const PK_PART_t part);
+
+	// PsKernel
+	const char* GetName() const override { return "standin"; }
+
+	PK_ERROR_code_t AskClass(const PK_ENTITY_t entity, PK_CLASS_t& entityClass) const override;
+
+	PK_ERROR_code_t AskBodyFaces(const PK_BODY_t body, std::vector<PK_FACE_t>& faceArr) const override;
+	PK_ERROR_code_t AskBodyEdges(const PK_BODY_t body, std::vector<PK_EDGE_t>& edgeArr) const override;
+	PK_ERROR_code_t AskFaceBody(const PK_FACE_t face, PK_BODY_t& body) const override;
+	PK_ERROR_code_t AskFaceEdges(const PK_FACE_t face, std::vector<PK_EDGE_t>& edgeArr) const override;
+	PK_ERROR_code_t AskEdgeConvexity(const PK_EDGE_t edge, PK_emboss_convexity_t& convexity) const override;
+	PK_ERROR_code_t FindFacesets(const PK_BODY_t body, const std::vector<PK_EDGE_t>& boundEdgeArr, const PK_FACE_t selectingFace,
+		std::vector<std::vector<PK_FACE_t>>& facesetArr) const override;
+
+	PK_ERROR_code_t AskFaceSurf(const PK_FACE_t face, PK_SURF_t& surf) const override;
+	PK_ERROR_code_t AskPlane(const PK_PLANE_t plane, PK_PLANE_sf_t& plane_sf) const override;
+	PK_ERROR_code_t AskCyl(const PK_CYL_t cyl, PK_CYL_sf_t& cyl_sf) const override;
+
+	PK_ERROR_code_t AskAssemblies(std::vector<PK_ASSEMBLY_t>& assyArr) const override;
+	PK_ERROR_code_t AskInstanceParts(const PK_ASSEMBLY_t assy, std::vector<PK_PART_t>& partArr) const override;
+};
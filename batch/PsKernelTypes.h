@@ -0,0 +1,68 @@
+#pragma once
+// PK tags, structures and constants used by the kernel-independent algorithms, for the builds without the Parasolid SDK (PS_KERNEL_STANDIN).
+// The layouts follow parasolid_kernel.h, the values only have to be distinct.
+
+typedef int PK_ENTITY_t;
+typedef PK_ENTITY_t PK_PART_t;
+typedef PK_ENTITY_t PK_BODY_t;
+typedef PK_ENTITY_t PK_ASSEMBLY_t;
+typedef PK_ENTITY_t PK_INSTANCE_t;
+typedef PK_ENTITY_t PK_TOPOL_t;
+typedef PK_ENTITY_t PK_FACE_t;
+typedef PK_ENTITY_t PK_EDGE_t;
+typedef PK_ENTITY_t PK_SURF_t;
+typedef PK_ENTITY_t PK_PLANE_t;
+typedef PK_ENTITY_t PK_CYL_t;
+typedef int PK_CLASS_t;
+typedef int PK_ERROR_code_t;
+typedef int PK_emboss_convexity_t;
+typedef int PK_LOGICAL_t;
+
+#define PK_ENTITY_null 0
+#define PK_LOGICAL_false 0
+#define PK_LOGICAL_true 1
+
+#define PK_ERROR_no_errors 0
+#define PK_ERROR_not_an_entity 1
+#define PK_ERROR_wrong_entity 2
+
+#define PK_CLASS_body 1
+#define PK_CLASS_assembly 2
+#define PK_CLASS_face 4
+#define PK_CLASS_edge 5
+#define PK_CLASS_plane 6
+#define PK_CLASS_cyl 7
+
+#define PK_EDGE_convexity_unknown_c 0
+#define PK_EDGE_convexity_convex_c 1
+#define PK_EDGE_convexity_concave_c 2
+#define PK_EDGE_convexity_smooth_cvx_c 3
+#define PK_EDGE_convexity_smooth_ccv_c 4
+#define PK_EDGE_convexity_variable_c 5
+
+struct PK_VECTOR_t
+{
+	double coord[3];
+};
+
+typedef PK_VECTOR_t PK_VECTOR1_t;
+
+struct PK_AXIS2_sf_t
+{
+	PK_VECTOR_t location;
+	PK_VECTOR1_t axis;
+	PK_VECTOR1_t ref_direction;
+};
+
+typedef PK_AXIS2_sf_t PK_AXIS2_sf_s;
+
+struct PK_PLANE_sf_t
+{
+	PK_AXIS2_sf_t basis_set;
+};
+
+struct PK_CYL_sf_t
+{
+	PK_AXIS2_sf_t basis_set;
+	double radius;
+};
@@ -4,6 +4,11 @@
 
 #pragma once
 
+#ifdef PS_HEADLESS
+// Kernel sources built without MFC and HPS (batch runner)
+#include "batch/PsHeadless.h"
+#else
+
 #ifndef _SECURE_ATL
 #define _SECURE_ATL 1
 #endif
@@ -62,3 +67,5 @@
 #ifdef USING_DWG
 #include "sprk_dwg.h"
 #endif
+
+#endif // PS_HEADLESS
@@ -12,7 +12,11 @@
 #ifndef A3D_CONNECTOR
 #define A3D_CONNECTOR
 
+#ifndef A3D_TESS_STANDIN
 #include <A3DSDKIncludes.h>
+#else
+#include "batch/A3DTessStandIn.h"
+#endif
 //#include <A3DInternalExports.h>
 #ifndef WIN32
 #define strcpy_s(dst, dst_size, src) strcpy((dst), (src))
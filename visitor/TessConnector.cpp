@@ -15,7 +15,9 @@ This file provide tools to get the tessellation of Cad Models
 ***********************************************************************************************************************/
 
 #include "TessConnector.h"
+#ifndef A3D_TESS_STANDIN
 #include "VisitorContainer.h"
+#endif
 #include <algorithm>
 
 ////////////////////////////////////////
@@ -435,6 +437,478 @@ A3DStatus A3DTessDataConnector::IndicesPerFaceAsTriangle(
 	return	 A3D_SUCCESS;
 }
 
+// Number of triangles of a fan / stripe of uiNbPoint points
+static inline A3DUns32 stNbTriangle(A3DUns32 uiNbPoint)
+{
+	return uiNbPoint > 2 ? uiNbPoint - 2 : 0;
+}
+
+// Fan with uStride indices per vertex: every triangle is (first vertex, i, i+1)
+template <unsigned uStride>
+static inline unsigned* stFillFan(unsigned* puOut, const A3DUns32* puiFan, const A3DUns32* puiPoint, A3DUns32 uiNbTriangle)
+{
+	for (A3DUns32 uI = 0; uI < uiNbTriangle; uI++)
+	{
+		for (unsigned uK = 0; uK < uStride; uK++)
+		{
+			puOut[uK] = puiFan[uK];
+			puOut[uStride + uK] = puiPoint[uK];
+			puOut[2 * uStride + uK] = puiPoint[uStride + uK];
+		}
+		puOut += 3 * uStride;
+		puiPoint += uStride;
+	}
+	return puOut;
+}
+
+// Stripe with uStride indices per vertex, puiPoint is the 2nd vertex of the stripe.
+// Triangles are written by pairs so the winding doesn't need a branch per triangle.
+template <unsigned uStride>
+static inline unsigned* stFillStripe(unsigned* puOut, const A3DUns32* puiPoint, A3DUns32 uiNbTriangle)
+{
+	const A3DUns32* puiPrev = puiPoint - uStride;
+	A3DUns32 uI = 0;
+	for (; uI + 1 < uiNbTriangle; uI += 2)
+	{
+		for (unsigned uK = 0; uK < uStride; uK++)
+		{
+			// even: (i, i+1, i-1)
+			puOut[uK] = puiPoint[uK];
+			puOut[uStride + uK] = puiPoint[uStride + uK];
+			puOut[2 * uStride + uK] = puiPrev[uK];
+			// odd: (i+1, i, i+2)
+			puOut[3 * uStride + uK] = puiPoint[uStride + uK];
+			puOut[4 * uStride + uK] = puiPoint[uK];
+			puOut[5 * uStride + uK] = puiPoint[2 * uStride + uK];
+		}
+		puOut += 6 * uStride;
+		puiPoint += 2 * uStride;
+		puiPrev += 2 * uStride;
+	}
+	if (uI < uiNbTriangle)
+	{
+		for (unsigned uK = 0; uK < uStride; uK++)
+		{
+			puOut[uK] = puiPoint[uK];
+			puOut[uStride + uK] = puiPoint[uStride + uK];
+			puOut[2 * uStride + uK] = puiPrev[uK];
+		}
+		puOut += 3 * uStride;
+	}
+	return puOut;
+}
+
+// Retrieve the exact number of indices IndicesPerFaceAsTriangleFill writes for a face
+A3DStatus A3DTessDataConnector::IndicesPerFaceAsTriangleSize(
+					const unsigned& uFaceIndice,
+					unsigned& uTriangleWithPoint_Normals_Size,
+					unsigned& uTriangleWithPoint_Normals_UV_Size) const
+{
+	uTriangleWithPoint_Normals_Size = 0;
+	uTriangleWithPoint_Normals_UV_Size = 0;
+
+	A3DTessFaceData* pFaceTessData =	&(m_sTessData.m_psFaceTessData[uFaceIndice]);
+
+	if (!pFaceTessData->m_uiSizesTriangulatedSize)
+		return A3D_SUCCESS;
+
+	const A3DUns32* puiSizes = pFaceTessData->m_puiSizesTriangulated;
+	const A3DUns16 usFlags = pFaceTessData->m_usUsedEntitiesFlags;
+	unsigned uiCurrentSize = 0;
+	A3DUns32 uiNbTriangle = 0, uiNbTriangleTextured = 0;
+
+	if (usFlags & kA3DTessFaceDataTriangle)
+		uiNbTriangle += puiSizes[uiCurrentSize++];
+
+	if (usFlags & kA3DTessFaceDataTriangleFan)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+			uiNbTriangle += stNbTriangle(puiSizes[uiCurrentSize++]);
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleStripe)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+			uiNbTriangle += stNbTriangle(puiSizes[uiCurrentSize++]);
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleOneNormal)
+		uiNbTriangle += puiSizes[uiCurrentSize++];
+
+	if (usFlags & kA3DTessFaceDataTriangleFanOneNormal)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+		{
+			if ((puiSizes[uiCurrentSize] & kA3DTessFaceDataNormalSingle) == 0)
+				return A3D_ERROR;
+			uiNbTriangle += stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+		}
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleStripeOneNormal)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+			uiNbTriangle += stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleTextured)
+		uiNbTriangleTextured += puiSizes[uiCurrentSize++];
+
+	if (usFlags & kA3DTessFaceDataTriangleFanTextured)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+			uiNbTriangleTextured += stNbTriangle(puiSizes[uiCurrentSize++]);
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleStripeTextured)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+			uiNbTriangleTextured += stNbTriangle(puiSizes[uiCurrentSize++]);
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleOneNormalTextured)
+		uiNbTriangleTextured += puiSizes[uiCurrentSize++];
+
+	if (usFlags & kA3DTessFaceDataTriangleFanOneNormalTextured)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+		{
+			if ((puiSizes[uiCurrentSize] & kA3DTessFaceDataNormalSingle) == 0)
+				return A3D_ERROR;
+			uiNbTriangleTextured += stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+		}
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleStripeOneNormalTextured)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+		{
+			if ((puiSizes[uiCurrentSize] & kA3DTessFaceDataNormalSingle) == 0)
+				return A3D_ERROR;
+			uiNbTriangleTextured += stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+		}
+	}
+
+	// (normal, point) x 3 and (normal, point, UV) x 3 per triangle
+	uTriangleWithPoint_Normals_Size = uiNbTriangle * 6;
+	uTriangleWithPoint_Normals_UV_Size = uiNbTriangleTextured * 9;
+	return A3D_SUCCESS;
+}
+
+// Same output as IndicesPerFaceAsTriangle, written to buffers sized by IndicesPerFaceAsTriangleSize
+A3DStatus A3DTessDataConnector::IndicesPerFaceAsTriangleFill(
+					const unsigned& uFaceIndice,
+					unsigned* puTriangleWithPoint_Normals_Indices,
+					unsigned* puTriangleWithPoint_Normals_UV_Indices) const
+{
+	A3DTessFaceData* pFaceTessData =	&(m_sTessData.m_psFaceTessData[uFaceIndice]);
+
+	if (!pFaceTessData->m_uiSizesTriangulatedSize)
+		return A3D_SUCCESS;
+
+	const A3DUns32* puiSizes = pFaceTessData->m_puiSizesTriangulated;
+	const A3DUns16 usFlags = pFaceTessData->m_usUsedEntitiesFlags;
+	const A3DUns32* puiTriangulatedIndexes = m_sTessData.m_puiTriangulatedIndexes 
+									+ pFaceTessData->m_uiStartTriangulated;
+	unsigned uiCurrentSize = 0;
+	unsigned* puOut = puTriangleWithPoint_Normals_Indices;
+	unsigned* puOutUV = puTriangleWithPoint_Normals_UV_Indices;
+
+	// Triangle One Normal Per vertex  
+	if (usFlags & kA3DTessFaceDataTriangle)
+	{
+		unsigned uiNbIndice = puiSizes[uiCurrentSize++] * 6;
+		std::copy(puiTriangulatedIndexes, puiTriangulatedIndexes + uiNbIndice, puOut);
+		puOut += uiNbIndice;
+		puiTriangulatedIndexes += uiNbIndice;
+	}
+
+	// Fan One Normal per vertex
+	if (usFlags & kA3DTessFaceDataTriangleFan)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+		{
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++]);
+			puOut = stFillFan<2>(puOut, puiTriangulatedIndexes, puiTriangulatedIndexes + 2, uiNbTriangle);
+			puiTriangulatedIndexes += (uiNbTriangle + 2) * 2;
+		}
+	}
+
+	// stripe One normal per vertex
+	if (usFlags & kA3DTessFaceDataTriangleStripe)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+		{
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++]);
+			puOut = stFillStripe<2>(puOut, puiTriangulatedIndexes + 2, uiNbTriangle);
+			puiTriangulatedIndexes += (uiNbTriangle + 2) * 2;
+		}
+	}
+
+	//Triangle one Normal Per entity: normal, point, point, point
+	if (usFlags & kA3DTessFaceDataTriangleOneNormal)
+	{
+		A3DUns32 uNbTriangles = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uI = 0; uI < uNbTriangles; uI++)
+		{
+			puOut[0] = puiTriangulatedIndexes[0];
+			puOut[1] = puiTriangulatedIndexes[1];
+			puOut[2] = puiTriangulatedIndexes[0];
+			puOut[3] = puiTriangulatedIndexes[2];
+			puOut[4] = puiTriangulatedIndexes[0];
+			puOut[5] = puiTriangulatedIndexes[3];
+			puOut += 6;
+			puiTriangulatedIndexes += 4;
+		}
+	}
+
+	// Fan One normal per entity: normal, point, ..., point
+	if (usFlags & kA3DTessFaceDataTriangleFanOneNormal)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+		{
+			if ((puiSizes[uiCurrentSize] & kA3DTessFaceDataNormalSingle) == 0)
+				return A3D_ERROR;
+
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+			const A3DUns32 uiNormal = puiTriangulatedIndexes[0];
+			const A3DUns32 uiFirst = puiTriangulatedIndexes[1];
+			const A3DUns32* puiPoint = puiTriangulatedIndexes + 2;
+			for (A3DUns32 uI = 0; uI < uiNbTriangle; uI++)
+			{
+				puOut[0] = uiNormal;
+				puOut[1] = uiFirst;
+				puOut[2] = uiNormal;
+				puOut[3] = puiPoint[uI];
+				puOut[4] = uiNormal;
+				puOut[5] = puiPoint[uI + 1];
+				puOut += 6;
+			}
+			puiTriangulatedIndexes += uiNbTriangle + 3;
+		}
+	}
+
+	// Stripe One normal per entity
+	if (usFlags & kA3DTessFaceDataTriangleStripeOneNormal)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+		{
+			bool bIsOneNormal = (puiSizes[uiCurrentSize] & kA3DTessFaceDataNormalSingle) != 0;
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+
+			// Is there only one normal for the entire stripe?
+			if (bIsOneNormal == false)
+			{
+				puOut = stFillStripe<2>(puOut, puiTriangulatedIndexes + 2, uiNbTriangle);
+				puiTriangulatedIndexes += (uiNbTriangle + 2) * 2;
+				continue;
+			}
+
+			const A3DUns32 uiNormal = puiTriangulatedIndexes[0];
+			const A3DUns32* puiPoint = puiTriangulatedIndexes + 2;
+			const A3DUns32* puiPrev = puiTriangulatedIndexes + 1;
+			A3DUns32 uI = 0;
+			for (; uI + 1 < uiNbTriangle; uI += 2)
+			{
+				puOut[0] = uiNormal;
+				puOut[1] = puiPoint[uI];
+				puOut[2] = uiNormal;
+				puOut[3] = puiPoint[uI + 1];
+				puOut[4] = uiNormal;
+				puOut[5] = puiPrev[uI];
+				puOut[6] = uiNormal;
+				puOut[7] = puiPoint[uI + 1];
+				puOut[8] = uiNormal;
+				puOut[9] = puiPoint[uI];
+				puOut[10] = uiNormal;
+				puOut[11] = puiPoint[uI + 2];
+				puOut += 12;
+			}
+			if (uI < uiNbTriangle)
+			{
+				puOut[0] = uiNormal;
+				puOut[1] = puiPoint[uI];
+				puOut[2] = uiNormal;
+				puOut[3] = puiPoint[uI + 1];
+				puOut[4] = uiNormal;
+				puOut[5] = puiPrev[uI];
+				puOut += 6;
+			}
+			puiTriangulatedIndexes += uiNbTriangle + 3;
+		}
+	}
+
+	// Textured triangle One normal per vertex
+	if (usFlags & kA3DTessFaceDataTriangleTextured)
+	{
+		unsigned uiNbIndice = puiSizes[uiCurrentSize++] * 9;
+		std::copy(puiTriangulatedIndexes, puiTriangulatedIndexes + uiNbIndice, puOutUV);
+		puOutUV += uiNbIndice;
+		puiTriangulatedIndexes += uiNbIndice;
+	}
+
+	// Textured Fan One normal per vertex
+	if (usFlags & kA3DTessFaceDataTriangleFanTextured)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+		{
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++]);
+			puOutUV = stFillFan<3>(puOutUV, puiTriangulatedIndexes, puiTriangulatedIndexes + 3, uiNbTriangle);
+			puiTriangulatedIndexes += (uiNbTriangle + 2) * 3;
+		}
+	}
+
+	//Textured Stripe One normal per vertex
+	if (usFlags & kA3DTessFaceDataTriangleStripeTextured)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+		{
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++]);
+			puOutUV = stFillStripe<3>(puOutUV, puiTriangulatedIndexes + 3, uiNbTriangle);
+			puiTriangulatedIndexes += (uiNbTriangle + 2) * 3;
+		}
+	}
+
+	// Textured One normal per Triangle: normal, {texture, point} x 3
+	if (usFlags & kA3DTessFaceDataTriangleOneNormalTextured)
+	{
+		A3DUns32 uNbTriangles = puiSizes[uiCurrentSize++];
+		for (A3DUns32 uI = 0; uI < uNbTriangles; uI++)
+		{
+			puOutUV[0] = puiTriangulatedIndexes[0];
+			puOutUV[1] = puiTriangulatedIndexes[1];
+			puOutUV[2] = puiTriangulatedIndexes[2];
+			puOutUV[3] = puiTriangulatedIndexes[0];
+			puOutUV[4] = puiTriangulatedIndexes[3];
+			puOutUV[5] = puiTriangulatedIndexes[4];
+			puOutUV[6] = puiTriangulatedIndexes[0];
+			puOutUV[7] = puiTriangulatedIndexes[5];
+			puOutUV[8] = puiTriangulatedIndexes[6];
+			puOutUV += 9;
+			puiTriangulatedIndexes += 7;
+		}
+	}
+
+	// Same index walk as IndicesPerFaceAsTriangle for the one normal textured fans and stripes
+	if (usFlags & kA3DTessFaceDataTriangleFanOneNormalTextured)
+	{
+		A3DUns32 uiNbFan = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiFan = 0; uiFan < uiNbFan; uiFan++)
+		{
+			if ((puiSizes[uiCurrentSize] & kA3DTessFaceDataNormalSingle) == 0)
+				return A3D_ERROR;
+
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+			const A3DUns32* puiFan = puiTriangulatedIndexes;
+			const A3DUns32* puiPoint = puiTriangulatedIndexes + 2;
+			for (A3DUns32 uI = 0; uI < uiNbTriangle; uI++)
+			{
+				puOutUV[0] = puiFan[0];
+				puOutUV[1] = puiFan[1];
+				puOutUV[2] = puiFan[2];
+				puOutUV[3] = puiFan[0];
+				puOutUV[4] = puiPoint[0];
+				puOutUV[5] = puiPoint[1];
+				puOutUV[6] = puiFan[0];
+				puOutUV[7] = puiPoint[2];
+				puOutUV[8] = puiPoint[3];
+				puOutUV += 9;
+				puiPoint += 2;
+			}
+			puiTriangulatedIndexes += (uiNbTriangle + 2) * 2;
+		}
+	}
+
+	if (usFlags & kA3DTessFaceDataTriangleStripeOneNormalTextured)
+	{
+		A3DUns32 uiNbStripe = puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask;
+		for (A3DUns32 uiStripe = 0; uiStripe < uiNbStripe; uiStripe++)
+		{
+			if ((puiSizes[uiCurrentSize] & kA3DTessFaceDataNormalSingle) == 0)
+				return A3D_ERROR;
+
+			A3DUns32 uiNbTriangle = stNbTriangle(puiSizes[uiCurrentSize++] & kA3DTessFaceDataNormalMask);
+			const A3DUns32 uiNormal = puiTriangulatedIndexes[0];
+			const A3DUns32* puiPoint = puiTriangulatedIndexes + 3;
+			for (A3DUns32 uI = 0; uI < uiNbTriangle; uI++)
+			{
+				const A3DUns32* puiFirst = (uI % 2) ? puiPoint - 2 : puiPoint + 2;
+				const A3DUns32* puiSecond = (uI % 2) ? puiPoint + 2 : puiPoint - 2;
+				puOutUV[0] = uiNormal;
+				puOutUV[1] = puiPoint[0];
+				puOutUV[2] = puiPoint[1];
+				puOutUV[3] = uiNormal;
+				puOutUV[4] = puiFirst[0];
+				puOutUV[5] = puiFirst[1];
+				puOutUV[6] = uiNormal;
+				puOutUV[7] = puiSecond[0];
+				puOutUV[8] = puiSecond[1];
+				puOutUV += 9;
+				puiPoint += 2;
+			}
+			puiTriangulatedIndexes = puiPoint;
+		}
+	}
+
+	return	 A3D_SUCCESS;
+}
+
+// Two-pass version of IndicesAsTriangle: sizes of all the faces first, then one fill per face
+A3DStatus A3DTessDataConnector::IndicesAsTriangleTwoPass(
+					std::vector<unsigned>& auTriangleWithPoint_Normals_Indices,
+					std::vector<unsigned>& auTriangleWithPoint_Normals_UV_Indices,
+					std::vector<unsigned>* pauFaceOffsets) const
+{
+	A3DStatus iRet = A3D_SUCCESS;
+	unsigned uFaceCount, uFaceSize = m_sTessData.m_uiFaceTessSize;
+
+	std::vector<unsigned> auSizes(uFaceSize * 2);
+	size_t uTotal = 0, uTotalUV = 0;
+	for (uFaceCount = 0; uFaceCount < uFaceSize; uFaceCount++)
+	{
+		CHECK_RET(IndicesPerFaceAsTriangleSize(uFaceCount, auSizes[uFaceCount * 2], auSizes[uFaceCount * 2 + 1]));
+		uTotal += auSizes[uFaceCount * 2];
+		uTotalUV += auSizes[uFaceCount * 2 + 1];
+	}
+
+	size_t uOffset = auTriangleWithPoint_Normals_Indices.size();
+	size_t uOffsetUV = auTriangleWithPoint_Normals_UV_Indices.size();
+	auTriangleWithPoint_Normals_Indices.resize(uOffset + uTotal);
+	auTriangleWithPoint_Normals_UV_Indices.resize(uOffsetUV + uTotalUV);
+	if (pauFaceOffsets)
+		pauFaceOffsets->resize(uFaceSize * 2);
+
+	for (uFaceCount = 0; uFaceCount < uFaceSize; uFaceCount++)
+	{
+		if (pauFaceOffsets)
+		{
+			(*pauFaceOffsets)[uFaceCount * 2] = (unsigned)uOffset;
+			(*pauFaceOffsets)[uFaceCount * 2 + 1] = (unsigned)uOffsetUV;
+		}
+
+		CHECK_RET(IndicesPerFaceAsTriangleFill(uFaceCount,
+					auTriangleWithPoint_Normals_Indices.data() + uOffset,
+					auTriangleWithPoint_Normals_UV_Indices.data() + uOffsetUV));
+		uOffset += auSizes[uFaceCount * 2];
+		uOffsetUV += auSizes[uFaceCount * 2 + 1];
+	}
+	return A3D_SUCCESS;
+}
+
 A3DStatus A3DTessDataConnector::IndicesPerFace(
 					const unsigned& uFaceIndice,
 					std::vector<unsigned>& /*auTrianglesOneNormal*/,			//(normal, point, point,..., point)
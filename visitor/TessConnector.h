@@ -52,6 +52,25 @@ public :
 					std::vector<unsigned>& auTriangleWithPoint_Normals_Indices,
 					std::vector<unsigned>& auTriangleWithPoint_Normals_UV_Indices) const;
 
+	// Allocation free version of IndicesPerFaceAsTriangle: get the sizes first,
+	// then fill caller buffers of at least these sizes with the same indices
+	A3DStatus IndicesPerFaceAsTriangleSize(
+					const unsigned& uFaceIndice,
+					unsigned& uTriangleWithPoint_Normals_Size,
+					unsigned& uTriangleWithPoint_Normals_UV_Size) const;
+
+	A3DStatus IndicesPerFaceAsTriangleFill(
+					const unsigned& uFaceIndice,
+					unsigned* puTriangleWithPoint_Normals_Indices,
+					unsigned* puTriangleWithPoint_Normals_UV_Indices) const;
+
+	// Same as IndicesAsTriangle with one resize per array, pauFaceOffsets gets
+	// (offset, UV offset) of each face if not NULL
+	A3DStatus IndicesAsTriangleTwoPass(
+					std::vector<unsigned>& auTriangleWithPoint_Normals_Indices,
+					std::vector<unsigned>& auTriangleWithPoint_Normals_UV_Indices,
+					std::vector<unsigned>* pauFaceOffsets = NULL) const;
+
 	A3DStatus Indices(	
 					std::vector<unsigned>& auTrianglesOneNormal,			//(normal, point, point,..., point)
 					std::vector<unsigned>& auFanOneNormal,
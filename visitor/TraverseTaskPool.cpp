@@ -0,0 +1,133 @@
+#include "TraverseTaskPool.h"
+#include "../PerfTrace.h"
+
+// Queue of the worker running on this thread
+static thread_local const A3DTraverseTaskPool* s_pCurrentPool = NULL;
+static thread_local unsigned int s_uCurrentQueue = 0;
+
+A3DTraverseTaskPool::A3DTraverseTaskPool(unsigned int uThreadCnt)
+	: m_iQueuedCnt(0)
+	, m_bStop(false)
+{
+	if (0 == uThreadCnt)
+		uThreadCnt = 1;
+
+	for (unsigned int ui = 0; ui < uThreadCnt; ui++)
+		m_apQueue.push_back(std::unique_ptr<Queue>(new Queue));
+
+	for (unsigned int ui = 0; ui + 1 < uThreadCnt; ui++)
+		m_aThread.push_back(std::thread(&A3DTraverseTaskPool::workerLoop, this, ui));
+}
+
+A3DTraverseTaskPool::~A3DTraverseTaskPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bStop = true;
+	}
+	m_wakeCond.notify_all();
+
+	for (size_t i = 0; i < m_aThread.size(); i++)
+		m_aThread[i].join();
+}
+
+unsigned int A3DTraverseTaskPool::currentQueue() const
+{
+	if (this == s_pCurrentPool)
+		return s_uCurrentQueue;
+
+	return (unsigned int)m_apQueue.size() - 1;
+}
+
+void A3DTraverseTaskPool::Submit(A3DTraverseTaskGroup& sGroup, std::function<void()> fnTask)
+{
+	sGroup.m_iPendingCnt++;
+
+	Task sTask = { fnTask, &sGroup };
+	Queue& sQueue = *m_apQueue[currentQueue()];
+	{
+		std::lock_guard<std::mutex> lock(sQueue.mutex);
+		sQueue.tasks.push_back(sTask);
+	}
+	m_iQueuedCnt++;
+
+	// Take the lock so that a worker between its check and its wait can't miss the notification
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+	m_wakeCond.notify_one();
+}
+
+bool A3DTraverseTaskPool::popTask(unsigned int uQueue, Task& sTask)
+{
+	// Latest task of its own queue first: the deepest subtree, still hot in cache
+	{
+		Queue& sQueue = *m_apQueue[uQueue];
+		std::lock_guard<std::mutex> lock(sQueue.mutex);
+		if (sQueue.tasks.size())
+		{
+			sTask = sQueue.tasks.back();
+			sQueue.tasks.pop_back();
+			m_iQueuedCnt--;
+			return true;
+		}
+	}
+
+	// Steal the oldest task of another queue: the biggest subtree
+	size_t uQueueCnt = m_apQueue.size();
+	for (size_t i = 1; i < uQueueCnt; i++)
+	{
+		Queue& sQueue = *m_apQueue[(uQueue + i) % uQueueCnt];
+		std::lock_guard<std::mutex> lock(sQueue.mutex);
+		if (sQueue.tasks.size())
+		{
+			sTask = sQueue.tasks.front();
+			sQueue.tasks.pop_front();
+			m_iQueuedCnt--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void A3DTraverseTaskPool::runTask(Task& sTask)
+{
+	sTask.fnTask();
+	sTask.pGroup->m_iPendingCnt--;
+}
+
+void A3DTraverseTaskPool::Wait(A3DTraverseTaskGroup& sGroup)
+{
+	unsigned int uQueue = currentQueue();
+	while (0 < sGroup.m_iPendingCnt)
+	{
+		Task sTask;
+		if (popTask(uQueue, sTask))
+			runTask(sTask);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void A3DTraverseTaskPool::workerLoop(unsigned int uQueue)
+{
+	s_pCurrentPool = this;
+	s_uCurrentQueue = uQueue;
+	PerfTrace::SetThreadName("A3DTraverseTaskPool");
+
+	while (!m_bStop)
+	{
+		Task sTask;
+		if (popTask(uQueue, sTask))
+		{
+			runTask(sTask);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wakeCond.wait(lock, [this] { return m_bStop || 0 < m_iQueuedCnt; });
+	}
+
+	s_pCurrentPool = NULL;
+}
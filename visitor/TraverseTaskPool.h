@@ -0,0 +1,63 @@
+#ifndef A3D_TRAVERSE_TASK_POOL
+#define A3D_TRAVERSE_TASK_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks submitted together and waited together (fork-join)
+struct A3DTraverseTaskGroup
+{
+	std::atomic<int> m_iPendingCnt;
+
+	A3DTraverseTaskGroup() : m_iPendingCnt(0) {}
+};
+
+// Work-stealing pool used by the parallel traversal of the assembly tree.
+// Every worker pushes and pops the sub tasks it creates at the back of its own queue,
+// idle workers steal from the front of the other queues.
+// A thread waiting a group runs pending tasks instead of blocking, so nested fork-join doesn't dead lock.
+class A3DTraverseTaskPool
+{
+public:
+	// uThreadCnt includes the calling thread which helps while waiting
+	A3DTraverseTaskPool(unsigned int uThreadCnt);
+	~A3DTraverseTaskPool();
+
+	unsigned int ThreadCount() const { return (unsigned int)m_aThread.size() + 1; }
+
+	void Submit(A3DTraverseTaskGroup& sGroup, std::function<void()> fnTask);
+	void Wait(A3DTraverseTaskGroup& sGroup);
+
+private:
+	struct Task
+	{
+		std::function<void()> fnTask;
+		A3DTraverseTaskGroup* pGroup;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_apQueue;	// One per worker, the last one for the threads out of the pool
+	std::vector<std::thread> m_aThread;
+	std::atomic<int> m_iQueuedCnt;
+	std::atomic<bool> m_bStop;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCond;
+
+	unsigned int currentQueue() const;
+	bool popTask(unsigned int uQueue, Task& sTask);
+	void runTask(Task& sTask);
+	void workerLoop(unsigned int uQueue);
+};
+
+#endif
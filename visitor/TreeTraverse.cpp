@@ -21,6 +21,8 @@ This file contains fuctionalities to traverse a Prc Model Tree
 #include "VisitorContainer.h"
 #include "MarkupTraverse.h"
 #include "ViewTraverse.h"
+#include "TraverseTaskPool.h"
+#include "../PerfTrace.h"
 
 
 /************************************************************************************
@@ -32,10 +34,19 @@ Traverse Model File
 // Traverse all the model tree
 A3DStatus A3DModelFileConnector::Traverse(A3DVisitorContainer* psVisitor, bool bVisitPrototype)
 {
+	PERF_TRACE_SCOPE("visitor", "A3DModelFileConnector::Traverse");
+
 	unsigned int uI;
 	psVisitor->visitEnter(*this);
-	
-	for (uI = 0; uI < m_sModelFileData.m_uiPOccurrencesSize; uI++)
+
+	std::vector<A3DAsmProductOccurrence*> apRootPOs(m_sModelFileData.m_ppPOccurrences,
+		m_sModelFileData.m_ppPOccurrences + m_sModelFileData.m_uiPOccurrencesSize);
+	bool bTraversed = false;
+	if (A3DProductOccurrenceConnector::TraverseSonsInTasks(A3D_NULL_HANDLE, A3D_NULL_HANDLE, apRootPOs,
+		psVisitor, bVisitPrototype, bTraversed) != A3D_SUCCESS)
+		return A3D_ERROR;
+
+	for (uI = 0; !bTraversed && uI < m_sModelFileData.m_uiPOccurrencesSize; uI++)
 	{
 		psVisitor->SetCurrentPoFather(A3D_NULL_HANDLE);
 		A3DProductOccurrenceConnector sTreeConnector(m_sModelFileData.m_ppPOccurrences[uI]);
@@ -187,6 +198,14 @@ A3DStatus A3DProductOccurrenceConnector::TraversePO(const A3DAsmProductOccurrenc
 	A3DStatus iRet = A3D_SUCCESS;
 	CHECK_RET(psVisitor->visitEnter(*this));
 
+	// A visitor doesn't need the content of this PO
+	if (psVisitor->SkipSons())
+	{
+		psVisitor->SetSkipSons(false);
+		CHECK_RET(psVisitor->visitLeave(*this));
+		return A3D_SUCCESS;
+	}
+
 	//Traverse AnnotationEntity
 	A3DUns32 uI;
 #ifdef CONNECT_PMI
@@ -297,14 +316,14 @@ A3DStatus A3DProductOccurrenceConnector::TraversePO(const A3DAsmProductOccurrenc
 	}
 	if(pPart)
 	{
-		void * pEntityInMap = psVisitor->FindInMap(pPart);
-		psVisitor->SetInMap( pPart, pPart);
+		// The map can be shared between tasks, search and set in one step
+		bool bFirstInstance = psVisitor->InsertInMap(pPart, pPart);
 		A3DPartConnector sPartConnector(pPart);
 		psVisitor->SetCurrentPoFather(pOccurrence);
 		sPartConnector.SetProductOccurrenceFather(pOccurrence);
 
 		// if we haven't found the part in the map or if we traverse the instance
-		if(pEntityInMap==A3D_NULL_HANDLE || psVisitor->TraverseInstances())
+		if(bFirstInstance || psVisitor->TraverseInstances())
 		{
 			CHECK_RET(sPartConnector.TraversePart(psVisitor));
 		}
@@ -319,9 +338,8 @@ A3DStatus A3DProductOccurrenceConnector::TraversePO(const A3DAsmProductOccurrenc
 	{
 		if(m_sProductOccurrenceData.m_pPrototype)
 		{
-			if(psVisitor->FindInMap(m_sProductOccurrenceData.m_pPrototype) == A3D_NULL_HANDLE)
+			if(psVisitor->InsertInMap(m_sProductOccurrenceData.m_pPrototype, m_sProductOccurrenceData.m_pPrototype))
 			{
-				psVisitor->SetInMap(m_sProductOccurrenceData.m_pPrototype, m_sProductOccurrenceData.m_pPrototype);	
 				A3DProductOccurrenceConnector sPrototypeConnector(m_sProductOccurrenceData.m_pPrototype);
 				sPrototypeConnector.SetPrototypeType(true);
 				sPrototypeConnector.TraversePO(m_sProductOccurrenceData.m_pPrototype, psVisitor, bVisitPrototype);
@@ -329,9 +347,8 @@ A3DStatus A3DProductOccurrenceConnector::TraversePO(const A3DAsmProductOccurrenc
 		}
 		if(m_sProductOccurrenceData.m_pExternalData)
 		{
-			if(psVisitor->FindInMap(m_sProductOccurrenceData.m_pExternalData) == A3D_NULL_HANDLE)
+			if(psVisitor->InsertInMap(m_sProductOccurrenceData.m_pExternalData, m_sProductOccurrenceData.m_pExternalData))
 			{
-				psVisitor->SetInMap(m_sProductOccurrenceData.m_pExternalData, m_sProductOccurrenceData.m_pExternalData);	
 				A3DProductOccurrenceConnector sExternalConnector(m_sProductOccurrenceData.m_pExternalData);
 				sExternalConnector.SetExternalType(true);
 				sExternalConnector.TraversePO(m_sProductOccurrenceData.m_pExternalData, psVisitor, bVisitPrototype);
@@ -347,7 +364,10 @@ A3DStatus A3DProductOccurrenceConnector::TraversePO(const A3DAsmProductOccurrenc
 		}
 	}
 
-	for (uI = 0; uI < apSons.size(); uI++)
+	bool bTraversed = false;
+	CHECK_RET(TraverseSonsInTasks(this->GetA3DEntity(), pOccurrence, apSons, psVisitor, bVisitPrototype, bTraversed));
+
+	for (uI = 0; !bTraversed && uI < apSons.size(); uI++)
 	{
 		A3DProductOccurrenceConnector sPoConnector(apSons[uI]);
 		sPoConnector.SetProductOccurrenceFather(this->GetA3DEntity());
@@ -360,6 +380,76 @@ A3DStatus A3DProductOccurrenceConnector::TraversePO(const A3DAsmProductOccurrenc
 	return A3D_SUCCESS;
 }
 
+A3DStatus A3DProductOccurrenceConnector::TraverseSonsInTasks(const A3DAsmProductOccurrence* pFather,
+																const A3DAsmProductOccurrence* pCurrentPOFather,
+																const std::vector<A3DAsmProductOccurrence*>& apSons,
+																A3DVisitorContainer* psVisitor,
+																bool bVisitPrototype,
+																bool& bTraversed)
+{
+	bTraversed = false;
+
+	// Without the instances, a shared part is visited by its first occurrence in the tree order: serial
+	A3DTraverseTaskPool* pTaskPool = psVisitor->GetTaskPool();
+	if (!pTaskPool || apSons.size() < 2 || !psVisitor->TraverseInstances())
+		return A3D_SUCCESS;
+
+	// One copy of the container per son, with the state of this level
+	size_t uI;
+	std::vector<A3DVisitorContainer*> apTaskContainer;
+	psVisitor->SetCurrentPoFather(pCurrentPOFather);
+	for (uI = 0; uI < apSons.size(); uI++)
+	{
+		A3DVisitorContainer* psTaskContainer = psVisitor->CreateTaskContainer();
+		if (!psTaskContainer)
+			break;
+		apTaskContainer.push_back(psTaskContainer);
+	}
+	psVisitor->SetCurrentPoFather(A3D_NULL_HANDLE);
+
+	if (apTaskContainer.size() < apSons.size())
+	{
+		for (uI = 0; uI < apTaskContainer.size(); uI++)
+			delete apTaskContainer[uI];
+		return A3D_SUCCESS;
+	}
+
+	bTraversed = true;
+
+	std::vector<A3DStatus> aiTaskRet(apSons.size(), A3D_SUCCESS);
+	A3DTraverseTaskGroup sTaskGroup;
+	for (uI = 0; uI < apSons.size(); uI++)
+	{
+		A3DAsmProductOccurrence* pSon = apSons[uI];
+		A3DVisitorContainer* psTaskContainer = apTaskContainer[uI];
+		A3DStatus* piTaskRet = &aiTaskRet[uI];
+		pTaskPool->Submit(sTaskGroup, [=]()
+		{
+			PERF_TRACE_SCOPE("visitor", "TraversePO task");
+			A3DProductOccurrenceConnector sPoConnector(pSon);
+			sPoConnector.SetProductOccurrenceFather(pFather);
+			*piTaskRet = sPoConnector.TraversePO(pSon, psTaskContainer, bVisitPrototype);
+		});
+	}
+	{
+		PERF_TRACE_SCOPE("visitor", "TraverseSonsInTasks wait");
+		pTaskPool->Wait(sTaskGroup);
+	}
+
+	// Merge in the order of the sons so the result doesn't depend on the scheduling
+	A3DStatus iRet = A3D_SUCCESS;
+	for (uI = 0; uI < apSons.size(); uI++)
+	{
+		if (A3D_SUCCESS == iRet)
+			iRet = aiTaskRet[uI];
+		if (A3D_SUCCESS == iRet)
+			iRet = psVisitor->MergeTaskContainer(*apTaskContainer[uI]);
+		delete apTaskContainer[uI];
+	}
+
+	return iRet;
+}
+
 A3DStatus A3DProductOccurrenceConnector::CollectSons(
 	std::vector<A3DAsmProductOccurrence*>& apSons) const 
 {
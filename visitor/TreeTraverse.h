@@ -56,6 +56,14 @@ private :
 
 	void SetProductOccurrenceFather(const A3DAsmProductOccurrence* pFather)	{ m_pFather = pFather; }
 
+	// Traverse the sons as tasks of the pool of the container, bTraversed is false if it can't be done in parallel
+	static A3DStatus TraverseSonsInTasks(const A3DAsmProductOccurrence* pFather,
+										const A3DAsmProductOccurrence* pCurrentPOFather,
+										const std::vector<A3DAsmProductOccurrence*>& apSons,
+										A3DVisitorContainer* psVisitor,
+										bool bVisitPrototype,
+										bool& bTraversed);
+
 public :
 	A3DStatus GetPart(A3DAsmPartDefinition*& pPart) const;
 	A3DStatus CollectSons(std::vector<A3DAsmProductOccurrence*>& apSons) const;
@@ -14,6 +14,7 @@
 #include "Visitors.h"
 #include "BrepTraverse.h"
 #include <map>
+#include <typeinfo>
 
 class A3DVisitorBrep  : public A3DVisitor
 {
@@ -25,6 +26,24 @@ public:
 	
 	A3DVisitorBrep(A3DVisitorContainer* psContainer = NULL) : A3DVisitor("Brep", psContainer) { m_dScale = 1.0;}
 
+	virtual A3DVisitor* Clone(A3DVisitorContainer* psContainer) const
+	{
+		// An inherited visitor has to clone its own members
+		if (typeid(*this) != typeid(A3DVisitorBrep))
+			return NULL;
+
+		A3DVisitorBrep* psClone = new A3DVisitorBrep(psContainer);
+		psClone->m_dScale = m_dScale;
+		return psClone;
+	}
+
+	virtual A3DStatus Merge(A3DVisitor& sClone)
+	{
+		std::map<A3DTopoEdge*,const A3DTopoCoEdge*>& rCloneMap = ((A3DVisitorBrep&)sClone).m_MapEdgeCoEdge;
+		m_MapEdgeCoEdge.insert(rCloneMap.begin(), rCloneMap.end());
+		return A3D_SUCCESS;
+	}
+
 	virtual A3DStatus visitEnter(const A3DRiConnector&) { return A3D_SUCCESS; }
 	virtual A3DStatus visitLeave(const A3DRiConnector&) { return A3D_SUCCESS; }
 	
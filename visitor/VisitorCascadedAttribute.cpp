@@ -12,16 +12,18 @@
 #include "VisitorCascadedAttribute.h"
 #include "CascadedAttributeConnector.h"
 #include "VisitorTree.h"
+#include <typeinfo>
 
 A3DVisitorColorMaterials::A3DVisitorColorMaterials(A3DVisitorContainer* psContainer)
 :	A3DVisitor("CascadedAttribute", psContainer),
+	m_uInheritedSize(0),
 	m_pCurrentRi(A3D_NULL_HANDLE)
 {
 }
 
 A3DVisitorColorMaterials::~A3DVisitorColorMaterials()
 {
-	std::vector<A3DMiscCascadedAttributes*>::iterator itCur = m_apsCascadedAttribute.begin();
+	std::vector<A3DMiscCascadedAttributes*>::iterator itCur = m_apsCascadedAttribute.begin() + m_uInheritedSize;
 	std::vector<A3DMiscCascadedAttributes*>::iterator itEnd = m_apsCascadedAttribute.end();
 	for(; itCur < itEnd; ++itCur)
 	{
@@ -29,6 +31,20 @@ A3DVisitorColorMaterials::~A3DVisitorColorMaterials()
 	}
 }
 
+A3DVisitor* A3DVisitorColorMaterials::Clone(A3DVisitorContainer* psContainer) const
+{
+	// An inherited visitor has to clone its own members
+	if (typeid(*this) != typeid(A3DVisitorColorMaterials))
+		return NULL;
+
+	// The father stack is shared read only: the father waits the end of the task before popping it
+	A3DVisitorColorMaterials* psClone = new A3DVisitorColorMaterials(psContainer);
+	psClone->m_apsCascadedAttribute = m_apsCascadedAttribute;
+	psClone->m_uInheritedSize = m_apsCascadedAttribute.size();
+	psClone->m_pCurrentRi = m_pCurrentRi;
+	return psClone;
+}
+
 A3DStatus A3DVisitorColorMaterials::pushCascadedAttribute(const A3DConnector& sEntity)
 {
 	unsigned int uSize = (unsigned int)m_apsCascadedAttribute.size();
@@ -52,7 +68,7 @@ A3DStatus A3DVisitorColorMaterials::pushCascadedAttribute(const A3DConnector& sE
 
 A3DStatus A3DVisitorColorMaterials::popCascadedAttribute(/*const A3DConnector& sEntity*/)
 {
-	if(m_apsCascadedAttribute.size() > 0)
+	if(m_apsCascadedAttribute.size() > m_uInheritedSize)
 	{
     	A3DEntityDelete(m_apsCascadedAttribute[m_apsCascadedAttribute.size() - 1]);
 		m_apsCascadedAttribute.pop_back();
@@ -30,6 +30,7 @@ class A3DVisitorColorMaterials : public A3DVisitor
 
 	//friend class A3DVisitorContainer;
 	std::vector<A3DMiscCascadedAttributes*> m_apsCascadedAttribute;
+	size_t m_uInheritedSize;	// Attributes owned by the father container of a task clone
 	A3DRiRepresentationItem* m_pCurrentRi; //needed for FaceTessDataConnector
 
 #ifdef _MSC_VER
@@ -41,6 +42,8 @@ public:
 	A3DVisitorColorMaterials(A3DVisitorContainer* psContainer = NULL);
 
 	virtual ~A3DVisitorColorMaterials();
+
+	virtual A3DVisitor* Clone(A3DVisitorContainer* psContainer) const;
 	
 	virtual A3DStatus pushCascadedAttribute(const A3DConnector& sEntity);
 	virtual A3DStatus visitEnter(const A3DProductOccurrenceConnector& sEntity);
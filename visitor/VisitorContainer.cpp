@@ -33,10 +33,12 @@
 #ifdef CONNECT_PMI
 #include "ViewTraverse.h"
 #endif
+#include "TraverseTaskPool.h"
 
 #include <map>
 #include <algorithm>
 #include <iostream>
+#include <thread>
 
 using namespace std;
 
@@ -310,7 +312,9 @@ A3DVisitorContainer::A3DVisitorContainer(unsigned int uFlagElementToconnect)
 	m_bTraverseActivatedViewOnly(true),
 	m_uiCurrentLevel(0),
 	m_uFlagElementToConnect(uFlagElementToconnect),
-	m_bTraverseInstance(false)
+	m_bTraverseInstance(false),
+	m_bSkipSons(false),
+	m_pMapOwner(this)
 {
 #ifdef CONNECT_TRANSFO
 	if(uFlagElementToconnect&CONNECT_TRANSFO)
@@ -480,21 +484,83 @@ A3DVisitorContainer::~A3DVisitorContainer()
 
 void* A3DVisitorContainer::FindInMap(const A3DEntity* pA3DEntity)
 {
+	lock_guard<mutex> lock(m_pMapOwner->m_mapMutex);
+	map<const A3DEntity*, void*>& rMap = m_pMapOwner->m_apA3DEntityYourEntityMap;
 	map<const A3DEntity*, void*>::iterator my_mapIter;
-	my_mapIter = m_apA3DEntityYourEntityMap.find(pA3DEntity);
-	if(my_mapIter == m_apA3DEntityYourEntityMap.end())
+	my_mapIter = rMap.find(pA3DEntity);
+	if(my_mapIter == rMap.end())
 		return A3D_NULL_HANDLE;
 	return my_mapIter->second;
 }
 
 void A3DVisitorContainer::SetInMap(const A3DEntity* pA3DEntity, void* pYourEntity)
 {
-	m_apA3DEntityYourEntityMap.emplace(pA3DEntity, pYourEntity);
+	lock_guard<mutex> lock(m_pMapOwner->m_mapMutex);
+	m_pMapOwner->m_apA3DEntityYourEntityMap.emplace(pA3DEntity, pYourEntity);
 }
 
 void A3DVisitorContainer::RemoveFromMap(const A3DEntity* pA3DEntity)
 {
-	m_apA3DEntityYourEntityMap.erase(pA3DEntity);
+	lock_guard<mutex> lock(m_pMapOwner->m_mapMutex);
+	m_pMapOwner->m_apA3DEntityYourEntityMap.erase(pA3DEntity);
+}
+
+bool A3DVisitorContainer::InsertInMap(const A3DEntity* pA3DEntity, void* pYourEntity)
+{
+	lock_guard<mutex> lock(m_pMapOwner->m_mapMutex);
+	return m_pMapOwner->m_apA3DEntityYourEntityMap.emplace(pA3DEntity, pYourEntity).second;
+}
+
+void A3DVisitorContainer::SetParallelTraverse(unsigned int uThreadCnt)
+{
+	if (0 == uThreadCnt)
+		uThreadCnt = std::thread::hardware_concurrency();
+
+	if (uThreadCnt < 2)
+		m_pTaskPool.reset();
+	else if (!m_pTaskPool || m_pTaskPool->ThreadCount() != uThreadCnt)
+		m_pTaskPool.reset(new A3DTraverseTaskPool(uThreadCnt));
+}
+
+A3DVisitorContainer* A3DVisitorContainer::CreateTaskContainer() const
+{
+	// No default visitor, they are cloned from this container
+	A3DVisitorContainer* psTaskContainer = new A3DVisitorContainer(0);
+	psTaskContainer->m_uFlagElementToConnect = m_uFlagElementToConnect;
+	psTaskContainer->m_bTraverseInstance = m_bTraverseInstance;
+	psTaskContainer->m_pCurrentPOFather = m_pCurrentPOFather;
+	psTaskContainer->m_psActivatedView = m_psActivatedView;
+	psTaskContainer->m_bTraverseActivatedViewOnly = m_bTraverseActivatedViewOnly;
+	psTaskContainer->m_asStepEntityRefManager = m_asStepEntityRefManager;
+	psTaskContainer->m_asViewLinkedItemManager = m_asViewLinkedItemManager;
+	psTaskContainer->m_uiCurrentLevel = m_uiCurrentLevel;
+	psTaskContainer->m_pMapOwner = m_pMapOwner;
+	psTaskContainer->m_pTaskPool = m_pTaskPool;
+
+	for (size_t uI = 0; uI < m_apVisitor.size(); uI++)
+	{
+		A3DVisitor* psClone = m_apVisitor[uI]->Clone(psTaskContainer);
+		if (!psClone)
+		{
+			delete psTaskContainer;
+			return NULL;
+		}
+		psTaskContainer->push(psClone);
+	}
+
+	return psTaskContainer;
+}
+
+A3DStatus A3DVisitorContainer::MergeTaskContainer(A3DVisitorContainer& sTaskContainer)
+{
+	A3DStatus iRet = A3D_SUCCESS;
+	if (sTaskContainer.m_apVisitor.size() != m_apVisitor.size())
+		return A3D_ERROR;
+
+	for (size_t uI = 0; uI < m_apVisitor.size(); uI++)
+		CHECK_RET(m_apVisitor[uI]->Merge(*sTaskContainer.m_apVisitor[uI]));
+
+	return A3D_SUCCESS;
 }
 
 A3DVisitor* A3DVisitorContainer::GetVisitorByName( std::string strName )
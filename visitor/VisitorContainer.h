@@ -12,8 +12,12 @@
 #ifndef A3DVISITOR_CONTAINER
 #define A3DVISITOR_CONTAINER
 #include <map>
+#include <memory>
+#include <mutex>
 #include "Visitors.h"
 
+class A3DTraverseTaskPool;
+
 //This class allow to use several vistor when traversing 3DX Tree.
 //It allow also to exchange parameters between visitors
 
@@ -70,8 +74,12 @@ class A3DVisitorContainer  : public A3DVisitor
 #endif // _MSC_VER
 
 	std::map<const A3DEntity*, void*>	m_apA3DEntityYourEntityMap;
+	A3DVisitorContainer*				m_pMapOwner;	// Task containers share the map of the root container
+	std::mutex							m_mapMutex;
+	std::shared_ptr<A3DTraverseTaskPool>	m_pTaskPool;
 	std::vector<A3DVisitor*>			m_apVisitor;
 	bool m_bTraverseInstance;
+	bool m_bSkipSons;
 
 	A3DVisitor*							m_pTreeVisitor;
 	A3DAsmProductOccurrence const *		m_pCurrentPOFather;
@@ -206,6 +214,8 @@ public:
 	void* FindInMap(const A3DEntity* pA3DEntity);
 	void SetInMap(const A3DEntity* pA3DEntity, void* pYourEntity);
 	void RemoveFromMap(const A3DEntity* pA3DEntity);
+	// Set the entity in the map if it isn't yet, returns true if it was set by this call
+	bool InsertInMap(const A3DEntity* pA3DEntity, void* pYourEntity);
 
 	std::vector<A3DVisitor*>& GetVisitor() { return m_apVisitor; }
 
@@ -213,6 +223,20 @@ public:
 	bool TraverseInstances() { return m_bTraverseInstance; }
 	void SetTraverseInstance(bool bTraverseInstance) { m_bTraverseInstance = bTraverseInstance; }
 
+	// Set by a visitor in visitEnter(A3DProductOccurrenceConnector) to not traverse the part and sons of this PO
+	bool SkipSons() { return m_bSkipSons; }
+	void SetSkipSons(bool bSkipSons) { m_bSkipSons = bSkipSons; }
+
+	// Traverse the product occurrence subtrees in parallel with uThreadCnt threads (0: number of cores, 1: serial, default).
+	// Each subtree task gets a copy of the container and of the visitors made by A3DVisitor::Clone, merged back
+	// in the order of the sons before the visitLeave of the father. If a visitor can't be cloned, it stays serial.
+	// With SetTraverseInstance(false) the traversal stays serial, the first occurrence of a shared part visits it.
+	void SetParallelTraverse(unsigned int uThreadCnt);
+	A3DTraverseTaskPool* GetTaskPool() const { return m_pTaskPool.get(); }
+
+	A3DVisitorContainer* CreateTaskContainer() const;
+	A3DStatus MergeTaskContainer(A3DVisitorContainer& sTaskContainer);
+
 	A3DVisitor* GetVisitorByName(std::string strName);
 	A3DVisitor* GetTreeVisitor() const;
 
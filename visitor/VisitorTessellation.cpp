@@ -13,6 +13,19 @@
 #include "TessConnector.h"
 #include "VisitorTessellation.h"
 #include "TessConnector.h"
+#include <typeinfo>
+
+A3DVisitor* A3DVisitorTessellation::Clone(A3DVisitorContainer* psContainer) const
+{
+	// An inherited visitor has to clone its own members
+	if (typeid(*this) != typeid(A3DVisitorTessellation))
+		return NULL;
+
+	A3DVisitorTessellation* psClone = new A3DVisitorTessellation(psContainer);
+	psClone->m_bShow = m_bShow;
+	psClone->m_uCurrentFaceIndice = m_uCurrentFaceIndice;
+	return psClone;
+}
 
 
 A3DStatus A3DVisitorTessellation::visitEnter(const A3DTessDataConnector& sTessConnector)
@@ -27,13 +40,18 @@ A3DStatus A3DVisitorTessellation::visitEnter(const A3DTessDataConnector& sTessCo
 	CHECK_RET(sTessConnector.UV(pdUV, uUVSize));
 	uFaceSize = sTessConnector.FacesSize();
 	unsigned int uIFaceCount;
+	// Buffers are reused for all the faces, they only grow to the largest face
+	std::vector<unsigned> auTriangleWithPointNormalInidces;
+	std::vector<unsigned> auTrinagleWithPointNromalUVindices;
 	for(uIFaceCount = 0; uIFaceCount<uFaceSize; uIFaceCount++)
 	{
-		std::vector<unsigned> auTriangleWithPointNormalInidces;
-		std::vector<unsigned> auTrinagleWithPointNromalUVindices;
-		CHECK_RET(sTessConnector.IndicesPerFaceAsTriangle(uIFaceCount,
-			auTriangleWithPointNormalInidces,
-			auTrinagleWithPointNromalUVindices));
+		unsigned uIndiceSize, uUVIndiceSize;
+		CHECK_RET(sTessConnector.IndicesPerFaceAsTriangleSize(uIFaceCount, uIndiceSize, uUVIndiceSize));
+		auTriangleWithPointNormalInidces.resize(uIndiceSize);
+		auTrinagleWithPointNromalUVindices.resize(uUVIndiceSize);
+		CHECK_RET(sTessConnector.IndicesPerFaceAsTriangleFill(uIFaceCount,
+			auTriangleWithPointNormalInidces.data(),
+			auTrinagleWithPointNromalUVindices.data()));
 
 		/****************************************************************************
 		Please create Your mesh here
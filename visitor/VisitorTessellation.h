@@ -26,6 +26,8 @@ public:
 	A3DVisitorTessellation(A3DVisitorContainer* psContainer = NULL) : A3DVisitor("Tessellation", psContainer) {};
 	virtual ~A3DVisitorTessellation() {}
 
+	virtual A3DVisitor* Clone(A3DVisitorContainer* psContainer) const;
+
 	virtual A3DStatus visitEnter(const A3DFaceTessDataConnector& sConnector);
 	virtual A3DStatus visitLeave(const A3DFaceTessDataConnector& sConnector);
 
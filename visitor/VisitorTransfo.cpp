@@ -14,6 +14,7 @@
 #include "TreeTraverse.h"
 #include "Matrix.h"
 #include "VisitorTree.h"
+#include <typeinfo>
 
 A3DVisitorTransfo::A3DVisitorTransfo(	bool bModelFileUnitFormCAD,
 													double dUnitModelFile,
@@ -35,6 +36,19 @@ A3DVisitorTransfo::~A3DVisitorTransfo()
 {
 }
 
+A3DVisitor* A3DVisitorTransfo::Clone(A3DVisitorContainer* psContainer) const
+{
+	// An inherited visitor has to clone its own members
+	if (typeid(*this) != typeid(A3DVisitorTransfo))
+		return NULL;
+
+	// The task continues from the current matrix stack
+	A3DVisitorTransfo* psClone = new A3DVisitorTransfo(m_bUnitFormCad, m_dUnit, psContainer);
+	psClone->m_adPushTransfo = m_adPushTransfo;
+	psClone->m_adLocalMatrix = m_adLocalMatrix;
+	return psClone;
+}
+
 A3DTransfoConnector* A3DVisitorTransfo::GetTransfoConnectorFromManager(A3DEntity const * pEntity)
 {
 	if(m_psContainer)
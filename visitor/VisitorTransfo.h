@@ -56,6 +56,8 @@ public:
 
 	virtual ~A3DVisitorTransfo();
 
+	virtual A3DVisitor* Clone(A3DVisitorContainer* psContainer) const;
+
 	virtual A3DStatus visitEnter(const A3DRiConnector& sConnector);
 	virtual A3DStatus visitLeave(const A3DRiConnector& sConnector);
 	virtual A3DStatus visitEnter(const A3DProductOccurrenceConnector& sConnector);
@@ -10,6 +10,19 @@
 ***********************************************************************************************************************/
 
 #include "VisitorTree.h"
+#include <typeinfo>
+
+A3DVisitor* A3DTreeVisitor::Clone(A3DVisitorContainer* psContainer) const
+{
+	// An inherited visitor has to clone its own members
+	if (typeid(*this) != typeid(A3DTreeVisitor))
+		return NULL;
+
+	A3DTreeVisitor* psClone = new A3DTreeVisitor(psContainer);
+	psClone->m_uOption = m_uOption;
+	psClone->m_pYourEntity = m_pYourEntity;
+	return psClone;
+}
 
 A3DStatus  A3DTreeVisitor::visitEnter(const A3DRiBrepModelConnector& /*sConnector*/)
 {
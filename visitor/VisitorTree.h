@@ -49,6 +49,8 @@ public:
 
 	virtual ~A3DTreeVisitor() {};
 
+	virtual A3DVisitor* Clone(A3DVisitorContainer* psContainer) const;
+
 	virtual A3DStatus visitEnter(const A3DRiBrepModelConnector& sConnector);
 	virtual A3DStatus visitLeave(const A3DRiBrepModelConnector& sConnector);
 
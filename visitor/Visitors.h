@@ -75,6 +75,12 @@ public :
 
 	virtual std::string GetName() const { return m_strName; }
 
+	// Parallel traversal: copy of the visitor with its current state to visit a subtree in a task.
+	// Returns NULL when the visitor can't be run in several tasks, the traversal stays serial then.
+	virtual A3DVisitor* Clone(A3DVisitorContainer* /*psContainer*/) const { return NULL; }
+	// Collect the result of a task clone, called in the order of the subtrees
+	virtual A3DStatus Merge(A3DVisitor& /*sClone*/) { return A3D_SUCCESS; }
+
 	//Assembly
 #ifdef CONNECT_ASSEMBLY_TREE
 	virtual A3DStatus visitEnter(const A3DModelFileConnector& /*sConnector*/) { return A3D_SUCCESS; }